@@ -0,0 +1,97 @@
+/**
+ * @file bench_american.cpp
+ * @author John Jacobson
+ * @brief Benchmarks for the American pricers: one expiry of a put chain
+ *        through each method, plus the lattice they replace.
+ */
+
+#include <cstdint>
+#include <vector>
+
+#include "american_options.h"
+#include "bench_harness.h"
+
+namespace {
+
+using qf::bench::State;
+using qf::bench::do_not_optimize;
+
+constexpr double kSpot = 100.0, kExpiry = 0.5, kRate = 0.05, kDiv = 0.02;
+
+struct Chain {
+    std::vector<double> S, K, T, r, q, sigma, price;
+};
+
+// One expiry with `n` strikes from 70 to 130 and a mild smile (or flat).
+Chain make_chain(std::size_t n, bool smile = true) {
+    Chain c;
+    for (std::size_t i = 0; i < n; ++i) {
+        double K = 70.0 + 60.0 * static_cast<double>(i) / static_cast<double>(n - 1);
+        double m = (K - kSpot) / kSpot;
+        c.S.push_back(kSpot);
+        c.K.push_back(K);
+        c.T.push_back(kExpiry);
+        c.r.push_back(kRate);
+        c.q.push_back(kDiv);
+        c.sigma.push_back(smile ? 0.22 + 0.2 * m * m - 0.05 * m : 0.22);
+    }
+    return c;
+}
+
+void chain_method(State& state, qf::AmericanMethod method, bool smile = true) {
+    Chain c = make_chain(100, smile);
+    std::vector<double> out(c.K.size());
+    state.set_items_per_iteration(c.K.size());
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t it = 0; it < iters; ++it) {
+            qf::american_price_batch(method, c.K.size(), false, c.S.data(), c.K.data(),
+                                     c.T.data(), c.r.data(), c.q.data(),
+                                     c.sigma.data(), out.data());
+            do_not_optimize(out.data());
+        }
+    });
+}
+
+void chain_baw(State& state) { chain_method(state, qf::AmericanMethod::BaroneAdesiWhaley); }
+void chain_qdplus(State& state) { chain_method(state, qf::AmericanMethod::QdPlus); }
+void chain_alo(State& state) { chain_method(state, qf::AmericanMethod::AndersenLake); }
+
+// Flat vol: every strike reuses one boundary solve.
+void chain_alo_flat(State& state) { chain_method(state, qf::AmericanMethod::AndersenLake, false); }
+
+// The reference the analytic methods replace.
+void binomial_1000(State& state) {
+    double S = kSpot, K = 105.0;
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i) {
+            do_not_optimize(S);
+            do_not_optimize(qf::american_binomial(false, S, K, kExpiry, kRate, kDiv, 0.22, 1000));
+        }
+    });
+}
+
+void chain_implied_vol_alo(State& state) {
+    Chain c = make_chain(20);
+    std::vector<double> price(c.K.size()), out(c.K.size());
+    qf::american_price_batch(qf::AmericanMethod::AndersenLake, c.K.size(), false, c.S.data(),
+                             c.K.data(), c.T.data(), c.r.data(), c.q.data(),
+                             c.sigma.data(), price.data());
+    state.set_items_per_iteration(c.K.size());
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t it = 0; it < iters; ++it) {
+            qf::implied_vol_american_batch(qf::AmericanMethod::AndersenLake, c.K.size(), false,
+                                           price.data(), c.S.data(), c.K.data(),
+                                           c.T.data(), c.r.data(), c.q.data(), out.data());
+            do_not_optimize(out.data());
+        }
+    });
+}
+
+} // namespace
+
+QF_BENCHMARK("american/chain_baw_100", "macro", chain_baw);
+QF_BENCHMARK("american/chain_qdplus_100", "macro", chain_qdplus);
+QF_BENCHMARK("american/chain_alo_100", "macro", chain_alo);
+QF_BENCHMARK("american/chain_alo_flat_100", "macro", chain_alo_flat);
+QF_BENCHMARK("american/binomial_1000", "micro", binomial_1000);
+QF_BENCHMARK("american/chain_implied_vol_alo_20", "macro", chain_implied_vol_alo);
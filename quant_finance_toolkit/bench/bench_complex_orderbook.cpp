@@ -0,0 +1,91 @@
+/**
+ * @file bench_complex_orderbook.cpp
+ * @author John Jacobson
+ * @brief Benchmarks for the complex (multi-leg) order book.
+ */
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "bench_harness.h"
+#include "complex_orderbook.h"
+
+namespace {
+
+using qf::bench::State;
+using qf::bench::do_not_optimize;
+using qf::OrderBook;
+using qf::Side;
+
+constexpr std::uint32_t kStrikes = 100;
+
+// 100 call and 100 put books quoted 0.10 wide, with every adjacent
+// vertical, every butterfly and every straddle defined (~300 strategies).
+struct Chain {
+    std::deque<OrderBook> books;
+    qf::ComplexOrderBook cx;
+    std::vector<std::uint32_t> verticals;
+
+    Chain() {
+        for (std::uint32_t k = 0; k < 2 * kStrikes; ++k) {
+            books.emplace_back();
+            const double mid = k < kStrikes ? 20.0 - 0.15 * k : 5.0 + 0.15 * (k - kStrikes);
+            books.back().add_limit_order(Side::Buy, mid - 0.05, 100);
+            books.back().add_limit_order(Side::Sell, mid + 0.05, 100);
+            cx.add_instrument(books.back());
+        }
+        for (std::uint32_t k = 0; k + 1 < kStrikes; ++k)
+            verticals.push_back(cx.define_strategy(qf::vertical_spread(k, k + 1)));
+        for (std::uint32_t k = 0; k + 2 < kStrikes; ++k)
+            cx.define_strategy(qf::butterfly(k, k + 1, k + 2));
+        for (std::uint32_t k = 0; k < kStrikes; ++k)
+            cx.define_strategy(qf::straddle(k, kStrikes + k));
+        std::vector<qf::ComplexExecution> out;
+        cx.refresh(out);
+    }
+};
+
+// A passive order improves one leg's bid and is cancelled again; each
+// change re-prices only the 3–4 strategies on that leg.
+void leg_update_refresh(State& state) {
+    Chain c;
+    std::vector<qf::ComplexExecution> out;
+    std::uint32_t leg = 0;
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i) {
+            OrderBook& b = c.books[leg];
+            auto id = b.add_limit_order(Side::Buy, *b.best_bid() + 0.01, 10).first;
+            c.cx.on_leg_update(leg);
+            c.cx.refresh(out);
+            b.cancel_order(id);
+            c.cx.on_leg_update(leg);
+            c.cx.refresh(out);
+            out.clear();
+            leg = (leg + 7) % (2 * kStrikes);
+        }
+        do_not_optimize(c.cx.evaluations());
+    });
+}
+
+// A vertical bought against the legs, after which the legs are
+// replenished at the same prices.
+void implied_fill(State& state) {
+    Chain c;
+    std::uint32_t k = 0;
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i) {
+            const std::uint32_t s = c.verticals[k];
+            auto ex = c.cx.add_order(s, Side::Buy, 1.0, 5);
+            do_not_optimize(ex);
+            c.books[k].add_limit_order(Side::Sell, *c.books[k].best_ask(), 5);
+            c.books[k + 1].add_limit_order(Side::Buy, *c.books[k + 1].best_bid(), 5);
+            k = (k + 1) % (kStrikes - 1);
+        }
+    });
+}
+
+} // namespace
+
+QF_BENCHMARK("complex_book/leg_update_refresh", "micro", leg_update_refresh);
+QF_BENCHMARK("complex_book/implied_fill_vertical", "micro", implied_fill);
@@ -0,0 +1,140 @@
+/**
+ * @file bench_covariance.cpp
+ * @author John Jacobson
+ * @brief Benchmarks for rolling / EWMA covariance and shrinkage on a
+ *        3,000-name universe with a one-year window.
+ */
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "bench_harness.h"
+#include "covariance.h"
+
+namespace {
+
+using qf::bench::State;
+using qf::bench::do_not_optimize;
+
+constexpr std::size_t kNames = 3000;
+constexpr std::size_t kWindow = 252;
+
+// Date-major one-factor returns: a market move plus idiosyncratic noise.
+std::vector<double> panel(std::size_t days, std::size_t n) {
+    std::vector<double> r(days * n);
+    std::mt19937_64 rng(23);
+    std::normal_distribution<double> z(0.0, 1.0);
+    for (std::size_t t = 0; t < days; ++t) {
+        const double m = 0.01 * z(rng);
+        for (std::size_t i = 0; i < n; ++i)
+            r[t * n + i] = (0.6 + 0.1 * static_cast<double>(i % 9)) * m + 0.015 * z(rng);
+    }
+    return r;
+}
+
+// Daily roll: one day enters and one leaves (a rank-2 update).
+void rolling_update(State& state) {
+    const std::vector<double> r = panel(2 * kWindow, kNames);
+    qf::RollingCovariance cov(kNames, kWindow);
+    cov.update(r.data(), kWindow);
+    std::size_t t = kWindow;
+    state.set_items_per_iteration(1);
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i) {
+            cov.update(r.data() + t * kNames);
+            t = t + 1 < 2 * kWindow ? t + 1 : kWindow;
+            do_not_optimize(cov.observations());
+        }
+    });
+}
+
+// Full recomputation from the window, the cost the rolling update avoids.
+void rebuild(State& state) {
+    const std::vector<double> r = panel(kWindow, kNames);
+    qf::RollingCovariance cov(kNames, kWindow);
+    cov.update(r.data(), kWindow);
+    state.set_items_per_iteration(1);
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i) {
+            cov.rebuild();
+            do_not_optimize(cov.observations());
+        }
+    });
+}
+
+void sample_covariance(State& state) {
+    const std::vector<double> r = panel(kWindow, kNames);
+    qf::RollingCovariance cov(kNames, kWindow);
+    cov.update(r.data(), kWindow);
+    qf::PackedSymmetric out;
+    state.set_items_per_iteration(1);
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i) {
+            cov.covariance(out);
+            do_not_optimize(out(1, 0));
+        }
+    });
+}
+
+void ledoit_wolf(State& state) {
+    const std::vector<double> r = panel(kWindow, kNames);
+    qf::RollingCovariance cov(kNames, kWindow);
+    cov.update(r.data(), kWindow);
+    qf::PackedSymmetric out;
+    state.set_items_per_iteration(1);
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i)
+            do_not_optimize(cov.ledoit_wolf(out));
+    });
+}
+
+void constant_correlation(State& state) {
+    const std::vector<double> r = panel(kWindow, kNames);
+    qf::RollingCovariance cov(kNames, kWindow);
+    cov.update(r.data(), kWindow);
+    qf::PackedSymmetric out;
+    state.set_items_per_iteration(1);
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i)
+            do_not_optimize(cov.constant_correlation(out));
+    });
+}
+
+void ewma_update(State& state) {
+    const std::vector<double> r = panel(64, kNames);
+    qf::EwmaCovariance cov(kNames, 0.94);
+    std::size_t t = 0;
+    state.set_items_per_iteration(1);
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i) {
+            cov.update(r.data() + t * kNames);
+            t = (t + 1) % 64;
+            do_not_optimize(cov.covariance()(1, 0));
+        }
+    });
+}
+
+// Rank-8 update of a 512-name packed matrix, per updated entry.
+void rank_update_kernel(State& state) {
+    constexpr std::size_t n = 512, k = 8;
+    const std::vector<double> r = panel(k, n);
+    qf::PackedSymmetric s(n);
+    state.set_items_per_iteration(s.size());
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i) {
+            qf::packed_rank_update(s, 0.5, r.data(), k, n);
+            do_not_optimize(s(1, 0));
+        }
+    });
+}
+
+} // namespace
+
+QF_BENCHMARK("covariance/rolling_update_3000x252", "macro", rolling_update);
+QF_BENCHMARK("covariance/rebuild_3000x252", "macro", rebuild);
+QF_BENCHMARK("covariance/sample_3000x252", "macro", sample_covariance);
+QF_BENCHMARK("covariance/ledoit_wolf_3000x252", "macro", ledoit_wolf);
+QF_BENCHMARK("covariance/constant_correlation_3000x252", "macro", constant_correlation);
+QF_BENCHMARK("covariance/ewma_update_3000", "macro", ewma_update);
+QF_BENCHMARK("covariance/rank8_update_512", "micro", rank_update_kernel);
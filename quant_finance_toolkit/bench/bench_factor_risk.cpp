@@ -0,0 +1,124 @@
+/**
+ * @file bench_factor_risk.cpp
+ * @author John Jacobson
+ * @brief Benchmarks for the factor risk model on a 3,000-name, 40-factor
+ *        universe: cross-sectional regressions, exposure refactorization
+ *        and portfolio risk decomposition.
+ */
+
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "bench_harness.h"
+#include "factor_risk_model.h"
+
+namespace {
+
+using qf::bench::State;
+using qf::bench::do_not_optimize;
+
+constexpr std::size_t kNames = 3000;
+constexpr std::size_t kFactors = 40;
+constexpr std::size_t kDays = 252;
+constexpr std::size_t kIndustries = 10;
+
+// Market, industry dummies and Gaussian styles, with √cap-like weights.
+struct Universe {
+    std::vector<double> exposures, weights, returns;
+
+    Universe() : exposures(kNames * kFactors, 0.0), weights(kNames), returns(kDays * kNames) {
+        std::mt19937_64 rng(41);
+        std::normal_distribution<double> z(0.0, 1.0);
+        std::uniform_real_distribution<double> u(0.5, 1.5);
+        for (std::size_t i = 0; i < kNames; ++i) {
+            double* x = exposures.data() + i * kFactors;
+            x[0] = 1.0;
+            x[1 + i % kIndustries] = 1.0;
+            for (std::size_t a = 1 + kIndustries; a < kFactors; ++a)
+                x[a] = z(rng);
+            weights[i] = u(rng);
+        }
+        std::vector<double> f(kFactors);
+        for (std::size_t t = 0; t < kDays; ++t) {
+            for (double& v : f)
+                v = 0.01 * z(rng);
+            for (std::size_t i = 0; i < kNames; ++i) {
+                const double* x = exposures.data() + i * kFactors;
+                double r = 0.02 * z(rng);
+                for (std::size_t a = 0; a < kFactors; ++a)
+                    r += x[a] * f[a];
+                // Roughly one name in fifty missing on a given day.
+                returns[t * kNames + i] = (i + 7 * t) % 50 == 0 ? NAN : r;
+            }
+        }
+    }
+};
+
+// A year of dates on one exposure snapshot, per date.
+void regress_year(State& state) {
+    const Universe u;
+    qf::FactorRiskModel model(kNames, kFactors);
+    const std::size_t id = model.add_exposures(u.exposures.data(), u.weights.data());
+    const std::vector<std::size_t> snapshot(kDays, id);
+    state.set_items_per_iteration(kDays);
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i) {
+            model.update(u.returns.data(), kDays, snapshot.data());
+            do_not_optimize(model.observations());
+        }
+    });
+}
+
+// The nightly step: one date in, covariance out for the optimizer.
+void daily_update(State& state) {
+    const Universe u;
+    qf::FactorRiskModel model(kNames, kFactors);
+    const std::size_t id = model.add_exposures(u.exposures.data(), u.weights.data());
+    std::size_t t = 0;
+    state.set_items_per_iteration(1);
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i) {
+            model.update(u.returns.data() + t * kNames, id);
+            t = (t + 1) % kDays;
+            do_not_optimize(model.observations());
+        }
+    });
+}
+
+// New exposures: Xᵀ V X and its Cholesky factor.
+void set_exposures(State& state) {
+    const Universe u;
+    qf::FactorRiskModel model(kNames, kFactors);
+    const std::size_t id = model.add_exposures(u.exposures.data(), u.weights.data());
+    state.set_items_per_iteration(1);
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i) {
+            model.set_exposures(id, u.exposures.data(), u.weights.data());
+            do_not_optimize(model.snapshots());
+        }
+    });
+}
+
+void decompose(State& state) {
+    const Universe u;
+    qf::FactorRiskModel model(kNames, kFactors);
+    const std::size_t id = model.add_exposures(u.exposures.data(), u.weights.data());
+    const std::vector<std::size_t> snapshot(kDays, id);
+    model.update(u.returns.data(), kDays, snapshot.data());
+    const qf::FactorCovariance cov = model.covariance();
+    const std::vector<double> w(kNames, 1.0 / static_cast<double>(kNames));
+    state.set_items_per_iteration(1);
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i)
+            do_not_optimize(qf::decompose_risk(cov, w.data()).variance);
+    });
+}
+
+} // namespace
+
+QF_BENCHMARK("factor_risk/regress_252x3000x40", "macro", regress_year);
+QF_BENCHMARK("factor_risk/daily_update_3000x40", "macro", daily_update);
+QF_BENCHMARK("factor_risk/set_exposures_3000x40", "macro", set_exposures);
+QF_BENCHMARK("factor_risk/decompose_3000x40", "micro", decompose);
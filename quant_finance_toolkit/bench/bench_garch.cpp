@@ -0,0 +1,104 @@
+/**
+ * @file bench_garch.cpp
+ * @author John Jacobson
+ * @brief Benchmarks for batch GARCH-family estimation, per series fitted
+ *        or per block likelihood pass.
+ */
+
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "bench_harness.h"
+#include "garch.h"
+
+namespace {
+
+using qf::bench::State;
+using qf::bench::do_not_optimize;
+
+constexpr std::size_t kDays = 2500;
+
+/**
+ * Date-major daily returns from GJR processes with persistence between
+ * 0.95 and 0.99 and 1–3% daily vol, so every model has something to fit.
+ * One extra leading day lets the warm-start benchmark roll the window.
+ */
+std::vector<double> panel(std::size_t n) {
+    std::vector<double> r((kDays + 1) * n);
+    std::mt19937_64 rng(17);
+    std::normal_distribution<double> z(0.0, 1.0);
+    for (std::size_t i = 0; i < n; ++i) {
+        const double vol = 0.01 + 0.02 * static_cast<double>(i % 11) / 10.0;
+        const double a = 0.02 + 0.03 * static_cast<double>(i % 3) / 2.0;
+        const double g = 0.06;
+        const double b = 0.92 + 0.02 * static_cast<double>(i % 5) / 4.0 - a;
+        const double w = vol * vol * (1.0 - a - 0.5 * g - b);
+        double h = vol * vol;
+        for (std::size_t t = 0; t < kDays + 1; ++t) {
+            const double e = std::sqrt(h) * z(rng);
+            r[t * n + i] = 0.0003 + e;
+            h = w + (a + (e < 0.0 ? g : 0.0)) * e * e + b * h;
+        }
+    }
+    return r;
+}
+
+void fit(State& state, qf::GarchModel model, std::size_t n) {
+    const std::vector<double> r = panel(n);
+    qf::GarchConfig cfg;
+    cfg.model = model;
+    state.set_items_per_iteration(n);
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i)
+            do_not_optimize(qf::fit_garch(r.data(), kDays, n, n, cfg).back().log_likelihood);
+    });
+}
+
+void fit_garch_256(State& state) { fit(state, qf::GarchModel::Garch, 256); }
+void fit_gjr_256(State& state) { fit(state, qf::GarchModel::Gjr, 256); }
+void fit_egarch_64(State& state) { fit(state, qf::GarchModel::Egarch, 64); }
+
+// Nightly refit: yesterday's parameters, window rolled forward one day.
+void warm_refit(State& state) {
+    constexpr std::size_t n = 256;
+    const std::vector<double> r = panel(n);
+    qf::GarchConfig cfg;
+    cfg.model = qf::GarchModel::Gjr;
+    const std::vector<qf::GarchFit> yesterday = qf::fit_garch(r.data(), kDays, n, n, cfg);
+    state.set_items_per_iteration(n);
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i)
+            do_not_optimize(
+                qf::fit_garch(r.data() + n, kDays, n, n, cfg, yesterday).back().log_likelihood);
+    });
+}
+
+// One likelihood-and-gradient pass over a block of kGarchLanes series.
+void likelihood_pass(State& state) {
+    constexpr std::size_t L = qf::kGarchLanes;
+    const std::vector<double> r = panel(L);
+    qf::detail::GarchBlock b;
+    b.pack(r.data(), kDays, L, 0, L, true);
+    double u[L][4], f[L], g[L][4];
+    for (std::size_t l = 0; l < L; ++l) {
+        const double th[4] = {0.05, 0.03, 0.06, 0.9};
+        qf::detail::garch_to_u(qf::GarchModel::Gjr, th, u[l]);
+    }
+    state.set_items_per_iteration(kDays * L);
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i) {
+            qf::detail::garch_eval_u(qf::GarchModel::Gjr, b, u, f, g, nullptr);
+            do_not_optimize(f[0]);
+        }
+    });
+}
+
+} // namespace
+
+QF_BENCHMARK("garch/fit_garch_256x2500", "macro", fit_garch_256);
+QF_BENCHMARK("garch/fit_gjr_256x2500", "macro", fit_gjr_256);
+QF_BENCHMARK("garch/fit_egarch_64x2500", "macro", fit_egarch_64);
+QF_BENCHMARK("garch/warm_refit_gjr_256x2500", "macro", warm_refit);
+QF_BENCHMARK("garch/likelihood_pass_gjr_8x2500", "micro", likelihood_pass);
@@ -0,0 +1,583 @@
+#ifndef QF_BENCH_HARNESS_H
+#define QF_BENCH_HARNESS_H
+
+/**
+ * @file bench_harness.h
+ * @author John Jacobson
+ * @brief Small benchmark harness used by the qf_bench executable.
+ *
+ * I wanted something that catches performance regressions in the toolkit
+ * without pulling in an external benchmark library. Each benchmark registers
+ * a function that does its own setup and then hands the timed region to
+ * State::run(). The harness:
+ *
+ *   - warms the code up for a fixed amount of time
+ *   - calibrates the iteration count so each sample is long enough to time
+ *   - collects several repetitions and reports median / MAD per item
+ *   - writes results as JSON and compares them against a stored baseline
+ *
+ * Medians and MAD (median absolute deviation) are used instead of mean and
+ * standard deviation because a single descheduled sample should not move the
+ * result.
+ *
+ * With Config::perf_counters set, hardware counters (perf_counters.h) are
+ * read across the timed repetitions and reported per item. When counters
+ * cannot be opened the benchmark still runs and just has none.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "perf_counters.h"
+
+namespace qf {
+namespace bench {
+
+// =======================
+// Optimizer barriers
+// =======================
+
+template <typename T>
+inline void do_not_optimize(T const& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+#endif
+}
+
+inline void clobber_memory() {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : : "memory");
+#endif
+}
+
+// =======================
+// Configuration and results
+// =======================
+
+struct Config {
+    int repetitions = 15;
+    double warmup_ms = 50.0;
+    double min_sample_ms = 10.0;
+    std::uint64_t max_iterations = 1ull << 30;
+    bool perf_counters = false;
+};
+
+struct Result {
+    std::string name;
+    std::string kind;                 // "micro" or "macro"
+    std::uint64_t items_per_iteration = 1;
+    std::uint64_t iterations = 0;     // iterations per sample
+    int repetitions = 0;
+    double median_ns = 0.0;           // per item
+    double mad_ns = 0.0;              // per item
+    double min_ns = 0.0;              // per item
+    double mean_ns = 0.0;             // per item
+
+    // Hardware counters per item (empty when disabled or unavailable).
+    std::vector<std::pair<std::string, double>> counters;
+
+    double counter(const std::string& key) const {
+        for (const auto& kv : counters)
+            if (kv.first == key) return kv.second;
+        return -1.0;
+    }
+};
+
+inline double median_of(std::vector<double> v) {
+    if (v.empty()) return 0.0;
+    std::sort(v.begin(), v.end());
+    std::size_t n = v.size();
+    return (n % 2 == 1) ? v[n / 2] : 0.5 * (v[n / 2 - 1] + v[n / 2]);
+}
+
+inline double mad_of(const std::vector<double>& v, double med) {
+    std::vector<double> dev;
+    dev.reserve(v.size());
+    for (double x : v)
+        dev.push_back(std::fabs(x - med));
+    return median_of(std::move(dev));
+}
+
+// =======================
+// Benchmark state
+// =======================
+
+class State {
+public:
+    State(const Config& cfg, Result& result, PerfCounters* counters = nullptr)
+        : cfg_(cfg), result_(result), counters_(counters) {}
+
+    /**
+     * @brief Number of logical items processed per call of the timed body
+     * (e.g. options in a chain). Reported times are divided by this.
+     */
+    void set_items_per_iteration(std::uint64_t n) {
+        result_.items_per_iteration = std::max<std::uint64_t>(n, 1);
+    }
+
+    /**
+     * @brief Time body(iters), which must run the measured operation
+     * `iters` times. Warm-up, calibration and repetitions happen here.
+     */
+    template <typename Body>
+    void run(Body&& body) {
+        using clock = std::chrono::steady_clock;
+
+        auto time_ns = [&](std::uint64_t iters) {
+            auto t0 = clock::now();
+            body(iters);
+            clobber_memory();
+            auto t1 = clock::now();
+            return static_cast<double>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+        };
+
+        // Warm-up: run until warmup_ms has elapsed, doubling the batch.
+        std::uint64_t iters = 1;
+        double elapsed = 0.0;
+        double last = 0.0;
+        while (elapsed < cfg_.warmup_ms * 1e6) {
+            last = time_ns(iters);
+            elapsed += last;
+            if (last < cfg_.min_sample_ms * 1e6 && iters < cfg_.max_iterations)
+                iters *= 2;
+        }
+
+        // Calibrate so that one sample lasts at least min_sample_ms.
+        double per_iter = std::max(last / static_cast<double>(iters), 1.0);
+        double target = cfg_.min_sample_ms * 1e6 / per_iter;
+        iters = static_cast<std::uint64_t>(std::ceil(target));
+        iters = std::min(std::max<std::uint64_t>(iters, 1), cfg_.max_iterations);
+
+        std::vector<double> samples;
+        samples.reserve(static_cast<std::size_t>(cfg_.repetitions));
+        double denom = static_cast<double>(iters) *
+                       static_cast<double>(result_.items_per_iteration);
+
+        bool counting = counters_ && counters_->available();
+        if (counting)
+            counters_->start();
+        for (int rep = 0; rep < cfg_.repetitions; ++rep)
+            samples.push_back(time_ns(iters) / denom);
+        if (counting) {
+            counters_->stop();
+            record_counters(counters_->read(), denom * cfg_.repetitions);
+        }
+
+        double med = median_of(samples);
+        double sum = 0.0;
+        for (double s : samples) sum += s;
+
+        result_.iterations = iters;
+        result_.repetitions = cfg_.repetitions;
+        result_.median_ns = med;
+        result_.mad_ns = mad_of(samples, med);
+        result_.min_ns = *std::min_element(samples.begin(), samples.end());
+        result_.mean_ns = sum / static_cast<double>(samples.size());
+        ran_ = true;
+    }
+
+    bool ran() const { return ran_; }
+
+private:
+    const Config& cfg_;
+    Result& result_;
+    PerfCounters* counters_;
+    bool ran_ = false;
+
+    void record_counters(const PerfSample& s, double items) {
+        result_.counters.clear();
+        for (std::size_t i = 0; i < kPerfEventCount; ++i) {
+            auto e = static_cast<PerfEvent>(i);
+            if (s.has(e))
+                result_.counters.emplace_back(perf_event_name(e), s.get(e) / items);
+        }
+        if (s.has(PerfEvent::Cycles) && s.has(PerfEvent::Instructions) &&
+            s.get(PerfEvent::Cycles) > 0.0)
+            result_.counters.emplace_back(
+                "ipc", s.get(PerfEvent::Instructions) / s.get(PerfEvent::Cycles));
+    }
+};
+
+// =======================
+// Registry
+// =======================
+
+struct Benchmark {
+    std::string name;
+    std::string kind;
+    std::function<void(State&)> fn;
+};
+
+inline std::vector<Benchmark>& registry() {
+    static std::vector<Benchmark> benchmarks;
+    return benchmarks;
+}
+
+struct Registrar {
+    Registrar(const char* name, const char* kind, void (*fn)(State&)) {
+        registry().push_back({name, kind, fn});
+    }
+};
+
+#define QF_BENCH_CONCAT_INNER(a, b) a##b
+#define QF_BENCH_CONCAT(a, b) QF_BENCH_CONCAT_INNER(a, b)
+
+/**
+ * Register a benchmark function `void fn(qf::bench::State&)` under `name`.
+ * `kind` is "micro" for single-call kernels and "macro" for workloads.
+ */
+#define QF_BENCHMARK(name, kind, fn)                                      \
+    static ::qf::bench::Registrar QF_BENCH_CONCAT(qf_bench_reg_, __LINE__)( \
+        name, kind, fn)
+
+// =======================
+// JSON output
+// =======================
+
+inline std::string json_escape(const std::string& s) {
+    std::string out;
+    out.reserve(s.size() + 2);
+    for (char c : s) {
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char buf[8];
+                std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                out += buf;
+            } else {
+                out += c;
+            }
+        }
+    }
+    return out;
+}
+
+inline void write_json(std::ostream& os, const std::vector<Result>& results,
+                       const Config& cfg) {
+    os << "{\n";
+    os << "  \"context\": {\n";
+    os << "    \"repetitions\": " << cfg.repetitions << ",\n";
+    os << "    \"min_sample_ms\": " << cfg.min_sample_ms << ",\n";
+#if defined(__clang__)
+    os << "    \"compiler\": \"clang " << __clang_major__ << "." << __clang_minor__ << "\",\n";
+#elif defined(__GNUC__)
+    os << "    \"compiler\": \"gcc " << __GNUC__ << "." << __GNUC_MINOR__ << "\",\n";
+#else
+    os << "    \"compiler\": \"unknown\",\n";
+#endif
+#ifdef NDEBUG
+    os << "    \"assertions\": false\n";
+#else
+    os << "    \"assertions\": true\n";
+#endif
+    os << "  },\n";
+    os << "  \"benchmarks\": [\n";
+    char buf[64];
+    auto num = [&](double v) {
+        std::snprintf(buf, sizeof(buf), "%.6g", v);
+        return std::string(buf);
+    };
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        os << "    {\"name\": \"" << json_escape(r.name) << "\""
+           << ", \"kind\": \"" << json_escape(r.kind) << "\""
+           << ", \"items_per_iteration\": " << r.items_per_iteration
+           << ", \"iterations\": " << r.iterations
+           << ", \"repetitions\": " << r.repetitions
+           << ", \"median_ns\": " << num(r.median_ns)
+           << ", \"mad_ns\": " << num(r.mad_ns)
+           << ", \"min_ns\": " << num(r.min_ns)
+           << ", \"mean_ns\": " << num(r.mean_ns);
+        if (!r.counters.empty()) {
+            os << ", \"counters\": {";
+            for (std::size_t k = 0; k < r.counters.size(); ++k)
+                os << (k ? ", " : "") << "\"" << r.counters[k].first
+                   << "\": " << num(r.counters[k].second);
+            os << "}";
+        }
+        os << "}"
+           << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    os << "  ]\n";
+    os << "}\n";
+}
+
+// =======================
+// Minimal JSON reader (baseline files)
+// =======================
+
+/**
+ * Just enough JSON to read back what write_json() produces (or a hand
+ * edited copy of it). Objects, arrays, strings, numbers, booleans and null.
+ */
+struct JsonValue {
+    enum class Type { Null, Bool, Number, String, Array, Object };
+
+    Type type = Type::Null;
+    bool boolean = false;
+    double number = 0.0;
+    std::string string;
+    std::vector<JsonValue> array;
+    std::map<std::string, JsonValue> object;
+
+    const JsonValue* find(const std::string& key) const {
+        if (type != Type::Object) return nullptr;
+        auto it = object.find(key);
+        return it == object.end() ? nullptr : &it->second;
+    }
+};
+
+class JsonParser {
+public:
+    explicit JsonParser(const std::string& text) : s_(text) {}
+
+    JsonValue parse() {
+        JsonValue v = value();
+        skip_ws();
+        if (pos_ != s_.size())
+            fail("trailing characters");
+        return v;
+    }
+
+private:
+    const std::string& s_;
+    std::size_t pos_ = 0;
+
+    [[noreturn]] void fail(const char* what) const {
+        throw std::runtime_error(std::string("json parse error: ") + what +
+                                 " at offset " + std::to_string(pos_));
+    }
+
+    void skip_ws() {
+        while (pos_ < s_.size() &&
+               (s_[pos_] == ' ' || s_[pos_] == '\n' || s_[pos_] == '\r' || s_[pos_] == '\t'))
+            ++pos_;
+    }
+
+    char peek() {
+        skip_ws();
+        if (pos_ >= s_.size()) fail("unexpected end of input");
+        return s_[pos_];
+    }
+
+    void expect(char c) {
+        if (peek() != c) fail("unexpected character");
+        ++pos_;
+    }
+
+    bool consume_literal(const char* lit) {
+        std::size_t n = std::char_traits<char>::length(lit);
+        if (s_.compare(pos_, n, lit) == 0) {
+            pos_ += n;
+            return true;
+        }
+        return false;
+    }
+
+    std::string string_literal() {
+        expect('"');
+        std::string out;
+        while (pos_ < s_.size() && s_[pos_] != '"') {
+            char c = s_[pos_++];
+            if (c == '\\') {
+                if (pos_ >= s_.size()) fail("bad escape");
+                char e = s_[pos_++];
+                switch (e) {
+                case 'n': out += '\n'; break;
+                case 't': out += '\t'; break;
+                case 'r': out += '\r'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'u':
+                    // Baseline names are ASCII; keep the escape verbatim.
+                    out += "\\u";
+                    break;
+                default: out += e;
+                }
+            } else {
+                out += c;
+            }
+        }
+        if (pos_ >= s_.size()) fail("unterminated string");
+        ++pos_;
+        return out;
+    }
+
+    JsonValue value() {
+        JsonValue v;
+        char c = peek();
+        if (c == '{') {
+            v.type = JsonValue::Type::Object;
+            ++pos_;
+            if (peek() == '}') { ++pos_; return v; }
+            while (true) {
+                std::string key = string_literal();
+                expect(':');
+                v.object[key] = value();
+                char d = peek();
+                ++pos_;
+                if (d == '}') break;
+                if (d != ',') fail("expected ',' or '}'");
+            }
+        } else if (c == '[') {
+            v.type = JsonValue::Type::Array;
+            ++pos_;
+            if (peek() == ']') { ++pos_; return v; }
+            while (true) {
+                v.array.push_back(value());
+                char d = peek();
+                ++pos_;
+                if (d == ']') break;
+                if (d != ',') fail("expected ',' or ']'");
+            }
+        } else if (c == '"') {
+            v.type = JsonValue::Type::String;
+            v.string = string_literal();
+        } else if (consume_literal("true")) {
+            v.type = JsonValue::Type::Bool;
+            v.boolean = true;
+        } else if (consume_literal("false")) {
+            v.type = JsonValue::Type::Bool;
+        } else if (consume_literal("null")) {
+            v.type = JsonValue::Type::Null;
+        } else {
+            const char* begin = s_.c_str() + pos_;
+            char* end = nullptr;
+            v.type = JsonValue::Type::Number;
+            v.number = std::strtod(begin, &end);
+            if (end == begin) fail("expected a value");
+            pos_ += static_cast<std::size_t>(end - begin);
+        }
+        return v;
+    }
+};
+
+inline std::vector<Result> load_results(const std::string& path) {
+    std::ifstream in(path);
+    if (!in)
+        throw std::runtime_error("cannot open baseline file: " + path);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    std::string text = ss.str();
+    JsonValue root = JsonParser(text).parse();
+
+    const JsonValue* list = root.find("benchmarks");
+    if (!list || list->type != JsonValue::Type::Array)
+        throw std::runtime_error("baseline file has no \"benchmarks\" array: " + path);
+
+    auto number = [](const JsonValue& obj, const char* key) {
+        const JsonValue* v = obj.find(key);
+        return (v && v->type == JsonValue::Type::Number) ? v->number : 0.0;
+    };
+
+    std::vector<Result> out;
+    for (const JsonValue& b : list->array) {
+        const JsonValue* name = b.find("name");
+        if (!name || name->type != JsonValue::Type::String)
+            continue;
+        Result r;
+        r.name = name->string;
+        if (const JsonValue* kind = b.find("kind"))
+            r.kind = kind->string;
+        r.median_ns = number(b, "median_ns");
+        r.mad_ns = number(b, "mad_ns");
+        r.min_ns = number(b, "min_ns");
+        r.mean_ns = number(b, "mean_ns");
+        out.push_back(r);
+    }
+    return out;
+}
+
+// =======================
+// Baseline comparison
+// =======================
+
+struct Comparison {
+    std::string name;
+    double baseline_ns = 0.0;
+    double current_ns = 0.0;
+    double change = 0.0;   // relative change of the median
+    std::string status;    // OK, REGRESSED, IMPROVED, NEW, MISSING
+};
+
+/**
+ * @brief Compare current results against a baseline.
+ *
+ * A benchmark regresses when its median is more than `threshold` (relative)
+ * slower than the baseline AND the difference is larger than `noise_mads`
+ * times the larger of the two MADs. The second condition keeps noisy
+ * benchmarks from failing the run on jitter alone.
+ */
+inline std::vector<Comparison>
+compare_to_baseline(const std::vector<Result>& current,
+                    const std::vector<Result>& baseline,
+                    double threshold, double noise_mads = 3.0) {
+    std::map<std::string, const Result*> base;
+    for (const auto& b : baseline)
+        base[b.name] = &b;
+
+    std::vector<Comparison> out;
+    for (const auto& c : current) {
+        Comparison cmp;
+        cmp.name = c.name;
+        cmp.current_ns = c.median_ns;
+
+        auto it = base.find(c.name);
+        if (it == base.end()) {
+            cmp.status = "NEW";
+            out.push_back(cmp);
+            continue;
+        }
+
+        const Result& b = *it->second;
+        cmp.baseline_ns = b.median_ns;
+        cmp.change = (b.median_ns > 0.0) ? (c.median_ns - b.median_ns) / b.median_ns : 0.0;
+
+        double diff = c.median_ns - b.median_ns;
+        double noise = noise_mads * std::max(c.mad_ns, b.mad_ns);
+
+        if (cmp.change > threshold && diff > noise)
+            cmp.status = "REGRESSED";
+        else if (cmp.change < -threshold && -diff > noise)
+            cmp.status = "IMPROVED";
+        else
+            cmp.status = "OK";
+
+        base.erase(it);
+        out.push_back(cmp);
+    }
+
+    for (const auto& kv : base) {
+        Comparison cmp;
+        cmp.name = kv.first;
+        cmp.baseline_ns = kv.second->median_ns;
+        cmp.status = "MISSING";
+        out.push_back(cmp);
+    }
+    return out;
+}
+
+} // namespace bench
+} // namespace qf
+
+#endif // QF_BENCH_HARNESS_H
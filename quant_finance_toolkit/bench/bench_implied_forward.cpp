@@ -0,0 +1,83 @@
+/**
+ * @file bench_implied_forward.cpp
+ * @author John Jacobson
+ * @brief Benchmarks for the put–call parity forward and discount fit.
+ */
+
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "bench_harness.h"
+#include "implied_forward.h"
+
+namespace {
+
+using qf::bench::State;
+using qf::bench::do_not_optimize;
+
+// Call and put quotes on a strike x maturity grid with a smile, a little
+// price noise and one bad quote per maturity.
+std::vector<OptionQuote> make_chain(int n_maturities, int n_strikes, std::uint64_t seed = 42) {
+    std::mt19937_64 rng(seed);
+    std::normal_distribution<double> noise(0.0, 0.01);
+    std::vector<OptionQuote> quotes;
+    for (int m = 0; m < n_maturities; ++m) {
+        double T = 0.1 + 0.1 * m;
+        double D = std::exp(-0.03 * T), F = 100.0 * std::exp(0.01 * T);
+        for (int k = 0; k < n_strikes; ++k) {
+            double K = 60.0 + 80.0 * k / (n_strikes - 1);
+            double x = (K - 100.0) / 100.0;
+            double vol = 0.20 + 0.02 * T + 0.10 * x * x;
+            double c = qf::bs_call(D * F, K, T, -std::log(D) / T, vol) + noise(rng);
+            double p = c - D * (F - K) + noise(rng) + (k == n_strikes / 3 ? 0.5 : 0.0);
+            quotes.push_back({K, T, vol, 'C', std::max(c - 0.05, 0.01), c + 0.05, 0.0, 0.0});
+            quotes.push_back({K, T, vol, 'P', std::max(p - 0.05, 0.01), p + 0.05, 0.0, 0.0});
+        }
+    }
+    return quotes;
+}
+
+void forwards_from_quotes(State& state) {
+    auto quotes = make_chain(20, 50);
+    state.set_items_per_iteration(20);
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i)
+            do_not_optimize(qf::implied_forwards(quotes));
+    });
+}
+
+// The flat kernel alone, on pairs already matched and laid out per expiry.
+void forward_batch(State& state) {
+    auto quotes = make_chain(20, 50);
+    std::vector<double> maturity, strike, diff;
+    std::vector<std::size_t> offsets{0};
+    for (std::size_t i = 0; i < quotes.size(); i += 2) {
+        const auto& c = quotes[i];
+        const auto& p = quotes[i + 1];
+        if (maturity.empty() || maturity.back() != c.maturity) {
+            if (!maturity.empty())
+                offsets.push_back(strike.size());
+            maturity.push_back(c.maturity);
+        }
+        strike.push_back(c.strike);
+        diff.push_back(0.5 * (c.bid + c.ask) - 0.5 * (p.bid + p.ask));
+    }
+    offsets.push_back(strike.size());
+
+    std::vector<qf::ImpliedForward> out(maturity.size());
+    state.set_items_per_iteration(maturity.size());
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i) {
+            qf::implied_forward_batch(maturity.size(), offsets.data(), maturity.data(),
+                                      strike.data(), diff.data(), nullptr, out.data());
+            do_not_optimize(out.data());
+        }
+    });
+}
+
+} // namespace
+
+QF_BENCHMARK("implied_forward/from_quotes_20x50", "macro", forwards_from_quotes);
+QF_BENCHMARK("implied_forward/batch_20x50", "macro", forward_batch);
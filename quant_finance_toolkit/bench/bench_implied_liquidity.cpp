@@ -0,0 +1,83 @@
+/**
+ * @file bench_implied_liquidity.cpp
+ * @author John Jacobson
+ * @brief Benchmarks for the implied-in / implied-out calendar spread
+ *        engine: the cost of a top-of-book change should not grow with
+ *        the number of expiries.
+ */
+
+#include <cstdint>
+
+#include "bench_harness.h"
+#include "implied_liquidity.h"
+
+namespace {
+
+using qf::bench::State;
+using qf::bench::do_not_optimize;
+using qf::Side;
+
+// Outrights quoted 2 ticks wide on an upward curve, with the 1-, 2- and
+// 3-month calendars listed for every expiry.
+qf::ImpliedMatchingEngine make_engine(std::uint32_t expiries) {
+    qf::ImpliedMatchingEngine e(expiries);
+    for (std::uint32_t i = 0; i < expiries; ++i) {
+        const double mid = 100.0 + 0.25 * i;
+        e.add_order(i, Side::Buy, mid - 0.01, 50);
+        e.add_order(i, Side::Sell, mid + 0.01, 50);
+    }
+    for (std::uint32_t gap = 1; gap <= 3; ++gap)
+        for (std::uint32_t i = 0; i + gap < expiries; ++i) {
+            const std::uint32_t s = e.add_calendar_spread(i, i + gap);
+            e.add_order(s, Side::Buy, -0.25 * gap - 0.03, 20);
+            e.add_order(s, Side::Sell, -0.25 * gap + 0.03, 20);
+        }
+    return e;
+}
+
+// A passive order improves one outright's bid and is cancelled; both
+// changes re-price the implieds that read that book.
+template <std::uint32_t Expiries>
+void outright_update(State& state) {
+    auto e = make_engine(Expiries);
+    std::uint32_t i = 0;
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t it = 0; it < iters; ++it) {
+            const double bid = 100.0 + 0.25 * i - 0.01;
+            auto ex = e.add_order(i, Side::Buy, bid + 0.005, 5);
+            e.cancel_order(i, ex.order_id);
+            i = (i + 1) % Expiries;
+        }
+        do_not_optimize(e.evaluations());
+    });
+}
+
+// An outright bought through an implied-out route (spread bid + near
+// outright), after which both legs are replenished.
+void implied_out_fill(State& state) {
+    constexpr std::uint32_t kExpiries = 120;
+    qf::ImpliedMatchingEngine e(kExpiries);
+    for (std::uint32_t i = 0; i < kExpiries; ++i) {
+        e.add_order(i, Side::Buy, 100.0, 50);
+        e.add_order(i, Side::Sell, 100.03, 50);
+    }
+    for (std::uint32_t i = 0; i + 1 < kExpiries; ++i)
+        e.add_calendar_spread(i, i + 1);
+    std::uint32_t k = 0;
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t it = 0; it < iters; ++it) {
+            const std::uint32_t s = kExpiries + k;
+            e.add_order(s, Side::Buy, 0.01, 5);                     // spread bid
+            auto ex = e.add_order(k + 1, Side::Buy, 100.02, 5);      // lifts near, sells spread
+            do_not_optimize(ex);
+            e.add_order(k, Side::Sell, 100.03, 5);                  // replenish near ask
+            k = (k + 1) % (kExpiries - 1);
+        }
+    });
+}
+
+} // namespace
+
+QF_BENCHMARK("implied/outright_update_12", "micro", outright_update<12>);
+QF_BENCHMARK("implied/outright_update_120", "micro", outright_update<120>);
+QF_BENCHMARK("implied/implied_out_fill_120", "micro", implied_out_fill);
@@ -0,0 +1,79 @@
+/**
+ * @file bench_market_maker.cpp
+ * @author John Jacobson
+ * @brief Benchmarks for the market-making quote engine on a 2,000-contract
+ *        chain. One item is one full-chain requote, so items/sec is
+ *        requotes/sec.
+ */
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "bench_harness.h"
+#include "market_maker.h"
+#include "memory_arena.h"
+
+namespace {
+
+using qf::bench::State;
+using qf::bench::do_not_optimize;
+
+// 10 expiries × 100 strikes × call/put.
+std::vector<qf::QuotedContract> make_chain() {
+    std::vector<qf::QuotedContract> c;
+    for (int e = 0; e < 10; ++e)
+        for (int k = 0; k < 100; ++k)
+            for (int cp = 0; cp < 2; ++cp)
+                c.push_back({50.0 + k, 0.1 * (e + 1), cp == 0});
+    return c;
+}
+
+double smile(double, double K) {
+    const double y = std::log(K / 100.0);
+    return 0.2 - 0.1 * y + 0.3 * y * y;
+}
+
+// Spot walks a cent per requote, so most quotes move a tick or more.
+void requote_spot_move(State& state) {
+    qf::PoolResource pool(std::pmr::new_delete_resource(), 256 * 1024);
+    qf::QuoteEngine mm(make_chain(), 0.02, {}, &pool);
+    mm.requote(100.0, smile);
+    std::uint64_t k = 0;
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i, ++k)
+            do_not_optimize(mm.requote(100.0 + 0.01 * static_cast<double>(k % 20), smile));
+    });
+}
+
+// Nothing moves: the whole cost is pricing and the diff.
+void requote_unchanged(State& state) {
+    qf::QuoteEngine mm(make_chain(), 0.02);
+    mm.requote(100.0, smile);
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i)
+            do_not_optimize(mm.requote(100.0, smile));
+    });
+}
+
+void plan_only(State& state) {
+    qf::QuoteEngine mm(make_chain(), 0.02);
+    mm.requote(100.0, smile);
+    std::vector<double> vol(mm.size());
+    for (std::size_t i = 0; i < mm.size(); ++i)
+        vol[i] = smile(mm.contract(i).maturity, mm.contract(i).strike);
+    std::vector<qf::QuoteCommand> out;
+    std::uint64_t k = 0;
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i, ++k) {
+            out.clear();
+            do_not_optimize(mm.plan(100.0 + 0.01 * static_cast<double>(k % 20), vol.data(), out));
+        }
+    });
+}
+
+} // namespace
+
+QF_BENCHMARK("market_maker/requote_2000_spot_move", "macro", requote_spot_move);
+QF_BENCHMARK("market_maker/requote_2000_unchanged", "macro", requote_unchanged);
+QF_BENCHMARK("market_maker/plan_2000", "macro", plan_only);
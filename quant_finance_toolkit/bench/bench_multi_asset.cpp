@@ -0,0 +1,104 @@
+/**
+ * @file bench_multi_asset.cpp
+ * @author John Jacobson
+ * @brief Benchmarks for correlated multi-asset Monte Carlo and the basket
+ *        and spread closed forms.
+ */
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "bench_harness.h"
+#include "multi_asset_mc.h"
+
+namespace {
+
+using qf::bench::State;
+using qf::bench::do_not_optimize;
+
+constexpr std::size_t kAssets = 5;
+
+qf::MultiAssetMarket make_market() {
+    return {{100.0, 90.0, 110.0, 95.0, 105.0},
+            {0.20, 0.30, 0.25, 0.35, 0.15},
+            {0.01, 0.02, 0.00, 0.03, 0.01},
+            0.03};
+}
+
+// Correlation decaying from 0.5 with distance between asset indices.
+std::vector<double> make_correlation(std::size_t n) {
+    std::vector<double> c(n * n);
+    for (std::size_t i = 0; i < n; ++i)
+        for (std::size_t j = 0; j < n; ++j)
+            c[i * n + j] = i == j ? 1.0 : 0.5 - 0.05 * std::fabs(double(i) - double(j));
+    return c;
+}
+
+void basket_mc(State& state) {
+    auto market = make_market();
+    auto factor = qf::CorrelationFactor::cholesky(make_correlation(kAssets), kAssets);
+    std::vector<double> weights(kAssets, 0.2);
+    qf::McConfig cfg;
+    state.set_items_per_iteration(cfg.paths);
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i)
+            do_not_optimize(qf::basket_option_mc(true, market, factor, weights, 100.0, 1.0, cfg));
+    });
+}
+
+void spread_mc(State& state) {
+    auto market = make_market();
+    auto factor = qf::CorrelationFactor::cholesky(make_correlation(kAssets), kAssets);
+    qf::McConfig cfg;
+    state.set_items_per_iteration(cfg.paths);
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i)
+            do_not_optimize(qf::spread_option_mc(true, market, factor, 5.0, 1.0, cfg));
+    });
+}
+
+// Path generation alone: 12 monthly steps for 5 assets.
+void generate_paths(State& state) {
+    auto market = make_market();
+    auto factor = qf::CorrelationFactor::cholesky(make_correlation(kAssets), kAssets);
+    qf::CorrelatedPathGenerator gen(market, factor, 1.0, 12);
+    qf::PathWorkspace ws;
+    std::uint64_t index = 0;
+    state.set_items_per_iteration(gen.block_size() * gen.steps() * kAssets);
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i)
+            do_not_optimize(gen.generate(42, index++, ws).data);
+    });
+}
+
+void kirk_single(State& state) {
+    double S1 = 100.0;
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i) {
+            do_not_optimize(S1);
+            do_not_optimize(qf::kirk_spread_option(true, S1, 90.0, 5.0, 1.0, 0.03, 0.01, 0.02,
+                                                   0.2, 0.3, 0.45));
+        }
+    });
+}
+
+void levy_basket(State& state) {
+    auto market = make_market();
+    auto factor = qf::CorrelationFactor::cholesky(make_correlation(kAssets), kAssets);
+    std::vector<double> weights(kAssets, 0.2);
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i) {
+            do_not_optimize(market.spot.data());
+            do_not_optimize(qf::levy_basket_option(true, market, factor, weights, 100.0, 1.0));
+        }
+    });
+}
+
+} // namespace
+
+QF_BENCHMARK("multi_asset/basket_mc_5x64k", "macro", basket_mc);
+QF_BENCHMARK("multi_asset/spread_mc_64k", "macro", spread_mc);
+QF_BENCHMARK("multi_asset/generate_paths_5x12", "macro", generate_paths);
+QF_BENCHMARK("multi_asset/kirk_spread", "micro", kirk_single);
+QF_BENCHMARK("multi_asset/levy_basket_5", "micro", levy_basket);
@@ -0,0 +1,96 @@
+/**
+ * @file bench_numa.cpp
+ * @author John Jacobson
+ * @brief Local versus interleaved memory placement for per-worker data.
+ *
+ * Every pool slot gets a 32 MB slice (think: its book shards or position
+ * slice) from WorkerArenas. Each task streams over the slice of whichever
+ * worker runs it, so the only difference between the variants is where the
+ * pages live: on the worker's own node, or interleaved over all nodes. On a
+ * single-node machine the two report the same numbers.
+ */
+
+#include <cstdint>
+#include <vector>
+
+#include "bench_harness.h"
+#include "numa_placement.h"
+#include "thread_pool.h"
+
+namespace {
+
+using qf::bench::State;
+using qf::bench::do_not_optimize;
+
+constexpr std::size_t kSliceDoubles = (32u << 20) / sizeof(double);
+constexpr std::size_t kTasksPerSlot = 4;
+
+template <qf::MemoryPlacement Placement>
+void worker_slices(State& state) {
+    qf::NumaTopology topo;
+    qf::ThreadPoolOptions opts;
+    opts.pin_threads = true;
+    opts.cpus = qf::thread_placement_cpus(topo, qf::ThreadPlacement::Scatter,
+                                          opts.num_workers + 1);
+    qf::ThreadPool pool(opts);
+
+    qf::WorkerArenas arenas(pool, topo, Placement, kSliceDoubles * sizeof(double) + 4096);
+    std::size_t tasks = arenas.slots() * kTasksPerSlot;
+
+    // Each slot allocates and writes its own slice from the thread that owns
+    // it, so under FirstTouch the pages fault in on that thread's node. The
+    // pool gives no way to target a worker, so repeat until every slot has
+    // run a task; a slot that never does is filled by the caller.
+    std::vector<double*> slices(arenas.slots(), nullptr);
+    auto fill = [](double* x) {
+        for (std::size_t i = 0; i < kSliceDoubles; ++i)
+            x[i] = 1.0 + 1e-9 * static_cast<double>(i);
+    };
+    auto filled = [&] {
+        for (double* x : slices)
+            if (!x)
+                return false;
+        return true;
+    };
+    for (int pass = 0; pass < 100 && !filled(); ++pass) {
+        qf::parallel_for(pool, 0, tasks, 1, [&](std::size_t) {
+            int w = pool.current_worker();
+            double*& x = slices[w >= 0 ? static_cast<std::size_t>(w) + 1 : 0];
+            if (!x) {
+                x = arenas.local().allocate_array<double>(kSliceDoubles);
+                fill(x);
+            }
+        });
+    }
+    for (std::size_t s = 0; s < arenas.slots(); ++s) {
+        if (!slices[s]) {
+            slices[s] = arenas.slot(s).allocate_array<double>(kSliceDoubles);
+            fill(slices[s]);
+        }
+    }
+
+    std::vector<double> sums(tasks);
+    state.set_items_per_iteration(tasks * kSliceDoubles);
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t it = 0; it < iters; ++it) {
+            qf::parallel_for(pool, 0, tasks, 1, [&](std::size_t t) {
+                int w = pool.current_worker();
+                const double* x = slices[w >= 0 ? static_cast<std::size_t>(w) + 1 : 0];
+                double s = 0.0;
+                for (std::size_t i = 0; i < kSliceDoubles; ++i)
+                    s += x[i];
+                sums[t] = s;
+            });
+            do_not_optimize(sums.data());
+        }
+    });
+}
+
+} // namespace
+
+QF_BENCHMARK("numa/worker_slices_stream/local", "macro",
+             worker_slices<qf::MemoryPlacement::Local>);
+QF_BENCHMARK("numa/worker_slices_stream/interleave", "macro",
+             worker_slices<qf::MemoryPlacement::Interleave>);
+QF_BENCHMARK("numa/worker_slices_stream/first_touch", "macro",
+             worker_slices<qf::MemoryPlacement::FirstTouch>);
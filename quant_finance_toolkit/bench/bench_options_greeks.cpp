@@ -0,0 +1,178 @@
+/**
+ * @file bench_options_greeks.cpp
+ * @author John Jacobson
+ * @brief Benchmarks for Black–Scholes pricing, Greeks and implied vol.
+ */
+
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "bench_harness.h"
+#include "bs_proxy.h"
+#include "options_greeks.h"
+
+namespace {
+
+using qf::bench::State;
+using qf::bench::do_not_optimize;
+
+struct Chain {
+    std::vector<double> S, K, T, r, sigma, price;
+};
+
+// A synthetic chain around spot = 100 with a mild smile.
+Chain make_chain(std::size_t n, std::uint64_t seed = 42) {
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> strike(60.0, 140.0);
+    std::uniform_real_distribution<double> mat(0.05, 2.0);
+
+    Chain c;
+    for (std::size_t i = 0; i < n; ++i) {
+        double K = strike(rng);
+        double T = mat(rng);
+        double m = (K - 100.0) / 100.0;
+        double vol = 0.20 + 0.15 * m * m - 0.05 * m;
+        c.S.push_back(100.0);
+        c.K.push_back(K);
+        c.T.push_back(T);
+        c.r.push_back(0.01);
+        c.sigma.push_back(vol);
+        c.price.push_back(qf::bs_call(100.0, K, T, 0.01, vol));
+    }
+    return c;
+}
+
+void bs_call_single(State& state) {
+    double S = 100.0, K = 105.0, T = 0.75, r = 0.01, sigma = 0.22;
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i) {
+            do_not_optimize(S);
+            do_not_optimize(qf::bs_call(S, K, T, r, sigma));
+        }
+    });
+}
+
+void bs_put_single(State& state) {
+    double S = 100.0, K = 95.0, T = 0.75, r = 0.01, sigma = 0.22;
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i) {
+            do_not_optimize(S);
+            do_not_optimize(qf::bs_put(S, K, T, r, sigma));
+        }
+    });
+}
+
+void call_greeks_single(State& state) {
+    double S = 100.0, K = 105.0, T = 0.75, r = 0.01, sigma = 0.22;
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i) {
+            do_not_optimize(S);
+            do_not_optimize(qf::call_greeks(S, K, T, r, sigma));
+        }
+    });
+}
+
+void implied_vol_single(State& state) {
+    double S = 100.0, K = 105.0, T = 0.75, r = 0.01;
+    double price = qf::bs_call(S, K, T, r, 0.27);
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i) {
+            do_not_optimize(price);
+            do_not_optimize(qf::implied_vol_call(price, S, K, T, r));
+        }
+    });
+}
+
+void chain_price_and_greeks(State& state) {
+    Chain c = make_chain(10000);
+    std::vector<double> out(c.S.size());
+    std::vector<qf::Greeks> greeks(c.S.size());
+    state.set_items_per_iteration(c.S.size());
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t it = 0; it < iters; ++it) {
+            for (std::size_t i = 0; i < c.S.size(); ++i) {
+                out[i] = qf::bs_call(c.S[i], c.K[i], c.T[i], c.r[i], c.sigma[i]);
+                greeks[i] = qf::call_greeks(c.S[i], c.K[i], c.T[i], c.r[i], c.sigma[i]);
+            }
+            do_not_optimize(out.data());
+            do_not_optimize(greeks.data());
+        }
+    });
+}
+
+void chain_implied_vol(State& state) {
+    Chain c = make_chain(1000);
+    std::vector<double> out(c.S.size());
+    state.set_items_per_iteration(c.S.size());
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t it = 0; it < iters; ++it) {
+            for (std::size_t i = 0; i < c.S.size(); ++i) {
+                try {
+                    out[i] = qf::implied_vol_call(c.price[i], c.S[i], c.K[i], c.T[i], c.r[i]);
+                } catch (const std::exception&) {
+                    out[i] = 0.0;
+                }
+            }
+            do_not_optimize(out.data());
+        }
+    });
+}
+
+void chain_bs_call(State& state) {
+    Chain c = make_chain(10000);
+    std::vector<double> out(c.S.size());
+    state.set_items_per_iteration(c.S.size());
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t it = 0; it < iters; ++it) {
+            qf::bs_call_batch(c.S.size(), c.S.data(), c.K.data(), c.T.data(), c.r.data(),
+                              c.sigma.data(), out.data());
+            do_not_optimize(out.data());
+        }
+    });
+}
+
+void chain_bs_proxy(State& state) {
+    const qf::BsProxy& proxy = qf::default_bs_proxy();
+    Chain c = make_chain(10000);
+    std::vector<double> out(c.S.size());
+    state.set_items_per_iteration(c.S.size());
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t it = 0; it < iters; ++it) {
+            proxy.call_batch(c.S.size(), c.S.data(), c.K.data(), c.T.data(), c.r.data(),
+                             c.sigma.data(), out.data());
+            do_not_optimize(out.data());
+        }
+    });
+}
+
+// Scenario-cube style: log-moneyness and total vol precomputed once.
+void chain_bs_proxy_normalized(State& state) {
+    const qf::BsProxy& proxy = qf::default_bs_proxy();
+    Chain c = make_chain(10000);
+    std::vector<double> x(c.S.size()), v(c.S.size()), out(c.S.size());
+    for (std::size_t i = 0; i < c.S.size(); ++i) {
+        x[i] = std::log(c.S[i] / c.K[i]) + c.r[i] * c.T[i];
+        v[i] = c.sigma[i] * std::sqrt(c.T[i]);
+    }
+    state.set_items_per_iteration(c.S.size());
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t it = 0; it < iters; ++it) {
+            proxy.normalized_call_batch(c.S.size(), x.data(), v.data(), out.data());
+            do_not_optimize(out.data());
+        }
+    });
+}
+
+} // namespace
+
+QF_BENCHMARK("options_greeks/bs_call", "micro", bs_call_single);
+QF_BENCHMARK("options_greeks/bs_put", "micro", bs_put_single);
+QF_BENCHMARK("options_greeks/call_greeks", "micro", call_greeks_single);
+QF_BENCHMARK("options_greeks/implied_vol_call", "micro", implied_vol_single);
+QF_BENCHMARK("options_greeks/chain_price_greeks_10k", "macro", chain_price_and_greeks);
+QF_BENCHMARK("options_greeks/chain_implied_vol_1k", "macro", chain_implied_vol);
+QF_BENCHMARK("options_greeks/chain_bs_call_10k", "macro", chain_bs_call);
+QF_BENCHMARK("options_greeks/chain_bs_proxy_10k", "macro", chain_bs_proxy);
+QF_BENCHMARK("options_greeks/chain_bs_proxy_normalized_10k", "macro", chain_bs_proxy_normalized);
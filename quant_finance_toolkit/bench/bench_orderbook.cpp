@@ -0,0 +1,178 @@
+/**
+ * @file bench_orderbook.cpp
+ * @author John Jacobson
+ * @brief Benchmarks for the limit order book simulator.
+ */
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "bench_harness.h"
+#include "fast_orderbook.h"
+#include "memory_arena.h"
+#include "orderbook_simulator.h"
+
+namespace {
+
+using qf::bench::State;
+using qf::bench::do_not_optimize;
+using qf::OrderBook;
+using qf::Side;
+
+// Resting buy below a fixed ask, then cancel it: the add/cancel round trip
+// without any matching.
+void add_cancel_passive(State& state) {
+    OrderBook ob;
+    for (int i = 0; i < 50; ++i) {
+        ob.add_limit_order(Side::Buy, 99.0 - 0.01 * i, 100);
+        ob.add_limit_order(Side::Sell, 101.0 + 0.01 * i, 100);
+    }
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i) {
+            auto res = ob.add_limit_order(Side::Buy, 99.5, 10);
+            do_not_optimize(res);
+            ob.cancel_order(res.first);
+        }
+    });
+}
+
+// Aggressive order that fully fills against one resting order, which is
+// then replenished.
+void add_crossing(State& state) {
+    OrderBook ob;
+    for (int i = 0; i < 50; ++i)
+        ob.add_limit_order(Side::Buy, 99.0 - 0.01 * i, 100);
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i) {
+            ob.add_limit_order(Side::Sell, 101.0, 10);
+            auto res = ob.add_limit_order(Side::Buy, 101.0, 10);
+            do_not_optimize(res);
+        }
+    });
+}
+
+struct Command {
+    int kind;        // 0 = add, 1 = cancel
+    Side side;
+    double price;
+    std::uint64_t qty;
+    std::size_t cancel_ref;  // index of an earlier add
+};
+
+// Random flow around a mid of 100 on a 1 cent grid: mostly passive adds,
+// some cancels and some marketable orders.
+std::vector<Command> make_flow(std::size_t n, std::uint64_t seed = 7) {
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> u(0.0, 1.0);
+    std::vector<Command> cmds;
+    cmds.reserve(n);
+    std::size_t adds = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        double x = u(rng);
+        if (x < 0.25 && adds > 0) {
+            std::uniform_int_distribution<std::size_t> pick(0, adds - 1);
+            cmds.push_back({1, Side::Buy, 0.0, 0, pick(rng)});
+            continue;
+        }
+        Side side = (u(rng) < 0.5) ? Side::Buy : Side::Sell;
+        int offset = static_cast<int>(u(rng) * 50.0);
+        if (x > 0.9)
+            offset = -static_cast<int>(u(rng) * 5.0);  // crosses the spread
+        double price = (side == Side::Buy) ? 100.0 - 0.01 * (offset + 1)
+                                           : 100.0 + 0.01 * (offset + 1);
+        std::uint64_t qty = 1 + static_cast<std::uint64_t>(u(rng) * 100.0);
+        cmds.push_back({0, side, price, qty, 0});
+        ++adds;
+    }
+    return cmds;
+}
+
+void replay_flow(State& state) {
+    auto cmds = make_flow(100000);
+    std::vector<std::uint64_t> ids;
+    ids.reserve(cmds.size());
+    state.set_items_per_iteration(cmds.size());
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t it = 0; it < iters; ++it) {
+            OrderBook ob;
+            ids.clear();
+            for (const auto& c : cmds) {
+                if (c.kind == 0) {
+                    auto res = ob.add_limit_order(c.side, c.price, c.qty);
+                    ids.push_back(res.first);
+                } else {
+                    ob.cancel_order(ids[c.cancel_ref]);
+                }
+            }
+            do_not_optimize(ob.best_bid());
+        }
+    });
+}
+
+// Same flow with the book on a node pool and one reused trade buffer, so
+// the matching path does not call malloc once the pool is warm.
+template <bool HugePages>
+void replay_flow_pooled(State& state) {
+    auto cmds = make_flow(100000);
+    std::vector<std::uint64_t> ids;
+    ids.reserve(cmds.size());
+    std::vector<qf::Trade> trades;
+    trades.reserve(1024);
+    // The pool outlives each replayed book, so later books reuse its nodes.
+    qf::HugePageResource huge;
+    qf::PoolResource pool(HugePages ? static_cast<std::pmr::memory_resource*>(&huge)
+                                    : std::pmr::new_delete_resource(),
+                          HugePages ? qf::HugePageResource::kHugePage : 256 * 1024);
+    state.set_items_per_iteration(cmds.size());
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t it = 0; it < iters; ++it) {
+            OrderBook ob(&pool);
+            ids.clear();
+            for (const auto& c : cmds) {
+                if (c.kind == 0) {
+                    trades.clear();
+                    ids.push_back(ob.add_limit_order(c.side, c.price, c.qty, trades));
+                } else {
+                    ob.cancel_order(ids[c.cancel_ref]);
+                }
+            }
+            do_not_optimize(ob.best_bid());
+        }
+    });
+}
+
+// Same flow on the flat-array book (checked against OrderBook by
+// tools/orderbook_diff).
+void replay_flow_fast(State& state) {
+    auto cmds = make_flow(100000);
+    std::vector<std::uint64_t> ids;
+    ids.reserve(cmds.size());
+    std::vector<qf::Trade> trades;
+    trades.reserve(1024);
+    state.set_items_per_iteration(cmds.size());
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t it = 0; it < iters; ++it) {
+            qf::FastOrderBook ob;
+            ids.clear();
+            for (const auto& c : cmds) {
+                if (c.kind == 0) {
+                    trades.clear();
+                    ids.push_back(ob.add_limit_order(c.side, c.price, c.qty, trades));
+                } else {
+                    ob.cancel_order(ids[c.cancel_ref]);
+                }
+            }
+            do_not_optimize(ob.best_bid());
+        }
+    });
+}
+
+} // namespace
+
+QF_BENCHMARK("orderbook/add_cancel_passive", "micro", add_cancel_passive);
+QF_BENCHMARK("orderbook/add_crossing", "micro", add_crossing);
+QF_BENCHMARK("orderbook/replay_flow_100k", "macro", replay_flow);
+QF_BENCHMARK("orderbook/replay_flow_100k/pool", "macro", replay_flow_pooled<false>);
+QF_BENCHMARK("orderbook/replay_flow_100k/pool_hugepage", "macro", replay_flow_pooled<true>);
+QF_BENCHMARK("orderbook/replay_flow_100k/fast", "macro", replay_flow_fast);
@@ -0,0 +1,116 @@
+/**
+ * @file bench_payoff_dsl.cpp
+ * @author John Jacobson
+ * @brief Payoff evaluation cost: the expression DSL against a hand-written
+ *        loop and a virtual per-path payoff, on the same block of paths.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "bench_harness.h"
+#include "payoff_dsl.h"
+
+namespace {
+
+using qf::bench::State;
+using qf::bench::do_not_optimize;
+
+constexpr double kBarrier = 0.7;
+
+// One block of 12-step paths on three assets, generated once.
+struct Fixture {
+    qf::MultiAssetMarket market{{100.0, 90.0, 110.0}, {0.2, 0.3, 0.25}, {0.01, 0.02, 0.0}, 0.03};
+    qf::CorrelatedPathGenerator gen{
+        market,
+        qf::CorrelationFactor::cholesky({1.0, 0.5, 0.4, 0.5, 1.0, 0.45, 0.4, 0.45, 1.0}, 3),
+        1.0, 12};
+    qf::PathWorkspace ws;
+    qf::PathBlock block = gen.generate(42, 0, ws);
+    std::vector<double> out = std::vector<double>(block.paths);
+};
+
+// Worst-of put that knocks in when any asset closes below 70% of spot.
+auto ki_worst_of_expr() {
+    using namespace qf::payoff;
+    return ind(min_assets(path_min_each_perf()) < kBarrier) * pos(1.0 - min_assets(perf_each()));
+}
+
+void ki_worst_of_dsl(State& state) {
+    Fixture f;
+    auto payoff = qf::payoff::compile(ki_worst_of_expr());
+    state.set_items_per_iteration(f.block.paths);
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i) {
+            payoff(f.block, f.out.data());
+            do_not_optimize(f.out.data());
+        }
+    });
+}
+
+void ki_worst_of_handwritten(State& state) {
+    Fixture f;
+    const qf::PathBlock& b = f.block;
+    state.set_items_per_iteration(b.paths);
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i) {
+            for (std::size_t p = 0; p < b.paths; ++p) {
+                double low = std::numeric_limits<double>::infinity();
+                double worst = low;
+                for (std::size_t a = 0; a < b.assets; ++a) {
+                    double m = b.row(1, a)[p];
+                    for (std::size_t s = 2; s <= b.steps; ++s)
+                        m = std::min(m, b.row(s, a)[p]);
+                    low = std::min(low, m / b.spot[a]);
+                    worst = std::min(worst, b.terminal(a)[p] / b.spot[a]);
+                }
+                f.out[p] = low < kBarrier ? std::max(1.0 - worst, 0.0) : 0.0;
+            }
+            do_not_optimize(f.out.data());
+        }
+    });
+}
+
+// What the DSL replaces: one virtual call per path.
+struct PathPayoff {
+    virtual ~PathPayoff() = default;
+    virtual double operator()(const qf::PathBlock& b, std::size_t p) const = 0;
+};
+
+struct KiWorstOf final : PathPayoff {
+    double operator()(const qf::PathBlock& b, std::size_t p) const override {
+        double low = std::numeric_limits<double>::infinity();
+        double worst = low;
+        for (std::size_t a = 0; a < b.assets; ++a) {
+            double m = b.row(1, a)[p];
+            for (std::size_t s = 2; s <= b.steps; ++s)
+                m = std::min(m, b.row(s, a)[p]);
+            low = std::min(low, m / b.spot[a]);
+            worst = std::min(worst, b.terminal(a)[p] / b.spot[a]);
+        }
+        return low < kBarrier ? std::max(1.0 - worst, 0.0) : 0.0;
+    }
+};
+
+void ki_worst_of_virtual(State& state) {
+    Fixture f;
+    std::unique_ptr<PathPayoff> payoff = std::make_unique<KiWorstOf>();
+    do_not_optimize(payoff.get());
+    state.set_items_per_iteration(f.block.paths);
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i) {
+            for (std::size_t p = 0; p < f.block.paths; ++p)
+                f.out[p] = (*payoff)(f.block, p);
+            do_not_optimize(f.out.data());
+        }
+    });
+}
+
+} // namespace
+
+QF_BENCHMARK("payoff_dsl/ki_worst_of_dsl", "micro", ki_worst_of_dsl);
+QF_BENCHMARK("payoff_dsl/ki_worst_of_handwritten", "micro", ki_worst_of_handwritten);
+QF_BENCHMARK("payoff_dsl/ki_worst_of_virtual", "micro", ki_worst_of_virtual);
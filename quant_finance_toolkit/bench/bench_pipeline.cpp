@@ -0,0 +1,40 @@
+/**
+ * @file bench_pipeline.cpp
+ * @author John Jacobson
+ * @brief Benchmarks for the streaming quote → alert pipeline.
+ */
+
+#include <cstdint>
+#include <vector>
+
+#include "bench_harness.h"
+#include "streaming_pipeline.h"
+
+namespace {
+
+using qf::bench::State;
+using qf::bench::do_not_optimize;
+
+// Unthrottled replay of 8 symbols x (4 x 15) grids plus 20k updates:
+// end-to-end cost per tick with every stage running.
+template <std::size_t Workers>
+void replay_unthrottled(State& state) {
+    auto ticks = qf::make_replay_ticks(8, 4, 15, 20000, 0.01);
+    qf::PipelineConfig cfg;
+    cfg.iv_workers = Workers;
+    cfg.detect_workers = Workers;
+    state.set_items_per_iteration(ticks.size());
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i) {
+            qf::ReplaySource source(ticks);
+            qf::ArbitragePipeline pipeline(cfg);
+            auto report = pipeline.run(source);
+            do_not_optimize(report.alerts);
+        }
+    });
+}
+
+} // namespace
+
+QF_BENCHMARK("pipeline/replay_20k/workers:1", "macro", replay_unthrottled<1>);
+QF_BENCHMARK("pipeline/replay_20k/workers:2", "macro", replay_unthrottled<2>);
@@ -0,0 +1,159 @@
+/**
+ * @file bench_portfolio.cpp
+ * @author John Jacobson
+ * @brief Benchmarks for mean-variance and risk-parity construction on a
+ *        3,000-name, 40-factor universe, cold and warm-started.
+ */
+
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "bench_harness.h"
+#include "portfolio_optimizer.h"
+
+namespace {
+
+using qf::bench::State;
+using qf::bench::do_not_optimize;
+
+constexpr std::size_t kNames = 3000;
+constexpr std::size_t kFactors = 40;
+
+// A market factor plus style factors, with F = A Aᵀ + a small ridge.
+qf::FactorCovariance model(std::size_t n, std::size_t k) {
+    std::mt19937_64 rng(31);
+    std::normal_distribution<double> z(0.0, 1.0);
+    std::uniform_real_distribution<double> u(0.0, 1.0);
+    qf::FactorCovariance cov(n, k);
+    for (std::size_t i = 0; i < n; ++i) {
+        cov.exposures[i * k] = 0.7 + 0.6 * u(rng);
+        for (std::size_t f = 1; f < k; ++f)
+            cov.exposures[i * k + f] = 0.5 * z(rng);
+        cov.specific_variance[i] = std::pow(0.01 + 0.02 * u(rng), 2);
+    }
+    std::vector<double> a(k * k);
+    for (double& x : a)
+        x = 0.004 * z(rng);
+    for (std::size_t r = 0; r < k; ++r)
+        for (std::size_t c = 0; c < k; ++c) {
+            double s = r == c ? (r == 0 ? 1e-4 : 2e-5) : 0.0;
+            for (std::size_t m = 0; m < k; ++m)
+                s += a[r * k + m] * a[c * k + m];
+            cov.factor_covariance[r * k + c] = s;
+        }
+    return cov;
+}
+
+std::vector<double> signal(std::size_t n, std::uint64_t seed, double scale) {
+    std::mt19937_64 rng(seed);
+    std::normal_distribution<double> z(0.0, scale);
+    std::vector<double> alpha(n);
+    for (double& x : alpha)
+        x = z(rng);
+    return alpha;
+}
+
+qf::MeanVarianceConfig long_only() {
+    qf::MeanVarianceConfig cfg;
+    cfg.risk_aversion = 5.0;
+    cfg.upper = 0.05;
+    return cfg;
+}
+
+void mean_variance_factor(State& state) {
+    const qf::FactorCovariance cov = model(kNames, kFactors);
+    qf::MeanVarianceProblem problem;
+    problem.expected_returns = signal(kNames, 7, 5e-4);
+    const qf::MeanVarianceConfig cfg = long_only();
+    state.set_items_per_iteration(1);
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i)
+            do_not_optimize(qf::optimize_mean_variance(cov, problem, cfg).variance);
+    });
+}
+
+// Daily rebalance: yesterday's weights as the turnover reference and warm
+// start, with a perturbed signal and a turnover cost.
+void warm_rebalance(State& state) {
+    const qf::FactorCovariance cov = model(kNames, kFactors);
+    qf::MeanVarianceProblem problem;
+    problem.expected_returns = signal(kNames, 7, 5e-4);
+    qf::MeanVarianceConfig cfg = long_only();
+    const qf::PortfolioResult yesterday = qf::optimize_mean_variance(cov, problem, cfg);
+    const std::vector<double> noise = signal(kNames, 8, 2e-3);
+    for (std::size_t i = 0; i < kNames; ++i)
+        problem.expected_returns[i] += noise[i];
+    problem.previous_weights = yesterday.weights;
+    cfg.turnover_penalty = 2e-4;
+    state.set_items_per_iteration(1);
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i)
+            do_not_optimize(qf::optimize_mean_variance(cov, problem, cfg, &yesterday).turnover);
+    });
+}
+
+// The ADMM fallback alone, for comparison with the active set.
+void admm_factor(State& state) {
+    const qf::FactorCovariance cov = model(kNames, kFactors);
+    qf::MeanVarianceProblem problem;
+    problem.expected_returns = signal(kNames, 7, 5e-4);
+    qf::MeanVarianceConfig cfg = long_only();
+    cfg.active_set = false;
+    state.set_items_per_iteration(1);
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i)
+            do_not_optimize(qf::optimize_mean_variance(cov, problem, cfg).variance);
+    });
+}
+
+// A cold solve on which phase 1 of the active set stalls: tight upper
+// bounds with a turnover cost. Phase 2 is cut short and ADMM + polish
+// finish the job.
+void mean_variance_stall(State& state) {
+    const qf::FactorCovariance cov = model(kNames, kFactors);
+    qf::MeanVarianceProblem problem;
+    problem.expected_returns = signal(kNames, 7, 5e-4);
+    problem.previous_weights.assign(kNames, 1.0 / static_cast<double>(kNames));
+    qf::MeanVarianceConfig cfg = long_only();
+    cfg.upper = 0.01;
+    cfg.turnover_penalty = 2e-4;
+    state.set_items_per_iteration(1);
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i)
+            do_not_optimize(qf::optimize_mean_variance(cov, problem, cfg).variance);
+    });
+}
+
+void mean_variance_dense(State& state) {
+    constexpr std::size_t n = 300;
+    qf::PackedSymmetric cov;
+    model(n, 8).to_packed(cov);
+    qf::MeanVarianceProblem problem;
+    problem.expected_returns = signal(n, 7, 5e-4);
+    const qf::MeanVarianceConfig cfg = long_only();
+    state.set_items_per_iteration(1);
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i)
+            do_not_optimize(qf::optimize_mean_variance(cov, problem, cfg).variance);
+    });
+}
+
+void risk_parity_factor(State& state) {
+    const qf::FactorCovariance cov = model(kNames, kFactors);
+    state.set_items_per_iteration(1);
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i)
+            do_not_optimize(qf::risk_parity(cov).variance);
+    });
+}
+
+} // namespace
+
+QF_BENCHMARK("portfolio/mean_variance_factor_3000x40", "macro", mean_variance_factor);
+QF_BENCHMARK("portfolio/warm_rebalance_3000x40", "macro", warm_rebalance);
+QF_BENCHMARK("portfolio/admm_factor_3000x40", "macro", admm_factor);
+QF_BENCHMARK("portfolio/mean_variance_stall_3000x40", "macro", mean_variance_stall);
+QF_BENCHMARK("portfolio/mean_variance_dense_300", "macro", mean_variance_dense);
+QF_BENCHMARK("portfolio/risk_parity_factor_3000x40", "macro", risk_parity_factor);
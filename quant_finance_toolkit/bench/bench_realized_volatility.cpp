@@ -0,0 +1,90 @@
+/**
+ * @file bench_realized_volatility.cpp
+ * @author John Jacobson
+ * @brief Benchmarks for the streaming realized-volatility estimators, per
+ *        tick or per bar.
+ */
+
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "bench_harness.h"
+#include "realized_volatility.h"
+
+namespace {
+
+using qf::bench::State;
+using qf::bench::do_not_optimize;
+
+// One session of 10 Hz ticks: GBM at 2% daily vol plus 2 bp noise.
+struct Tape {
+    std::vector<double> t, price;
+
+    Tape() {
+        std::mt19937_64 rng(3);
+        std::normal_distribution<double> z(0.0, 1.0);
+        const double sig = 0.02 / std::sqrt(23400.0);
+        double x = std::log(100.0);
+        for (double s = 0.0; s < 23400.0; s += 0.1) {
+            x += sig * std::sqrt(0.1) * z(rng);
+            t.push_back(s);
+            price.push_back(std::exp(x + 2e-4 * z(rng)));
+        }
+    }
+};
+
+void tracker(State& state) {
+    Tape tape;
+    state.set_items_per_iteration(tape.t.size());
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i) {
+            qf::RealizedVolTracker tr;
+            for (std::size_t k = 0; k < tape.t.size(); ++k)
+                tr.add(tape.t[k], tape.price[k]);
+            tr.end_session();
+            do_not_optimize(tr.kernel().variance());
+        }
+    });
+}
+
+void kernel_tick_time(State& state) {
+    Tape tape;
+    state.set_items_per_iteration(tape.t.size());
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i) {
+            qf::RealizedKernel k(150);
+            for (std::size_t j = 0; j < tape.t.size(); ++j)
+                k.add(tape.t[j], tape.price[j]);
+            do_not_optimize(k.variance());
+        }
+    });
+}
+
+void range_bars(State& state) {
+    std::vector<qf::Bar> bars;
+    std::mt19937_64 rng(5);
+    std::normal_distribution<double> z(0.0, 0.01);
+    double c = 100.0;
+    for (int i = 0; i < 10000; ++i) {
+        const double o = c * std::exp(z(rng) * 0.1), cl = o * std::exp(z(rng));
+        bars.push_back({o, std::max(o, cl) * 1.002, std::min(o, cl) * 0.998, cl});
+        c = cl;
+    }
+    state.set_items_per_iteration(bars.size());
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i) {
+            qf::RangeVolatility r;
+            for (const auto& b : bars)
+                r.add_bar(b);
+            do_not_optimize(r.yang_zhang());
+        }
+    });
+}
+
+} // namespace
+
+QF_BENCHMARK("realized_vol/tracker_234k_ticks", "macro", tracker);
+QF_BENCHMARK("realized_vol/kernel_h150_234k_ticks", "macro", kernel_tick_time);
+QF_BENCHMARK("realized_vol/range_10k_bars", "micro", range_bars);
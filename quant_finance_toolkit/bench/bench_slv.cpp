@@ -0,0 +1,71 @@
+/**
+ * @file bench_slv.cpp
+ * @author John Jacobson
+ * @brief Benchmarks for particle-method SLV calibration and SLV path
+ *        pricing.
+ */
+
+#include <cmath>
+#include <cstdint>
+
+#include "bench_harness.h"
+#include "payoff_dsl.h"
+#include "slv_calibration.h"
+
+namespace {
+
+using qf::bench::State;
+using qf::bench::do_not_optimize;
+
+constexpr double kSpot = 100.0, kRate = 0.02, kDiv = 0.0, kMaturity = 1.0;
+
+// Quadratic smile in log-forward-moneyness with a negative skew.
+double smile(double T, double K) {
+    const double y = std::log(K / (kSpot * std::exp((kRate - kDiv) * T)));
+    return 0.2 - 0.1 * y + 0.3 * y * y;
+}
+
+void calibrate(State& state) {
+    qf::HestonParams heston;
+    qf::SlvConfig cfg;
+    state.set_items_per_iteration(cfg.particles);
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i)
+            do_not_optimize(qf::calibrate_slv(kSpot, kRate, kDiv, kMaturity, heston, smile, cfg));
+    });
+}
+
+// Down-and-out call, barrier monitored at every calibration step.
+void barrier_price(State& state) {
+    using namespace qf::payoff;
+    qf::HestonParams heston;
+    qf::SlvPathGenerator gen(kSpot, kRate, kDiv, heston,
+                             qf::calibrate_slv(kSpot, kRate, kDiv, kMaturity, heston, smile));
+    auto payoff = ind(path_min(0) > 80.0) * pos(spot(0) - 100.0);
+    qf::McConfig cfg;
+    state.set_items_per_iteration(cfg.paths);
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i)
+            do_not_optimize(qf::payoff::price(gen, payoff, cfg));
+    });
+}
+
+void leverage_lookup(State& state) {
+    qf::HestonParams heston;
+    const qf::LeverageGrid grid = qf::calibrate_slv(kSpot, kRate, kDiv, kMaturity, heston, smile);
+    state.set_items_per_iteration(1000);
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i) {
+            double acc = 0.0;
+            for (int j = 0; j < 1000; ++j)
+                acc += grid(0.001 * j, 70.0 + 0.06 * j);
+            do_not_optimize(acc);
+        }
+    });
+}
+
+} // namespace
+
+QF_BENCHMARK("slv/calibrate_64k_1y", "macro", calibrate);
+QF_BENCHMARK("slv/barrier_price_64k", "macro", barrier_price);
+QF_BENCHMARK("slv/leverage_lookup_1000", "micro", leverage_lookup);
@@ -0,0 +1,134 @@
+/**
+ * @file bench_thread_pool.cpp
+ * @author John Jacobson
+ * @brief Scaling benchmarks for the work-stealing pool.
+ *
+ * The same batch pricing and surface detection workloads are run with 1, 2,
+ * 4 and 8 threads (workers plus the calling thread). Compare the per-item
+ * medians across the threads:N variants to read off the speedup.
+ */
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "bench_harness.h"
+#include "options_greeks.h"
+#include "thread_pool.h"
+#include "vol_surface_arbitrage.h"
+
+namespace {
+
+using qf::bench::State;
+using qf::bench::do_not_optimize;
+
+qf::ThreadPoolOptions pool_options(std::size_t threads) {
+    qf::ThreadPoolOptions opts;
+    opts.num_workers = threads - 1;
+    return opts;
+}
+
+struct Batch {
+    std::vector<double> K, T, sigma, out;
+};
+
+Batch make_batch(std::size_t n) {
+    std::mt19937_64 rng(11);
+    std::uniform_real_distribution<double> strike(60.0, 140.0);
+    std::uniform_real_distribution<double> mat(0.05, 2.0);
+    std::uniform_real_distribution<double> vol(0.1, 0.5);
+    Batch b;
+    for (std::size_t i = 0; i < n; ++i) {
+        b.K.push_back(strike(rng));
+        b.T.push_back(mat(rng));
+        b.sigma.push_back(vol(rng));
+    }
+    b.out.resize(n);
+    return b;
+}
+
+template <std::size_t Threads>
+void batch_pricing(State& state) {
+    qf::ThreadPool pool(pool_options(Threads));
+    Batch b = make_batch(1 << 20);
+    state.set_items_per_iteration(b.K.size());
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t it = 0; it < iters; ++it) {
+            qf::parallel_for_range(pool, 0, b.K.size(), 0, [&](std::size_t lo, std::size_t hi) {
+                for (std::size_t i = lo; i < hi; ++i)
+                    b.out[i] = qf::bs_call(100.0, b.K[i], b.T[i], 0.01, b.sigma[i]);
+            });
+            do_not_optimize(b.out.data());
+        }
+    });
+}
+
+template <std::size_t Threads>
+void batch_portfolio_value(State& state) {
+    qf::ThreadPool pool(pool_options(Threads));
+    Batch b = make_batch(1 << 20);
+    state.set_items_per_iteration(b.K.size());
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t it = 0; it < iters; ++it) {
+            double value = qf::parallel_reduce(
+                pool, 0, b.K.size(), 8192, 0.0,
+                [&](std::size_t lo, std::size_t hi) {
+                    double s = 0.0;
+                    for (std::size_t i = lo; i < hi; ++i)
+                        s += qf::bs_call(100.0, b.K[i], b.T[i], 0.01, b.sigma[i]);
+                    return s;
+                },
+                [](double a, double c) { return a + c; });
+            do_not_optimize(value);
+        }
+    });
+}
+
+// One surface per underlying: 10 maturities x 30 strikes.
+std::vector<std::vector<OptionQuote>> make_surfaces(int n) {
+    std::vector<std::vector<OptionQuote>> surfaces(static_cast<std::size_t>(n));
+    for (int u = 0; u < n; ++u) {
+        double spot = 50.0 + u;
+        for (int m = 0; m < 10; ++m) {
+            double T = 0.1 + 0.2 * m;
+            for (int k = 0; k < 30; ++k) {
+                double K = spot * (0.6 + 0.8 * k / 29.0);
+                double x = K / spot - 1.0;
+                double vol = 0.2 + 0.02 * T + 0.1 * x * x;
+                surfaces[static_cast<std::size_t>(u)].push_back(
+                    {K, T, vol, 'C', 0.0, 0.0, spot, 0.01});
+            }
+        }
+    }
+    return surfaces;
+}
+
+template <std::size_t Threads>
+void surface_detection(State& state) {
+    qf::ThreadPool pool(pool_options(Threads));
+    auto surfaces = make_surfaces(64);
+    std::vector<std::size_t> flags(surfaces.size());
+    VolSurfaceArbitrageDetector detector;
+    state.set_items_per_iteration(surfaces.size());
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t it = 0; it < iters; ++it) {
+            qf::parallel_for(pool, 0, surfaces.size(), 1, [&](std::size_t u) {
+                flags[u] = detector.detect_arbitrage(surfaces[u]).size();
+            });
+            do_not_optimize(flags.data());
+        }
+    });
+}
+
+} // namespace
+
+QF_BENCHMARK("thread_pool/bs_call_batch_1m/threads:1", "macro", batch_pricing<1>);
+QF_BENCHMARK("thread_pool/bs_call_batch_1m/threads:2", "macro", batch_pricing<2>);
+QF_BENCHMARK("thread_pool/bs_call_batch_1m/threads:4", "macro", batch_pricing<4>);
+QF_BENCHMARK("thread_pool/bs_call_batch_1m/threads:8", "macro", batch_pricing<8>);
+QF_BENCHMARK("thread_pool/reduce_portfolio_1m/threads:1", "macro", batch_portfolio_value<1>);
+QF_BENCHMARK("thread_pool/reduce_portfolio_1m/threads:4", "macro", batch_portfolio_value<4>);
+QF_BENCHMARK("thread_pool/detect_surfaces_64/threads:1", "macro", surface_detection<1>);
+QF_BENCHMARK("thread_pool/detect_surfaces_64/threads:2", "macro", surface_detection<2>);
+QF_BENCHMARK("thread_pool/detect_surfaces_64/threads:4", "macro", surface_detection<4>);
+QF_BENCHMARK("thread_pool/detect_surfaces_64/threads:8", "macro", surface_detection<8>);
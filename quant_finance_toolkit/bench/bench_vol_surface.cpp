@@ -0,0 +1,151 @@
+/**
+ * @file bench_vol_surface.cpp
+ * @author John Jacobson
+ * @brief Benchmarks for the volatility surface arbitrage detector.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "bench_harness.h"
+#include "memory_arena.h"
+#include "parity_normalization.h"
+#include "vol_surface_arbitrage.h"
+
+namespace {
+
+using qf::bench::State;
+using qf::bench::do_not_optimize;
+
+// Regular strike x maturity grid with a smile and upward sloping term
+// structure, so the detector has to walk everything without early exits.
+std::vector<OptionQuote> make_surface(int n_maturities, int n_strikes) {
+    std::vector<OptionQuote> quotes;
+    quotes.reserve(static_cast<std::size_t>(n_maturities * n_strikes));
+    for (int m = 0; m < n_maturities; ++m) {
+        double T = 0.1 + 0.1 * m;
+        for (int k = 0; k < n_strikes; ++k) {
+            double K = 60.0 + 80.0 * k / (n_strikes - 1);
+            double x = (K - 100.0) / 100.0;
+            double vol = 0.20 + 0.02 * T + 0.10 * x * x;
+            quotes.push_back({K, T, vol, 'C', 0.0, 0.0, 100.0, 0.01});
+        }
+    }
+    return quotes;
+}
+
+void detect_small(State& state) {
+    std::vector<OptionQuote> quotes = {
+        {100.0, 0.5, 0.20, 'C', 4.8, 5.2, 100.0, 0.01},
+        {100.0, 1.0, 0.25, 'C', 7.8, 8.2, 100.0, 0.01},
+        { 90.0, 0.5, 0.22, 'C', 11.8, 12.2, 100.0, 0.01},
+        {110.0, 0.5, 0.19, 'C', 1.8, 2.2, 100.0, 0.01},
+    };
+    VolSurfaceArbitrageDetector detector;
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i)
+            do_not_optimize(detector.detect_arbitrage(quotes));
+    });
+}
+
+// The small surface with its scratch in an arena, reset once per batch of
+// kArenaBatch surfaces as the pipeline's detect stage would.
+constexpr std::uint64_t kArenaBatch = 64;
+
+void detect_small_arena(State& state) {
+    std::vector<OptionQuote> quotes = {
+        {100.0, 0.5, 0.20, 'C', 4.8, 5.2, 100.0, 0.01},
+        {100.0, 1.0, 0.25, 'C', 7.8, 8.2, 100.0, 0.01},
+        { 90.0, 0.5, 0.22, 'C', 11.8, 12.2, 100.0, 0.01},
+        {110.0, 0.5, 0.19, 'C', 1.8, 2.2, 100.0, 0.01},
+    };
+    VolSurfaceArbitrageDetector detector;
+    qf::MonotonicArena arena(64 * 1024);
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i) {
+            do_not_optimize(detector.detect_arbitrage(quotes, &arena));
+            if ((i + 1) % kArenaBatch == 0)
+                arena.reset();
+        }
+        arena.reset();
+    });
+}
+
+void detect_surface(State& state) {
+    auto quotes = make_surface(20, 50);
+    VolSurfaceArbitrageDetector detector;
+    state.set_items_per_iteration(quotes.size());
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i)
+            do_not_optimize(detector.detect_arbitrage(quotes));
+    });
+}
+
+// Scratch in an arena reset after every surface. This runs level with the
+// heap variant: the O(n^2) calendar scan dominates a 1,000-quote surface and
+// the scratch is a few allocations, so there is little malloc time to save.
+// The arena pays off on small surfaces (detect_arbitrage_4q/arena) and when
+// several detect workers would otherwise contend on the global allocator.
+void detect_surface_arena(State& state) {
+    auto quotes = make_surface(20, 50);
+    VolSurfaceArbitrageDetector detector;
+    qf::MonotonicArena arena(256 * 1024);
+    state.set_items_per_iteration(quotes.size());
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i) {
+            do_not_optimize(detector.detect_arbitrage(quotes, &arena));
+            arena.reset();
+        }
+    });
+}
+
+// The same grid quoted as a call and a put at every strike.
+std::vector<OptionQuote> make_mixed_surface(int n_maturities, int n_strikes) {
+    std::vector<OptionQuote> quotes;
+    for (const auto& c : make_surface(n_maturities, n_strikes)) {
+        double price = qf::bs_call(c.spot, c.strike, c.maturity, c.rate, c.implied_vol);
+        double put = price - c.spot + c.strike * std::exp(-c.rate * c.maturity);
+        OptionQuote call = c, p = c;
+        call.bid = std::max(price - 0.05, 0.01);
+        call.ask = price + 0.05;
+        p.option_type = 'P';
+        p.bid = std::max(put - 0.05, 0.01);
+        p.ask = put + 0.05;
+        quotes.push_back(call);
+        quotes.push_back(p);
+    }
+    return quotes;
+}
+
+void normalize_mixed(State& state) {
+    auto quotes = make_mixed_surface(20, 50);
+    state.set_items_per_iteration(quotes.size());
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i) {
+            qf::NormalizedChain chain = qf::normalize_chain(quotes);
+            do_not_optimize(chain.strike.data());
+        }
+    });
+}
+
+// Detection alone on the normalized chain (1000 rows), comparable with
+// detect_arbitrage_20x50.
+void detect_normalized(State& state) {
+    qf::NormalizedChain chain = qf::normalize_chain(make_mixed_surface(20, 50));
+    state.set_items_per_iteration(chain.size());
+    state.run([&](std::uint64_t iters) {
+        for (std::uint64_t i = 0; i < iters; ++i)
+            do_not_optimize(qf::detect_arbitrage(chain));
+    });
+}
+
+} // namespace
+
+QF_BENCHMARK("vol_surface/detect_arbitrage_4q", "micro", detect_small);
+QF_BENCHMARK("vol_surface/detect_arbitrage_4q/arena", "micro", detect_small_arena);
+QF_BENCHMARK("vol_surface/detect_arbitrage_20x50", "macro", detect_surface);
+QF_BENCHMARK("vol_surface/detect_arbitrage_20x50/arena", "macro", detect_surface_arena);
+QF_BENCHMARK("vol_surface/normalize_chain_20x50x2", "macro", normalize_mixed);
+QF_BENCHMARK("vol_surface/detect_arbitrage_normalized_20x50", "macro", detect_normalized);
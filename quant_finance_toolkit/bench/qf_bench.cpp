@@ -0,0 +1,211 @@
+/**
+ * @file qf_bench.cpp
+ * @author John Jacobson
+ * @brief Entry point for the toolkit benchmark suite.
+ *
+ * Runs every registered benchmark (see bench_*.cpp), prints a summary table,
+ * optionally writes JSON results, and optionally compares against a stored
+ * baseline. The process exits with status 1 when a benchmark regresses, so
+ * it can gate a build.
+ *
+ * Usage:
+ *   qf_bench [--filter SUBSTR] [--repetitions N] [--min-time-ms MS]
+ *            [--warmup-ms MS] [--json OUT.json]
+ *            [--baseline BASE.json] [--threshold FRACTION] [--list]
+ *            [--trace TRACE.json] [--perf] [--metrics-port PORT]
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bench_harness.h"
+#include "metrics_http.h"
+#include "trace.h"
+
+namespace {
+
+void usage(const char* argv0) {
+    std::cerr
+        << "usage: " << argv0 << " [options]\n"
+        << "  --filter SUBSTR       only run benchmarks whose name contains SUBSTR\n"
+        << "  --repetitions N       timed samples per benchmark (default 15)\n"
+        << "  --min-time-ms MS      minimum duration of one sample (default 10)\n"
+        << "  --warmup-ms MS        warm-up time per benchmark (default 50)\n"
+        << "  --json PATH           write results as JSON\n"
+        << "  --baseline PATH       compare against a baseline JSON file\n"
+        << "  --threshold FRACTION  allowed median slowdown (default 0.10)\n"
+        << "  --list                list benchmark names and exit\n"
+        << "  --trace PATH          write recorded trace spans (needs QF_ENABLE_TRACING)\n"
+        << "  --perf                report hardware counters per item (Linux perf_event)\n"
+        << "  --metrics-port PORT   serve /metrics on 127.0.0.1:PORT while running\n"
+        << "                        (needs QF_ENABLE_METRICS)\n";
+}
+
+bool matches(const std::string& name, const std::string& filter) {
+    return filter.empty() || name.find(filter) != std::string::npos;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    using namespace qf::bench;
+
+    Config cfg;
+    std::string filter;
+    std::string json_path;
+    std::string baseline_path;
+    std::string trace_path;
+    double threshold = 0.10;
+    bool list_only = false;
+    int metrics_port = -1;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next = [&]() -> const char* {
+            if (i + 1 >= argc) {
+                std::cerr << "missing value for " << arg << "\n";
+                std::exit(2);
+            }
+            return argv[++i];
+        };
+
+        if (arg == "--filter") filter = next();
+        else if (arg == "--repetitions") cfg.repetitions = std::max(1, std::atoi(next()));
+        else if (arg == "--min-time-ms") cfg.min_sample_ms = std::atof(next());
+        else if (arg == "--warmup-ms") cfg.warmup_ms = std::atof(next());
+        else if (arg == "--json") json_path = next();
+        else if (arg == "--baseline") baseline_path = next();
+        else if (arg == "--threshold") threshold = std::atof(next());
+        else if (arg == "--list") list_only = true;
+        else if (arg == "--trace") trace_path = next();
+        else if (arg == "--perf") cfg.perf_counters = true;
+        else if (arg == "--metrics-port") metrics_port = std::atoi(next());
+        else if (arg == "--help" || arg == "-h") { usage(argv[0]); return 0; }
+        else {
+            std::cerr << "unknown option: " << arg << "\n";
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    if (list_only) {
+        for (const auto& b : registry())
+            if (matches(b.name, filter))
+                std::cout << b.name << " (" << b.kind << ")\n";
+        return 0;
+    }
+
+    std::unique_ptr<qf::metrics::MetricsServer> metrics_server;
+    if (metrics_port >= 0) {
+        if (!qf::metrics::enabled())
+            std::cerr << "warning: built without QF_ENABLE_METRICS, /metrics will be empty\n";
+        metrics_server = std::make_unique<qf::metrics::MetricsServer>(
+            static_cast<std::uint16_t>(metrics_port));
+        try {
+            metrics_server->start();
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << "\n";
+            return 2;
+        }
+        std::cerr << "serving metrics on http://127.0.0.1:" << metrics_server->port()
+                  << "/metrics\n";
+    }
+
+    std::vector<Result> results;
+    bool warned_no_counters = false;
+    std::printf("%-48s %6s %14s %12s %12s\n", "benchmark", "kind", "median ns/item",
+                "MAD", "min");
+    for (const auto& b : registry()) {
+        if (!matches(b.name, filter))
+            continue;
+
+        Result r;
+        r.name = b.name;
+        r.kind = b.kind;
+        // Opened before setup so threads the benchmark starts are counted.
+        std::unique_ptr<qf::PerfCounters> counters;
+        if (cfg.perf_counters) {
+            counters = std::make_unique<qf::PerfCounters>();
+            if (!counters->available() && !warned_no_counters) {
+                std::cerr << "note: hardware counters unavailable ("
+                          << counters->unavailable_reason() << "), timing only\n";
+                warned_no_counters = true;
+            }
+        }
+
+        State state(cfg, r, counters.get());
+        b.fn(state);
+        if (!state.ran()) {
+            std::cerr << "benchmark " << b.name << " never called State::run()\n";
+            return 2;
+        }
+
+        std::printf("%-48s %6s %14.2f %12.2f %12.2f\n", r.name.c_str(), r.kind.c_str(),
+                    r.median_ns, r.mad_ns, r.min_ns);
+        if (!r.counters.empty()) {
+            std::printf("    ");
+            for (const auto& kv : r.counters)
+                std::printf(" %s=%.3g", kv.first.c_str(), kv.second);
+            std::printf("\n");
+        }
+        std::fflush(stdout);
+        results.push_back(r);
+    }
+
+    if (!json_path.empty()) {
+        std::ofstream out(json_path);
+        if (!out) {
+            std::cerr << "cannot write " << json_path << "\n";
+            return 2;
+        }
+        write_json(out, results, cfg);
+    }
+
+    if (!trace_path.empty()) {
+        if (!qf::trace::enabled())
+            std::cerr << "warning: built without QF_ENABLE_TRACING, trace will be empty\n";
+        qf::trace::write_chrome_trace(trace_path);
+    }
+
+    if (baseline_path.empty())
+        return 0;
+
+    std::vector<Result> baseline;
+    try {
+        for (auto& b : load_results(baseline_path))
+            if (matches(b.name, filter))
+                baseline.push_back(b);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 2;
+    }
+
+    auto cmp = compare_to_baseline(results, baseline, threshold);
+
+    int regressions = 0;
+    std::printf("\nBaseline comparison (%s, threshold %.1f%%)\n", baseline_path.c_str(),
+                threshold * 100.0);
+    std::printf("%-48s %12s %12s %9s  %s\n", "benchmark", "baseline", "current",
+                "change", "status");
+    for (const auto& c : cmp) {
+        if (c.status == "REGRESSED")
+            ++regressions;
+        std::printf("%-48s %12.2f %12.2f %+8.1f%%  %s\n", c.name.c_str(), c.baseline_ns,
+                    c.current_ns, c.change * 100.0, c.status.c_str());
+    }
+
+    if (regressions > 0) {
+        std::printf("\nFAILED: %d benchmark(s) regressed by more than %.1f%%\n",
+                    regressions, threshold * 100.0);
+        return 1;
+    }
+
+    std::printf("\nNo regressions.\n");
+    return 0;
+}
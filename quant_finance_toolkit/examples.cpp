@@ -5,16 +5,30 @@
  *
  * This file runs a few small demonstrations of:
  *   - Volatility surface arbitrage checks
- *   - Black–Scholes Greeks and implied volatility
+ *   - Black–Scholes Greeks, implied volatility and the Chebyshev price proxy
  *   - A simple limit order book simulation
+ *   - A paced quote replay through the streaming arbitrage pipeline
+ *   - American puts by BAW, QD+, Andersen–Lake and a binomial lattice
+ *
+ * When built with QF_ENABLE_TRACING the run is written to
+ * examples_trace.json, which opens in chrome://tracing or Perfetto. With
+ * QF_ENABLE_METRICS the collected metrics are printed in Prometheus format.
  */
 
+#include <cmath>
+#include <cstdint>
 #include <iostream>
+#include <map>
 #include <vector>
 
 #include "include/vol_surface_arbitrage.h"
 #include "include/options_greeks.h"
+#include "include/american_options.h"
+#include "include/bs_proxy.h"
 #include "include/orderbook_simulator.h"
+#include "include/streaming_pipeline.h"
+#include "include/metrics.h"
+#include "include/trace.h"
 
 int main() {
     using namespace qf;
@@ -70,6 +84,11 @@ int main() {
                   << ", Theta: " << g.theta
                   << ", Rho: " << g.rho << "\n";
 
+        const BsProxy& proxy = default_bs_proxy();
+        std::cout << "Chebyshev proxy price: " << proxy.call(S, K, T, r, sigma)
+                  << " (error estimate " << S * sigma * std::sqrt(T) * proxy.error_bound()
+                  << ")\n";
+
         try {
             double implied = implied_vol_call(call_price, S, K, T, r);
             std::cout << "Implied vol recovered from price: " << implied << "\n\n";
@@ -114,5 +133,68 @@ int main() {
                   << (ob.best_ask().has_value() ? std::to_string(*ob.best_ask()) : "none") << "\n\n";
     }
 
+    // ===============================
+    // 4. Streaming arbitrage pipeline
+    // ===============================
+    {
+        std::cout << "=== Streaming Pipeline Example ===\n";
+
+        // 4 symbols, 4 maturities x 15 strikes each, then 10k updates
+        // replayed at 50k ticks/s with occasional mispriced calls.
+        ReplaySource source(make_replay_ticks(4, 4, 15, 10000, 0.01), 50000.0);
+        ArbitragePipeline pipeline;
+        std::size_t printed = 0, out_of_order = 0;
+        std::map<std::uint32_t, std::uint64_t> last_version;
+        auto report = pipeline.run(source, [&](const SurfaceCheck& c) {
+            std::uint64_t& last = last_version[c.symbol];
+            if (c.version <= last)
+                ++out_of_order;
+            last = c.version;
+            if (printed++ < 3)
+                std::cout << "  alert: symbol " << c.symbol << " v" << c.version << " "
+                          << c.found.front().type << " (" << c.found.size() << " flags)\n";
+        });
+        report.print(std::cout);
+        std::cout << "\n";
+        // The sink promises increasing versions per symbol.
+        if (out_of_order != 0) {
+            std::cerr << out_of_order << " alert(s) delivered out of version order\n";
+            return 1;
+        }
+    }
+
+    // ===============================
+    // 5. American options
+    // ===============================
+    {
+        std::cout << "=== American Put Example ===\n";
+
+        double S = 100.0, K = 100.0, T = 1.0, r = 0.05, q = 0.0, sigma = 0.20;
+
+        std::cout << "European:            " << bs_price_q(false, S, K, T, r, q, sigma) << "\n";
+        std::cout << "Barone-Adesi-Whaley: "
+                  << american_price(AmericanMethod::BaroneAdesiWhaley, false, S, K, T, r, q, sigma)
+                  << "\n";
+        std::cout << "QD+:                 "
+                  << american_price(AmericanMethod::QdPlus, false, S, K, T, r, q, sigma) << "\n";
+        double alo = american_price(AmericanMethod::AndersenLake, false, S, K, T, r, q, sigma);
+        std::cout << "Andersen-Lake:       " << alo << "\n";
+        std::cout << "Binomial (2000):     " << american_binomial(false, S, K, T, r, q, sigma, 2000)
+                  << "\n";
+        std::cout << "American implied vol from the Andersen-Lake price: "
+                  << implied_vol_american(AmericanMethod::AndersenLake, false, alo, S, K, T, r, q)
+                  << "\n\n";
+    }
+
+    if (trace::enabled()) {
+        trace::write_chrome_trace("examples_trace.json");
+        std::cout << "Trace written to examples_trace.json\n";
+    }
+
+    if (metrics::enabled()) {
+        std::cout << "=== Metrics (Prometheus text format) ===\n";
+        std::cout << metrics::registry().render_prometheus();
+    }
+
     return 0;
 }
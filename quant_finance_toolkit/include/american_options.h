@@ -0,0 +1,775 @@
+#ifndef QF_AMERICAN_OPTIONS_H
+#define QF_AMERICAN_OPTIONS_H
+
+/**
+ * @file american_options.h
+ * @author John Jacobson
+ * @brief Analytic and spectral American option pricers with a per-expiry
+ *        chain sweep and American implied vol.
+ *
+ * A lattice needs thousands of steps for cent-level accuracy on a single
+ * stock chain, which is far too slow for live quoting. These methods price
+ * from the early exercise boundary instead:
+ *
+ *   - Barone-Adesi–Whaley (1987): quadratic approximation, one root solve.
+ *     The classic baseline. Against a 4000-step tree (S = 100, K 80–120)
+ *     its error stays under 0.1 up to three months, reaches about 0.2 at
+ *     one year and about 1.2 at three years with σ = 0.6, r = 8%, q = 10%;
+ *     it grows with maturity, volatility and the carry.
+ *   - QD+ (Li 2010): Ju–Zhong's quadratic decomposition with the time
+ *     derivative of the premium kept to first order. Same cost as BAW,
+ *     and about half its error on a broad grid; its boundary is close
+ *     enough to seed the Andersen–Lake iteration.
+ *   - Andersen–Lake–Offengelden (2016): solves the integral equation for
+ *     the exercise boundary by fixed-point iteration on Chebyshev nodes,
+ *     starting from the QD+ boundary, then integrates the early exercise
+ *     premium. Accuracy is set by AloConfig; the defaults stay within
+ *     1e-3 of a converged solve on almost all of a broad test grid, with
+ *     a worst case of about 4e-3 on deep in-the-money, multi-year puts.
+ *
+ * Everything is written for the put. Calls use the put–call symmetry
+ * C(S, K, r, q) = P(K, S, q, r), so dividend-paying calls get the same
+ * treatment. The Black–Scholes normal kernels come from options_greeks.h.
+ *
+ * The boundary scaled by the strike depends only on (T, r, q, σ), and the
+ * collocation times, quadrature points, discount factors and Chebyshev
+ * interpolation weights depend only on (T, r, q). AmericanChainPricer
+ * builds those tables once per expiry and then prices each strike with
+ * flat loops over them (no log/exp of the time grid per option, no
+ * Clenshaw sums). american_price_batch() regroups a sorted chain by expiry
+ * automatically.
+ *
+ * Negative rates with q < r < 0 (puts) have a double exercise boundary
+ * that none of these methods model; those inputs go to the binomial lattice.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "options_greeks.h"
+#include "trace.h"
+
+namespace qf {
+
+enum class AmericanMethod {
+    BaroneAdesiWhaley,
+    QdPlus,
+    AndersenLake
+};
+
+// Resolution of the Andersen–Lake–Offengelden solver.
+struct AloConfig {
+    std::size_t nodes = 8;          // Chebyshev collocation nodes for the boundary
+    std::size_t quad_points = 16;   // Gauss–Legendre points per boundary integral
+    std::size_t iterations = 6;     // fixed-point sweeps
+    std::size_t price_points = 32;  // Gauss–Legendre points for the premium integral
+};
+
+// =======================
+// European with dividend yield
+// =======================
+
+inline double bs_price_q(bool is_call, double S, double K, double T, double r, double q,
+                         double sigma) {
+    if (T <= 0.0)
+        return is_call ? std::max(S - K, 0.0) : std::max(K - S, 0.0);
+
+    double v = sigma * std::sqrt(T);
+    double d1 = (std::log(S / K) + (r - q) * T) / v + 0.5 * v;
+    double d2 = d1 - v;
+    double dq = std::exp(-q * T), dr = std::exp(-r * T);
+    if (is_call)
+        return S * dq * norm_cdf(d1) - K * dr * norm_cdf(d2);
+    return K * dr * norm_cdf(-d2) - S * dq * norm_cdf(-d1);
+}
+
+namespace detail {
+
+/**
+ * Brent's method on [a, b] with f(a), f(b) of opposite sign. Returns the
+ * bracketed root to within `tol`.
+ */
+template <typename F>
+double brent_root(F&& f, double a, double b, double fa, double fb, double tol,
+                  int max_iter = 100) {
+    if (std::fabs(fa) < std::fabs(fb)) {
+        std::swap(a, b);
+        std::swap(fa, fb);
+    }
+    double c = a, fc = fa, d = b - a;
+    bool bisected = true;
+
+    for (int i = 0; i < max_iter && fb != 0.0 && std::fabs(b - a) > tol; ++i) {
+        double s;
+        if (fa != fc && fb != fc) {
+            s = a * fb * fc / ((fa - fb) * (fa - fc)) + b * fa * fc / ((fb - fa) * (fb - fc)) +
+                c * fa * fb / ((fc - fa) * (fc - fb));
+        } else {
+            s = b - fb * (b - a) / (fb - fa);
+        }
+
+        double lo = (3.0 * a + b) / 4.0;
+        bool outside = (s - lo) * (s - b) > 0.0;
+        if (outside || (bisected && std::fabs(s - b) >= 0.5 * std::fabs(b - c)) ||
+            (!bisected && std::fabs(s - b) >= 0.5 * std::fabs(c - d)) ||
+            (bisected && std::fabs(b - c) < tol) || (!bisected && std::fabs(c - d) < tol)) {
+            s = 0.5 * (a + b);
+            bisected = true;
+        } else {
+            bisected = false;
+        }
+
+        double fs = f(s);
+        d = c;
+        c = b;
+        fc = fb;
+        if (fa * fs < 0.0) {
+            b = s;
+            fb = fs;
+        } else {
+            a = s;
+            fa = fs;
+        }
+        if (std::fabs(fa) < std::fabs(fb)) {
+            std::swap(a, b);
+            std::swap(fa, fb);
+        }
+    }
+    return b;
+}
+
+// Gauss–Legendre nodes and weights on [−1, 1].
+inline void gauss_legendre(std::size_t n, std::vector<double>& x, std::vector<double>& w) {
+    x.assign(n, 0.0);
+    w.assign(n, 0.0);
+    for (std::size_t i = 0; i < n; ++i) {
+        double z = std::cos(M_PI * (static_cast<double>(i) + 0.75) / (static_cast<double>(n) + 0.5));
+        double dp = 1.0;
+        for (int it = 0; it < 100; ++it) {
+            double p0 = 1.0, p1 = z;
+            for (std::size_t k = 2; k <= n; ++k) {
+                double pk = ((2.0 * k - 1.0) * z * p1 - (k - 1.0) * p0) / static_cast<double>(k);
+                p0 = p1;
+                p1 = pk;
+            }
+            dp = static_cast<double>(n) * (z * p1 - p0) / (z * z - 1.0);
+            double dz = p1 / dp;
+            z -= dz;
+            if (std::fabs(dz) < 1e-15) break;
+        }
+        x[i] = -z;  // ascending
+        w[i] = 2.0 / ((1.0 - z * z) * dp * dp);
+    }
+}
+
+/**
+ * True when early exercise of a put never pays (or the double-boundary
+ * regime applies). Sets `lattice` for the latter.
+ */
+inline bool put_is_european(double r, double q, bool& lattice) {
+    lattice = r < 0.0 && q < r;
+    return r <= 0.0;
+}
+
+// Normalized (K = 1) European put.
+inline double euro_put_n(double x, double T, double r, double q, double sigma) {
+    return bs_price_q(false, x, 1.0, T, r, q, sigma);
+}
+
+} // namespace detail
+
+// =======================
+// Binomial reference
+// =======================
+
+/**
+ * @brief Cox–Ross–Rubinstein lattice, averaged over `steps` and `steps + 1`
+ * to damp the odd/even oscillation. Reference for the approximations and
+ * the fallback for the double-boundary regime; too slow for quoting.
+ */
+inline double american_binomial(bool is_call, double S, double K, double T, double r, double q,
+                                double sigma, std::size_t steps = 1000) {
+    if (T <= 0.0)
+        return is_call ? std::max(S - K, 0.0) : std::max(K - S, 0.0);
+
+    auto run = [&](std::size_t n) {
+        double dt = T / static_cast<double>(n);
+        double u = std::exp(sigma * std::sqrt(dt)), d = 1.0 / u;
+        double p = (std::exp((r - q) * dt) - d) / (u - d);
+        double disc = std::exp(-r * dt);
+        std::vector<double> v(n + 1);
+        for (std::size_t i = 0; i <= n; ++i) {
+            double s = S * std::pow(u, static_cast<double>(n - i)) * std::pow(d, static_cast<double>(i));
+            v[i] = is_call ? std::max(s - K, 0.0) : std::max(K - s, 0.0);
+        }
+        for (std::size_t step = n; step-- > 0;) {
+            double s = S * std::pow(u, static_cast<double>(step));
+            for (std::size_t i = 0; i <= step; ++i) {
+                double hold = disc * (p * v[i] + (1.0 - p) * v[i + 1]);
+                double ex = is_call ? s - K : K - s;
+                v[i] = std::max(hold, ex);
+                s *= d * d;
+            }
+        }
+        return v[0];
+    };
+    return 0.5 * (run(steps) + run(steps + 1));
+}
+
+// =======================
+// Barone-Adesi–Whaley
+// =======================
+
+inline double american_baw(bool is_call, double S, double K, double T, double r, double q,
+                           double sigma) {
+    if (is_call)
+        return american_baw(false, K, S, T, q, r, sigma);
+    if (T <= 0.0)
+        return std::max(K - S, 0.0);
+
+    bool lattice;
+    if (detail::put_is_european(r, q, lattice))
+        return lattice ? american_binomial(false, S, K, T, r, q, sigma)
+                       : bs_price_q(false, S, K, T, r, q, sigma);
+
+    const double v = sigma * std::sqrt(T);
+    const double M = 2.0 * r / (sigma * sigma), N = 2.0 * (r - q) / (sigma * sigma);
+    const double h = 1.0 - std::exp(-r * T);
+    const double q1 = 0.5 * (-(N - 1.0) - std::sqrt((N - 1.0) * (N - 1.0) + 4.0 * M / h));
+    const double dq = std::exp(-q * T);
+
+    // K − S* = p(S*) − (1 − e^{−qT} N(−d1(S*))) S* / q1
+    auto f = [&](double s) {
+        double d1 = (std::log(s / K) + (r - q) * T) / v + 0.5 * v;
+        return bs_price_q(false, s, K, T, r, q, sigma) - (1.0 - dq * norm_cdf(-d1)) * s / q1 -
+               (K - s);
+    };
+    double lo = 1e-8 * K, hi = K;
+    double s_star = detail::brent_root(f, lo, hi, f(lo), f(hi), 1e-10 * K);
+
+    if (S <= s_star)
+        return K - S;
+    double d1 = (std::log(s_star / K) + (r - q) * T) / v + 0.5 * v;
+    double A = -(s_star / q1) * (1.0 - dq * norm_cdf(-d1));
+    return bs_price_q(false, S, K, T, r, q, sigma) + A * std::pow(S / s_star, q1);
+}
+
+// =======================
+// QD+
+// =======================
+
+namespace detail {
+
+// Coefficients of the QD+ approximation for a put at time to maturity T.
+struct QdPlusParams {
+    double h, alpha, omega, lambda, lambda_prime;
+
+    QdPlusParams(double T, double r, double q, double sigma) {
+        h = 1.0 - std::exp(-r * T);
+        alpha = 2.0 * r / (sigma * sigma);
+        omega = 2.0 * (r - q) / (sigma * sigma);
+        double root = std::sqrt((omega - 1.0) * (omega - 1.0) + 4.0 * alpha / h);
+        lambda = 0.5 * (-(omega - 1.0) - root);
+        lambda_prime = alpha / (h * h * root);
+    }
+};
+
+// Theta term of the QD+ c0 coefficient for the normalized European put
+// (the form used by Li 2010 and QuantLib).
+inline double euro_put_theta_n(double x, double T, double r, double q, double sigma) {
+    double v = sigma * std::sqrt(T);
+    double d1 = (std::log(x) + (r - q) * T) / v + 0.5 * v;
+    double d2 = d1 - v;
+    return r * std::exp(-r * T) * norm_cdf(-d2) - q * x * std::exp(-q * T) * norm_cdf(-d1) -
+           0.5 * sigma * x * std::exp(-q * T) * norm_pdf(d1) / std::sqrt(T);
+}
+
+/**
+ * QD+ exercise boundary S* / K of a put with time to maturity T (r > 0).
+ * The smooth-pasting condition is written with c0 multiplied through, so
+ * it has no pole where the European put equals intrinsic.
+ */
+inline double qdplus_boundary_n(double T, double r, double q, double sigma) {
+    const QdPlusParams P(T, r, q, sigma);
+    const double den = 2.0 * P.lambda + P.omega - 1.0;
+    const double A = (1.0 - P.h) * P.alpha / den;
+    const double c_lin = P.lambda - A * (1.0 / P.h + P.lambda_prime / den);
+    const double v = sigma * std::sqrt(T), dq = std::exp(-q * T), er = std::exp(r * T);
+    const double x_max = q > 0.0 ? std::min(1.0, r / q) : 1.0;
+
+    auto f = [&](double s) {
+        double d1 = (std::log(s) + (r - q) * T) / v + 0.5 * v;
+        double p = euro_put_n(s, T, r, q, sigma);
+        double theta = euro_put_theta_n(s, T, r, q, sigma);
+        return (1.0 - dq * norm_cdf(-d1)) * s + c_lin * (1.0 - s - p) + A * er * theta / r;
+    };
+
+    double hi = x_max * (1.0 - 1e-12), fhi = f(hi);
+    double lo = 0.5 * x_max, flo = f(lo);
+    while (flo * fhi > 0.0 && lo > 1e-12) {
+        hi = lo;
+        fhi = flo;
+        lo *= 0.5;
+        flo = f(lo);
+    }
+    if (flo * fhi > 0.0)
+        return x_max;
+    return brent_root(f, lo, hi, flo, fhi, 1e-12);
+}
+
+// QD+ price of a normalized put (K = 1) at spot x, given the boundary.
+inline double qdplus_put_n(double x, double s_star, double T, double r, double q, double sigma) {
+    if (x <= s_star)
+        return 1.0 - x;
+    const QdPlusParams P(T, r, q, sigma);
+    const double den = 2.0 * P.lambda + P.omega - 1.0;
+    const double p_star = euro_put_n(s_star, T, r, q, sigma);
+    const double gap = std::max(1.0 - s_star - p_star, 0.0);
+    const double theta = euro_put_theta_n(s_star, T, r, q, sigma);
+    const double c0 = gap > 0.0 ? -((1.0 - P.h) * P.alpha / den) *
+                                      (1.0 / P.h - std::exp(r * T) * theta / (r * gap) +
+                                       P.lambda_prime / den)
+                                : 0.0;
+    const double b = (1.0 - P.h) * P.alpha * P.lambda_prime / (2.0 * den);
+    const double l = std::log(x / s_star);
+    const double premium = gap / (1.0 - b * l * l - c0 * l) * std::pow(x / s_star, P.lambda);
+    return std::max(euro_put_n(x, T, r, q, sigma) + premium, 1.0 - x);
+}
+
+} // namespace detail
+
+inline double american_qdplus(bool is_call, double S, double K, double T, double r, double q,
+                              double sigma) {
+    if (is_call)
+        return american_qdplus(false, K, S, T, q, r, sigma);
+    if (T <= 0.0)
+        return std::max(K - S, 0.0);
+
+    bool lattice;
+    if (detail::put_is_european(r, q, lattice))
+        return lattice ? american_binomial(false, S, K, T, r, q, sigma)
+                       : bs_price_q(false, S, K, T, r, q, sigma);
+
+    double s_star = detail::qdplus_boundary_n(T, r, q, sigma);
+    return K * detail::qdplus_put_n(S / K, s_star, T, r, q, sigma);
+}
+
+// =======================
+// Andersen–Lake–Offengelden chain pricer
+// =======================
+
+/**
+ * @brief Prices any number of strikes and vols sharing one expiry, rate and
+ * dividend yield.
+ *
+ * The constructor lays out everything that depends only on (T, r, q): the
+ * Chebyshev collocation times τ_i = T ((1 + z_i) / 2)^2, the Gauss–Legendre
+ * points of every boundary integral with their discount factors, and the
+ * interpolation weights that map node values of H = ln(B / B(0+))^2 to each
+ * quadrature point. A price is then the QD+ starting boundary, a few
+ * fixed-point sweeps and one premium integral, all as flat loops over
+ * those tables.
+ *
+ * The sweeps use the paper's FP-A form, B = K e^{−(r−q)τ} N / D with the
+ * N(d±) integrals. FP-B (the φ form) converges in fewer sweeps when it
+ * converges, but diverges for large r / σ^2, e.g. r = 8%, σ = 10%.
+ *
+ * Holds scratch buffers and the last boundary, so use one instance per
+ * thread.
+ */
+class AmericanChainPricer {
+public:
+    AmericanChainPricer(double T, double r, double q, AloConfig cfg = {})
+        : T_(T), r_(r), q_(q), cfg_(cfg) {
+        if (cfg_.nodes < 2 || cfg_.quad_points == 0 || cfg_.price_points == 0)
+            throw std::runtime_error("AmericanChainPricer: need >= 2 nodes and >= 1 quadrature point");
+        if (T_ > 0.0)
+            build_tables();
+    }
+
+    double expiry() const { return T_; }
+    double rate() const { return r_; }
+    double dividend_yield() const { return q_; }
+
+    /**
+     * @brief American price for one strike. Calls go through put–call
+     * symmetry with r and q swapped.
+     */
+    double price(bool is_call, double S, double K, double sigma) {
+        QF_TRACE_SCOPE_CAT("american_alo", "american_options");
+        if (!(sigma > 0.0))
+            throw std::runtime_error("AmericanChainPricer: sigma must be positive");
+        if (T_ <= 0.0)
+            return is_call ? std::max(S - K, 0.0) : std::max(K - S, 0.0);
+
+        // C(S, K, r, q) = P(K, S, q, r): a call is a put on the strike.
+        const double rr = is_call ? q_ : r_;
+        const double qq = is_call ? r_ : q_;
+        const double spot = is_call ? K : S;
+        const double strike = is_call ? S : K;
+
+        bool lattice;
+        if (detail::put_is_european(rr, qq, lattice))
+            return lattice ? american_binomial(is_call, S, K, T_, r_, q_, sigma)
+                           : bs_price_q(is_call, S, K, T_, r_, q_, sigma);
+
+        // The normalized boundary depends only on σ here, so strikes quoted
+        // off one flat vol share a single solve.
+        if (!(has_boundary_ && sigma == boundary_sigma_ && is_call == boundary_swapped_)) {
+            solve_boundary(is_call, sigma);
+            has_boundary_ = true;
+            boundary_sigma_ = sigma;
+            boundary_swapped_ = is_call;
+        }
+        return strike * premium_put_n(is_call, spot / strike, sigma);
+    }
+
+    /**
+     * @brief Prices `n` options of this expiry.
+     */
+    void price_chain(std::size_t n, bool is_call, StridedView S, StridedView K,
+                     StridedView sigma, double* out) {
+        for (std::size_t i = 0; i < n; ++i)
+            out[i] = price(is_call, S[i], K[i], sigma[i]);
+    }
+
+    /**
+     * @brief Volatility at which the American price matches `market_price`.
+     *
+     * Brent's method on σ in [1e-4, 5]. Returns false when the price is
+     * outside the range spanned by those vols (e.g. below intrinsic).
+     */
+    bool implied_vol(bool is_call, double market_price, double S, double K, double& sigma,
+                     double tol = 1e-8, int max_iter = 100) {
+        QF_TRACE_SCOPE_CAT("implied_vol_american", "american_options");
+        double lo = 1e-4, hi = 5.0;
+        auto f = [&](double s) { return price(is_call, S, K, s) - market_price; };
+        double flo = f(lo), fhi = f(hi);
+        if (flo > 0.0 || fhi < 0.0) {
+            sigma = std::numeric_limits<double>::quiet_NaN();
+            return false;
+        }
+        sigma = detail::brent_root(f, lo, hi, flo, fhi, tol, max_iter);
+        return true;
+    }
+
+private:
+    double T_, r_, q_;
+    AloConfig cfg_;
+
+    // Collocation nodes i = 0..n (τ_0 = 0).
+    std::vector<double> tau_;
+
+    // Boundary integrals, (node i ≥ 1, quadrature k) flattened with
+    // stride l = quad_points. `weight_` rows hold n + 1 interpolation weights.
+    std::vector<double> jac_;        // dm/dy · w_k = τ (1 + y) / 2 · w_k
+    std::vector<double> m_;          // τ − u
+    std::vector<double> sqrt_m_;
+    std::vector<double> er_, eq_;    // e^{r u}, e^{q u}
+    std::vector<double> weight_;
+
+    // Premium integral over u ∈ (0, T), p = price_points.
+    std::vector<double> pm_;         // T − u
+    std::vector<double> psqrt_m_;
+    std::vector<double> pjac_;       // T (1 + z) / 2 · w_k
+    std::vector<double> pdr_, pdq_;  // e^{−r (T − u)}, e^{−q (T − u)}
+    std::vector<double> pweight_;
+
+    // Scratch. H_ holds the boundary last solved for (boundary_swapped_,
+    // boundary_sigma_).
+    std::vector<double> H_, s_node_, s_quad_, b_new_;
+    bool has_boundary_ = false, boundary_swapped_ = false;
+    double boundary_sigma_ = 0.0;
+
+    // Chebyshev (Lobatto) interpolation weights for node values at point z.
+    void interp_weights(double z, double* w) const {
+        const std::size_t n = cfg_.nodes;
+        std::vector<double> Tz(n + 1);
+        Tz[0] = 1.0;
+        Tz[1] = z;
+        for (std::size_t k = 2; k <= n; ++k)
+            Tz[k] = 2.0 * z * Tz[k - 1] - Tz[k - 2];
+        for (std::size_t i = 0; i <= n; ++i) {
+            double gi = (i == 0 || i == n) ? 0.5 : 1.0;
+            double ti = M_PI - M_PI * static_cast<double>(i) / static_cast<double>(n);  // z_i = cos(ti)
+            double s = 0.0;
+            for (std::size_t k = 0; k <= n; ++k) {
+                double dk = (k == 0 || k == n) ? 0.5 : 1.0;
+                s += dk * std::cos(static_cast<double>(k) * ti) * Tz[k];
+            }
+            w[i] = 2.0 / static_cast<double>(n) * gi * s;
+        }
+    }
+
+    void build_tables() {
+        const std::size_t n = cfg_.nodes, l = cfg_.quad_points, p = cfg_.price_points;
+        tau_.resize(n + 1);
+        for (std::size_t i = 0; i <= n; ++i) {
+            double z = -std::cos(M_PI * static_cast<double>(i) / static_cast<double>(n));
+            tau_[i] = T_ * 0.25 * (1.0 + z) * (1.0 + z);
+        }
+        tau_[0] = 0.0;
+
+        std::vector<double> y, w;
+        detail::gauss_legendre(l, y, w);
+        const std::size_t cnt = n * l;
+        jac_.resize(cnt);
+        m_.resize(cnt);
+        sqrt_m_.resize(cnt);
+        er_.resize(cnt);
+        eq_.resize(cnt);
+        weight_.resize(cnt * (n + 1));
+        for (std::size_t i = 1; i <= n; ++i) {
+            const double tau = tau_[i];
+            for (std::size_t k = 0; k < l; ++k) {
+                const std::size_t j = (i - 1) * l + k;
+                // τ − u = m = τ (1 + y)^2 / 4 clusters points where d± changes
+                // fastest, near u = τ.
+                double m = 0.25 * tau * (1.0 + y[k]) * (1.0 + y[k]);
+                double u = tau - m;
+                m_[j] = m;
+                sqrt_m_[j] = std::sqrt(m);
+                jac_[j] = 0.5 * tau * (1.0 + y[k]) * w[k];
+                er_[j] = std::exp(r_ * u);
+                eq_[j] = std::exp(q_ * u);
+                interp_weights(2.0 * std::sqrt(std::max(u, 0.0) / T_) - 1.0,
+                               weight_.data() + j * (n + 1));
+            }
+        }
+
+        detail::gauss_legendre(p, y, w);
+        pm_.resize(p);
+        psqrt_m_.resize(p);
+        pjac_.resize(p);
+        pdr_.resize(p);
+        pdq_.resize(p);
+        pweight_.resize(p * (n + 1));
+        for (std::size_t k = 0; k < p; ++k) {
+            // u = T ((1 + z) / 2)^2 follows the √u shape of the boundary.
+            double u = T_ * 0.25 * (1.0 + y[k]) * (1.0 + y[k]);
+            double m = T_ - u;
+            pm_[k] = m;
+            psqrt_m_[k] = std::sqrt(m);
+            pjac_[k] = 0.5 * T_ * (1.0 + y[k]) * w[k];
+            pdr_[k] = std::exp(-r_ * m);
+            pdq_[k] = std::exp(-q_ * m);
+            interp_weights(y[k], pweight_.data() + k * (n + 1));
+        }
+
+        H_.resize(n + 1);
+        s_node_.resize(n + 1);
+        s_quad_.resize(std::max(cnt, p));
+        b_new_.resize(n + 1);
+    }
+
+    // √H at every point of a table, from the node values H_.
+    void interpolate(const std::vector<double>& weights, std::size_t count) {
+        const std::size_t stride = cfg_.nodes + 1;
+        for (std::size_t j = 0; j < count; ++j) {
+            const double* wj = weights.data() + j * stride;
+            double h = 0.0;
+            for (std::size_t i = 0; i < stride; ++i)
+                h += wj[i] * H_[i];
+            s_quad_[j] = std::sqrt(std::max(h, 0.0));
+        }
+    }
+
+    // Boundary of the normalized put (K = 1) with rates (rr, qq) into H_.
+    void solve_boundary(bool swapped, double sigma) {
+        const std::size_t n = cfg_.nodes, l = cfg_.quad_points;
+        const double rr = swapped ? q_ : r_, qq = swapped ? r_ : q_;
+        const std::vector<double>& er = swapped ? eq_ : er_;
+        const std::vector<double>& eq = swapped ? er_ : eq_;
+        const double x0 = qq > 0.0 ? std::min(1.0, rr / qq) : 1.0;  // B(0+)
+        const double log_x0 = std::log(x0);
+
+        H_[0] = 0.0;
+        for (std::size_t i = 1; i <= n; ++i) {
+            double b = detail::qdplus_boundary_n(tau_[i], rr, qq, sigma);
+            double s = b < x0 ? std::log(x0 / b) : 0.0;
+            H_[i] = s * s;
+        }
+
+        for (std::size_t it = 0; it < cfg_.iterations; ++it) {
+            for (std::size_t i = 0; i <= n; ++i)
+                s_node_[i] = std::sqrt(H_[i]);
+            interpolate(weight_, n * l);
+
+            for (std::size_t i = 1; i <= n; ++i) {
+                const double tau = tau_[i], s = s_node_[i];
+                const double v = sigma * std::sqrt(tau);
+                const double dp = (log_x0 - s + (rr - qq) * tau) / v + 0.5 * v;
+                const double dm = dp - v;
+                double num = norm_cdf(dm), den = norm_cdf(dp);
+                double k3 = 0.0, k12 = 0.0;
+                for (std::size_t k = 0; k < l; ++k) {
+                    const std::size_t j = (i - 1) * l + k;
+                    // ln(B(τ) / B(u)) = √H(u) − √H(τ)
+                    const double sm = sigma * sqrt_m_[j];
+                    const double dpj = (s_quad_[j] - s + (rr - qq) * m_[j]) / sm + 0.5 * sm;
+                    k3 += er[j] * norm_cdf(dpj - sm) * jac_[j];
+                    k12 += eq[j] * norm_cdf(dpj) * jac_[j];
+                }
+                num += rr * k3;
+                den += qq * k12;
+
+                double b = std::exp(-(rr - qq) * tau) * num / den;
+                b_new_[i] = std::min(std::max(b, 1e-12), x0);
+            }
+
+            for (std::size_t i = 1; i <= n; ++i) {
+                double s = std::log(x0 / b_new_[i]);
+                H_[i] = s * s;
+            }
+        }
+    }
+
+    // Normalized put price at spot x (K = 1) given the boundary in H_.
+    double premium_put_n(bool swapped, double x, double sigma) {
+        const std::size_t n = cfg_.nodes, p = cfg_.price_points;
+        const double rr = swapped ? q_ : r_, qq = swapped ? r_ : q_;
+        const std::vector<double>& dr = swapped ? pdq_ : pdr_;
+        const std::vector<double>& dq = swapped ? pdr_ : pdq_;
+        const double x0 = qq > 0.0 ? std::min(1.0, rr / qq) : 1.0;
+
+        const double b_T = x0 * std::exp(-std::sqrt(H_[n]));
+        if (x <= b_T)
+            return 1.0 - x;
+
+        interpolate(pweight_, p);
+        const double log_x = std::log(x / x0);  // ln(x / B(u)) = log_x + √H(u)
+        double premium = 0.0;
+        for (std::size_t k = 0; k < p; ++k) {
+            const double v = sigma * psqrt_m_[k];
+            const double dp = (log_x + s_quad_[k] + (rr - qq) * pm_[k]) / v + 0.5 * v;
+            const double dm = dp - v;
+            premium += (rr * dr[k] * norm_cdf(-dm) - qq * x * dq[k] * norm_cdf(-dp)) * pjac_[k];
+        }
+        return std::max(detail::euro_put_n(x, T_, rr, qq, sigma) + premium, 1.0 - x);
+    }
+};
+
+// =======================
+// Dispatch, batches and implied vol
+// =======================
+
+inline double american_alo(bool is_call, double S, double K, double T, double r, double q,
+                           double sigma, AloConfig cfg = {}) {
+    AmericanChainPricer pricer(T, r, q, cfg);
+    return pricer.price(is_call, S, K, sigma);
+}
+
+inline double american_price(AmericanMethod method, bool is_call, double S, double K, double T,
+                             double r, double q, double sigma) {
+    switch (method) {
+    case AmericanMethod::BaroneAdesiWhaley:
+        return american_baw(is_call, S, K, T, r, q, sigma);
+    case AmericanMethod::QdPlus:
+        return american_qdplus(is_call, S, K, T, r, q, sigma);
+    case AmericanMethod::AndersenLake:
+        break;
+    }
+    return american_alo(is_call, S, K, T, r, q, sigma);
+}
+
+/**
+ * @brief American prices for a batch. With AndersenLake, consecutive
+ * options sharing (T, r, q) reuse one AmericanChainPricer, so a chain
+ * sorted by expiry builds its tables once per expiry.
+ */
+inline void american_price_batch(AmericanMethod method, std::size_t n, bool is_call,
+                                 StridedView S, StridedView K, StridedView T, StridedView r,
+                                 StridedView q, StridedView sigma, double* out,
+                                 AloConfig cfg = {}) {
+    if (method != AmericanMethod::AndersenLake) {
+        for (std::size_t i = 0; i < n; ++i)
+            out[i] = american_price(method, is_call, S[i], K[i], T[i], r[i], q[i], sigma[i]);
+        return;
+    }
+
+    std::size_t i = 0;
+    while (i < n) {
+        AmericanChainPricer pricer(T[i], r[i], q[i], cfg);
+        std::size_t j = i;
+        while (j < n && T[j] == pricer.expiry() && r[j] == pricer.rate() &&
+               q[j] == pricer.dividend_yield()) {
+            out[j] = pricer.price(is_call, S[j], K[j], sigma[j]);
+            ++j;
+        }
+        i = j;
+    }
+}
+
+/**
+ * @brief Implied vol of an American quote. Non-throwing like
+ * try_implied_vol_call(): returns false when no vol in [1e-4, 5]
+ * reproduces the price.
+ */
+inline bool try_implied_vol_american(AmericanMethod method, bool is_call, double market_price,
+                                     double S, double K, double T, double r, double q,
+                                     double& sigma, double tol = 1e-8, int max_iter = 100) {
+    QF_METRIC_INC("qf_iv_solves_total", "Implied volatility solves attempted");
+    bool ok;
+    if (method == AmericanMethod::AndersenLake) {
+        AmericanChainPricer pricer(T, r, q);
+        ok = pricer.implied_vol(is_call, market_price, S, K, sigma, tol, max_iter);
+    } else {
+        auto f = [&](double s) { return american_price(method, is_call, S, K, T, r, q, s) - market_price; };
+        double lo = 1e-4, hi = 5.0, flo = f(lo), fhi = f(hi);
+        ok = flo <= 0.0 && fhi >= 0.0;
+        sigma = ok ? detail::brent_root(f, lo, hi, flo, fhi, tol, max_iter)
+                   : std::numeric_limits<double>::quiet_NaN();
+    }
+    if (!ok)
+        QF_METRIC_INC("qf_iv_nonconvergence_total", "Implied volatility solves that did not converge");
+    return ok;
+}
+
+inline double implied_vol_american(AmericanMethod method, bool is_call, double market_price,
+                                   double S, double K, double T, double r, double q) {
+    double sigma;
+    if (!try_implied_vol_american(method, is_call, market_price, S, K, T, r, q, sigma))
+        throw std::runtime_error("implied_vol_american: price outside the attainable range");
+    return sigma;
+}
+
+/**
+ * @brief Implied vols for a batch of American quotes, NaN where no vol
+ * fits. Shares chain pricers across an expiry like american_price_batch().
+ */
+inline void implied_vol_american_batch(AmericanMethod method, std::size_t n, bool is_call,
+                                       StridedView price, StridedView S, StridedView K,
+                                       StridedView T, StridedView r, StridedView q, double* out,
+                                       double tol = 1e-8) {
+    std::size_t i = 0;
+    while (i < n) {
+        if (method != AmericanMethod::AndersenLake) {
+            double sigma;
+            try_implied_vol_american(method, is_call, price[i], S[i], K[i], T[i], r[i], q[i],
+                                     sigma, tol);
+            out[i++] = sigma;
+            continue;
+        }
+        AmericanChainPricer pricer(T[i], r[i], q[i]);
+        std::size_t j = i;
+        while (j < n && T[j] == pricer.expiry() && r[j] == pricer.rate() &&
+               q[j] == pricer.dividend_yield()) {
+            QF_METRIC_INC("qf_iv_solves_total", "Implied volatility solves attempted");
+            double sigma;
+            if (!pricer.implied_vol(is_call, price[j], S[j], K[j], sigma, tol))
+                QF_METRIC_INC("qf_iv_nonconvergence_total",
+                              "Implied volatility solves that did not converge");
+            out[j++] = sigma;
+        }
+        i = j;
+    }
+}
+
+} // namespace qf
+
+#endif // QF_AMERICAN_OPTIONS_H
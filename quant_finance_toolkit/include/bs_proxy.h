@@ -0,0 +1,329 @@
+#ifndef QF_BS_PROXY_H
+#define QF_BS_PROXY_H
+
+/**
+ * @file bs_proxy.h
+ * @author John Jacobson
+ * @brief Piecewise Chebyshev proxy for the Black–Scholes call price.
+ *
+ * For pre-trade screening and large scenario cubes the exact bs_call (one
+ * log, one exp, two erfc) costs more than the accuracy is worth. This proxy
+ * trades a small, measured error for a polynomial evaluation.
+ *
+ * With forward log-moneyness x = ln(S/K) + rT and total vol v = σ√T, the
+ * call price is
+ *
+ *   C = S · c(x, v),   c = N(x/v + v/2) − e^{−x} N(x/v − v/2)
+ *
+ * c has a kink at x = 0 as v → 0, which polynomials fit badly. In the
+ * standardized moneyness z = x / v the function h(z, v) = c / v is smooth
+ * and O(1) over the whole domain, so that is what gets interpolated:
+ *
+ *   - [−z_max, z_max] × [v_min, v_max] is cut into a grid of tiles
+ *   - each tile holds a tensor Chebyshev fit of degree kDegree in both
+ *     variables, converted to monomials on [−1, 1]; evaluation runs
+ *     Estrin's scheme (dependency depth 3) over the eight rows in z and
+ *     once more in v, so only FMAs after one division for z
+ *   - after the fit every tile is checked against the exact formula on a
+ *     grid 4× denser than the fit nodes, including tile edges; error_bound()
+ *     is twice the worst error found
+ *
+ * error_bound() is an empirical estimate with a safety factor of 2, not a
+ * proven bound: the error between check points is not controlled. h is
+ * analytic and the Chebyshev coefficients decay fast at degree 7, so the
+ * dense check catches the peaks in practice. The estimate is on h, so the
+ * price error is expected within S · v · error_bound().
+ * Inputs outside the domain (very short or very long dated, deep in or out
+ * of the money, T ≤ 0, σ ≤ 0) go to the exact formula.
+ *
+ * The tables (256 KB with the default config) are built once in the
+ * constructor, which takes tens of milliseconds, mostly for the error check;
+ * default_bs_proxy() builds a shared instance on first use. Evaluation is
+ * written as plain multiply-adds; building with QF_NATIVE_ARCH lets the
+ * compiler contract them into hardware FMAs.
+ */
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "metrics.h"
+#include "options_greeks.h"
+
+namespace qf {
+
+// Domain and resolution of the proxy tables.
+struct BsProxyConfig {
+    double z_max = 8.0;    // |ln(F/K)| / (σ√T) covered by the tables
+    double v_min = 0.01;   // σ√T range covered by the tables
+    double v_max = 2.5;
+    std::size_t z_tiles = 32;
+    std::size_t v_tiles = 16;
+};
+
+class BsProxy {
+public:
+    // Polynomial degree per variable within a tile. Fixed at compile time so
+    // eval() unrolls into straight-line FMAs.
+    static constexpr std::size_t kDegree = 7;
+
+    explicit BsProxy(BsProxyConfig cfg = {}) : cfg_(cfg) {
+        if (!(cfg_.z_max > 0.0) || !(cfg_.v_min > 0.0) || !(cfg_.v_max > cfg_.v_min))
+            throw std::runtime_error("BsProxy: invalid domain");
+        if (cfg_.z_tiles == 0 || cfg_.v_tiles == 0)
+            throw std::runtime_error("BsProxy: tile counts must be positive");
+
+        z_scale_ = static_cast<double>(cfg_.z_tiles) / (2.0 * cfg_.z_max);
+        v_scale_ = static_cast<double>(cfg_.v_tiles) / (cfg_.v_max - cfg_.v_min);
+        coef_.assign(cfg_.z_tiles * cfg_.v_tiles * n_ * n_, 0.0);
+
+        for (std::size_t iv = 0; iv < cfg_.v_tiles; ++iv)
+            for (std::size_t iz = 0; iz < cfg_.z_tiles; ++iz)
+                fit_tile(iz, iv);
+        error_bound_ = 2.0 * max_fit_error();
+    }
+
+    const BsProxyConfig& config() const { return cfg_; }
+
+    /**
+     * @brief Estimated bound on |h_proxy − h| over the domain: twice the
+     * worst error on the check grid, not a proven bound. The call price
+     * error is expected within S · σ√T · error_bound().
+     */
+    double error_bound() const { return error_bound_; }
+
+    bool in_domain(double z, double v) const {
+        return v >= cfg_.v_min && v < cfg_.v_max && z > -cfg_.z_max && z < cfg_.z_max;
+    }
+
+    /**
+     * @brief Normalized call price c = C / S for forward log-moneyness `x`
+     * and total vol `v`. Falls back to the exact formula outside the domain.
+     */
+    double normalized_call(double x, double v) const {
+        double z = x / v;
+        if (!in_domain(z, v))
+            return exact_normalized_call(x, v);
+        return v * eval(z, v);
+    }
+
+    double call(double S, double K, double T, double r, double sigma) const {
+        if (T <= 0.0 || sigma <= 0.0)
+            return bs_call(S, K, T, r, sigma);
+        double v = sigma * std::sqrt(T);
+        double z = (std::log(S / K) + r * T) / v;
+        if (!in_domain(z, v))
+            return bs_call(S, K, T, r, sigma);
+        return S * v * eval(z, v);
+    }
+
+    // Put by put–call parity on the proxied call.
+    double put(double S, double K, double T, double r, double sigma) const {
+        if (T <= 0.0 || sigma <= 0.0)
+            return bs_put(S, K, T, r, sigma);
+        return call(S, K, T, r, sigma) - S + K * std::exp(-r * T);
+    }
+
+    /**
+     * @brief Normalized call prices for precomputed (x, v) pairs. This is the
+     * scenario-cube entry point: spot shocks are additive in x, vol shocks
+     * scale v, and neither needs a log or exp. Returns the number of inputs
+     * that fell back to the exact formula.
+     */
+    std::size_t normalized_call_batch(std::size_t n, StridedView x, StridedView v,
+                                      double* out) const {
+        std::size_t fallbacks = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+            double vi = v[i];
+            double z = x[i] / vi;
+            if (in_domain(z, vi)) {
+                out[i] = vi * eval(z, vi);
+            } else {
+                out[i] = exact_normalized_call(x[i], vi);
+                ++fallbacks;
+            }
+        }
+        count(n, fallbacks);
+        return fallbacks;
+    }
+
+    std::size_t call_batch(std::size_t n, StridedView S, StridedView K, StridedView T,
+                           StridedView r, StridedView sigma, double* out) const {
+        std::size_t fallbacks = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+            double t = T[i], s = sigma[i];
+            double v = s * std::sqrt(t);
+            double z = (std::log(S[i] / K[i]) + r[i] * t) / v;
+            if (t > 0.0 && s > 0.0 && in_domain(z, v)) {
+                out[i] = S[i] * v * eval(z, v);
+            } else {
+                out[i] = bs_call(S[i], K[i], t, r[i], s);
+                ++fallbacks;
+            }
+        }
+        count(n, fallbacks);
+        return fallbacks;
+    }
+
+    /**
+     * @brief Exact c(x, v), used for fitting, checking and fallbacks.
+     */
+    static double exact_normalized_call(double x, double v) {
+        if (!(v > 0.0))
+            return std::max(1.0 - std::exp(-x), 0.0);
+        double z = x / v;
+        return norm_cdf(z + 0.5 * v) - std::exp(-x) * norm_cdf(z - 0.5 * v);
+    }
+
+private:
+    BsProxyConfig cfg_;
+    static constexpr std::size_t n_ = kDegree + 1;  // coefficients per variable
+    double z_scale_ = 0.0;
+    double v_scale_ = 0.0;
+    double error_bound_ = 0.0;
+
+    // Per tile, row-major [j][i]: coefficient of tv^j · tz^i, with tz, tv the
+    // tile-local coordinates in [−1, 1].
+    std::vector<double> coef_;
+
+    static double exact_h(double z, double v) {
+        return exact_normalized_call(z * v, v) / v;
+    }
+
+    double z_lo(std::size_t iz) const {
+        return -cfg_.z_max + static_cast<double>(iz) / z_scale_;
+    }
+    double v_lo(std::size_t iv) const {
+        return cfg_.v_min + static_cast<double>(iv) / v_scale_;
+    }
+
+    double eval(double z, double v) const {
+        double fz = (z + cfg_.z_max) * z_scale_;
+        double fv = (v - cfg_.v_min) * v_scale_;
+        std::size_t iz = static_cast<std::size_t>(fz);
+        std::size_t iv = static_cast<std::size_t>(fv);
+        // Guard the upper edge against rounding.
+        if (iz >= cfg_.z_tiles) iz = cfg_.z_tiles - 1;
+        if (iv >= cfg_.v_tiles) iv = cfg_.v_tiles - 1;
+        double tz = 2.0 * (fz - static_cast<double>(iz)) - 1.0;
+        double tv = 2.0 * (fv - static_cast<double>(iv)) - 1.0;
+
+        const double* c = coef_.data() + (iv * cfg_.z_tiles + iz) * n_ * n_;
+        const double tz2 = tz * tz, tz4 = tz2 * tz2;
+        double rows[n_];
+        for (std::size_t j = 0; j < n_; ++j)
+            rows[j] = estrin(c + j * n_, tz, tz2, tz4);
+        return estrin(rows, tv, tv * tv, (tv * tv) * (tv * tv));
+    }
+
+    /**
+     * Degree-7 polynomial by Estrin's scheme: the same multiply-adds as
+     * Horner, but a dependency depth of 3 instead of 7, so the eight rows
+     * of a tile evaluate in parallel.
+     */
+    static double estrin(const double* a, double t, double t2, double t4) {
+        static_assert(kDegree == 7, "estrin() is written out for degree 7");
+        double p01 = a[0] + a[1] * t, p23 = a[2] + a[3] * t;
+        double p45 = a[4] + a[5] * t, p67 = a[6] + a[7] * t;
+        return (p01 + p23 * t2) + (p45 + p67 * t2) * t4;
+    }
+
+    /**
+     * Chebyshev interpolation at the (kDegree + 1)^2 Chebyshev points of the
+     * tile, then conversion of each 1-D Chebyshev series to monomials.
+     */
+    void fit_tile(std::size_t iz, std::size_t iv) {
+        constexpr std::size_t n = n_;
+        const double zw = 0.5 / z_scale_, zc = z_lo(iz) + zw;
+        const double vw = 0.5 / v_scale_, vc = v_lo(iv) + vw;
+
+        std::vector<double> node(n);  // cos(π (k + ½) / n), i.e. T_1 at the nodes
+        for (std::size_t k = 0; k < n; ++k)
+            node[k] = std::cos(M_PI * (static_cast<double>(k) + 0.5) / static_cast<double>(n));
+
+        std::vector<double> f(n * n);  // f[j][i] = h(z_i, v_j)
+        for (std::size_t j = 0; j < n; ++j)
+            for (std::size_t i = 0; i < n; ++i)
+                f[j * n + i] = exact_h(zc + zw * node[i], vc + vw * node[j]);
+
+        // Chebyshev coefficients a[q][p] of T_p(tz) T_q(tv), one variable at
+        // a time: cheb[k][i] = T_k(node_i).
+        std::vector<double> cheb(n * n);
+        for (std::size_t k = 0; k < n; ++k)
+            for (std::size_t i = 0; i < n; ++i)
+                cheb[k * n + i] = std::cos(M_PI * static_cast<double>(k) *
+                                           (static_cast<double>(i) + 0.5) / static_cast<double>(n));
+
+        std::vector<double> g(n * n, 0.0);  // g[j][p]: transform along z
+        for (std::size_t j = 0; j < n; ++j)
+            for (std::size_t p = 0; p < n; ++p)
+                for (std::size_t i = 0; i < n; ++i)
+                    g[j * n + p] += f[j * n + i] * cheb[p * n + i];
+
+        std::vector<double> a(n * n, 0.0);
+        for (std::size_t q = 0; q < n; ++q)
+            for (std::size_t p = 0; p < n; ++p) {
+                double s = 0.0;
+                for (std::size_t j = 0; j < n; ++j)
+                    s += g[j * n + p] * cheb[q * n + j];
+                double w = (p == 0 ? 1.0 : 2.0) * (q == 0 ? 1.0 : 2.0);
+                a[q * n + p] = s * w / static_cast<double>(n * n);
+            }
+
+        // Monomial coefficients of T_k, by the recurrence T_{k+1} = 2t T_k − T_{k−1}.
+        std::vector<double> mono(n * n, 0.0);  // mono[k][m]: coefficient of t^m in T_k
+        mono[0] = 1.0;
+        if (n > 1) mono[n + 1] = 1.0;
+        for (std::size_t k = 2; k < n; ++k)
+            for (std::size_t m = 0; m < n; ++m)
+                mono[k * n + m] = (m > 0 ? 2.0 * mono[(k - 1) * n + m - 1] : 0.0) -
+                                  mono[(k - 2) * n + m];
+
+        double* out = coef_.data() + (iv * cfg_.z_tiles + iz) * n * n;
+        for (std::size_t q = 0; q < n; ++q)
+            for (std::size_t p = 0; p < n; ++p) {
+                double apq = a[q * n + p];
+                if (apq == 0.0) continue;
+                for (std::size_t j = 0; j <= q; ++j)
+                    for (std::size_t i = 0; i <= p; ++i)
+                        out[j * n + i] += apq * mono[q * n + j] * mono[p * n + i];
+            }
+    }
+
+    double max_fit_error() const {
+        const std::size_t m = 4 * n_;  // check points per tile per variable
+        double worst = 0.0;
+        for (std::size_t iv = 0; iv < cfg_.v_tiles; ++iv)
+            for (std::size_t iz = 0; iz < cfg_.z_tiles; ++iz)
+                for (std::size_t b = 0; b <= m; ++b)
+                    for (std::size_t a = 0; a <= m; ++a) {
+                        double z = z_lo(iz) + (static_cast<double>(a) / m) / z_scale_;
+                        double v = v_lo(iv) + (static_cast<double>(b) / m) / v_scale_;
+                        if (!in_domain(z, v)) continue;
+                        worst = std::max(worst, std::fabs(eval(z, v) - exact_h(z, v)));
+                    }
+        return worst;
+    }
+
+    static void count(std::size_t n, std::size_t fallbacks) {
+        QF_METRIC_ADD("qf_bs_proxy_evaluations_total", "Prices requested from the BS proxy", n);
+        QF_METRIC_ADD("qf_bs_proxy_fallbacks_total",
+                      "BS proxy inputs outside the table domain, priced exactly", fallbacks);
+        (void)n;
+        (void)fallbacks;
+    }
+};
+
+/**
+ * @brief Shared proxy with the default config, built on first use.
+ */
+inline const BsProxy& default_bs_proxy() {
+    static const BsProxy proxy;
+    return proxy;
+}
+
+} // namespace qf
+
+#endif // QF_BS_PROXY_H
@@ -0,0 +1,427 @@
+#ifndef QF_COMPLEX_ORDERBOOK_H
+#define QF_COMPLEX_ORDERBOOK_H
+
+/**
+ * @file complex_orderbook.h
+ * @author John Jacobson
+ * @brief Complex (multi-leg) order book for option spreads, matched against
+ *        other spread orders and against the legs' OrderBooks.
+ *
+ * A strategy is a list of (instrument, ratio) legs; buying one unit buys
+ * `ratio` of every positive leg and sells |ratio| of every negative one.
+ * Each distinct definition gets its own spread OrderBook, so spread orders
+ * match each other with the usual price-time priority. The leg books
+ * additionally imply a spread market:
+ *
+ *     implied ask = Σ_{r>0} r · ask_i − Σ_{r<0} |r| · bid_i
+ *     implied bid = Σ_{r>0} r · bid_i − Σ_{r<0} |r| · ask_i
+ *
+ * with size the minimum over legs of top-of-book quantity / |r|, rounded
+ * to the tick. Before trading against it, every leg's top is re-read, and
+ * each leg order is sized to fit inside that level at the top price, so
+ * all legs fill in full or (when a leg has no top) nothing is sent. Leg
+ * orders are immediate-or-cancel: any remainder is cancelled, never left
+ * resting in a leg book.
+ *
+ * Re-evaluation is incremental. Every instrument keeps the strategies that
+ * reference it and a snapshot of its top of book. on_leg_update(i) compares
+ * the snapshot and only marks those strategies dirty when it changed;
+ * refresh() re-prices the dirty ones and trades resting spread orders that
+ * now cross their implied market. The work per leg update is therefore
+ * proportional to the strategies on that leg, not to the whole book.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <memory_resource>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "metrics.h"
+#include "orderbook_simulator.h"
+#include "trace.h"
+
+namespace qf {
+
+struct StrategyLeg {
+    std::uint32_t instrument;
+    std::int32_t ratio;  // > 0: bought with the spread, < 0: sold
+};
+
+inline std::vector<StrategyLeg> vertical_spread(std::uint32_t long_leg, std::uint32_t short_leg) {
+    return {{long_leg, 1}, {short_leg, -1}};
+}
+
+inline std::vector<StrategyLeg> straddle(std::uint32_t call, std::uint32_t put) {
+    return {{call, 1}, {put, 1}};
+}
+
+inline std::vector<StrategyLeg> butterfly(std::uint32_t low, std::uint32_t mid, std::uint32_t high) {
+    return {{low, 1}, {mid, -2}, {high, 1}};
+}
+
+// Spread market implied by the leg books; a size of 0 means no market.
+struct ImpliedQuote {
+    double bid = 0.0, ask = 0.0;
+    std::uint64_t bid_size = 0, ask_size = 0;
+};
+
+struct LegFill {
+    std::uint32_t instrument;
+    Trade trade;
+};
+
+/**
+ * Outcome of one spread order, or of one resting spread order trading
+ * against the legs in refresh(). `order_id` is the spread-book ID of the
+ * resting order (0 if nothing rests). `spread_trades` are fills against
+ * other spread orders, `leg_fills` the leg trades of implied fills.
+ * `filled` counts complete spreads, as executed.
+ */
+struct ComplexExecution {
+    std::uint32_t strategy = 0;
+    std::uint64_t order_id = 0;
+    std::uint64_t filled = 0;  // spreads
+    std::vector<Trade> spread_trades;
+    std::vector<LegFill> leg_fills;
+};
+
+namespace detail {
+
+// Best price and quantity on each side of a book; quantity 0 = empty side.
+struct TopOfBook {
+    double bid = 0.0, ask = 0.0;
+    std::uint64_t bid_qty = 0, ask_qty = 0;
+
+    bool operator==(const TopOfBook& o) const {
+        return bid == o.bid && ask == o.ask && bid_qty == o.bid_qty && ask_qty == o.ask_qty;
+    }
+    bool operator!=(const TopOfBook& o) const { return !(*this == o); }
+};
+
+inline TopOfBook read_top(const OrderBook& book, std::vector<DepthLevel>& buf) {
+    TopOfBook t;
+    book.depth(Side::Buy, 1, buf);
+    if (!buf.empty()) {
+        t.bid = buf[0].price;
+        t.bid_qty = buf[0].quantity;
+    }
+    book.depth(Side::Sell, 1, buf);
+    if (!buf.empty()) {
+        t.ask = buf[0].price;
+        t.ask_qty = buf[0].quantity;
+    }
+    return t;
+}
+
+} // namespace detail
+
+struct ComplexBookConfig {
+    double tick = 0.01;  // implied prices are rounded to this
+};
+
+class ComplexOrderBook {
+public:
+    explicit ComplexOrderBook(const ComplexBookConfig& cfg = {},
+                              std::pmr::memory_resource* mr = std::pmr::get_default_resource())
+        : cfg_(cfg), mr_(mr) {
+        if (!(cfg_.tick > 0.0))
+            throw std::runtime_error("ComplexOrderBook: tick must be positive");
+    }
+
+    // Registers a leg book; the book must outlive this object.
+    std::uint32_t add_instrument(OrderBook& book) {
+        legs_.push_back(&book);
+        tops_.push_back(read_top(book));
+        users_.emplace_back();
+        return static_cast<std::uint32_t>(legs_.size() - 1);
+    }
+
+    /**
+     * @brief Returns the strategy ID for a definition, creating its spread
+     * book on first use. Legs are sorted and merged by instrument, so
+     * equivalent definitions share one book.
+     */
+    std::uint32_t define_strategy(std::vector<StrategyLeg> legs) {
+        std::sort(legs.begin(), legs.end(), [](const StrategyLeg& a, const StrategyLeg& b) {
+            return a.instrument < b.instrument;
+        });
+        std::vector<StrategyLeg> merged;
+        for (const auto& l : legs) {
+            if (l.instrument >= legs_.size())
+                throw std::runtime_error("define_strategy: unknown instrument");
+            if (!merged.empty() && merged.back().instrument == l.instrument)
+                merged.back().ratio += l.ratio;
+            else
+                merged.push_back(l);
+        }
+        merged.erase(std::remove_if(merged.begin(), merged.end(),
+                                    [](const StrategyLeg& l) { return l.ratio == 0; }),
+                     merged.end());
+        if (merged.empty())
+            throw std::runtime_error("define_strategy: no legs");
+
+        std::vector<std::pair<std::uint32_t, std::int32_t>> key;
+        for (const auto& l : merged)
+            key.emplace_back(l.instrument, l.ratio);
+        auto found = by_definition_.find(key);
+        if (found != by_definition_.end())
+            return found->second;
+
+        const auto id = static_cast<std::uint32_t>(strategies_.size());
+        strategies_.emplace_back(std::move(merged), mr_);
+        for (const auto& l : strategies_.back().legs)
+            users_[l.instrument].push_back(id);
+        by_definition_.emplace(std::move(key), id);
+        evaluate(id);
+        return id;
+    }
+
+    std::size_t instruments() const { return legs_.size(); }
+    std::size_t strategies() const { return strategies_.size(); }
+    const std::vector<StrategyLeg>& legs(std::uint32_t s) const { return strategies_[s].legs; }
+    OrderBook& spread_book(std::uint32_t s) { return strategies_[s].book; }
+    const OrderBook& spread_book(std::uint32_t s) const { return strategies_[s].book; }
+
+    // Implied market as of the last evaluation of strategy s.
+    const ImpliedQuote& implied(std::uint32_t s) const { return strategies_[s].implied; }
+
+    // Strategy evaluations performed so far (for monitoring the cost).
+    std::uint64_t evaluations() const { return evaluations_; }
+
+    /**
+     * @brief Tells the book that leg book i may have changed. Strategies on
+     * that leg are marked dirty only if its top of book actually moved.
+     */
+    void on_leg_update(std::uint32_t i) {
+        const Top t = read_top(*legs_[i]);
+        if (t == tops_[i])
+            return;
+        tops_[i] = t;
+        for (std::uint32_t s : users_[i]) {
+            if (!strategies_[s].dirty) {
+                strategies_[s].dirty = true;
+                dirty_.push_back(s);
+            }
+        }
+    }
+
+    /**
+     * @brief Re-prices dirty strategies and trades resting spread orders
+     * that cross their implied market. Fills cascade: legs consumed here
+     * mark further strategies dirty, which are processed in the same call.
+     * Appends one execution per resting order traded; returns how many.
+     */
+    std::size_t refresh(std::vector<ComplexExecution>& out) {
+        QF_TRACE_SCOPE_CAT("complex_refresh", "complex_orderbook");
+        const std::size_t before = out.size();
+        while (!dirty_.empty()) {
+            const std::uint32_t s = dirty_.back();
+            dirty_.pop_back();
+            strategies_[s].dirty = false;
+            evaluate(s);
+            cross_resting(s, Side::Buy, out);
+            cross_resting(s, Side::Sell, out);
+        }
+        return out.size() - before;
+    }
+
+    /**
+     * @brief Submits a spread order. It takes the better of the resting
+     * spread book and the implied leg market level by level (resting
+     * spread orders win ties), and rests any remainder in the spread book.
+     */
+    ComplexExecution add_order(std::uint32_t s, Side side, double price, std::uint64_t quantity) {
+        QF_TRACE_SCOPE_CAT("complex_add_order", "complex_orderbook");
+        ComplexExecution ex;
+        ex.strategy = s;
+        OrderBook& book = strategies_[s].book;
+        const Side other = side == Side::Buy ? Side::Sell : Side::Buy;
+        std::uint64_t remaining = quantity;
+
+        while (remaining > 0) {
+            sync(s);
+            const ImpliedQuote& imp = strategies_[s].implied;
+            const double imp_px = side == Side::Buy ? imp.ask : imp.bid;
+            const std::uint64_t imp_qty = side == Side::Buy ? imp.ask_size : imp.bid_size;
+
+            book.depth(other, 1, level_);
+            const bool spread_ok = !level_.empty() && crosses(side, price, level_[0].price);
+            const bool implied_ok = imp_qty > 0 && crosses(side, price, imp_px);
+
+            if (spread_ok && !(implied_ok && strictly_better(side, imp_px, level_[0].price))) {
+                const std::uint64_t q = std::min(remaining, level_[0].quantity);
+                trades_.clear();
+                book.add_limit_order(side, level_[0].price, q, trades_);
+                ex.spread_trades.insert(ex.spread_trades.end(), trades_.begin(), trades_.end());
+                remaining -= q;
+                ex.filled += q;
+            } else if (implied_ok) {
+                const std::uint64_t q = execute_legs(s, side, std::min(remaining, imp_qty), ex);
+                if (q == 0)
+                    break;
+                remaining -= q;
+                ex.filled += q;
+            } else {
+                break;
+            }
+        }
+
+        if (remaining > 0) {
+            trades_.clear();
+            ex.order_id = book.add_limit_order(side, price, remaining, trades_);
+        }
+        return ex;
+    }
+
+    bool cancel_order(std::uint32_t s, std::uint64_t id) { return strategies_[s].book.cancel_order(id); }
+
+private:
+    using Top = detail::TopOfBook;
+
+    struct Strategy {
+        Strategy(std::vector<StrategyLeg> l, std::pmr::memory_resource* mr)
+            : legs(std::move(l)), book(mr) {}
+
+        std::vector<StrategyLeg> legs;
+        OrderBook book;
+        ImpliedQuote implied;
+        bool dirty = false;
+    };
+
+    Top read_top(const OrderBook& book) { return detail::read_top(book, level_); }
+
+    double round_tick(double x) const { return std::round(x / cfg_.tick) * cfg_.tick; }
+
+    // Tolerance for comparing spread prices that went through rounding.
+    bool crosses(Side side, double limit, double px) const {
+        const double eps = 1e-6 * cfg_.tick;
+        return side == Side::Buy ? px <= limit + eps : px >= limit - eps;
+    }
+
+    bool strictly_better(Side side, double a, double b) const {
+        const double eps = 1e-6 * cfg_.tick;
+        return side == Side::Buy ? a < b - eps : a > b + eps;
+    }
+
+    // Leg books may have moved without a notification: re-read every leg's
+    // top, then re-price s.
+    void sync(std::uint32_t s) {
+        for (const auto& l : strategies_[s].legs)
+            on_leg_update(l.instrument);
+        evaluate(s);
+    }
+
+    void evaluate(std::uint32_t s) {
+        ++evaluations_;
+        Strategy& st = strategies_[s];
+        double bid = 0.0, ask = 0.0;
+        std::uint64_t bid_size = ~std::uint64_t{0}, ask_size = ~std::uint64_t{0};
+        for (const auto& l : st.legs) {
+            const Top& t = tops_[l.instrument];
+            const auto r = static_cast<std::uint64_t>(std::abs(l.ratio));
+            const double w = static_cast<double>(r);
+            if (l.ratio > 0) {
+                ask += w * t.ask;
+                bid += w * t.bid;
+                ask_size = std::min(ask_size, t.ask_qty / r);
+                bid_size = std::min(bid_size, t.bid_qty / r);
+            } else {
+                ask -= w * t.bid;
+                bid -= w * t.ask;
+                ask_size = std::min(ask_size, t.bid_qty / r);
+                bid_size = std::min(bid_size, t.ask_qty / r);
+            }
+        }
+        st.implied = {round_tick(bid), round_tick(ask), bid_size, ask_size};
+    }
+
+    // Trades up to q spreads on `side` against the leg tops, which the
+    // caller has just re-read with sync(). Each leg order is
+    // immediate-or-cancel at its top price and fits inside that level, so
+    // normally all of them fill completely. If a leg comes up short anyway,
+    // later legs are cut to match; earlier legs keep the excess, which
+    // shows in leg_fills. Returns the complete spreads traded.
+    std::uint64_t execute_legs(std::uint32_t s, Side side, std::uint64_t q, ComplexExecution& ex) {
+        std::uint64_t done = q;
+        for (const auto& l : strategies_[s].legs) {
+            if (done == 0)
+                break;
+            const bool buy = (l.ratio > 0) == (side == Side::Buy);
+            const Top& t = tops_[l.instrument];
+            const auto r = static_cast<std::uint64_t>(std::abs(l.ratio));
+            OrderBook& leg = *legs_[l.instrument];
+            trades_.clear();
+            const std::uint64_t id = leg.add_limit_order(buy ? Side::Buy : Side::Sell,
+                                                         buy ? t.ask : t.bid, done * r, trades_);
+            std::uint64_t got = 0;
+            for (const Trade& tr : trades_) {
+                got += tr.quantity;
+                ex.leg_fills.push_back({l.instrument, tr});
+            }
+            if (got < done * r)
+                leg.cancel_order(id);
+            done = std::min(done, got / r);
+        }
+        for (const auto& l : strategies_[s].legs)
+            on_leg_update(l.instrument);
+        QF_METRIC_ADD("qf_complex_implied_fills_total", "Spreads filled against leg books", done);
+        return done;
+    }
+
+    // Resting spread orders on `side` that cross the implied market trade
+    // against the legs, front of queue first.
+    void cross_resting(std::uint32_t s, Side side, std::vector<ComplexExecution>& out) {
+        OrderBook& book = strategies_[s].book;
+        for (;;) {
+            if (!book.front_order(side))
+                return;
+            sync(s);
+            const Order* o = book.front_order(side);
+            const ImpliedQuote& imp = strategies_[s].implied;
+            const double imp_px = side == Side::Buy ? imp.ask : imp.bid;
+            const std::uint64_t imp_qty = side == Side::Buy ? imp.ask_size : imp.bid_size;
+            if (!o || imp_qty == 0 || !crosses(side, o->price, imp_px))
+                return;
+
+            const std::uint64_t id = o->id, rem = o->remaining;
+            const double px = o->price;
+            ComplexExecution ex;
+            ex.strategy = s;
+            ex.order_id = id;
+            ex.filled = execute_legs(s, side, std::min(rem, imp_qty), ex);
+            if (ex.filled > 0) {
+                trades_.clear();
+                book.modify_order(id, px, rem - ex.filled, trades_);
+            }
+            const bool stuck = ex.filled == 0;
+            out.push_back(std::move(ex));
+            if (stuck)
+                return;
+        }
+    }
+
+    ComplexBookConfig cfg_;
+    std::pmr::memory_resource* mr_;
+
+    std::vector<OrderBook*> legs_;
+    std::vector<Top> tops_;
+    std::vector<std::vector<std::uint32_t>> users_;  // instrument → strategies
+
+    std::vector<Strategy> strategies_;
+    std::map<std::vector<std::pair<std::uint32_t, std::int32_t>>, std::uint32_t> by_definition_;
+    std::vector<std::uint32_t> dirty_;
+    std::uint64_t evaluations_ = 0;
+
+    std::vector<DepthLevel> level_;
+    std::vector<Trade> trades_;
+};
+
+} // namespace qf
+
+#endif // QF_COMPLEX_ORDERBOOK_H
@@ -0,0 +1,715 @@
+#ifndef QF_COVARIANCE_H
+#define QF_COVARIANCE_H
+
+/**
+ * @file covariance.h
+ * @author John Jacobson
+ * @brief Rolling and EWMA covariance matrices for large universes, with
+ *        Ledoit–Wolf and constant-correlation shrinkage, in packed storage.
+ *
+ * Recomputing an n × n covariance from a T-day window costs T n² / 2
+ * multiply-adds per day. Instead, RollingCovariance keeps Σ x and Σ x xᵀ
+ * over the window. A day that enters adds x xᵀ and a day that leaves
+ * subtracts it, so advancing k days is one rank-2k update of the running
+ * sums. EwmaCovariance decays and adds in the same way.
+ *
+ * Every matrix is symmetric, so only the lower triangle is stored, packed
+ * row by row (PackedSymmetric). That halves the memory: about 36 MB
+ * instead of 72 MB for 3,000 names. The update kernel splits the triangle
+ * into 64 × 64 tiles and runs tile pairs across the shared thread pool.
+ * Within a tile each packed row segment stays in L1 while the update rows
+ * stream past it, four at a time.
+ *
+ * Shrinkage (Ledoit & Wolf 2004 toward a scaled identity, Ledoit & Wolf
+ * 2003 toward constant correlation) needs fourth-moment sums. These are
+ * computed from the stored window in O(nT) by reducing the n² sums
+ * algebraically to per-day norms and one matrix–vector product.
+ *
+ * Returns are passed date-major (one row of n returns per day). Non-finite
+ * returns count as 0, the usual fill for names that are not trading.
+ *
+ * FactorCovariance is the structured alternative, B F Bᵀ + D, used by the
+ * portfolio optimizer when n is too large for a dense matrix.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "thread_pool.h"
+#include "trace.h"
+
+namespace qf {
+
+// =======================
+// Packed symmetric storage
+// =======================
+
+// Position of (i, j), j ≤ i, in a row-packed lower triangle.
+inline std::size_t packed_index(std::size_t i, std::size_t j) {
+    return i * (i + 1) / 2 + j;
+}
+
+/**
+ * Symmetric n × n matrix stored as its lower triangle, row by row: row i
+ * holds (i, 0) .. (i, i) contiguously.
+ */
+class PackedSymmetric {
+public:
+    PackedSymmetric() = default;
+    explicit PackedSymmetric(std::size_t n, double value = 0.0)
+        : n_(n), data_(n * (n + 1) / 2, value) {}
+
+    std::size_t dim() const { return n_; }
+    std::size_t size() const { return data_.size(); }
+
+    double operator()(std::size_t i, std::size_t j) const {
+        return i >= j ? data_[packed_index(i, j)] : data_[packed_index(j, i)];
+    }
+    double& at(std::size_t i, std::size_t j) {
+        return i >= j ? data_[packed_index(i, j)] : data_[packed_index(j, i)];
+    }
+
+    double* row(std::size_t i) { return data_.data() + packed_index(i, 0); }
+    const double* row(std::size_t i) const { return data_.data() + packed_index(i, 0); }
+    double* data() { return data_.data(); }
+    const double* data() const { return data_.data(); }
+
+    void resize(std::size_t n) {
+        n_ = n;
+        data_.assign(n * (n + 1) / 2, 0.0);
+    }
+
+    // Full n × n row-major copy.
+    void unpack(double* full) const {
+        for (std::size_t i = 0; i < n_; ++i) {
+            const double* r = row(i);
+            for (std::size_t j = 0; j <= i; ++j)
+                full[i * n_ + j] = full[j * n_ + i] = r[j];
+        }
+    }
+
+    // y = A x.
+    void multiply(const double* x, double* y) const {
+        std::fill(y, y + n_, 0.0);
+        for (std::size_t i = 0; i < n_; ++i) {
+            const double* r = row(i);
+            double s = 0.0;
+            for (std::size_t j = 0; j < i; ++j) {
+                s += r[j] * x[j];
+                y[j] += r[j] * x[i];
+            }
+            y[i] += s + r[i] * x[i];
+        }
+    }
+
+private:
+    std::size_t n_ = 0;
+    std::vector<double> data_;
+};
+
+// =======================
+// Blocked kernels
+// =======================
+
+constexpr std::size_t kCovTile = 64;
+constexpr std::size_t kCovStreamRank = 8;
+
+namespace detail {
+
+// Tile pair p → (I, J), J ≤ I, in row order of the tile triangle.
+inline void tile_pair(std::size_t p, std::size_t& I, std::size_t& J) {
+    I = static_cast<std::size_t>((std::sqrt(8.0 * static_cast<double>(p) + 1.0) - 1.0) / 2.0);
+    while (I * (I + 1) / 2 > p)
+        --I;
+    while ((I + 1) * (I + 2) / 2 <= p)
+        ++I;
+    J = p - I * (I + 1) / 2;
+}
+
+/**
+ * Runs body(i, j0, j1) for every packed row segment, tile by tile, with
+ * tile pairs spread over the pool. Segments of one tile run on one thread.
+ */
+template <typename Body>
+void for_each_tile(std::size_t n, Body&& body) {
+    const std::size_t tiles = (n + kCovTile - 1) / kCovTile;
+    parallel_for(default_thread_pool(), 0, tiles * (tiles + 1) / 2, 1, [&](std::size_t p) {
+        std::size_t I, J;
+        tile_pair(p, I, J);
+        const std::size_t i0 = I * kCovTile, i1 = std::min(n, i0 + kCovTile);
+        const std::size_t j0 = J * kCovTile;
+        for (std::size_t i = i0; i < i1; ++i)
+            body(i, j0, I == J ? i + 1 : std::min(n, j0 + kCovTile));
+    });
+}
+
+/**
+ * Runs body(i, 0, i + 1) for every packed row, in contiguous row blocks of
+ * about equal area so the triangle streams through memory in order. Used
+ * for elementwise passes and low-rank updates, where tiling buys no reuse.
+ */
+template <typename Body>
+void for_each_row(std::size_t n, Body&& body) {
+    const std::size_t blocks = std::min<std::size_t>(n, 256);
+    parallel_for(default_thread_pool(), 0, blocks, 1, [&](std::size_t b) {
+        const auto edge = [&](std::size_t c) {
+            return static_cast<std::size_t>(
+                static_cast<double>(n) * std::sqrt(static_cast<double>(c) / static_cast<double>(blocks)));
+        };
+        const std::size_t lo = edge(b), hi = b + 1 == blocks ? n : edge(b + 1);
+        for (std::size_t i = lo; i < hi; ++i)
+            body(i, std::size_t{0}, i + 1);
+    });
+}
+
+} // namespace detail
+
+/**
+ * @brief S ← scale · S + Σ_r w_r a_r a_rᵀ, with a_r = A + r · lda (length
+ * n) and w = null meaning all ones. This is a symmetric rank-k update on
+ * packed storage, cache-blocked and parallel over tiles.
+ */
+inline void packed_rank_update(PackedSymmetric& S, double scale, const double* A, std::size_t k,
+                               std::size_t lda, const double* w = nullptr) {
+    QF_TRACE_SCOPE_CAT("packed_rank_update", "covariance");
+    const auto kernel = [&](std::size_t i, std::size_t j0, std::size_t j1) {
+        double* row = S.row(i);
+        if (scale != 1.0) {
+            for (std::size_t j = j0; j < j1; ++j)
+                row[j] *= scale;
+        }
+        std::size_t r = 0;
+        for (; r + 4 <= k; r += 4) {
+            const double* a0 = A + r * lda;
+            const double* a1 = a0 + lda;
+            const double* a2 = a1 + lda;
+            const double* a3 = a2 + lda;
+            const double c0 = (w ? w[r] : 1.0) * a0[i];
+            const double c1 = (w ? w[r + 1] : 1.0) * a1[i];
+            const double c2 = (w ? w[r + 2] : 1.0) * a2[i];
+            const double c3 = (w ? w[r + 3] : 1.0) * a3[i];
+            for (std::size_t j = j0; j < j1; ++j)
+                row[j] += c0 * a0[j] + c1 * a1[j] + c2 * a2[j] + c3 * a3[j];
+        }
+        if (r + 2 <= k) {
+            const double* a0 = A + r * lda;
+            const double* a1 = a0 + lda;
+            const double c0 = (w ? w[r] : 1.0) * a0[i];
+            const double c1 = (w ? w[r + 1] : 1.0) * a1[i];
+            for (std::size_t j = j0; j < j1; ++j)
+                row[j] += c0 * a0[j] + c1 * a1[j];
+            r += 2;
+        }
+        if (r < k) {
+            const double* a = A + r * lda;
+            const double c = (w ? w[r] : 1.0) * a[i];
+            for (std::size_t j = j0; j < j1; ++j)
+                row[j] += c * a[j];
+        }
+    };
+    // A few update rows fit in L1 beside a whole packed row, so stream the
+    // triangle in memory order; beyond that, tile so the rows are reused.
+    if (k <= kCovStreamRank)
+        detail::for_each_row(S.dim(), kernel);
+    else
+        detail::for_each_tile(S.dim(), kernel);
+}
+
+// =======================
+// Rolling window
+// =======================
+
+/**
+ * Sample covariance over the last `window` days, advanced with rank-k
+ * updates. The window itself is kept in a ring buffer (window × n) for
+ * the days that leave and for the shrinkage moments.
+ */
+class RollingCovariance {
+public:
+    RollingCovariance(std::size_t assets, std::size_t window)
+        : n_(assets), window_(window), days_(window * assets), sum_(assets, 0.0), cross_(assets) {
+        if (assets == 0 || window < 2)
+            throw std::runtime_error("RollingCovariance: need assets > 0 and window >= 2");
+    }
+
+    std::size_t assets() const { return n_; }
+    std::size_t window() const { return window_; }
+    std::size_t observations() const { return count_; }
+    std::uint64_t updates() const { return updates_; }
+
+    /**
+     * @brief Appends k days of returns (day d at returns + d · stride;
+     * stride 0 means n). Once the window is full, the oldest days leave.
+     * All entering and leaving days go into one rank update.
+     */
+    void update(const double* returns, std::size_t k = 1, std::size_t stride = 0) {
+        QF_TRACE_SCOPE_CAT("rolling_cov_update", "covariance");
+        if (stride == 0)
+            stride = n_;
+        if (k >= window_) {
+            // The whole window is replaced: rebuild from the last `window` days.
+            returns += (k - window_) * stride;
+            k = window_;
+            count_ = 0;
+            head_ = 0;
+            for (std::size_t d = 0; d < k; ++d)
+                store(returns + d * stride);
+            rebuild();
+            return;
+        }
+
+        const std::size_t leaving = count_ + k > window_ ? count_ + k - window_ : 0;
+        rows_.resize((k + leaving) * n_);
+        weights_.assign(k + leaving, 1.0);
+        for (std::size_t d = 0; d < leaving; ++d) {
+            const double* old = day(d);
+            std::copy(old, old + n_, rows_.begin() + static_cast<std::ptrdiff_t>(d * n_));
+            weights_[d] = -1.0;
+        }
+        count_ -= leaving;
+        for (std::size_t d = 0; d < k; ++d) {
+            double* x = store(returns + d * stride);
+            std::copy(x, x + n_, rows_.begin() + static_cast<std::ptrdiff_t>((leaving + d) * n_));
+        }
+        for (std::size_t d = 0; d < k + leaving; ++d) {
+            const double* x = rows_.data() + d * n_;
+            for (std::size_t i = 0; i < n_; ++i)
+                sum_[i] += weights_[d] * x[i];
+        }
+        packed_rank_update(cross_, 1.0, rows_.data(), k + leaving, n_, weights_.data());
+        ++updates_;
+    }
+
+    /**
+     * @brief Recomputes the running sums from the stored window. Adding
+     * and subtracting days drifts by rounding only (relative 1e-16 per
+     * update for return-sized data), so this is rarely needed.
+     */
+    void rebuild() {
+        std::fill(sum_.begin(), sum_.end(), 0.0);
+        std::fill(cross_.data(), cross_.data() + cross_.size(), 0.0);
+        rows_.resize(count_ * n_);
+        for (std::size_t d = 0; d < count_; ++d) {
+            const double* x = day(d);
+            std::copy(x, x + n_, rows_.begin() + static_cast<std::ptrdiff_t>(d * n_));
+            for (std::size_t i = 0; i < n_; ++i)
+                sum_[i] += x[i];
+        }
+        packed_rank_update(cross_, 0.0, rows_.data(), count_, n_);
+    }
+
+    void mean(double* out) const {
+        for (std::size_t i = 0; i < n_; ++i)
+            out[i] = sum_[i] / static_cast<double>(count_);
+    }
+
+    /**
+     * @brief Sample covariance Σ (x − x̄)(x − x̄)ᵀ / (T − 1) over the
+     * current window.
+     */
+    void covariance(PackedSymmetric& out) const {
+        require(2);
+        moments(out, 1.0 / static_cast<double>(count_ - 1));
+    }
+
+    /**
+     * @brief Ledoit–Wolf (2004) shrinkage toward μ I, μ = tr(S) / n, where S
+     * is the 1/T sample covariance. Returns the shrinkage intensity in
+     * [0, 1]; out = (1 − s) S + s μ I.
+     */
+    double ledoit_wolf(PackedSymmetric& out) const {
+        QF_TRACE_SCOPE_CAT("ledoit_wolf", "covariance");
+        require(2);
+        const double T = static_cast<double>(count_);
+        moments(out, 1.0 / T);
+        const Sums s = sums(out, nullptr, nullptr);
+        const double mu = s.trace / static_cast<double>(n_);
+
+        // ||S − μI||² and (1/T²) Σ_t ||y_t yᵀ_t − S||², the latter as
+        // (Σ_t ||y_t||⁴ − T ||S||²) / T².
+        const double delta = s.frobenius - static_cast<double>(n_) * mu * mu;
+        const double beta_bar = (fourth_moment_norm() - T * s.frobenius) / (T * T);
+        const double shrink = delta > 0.0 ? std::clamp(beta_bar / delta, 0.0, 1.0) : 0.0;
+
+        detail::for_each_row(n_, [&](std::size_t i, std::size_t j0, std::size_t j1) {
+            double* r = out.row(i);
+            for (std::size_t j = j0; j < j1; ++j)
+                r[j] *= 1.0 - shrink;
+            r[i] += shrink * mu;
+        });
+        return shrink;
+    }
+
+    /**
+     * @brief Ledoit–Wolf (2003) shrinkage toward the constant-correlation
+     * matrix F (f_ii = s_ii, f_ij = r̄ √(s_ii s_jj)), S the 1/T sample
+     * covariance. Returns δ in [0, 1]; out = δ F + (1 − δ) S.
+     */
+    double constant_correlation(PackedSymmetric& out) const {
+        QF_TRACE_SCOPE_CAT("constant_correlation", "covariance");
+        require(2);
+        const double T = static_cast<double>(count_);
+        const double n = static_cast<double>(n_);
+        moments(out, 1.0 / T);
+
+        std::vector<double> sd(n_), inv(n_);
+        double var_sum = 0.0, var_sq = 0.0;
+        for (std::size_t i = 0; i < n_; ++i) {
+            const double v = std::max(out(i, i), 0.0);
+            sd[i] = std::sqrt(v);
+            inv[i] = sd[i] > 0.0 ? 1.0 / sd[i] : 0.0;
+            var_sum += v;
+            var_sq += v * v;
+        }
+        const Sums s = sums(out, sd.data(), inv.data());
+        const double rbar = n_ > 1 ? s.correlation / (n * (n - 1.0) / 2.0) : 0.0;
+
+        // π̂ = Σ_ij Var(y_i y_j) = (1/T) Σ_t ||y_t||⁴ − ||S||².
+        const double pi_hat = fourth_moment_norm() / T - s.frobenius;
+        // ρ̂ = Σ_i π_ii + r̄ Σ_{i≠j} √(s_jj / s_ii) θ_ii,ij.
+        const double rho_hat = diagonal_pi(out) + rbar * cross_theta(out, sd, inv);
+        // γ̂ = Σ_{i≠j} (r̄ σ_i σ_j − s_ij)², expanded so it comes out of the
+        // same pass as r̄.
+        const double gamma_hat = rbar * rbar * (var_sum * var_sum - var_sq) -
+                                 4.0 * rbar * s.weighted + (s.frobenius - s.diagonal);
+        const double shrink =
+            gamma_hat > 0.0 ? std::clamp((pi_hat - rho_hat) / gamma_hat / T, 0.0, 1.0) : 0.0;
+
+        detail::for_each_row(n_, [&](std::size_t i, std::size_t j0, std::size_t j1) {
+            double* r = out.row(i);
+            for (std::size_t j = j0; j < j1; ++j) {
+                const double f = j == i ? r[j] : rbar * sd[i] * sd[j];
+                r[j] = shrink * f + (1.0 - shrink) * r[j];
+            }
+        });
+        return shrink;
+    }
+
+private:
+    struct Sums {
+        double trace = 0.0;
+        double frobenius = 0.0;    // ||S||²_F
+        double diagonal = 0.0;     // Σ_i s_ii²
+        double correlation = 0.0;  // Σ_{i>j} s_ij / (σ_i σ_j)
+        double weighted = 0.0;     // Σ_{i>j} σ_i σ_j s_ij
+    };
+
+    void require(std::size_t days) const {
+        if (count_ < days)
+            throw std::runtime_error("RollingCovariance: not enough observations in the window");
+    }
+
+    const double* slot(std::size_t s) const { return days_.data() + s * n_; }
+
+    // Copies one day into the ring buffer, non-finite values as 0.
+    double* store(const double* x) {
+        double* dst = days_.data() + head_ * n_;
+        for (std::size_t i = 0; i < n_; ++i)
+            dst[i] = std::isfinite(x[i]) ? x[i] : 0.0;
+        head_ = (head_ + 1) % window_;
+        count_ = std::min(count_ + 1, window_);
+        return dst;
+    }
+
+    // The d-th oldest day of the window.
+    const double* day(std::size_t d) const {
+        return slot((head_ + window_ - count_ + d) % window_);
+    }
+
+    // out = (Σ x xᵀ − T x̄ x̄ᵀ) · norm.
+    void moments(PackedSymmetric& out, double norm) const {
+        if (out.dim() != n_)
+            out.resize(n_);
+        const double T = static_cast<double>(count_);
+        std::vector<double> m(n_);
+        mean(m.data());
+        detail::for_each_row(n_, [&](std::size_t i, std::size_t j0, std::size_t j1) {
+            const double* c = cross_.row(i);
+            double* r = out.row(i);
+            const double mi = T * m[i];
+            for (std::size_t j = j0; j < j1; ++j)
+                r[j] = (c[j] - mi * m[j]) * norm;
+        });
+    }
+
+    // Trace, Frobenius norm and (given σ and 1/σ) the correlation sums over
+    // the packed triangle, reduced by row chunks so the result is deterministic.
+    Sums sums(const PackedSymmetric& S, const double* sd, const double* inv) const {
+        return parallel_reduce(
+            default_thread_pool(), 0, n_, 64, Sums{},
+            [&](std::size_t lo, std::size_t hi) {
+                Sums a;
+                for (std::size_t i = lo; i < hi; ++i) {
+                    const double* r = S.row(i);
+                    double off = 0.0, corr = 0.0, wsum = 0.0;
+                    if (sd) {
+                        for (std::size_t j = 0; j < i; ++j) {
+                            off += r[j] * r[j];
+                            corr += r[j] * inv[j];
+                            wsum += r[j] * sd[j];
+                        }
+                        a.correlation += corr * inv[i];
+                        a.weighted += wsum * sd[i];
+                    } else {
+                        for (std::size_t j = 0; j < i; ++j)
+                            off += r[j] * r[j];
+                    }
+                    a.trace += r[i];
+                    a.diagonal += r[i] * r[i];
+                    a.frobenius += r[i] * r[i] + 2.0 * off;
+                }
+                return a;
+            },
+            [](Sums a, const Sums& b) {
+                a.trace += b.trace;
+                a.frobenius += b.frobenius;
+                a.diagonal += b.diagonal;
+                a.correlation += b.correlation;
+                a.weighted += b.weighted;
+                return a;
+            });
+    }
+
+    // Σ_t ||y_t||⁴ over the window, y_t = x_t − x̄.
+    double fourth_moment_norm() const {
+        std::vector<double> m(n_);
+        mean(m.data());
+        return parallel_reduce(
+            default_thread_pool(), 0, count_, 8, 0.0,
+            [&](std::size_t lo, std::size_t hi) {
+                double acc = 0.0;
+                for (std::size_t d = lo; d < hi; ++d) {
+                    const double* x = day(d);
+                    double q = 0.0;
+                    for (std::size_t i = 0; i < n_; ++i) {
+                        const double y = x[i] - m[i];
+                        q += y * y;
+                    }
+                    acc += q * q;
+                }
+                return acc;
+            },
+            [](double a, double b) { return a + b; });
+    }
+
+    // Σ_i π_ii = Σ_i [(1/T) Σ_t y_ti⁴ − s_ii²].
+    double diagonal_pi(const PackedSymmetric& S) const {
+        std::vector<double> m(n_), q(n_, 0.0);
+        mean(m.data());
+        for (std::size_t d = 0; d < count_; ++d) {
+            const double* x = day(d);
+            for (std::size_t i = 0; i < n_; ++i) {
+                const double y2 = (x[i] - m[i]) * (x[i] - m[i]);
+                q[i] += y2 * y2;
+            }
+        }
+        double acc = 0.0;
+        for (std::size_t i = 0; i < n_; ++i)
+            acc += q[i] / static_cast<double>(count_) - S(i, i) * S(i, i);
+        return acc;
+    }
+
+    /**
+     * Σ_{i≠j} (σ_j / σ_i) θ_ii,ij, θ_ii,ij = (1/T) Σ_t y_ti³ y_tj − s_ii s_ij.
+     * Summed over j first: Σ_{j≠i} σ_j y_tj = u_t − σ_i y_ti with
+     * u_t = Σ_j σ_j y_tj, and Σ_{j≠i} σ_j s_ij = (S σ)_i − σ_i s_ii where
+     * S σ = (1/T) Σ_t y_t u_t. Everything is O(nT).
+     */
+    double cross_theta(const PackedSymmetric& S, const std::vector<double>& sd,
+                       const std::vector<double>& inv) const {
+        const double T = static_cast<double>(count_);
+        std::vector<double> m(n_), u(count_), acc(n_, 0.0), v(n_, 0.0);
+        mean(m.data());
+        for (std::size_t d = 0; d < count_; ++d) {
+            const double* x = day(d);
+            double s = 0.0;
+            for (std::size_t i = 0; i < n_; ++i)
+                s += sd[i] * (x[i] - m[i]);
+            u[d] = s;
+        }
+        parallel_for_range(default_thread_pool(), 0, n_, 256, [&](std::size_t lo, std::size_t hi) {
+            for (std::size_t d = 0; d < count_; ++d) {
+                const double* x = day(d);
+                for (std::size_t i = lo; i < hi; ++i) {
+                    const double y = x[i] - m[i];
+                    acc[i] += y * y * y * (u[d] - sd[i] * y);
+                    v[i] += y * u[d];
+                }
+            }
+        });
+        double total = 0.0;
+        for (std::size_t i = 0; i < n_; ++i) {
+            const double sii = S(i, i);
+            total += (acc[i] / T - sii * (v[i] / T - sd[i] * sii)) * inv[i];
+        }
+        return total;
+    }
+
+    std::size_t n_, window_;
+    std::vector<double> days_;  // ring buffer, window × n
+    std::size_t head_ = 0;      // next slot to write
+    std::size_t count_ = 0;     // days in the window
+    std::uint64_t updates_ = 0;
+
+    std::vector<double> sum_;  // Σ x
+    PackedSymmetric cross_;    // Σ x xᵀ
+
+    std::vector<double> rows_, weights_;  // update scratch
+};
+
+// =======================
+// EWMA
+// =======================
+
+/**
+ * RiskMetrics-style zero-mean EWMA, C ← λ C + (1 − λ) x xᵀ per day. k days
+ * go in as one rank-k update, C ← λ^k C + (1 − λ) Σ_r λ^{k−1−r} x_r x_rᵀ
+ * (oldest first). Starts from `initial` (e.g. a sample covariance over a
+ * burn-in window) or from zero.
+ */
+class EwmaCovariance {
+public:
+    explicit EwmaCovariance(std::size_t assets, double lambda = 0.94)
+        : lambda_(lambda), cov_(assets) {
+        check();
+    }
+
+    EwmaCovariance(const PackedSymmetric& initial, double lambda)
+        : lambda_(lambda), cov_(initial) {
+        check();
+    }
+
+    std::size_t assets() const { return cov_.dim(); }
+    double lambda() const { return lambda_; }
+    const PackedSymmetric& covariance() const { return cov_; }
+
+    void update(const double* returns, std::size_t k = 1, std::size_t stride = 0) {
+        QF_TRACE_SCOPE_CAT("ewma_cov_update", "covariance");
+        const std::size_t n = cov_.dim();
+        if (stride == 0)
+            stride = n;
+        rows_.resize(k * n);
+        weights_.resize(k);
+        double w = 1.0 - lambda_;
+        for (std::size_t r = k; r-- > 0;) {
+            const double* x = returns + r * stride;
+            double* dst = rows_.data() + r * n;
+            for (std::size_t i = 0; i < n; ++i)
+                dst[i] = std::isfinite(x[i]) ? x[i] : 0.0;
+            weights_[r] = w;
+            w *= lambda_;
+        }
+        packed_rank_update(cov_, std::pow(lambda_, static_cast<double>(k)), rows_.data(), k, n,
+                           weights_.data());
+    }
+
+private:
+    void check() const {
+        if (!(lambda_ > 0.0 && lambda_ < 1.0))
+            throw std::runtime_error("EwmaCovariance: lambda must be in (0, 1)");
+    }
+
+    double lambda_;
+    PackedSymmetric cov_;
+    std::vector<double> rows_, weights_;
+};
+
+// =======================
+// Factor structure
+// =======================
+
+/**
+ * Σ = B F Bᵀ + diag(d) for n assets and k factors: exposures B (n × k,
+ * asset-major), factor covariance F (k × k, row-major) and specific
+ * variances d. Products with Σ cost O(nk + k²) instead of O(n²), which
+ * is what the portfolio optimizer and the risk model rely on.
+ */
+struct FactorCovariance {
+    std::size_t assets = 0;
+    std::size_t factors = 0;
+    std::vector<double> exposures;          // B, n × k
+    std::vector<double> factor_covariance;  // F, k × k
+    std::vector<double> specific_variance;  // d, n
+
+    FactorCovariance() = default;
+    FactorCovariance(std::size_t n, std::size_t k)
+        : assets(n), factors(k), exposures(n * k, 0.0), factor_covariance(k * k, 0.0),
+          specific_variance(n, 0.0) {}
+
+    void validate() const {
+        if (exposures.size() != assets * factors ||
+            factor_covariance.size() != factors * factors ||
+            specific_variance.size() != assets)
+            throw std::runtime_error("FactorCovariance: inconsistent dimensions");
+    }
+
+    // f = Bᵀ x (k).
+    void factor_exposure(const double* x, double* f) const {
+        std::fill(f, f + factors, 0.0);
+        for (std::size_t i = 0; i < assets; ++i) {
+            const double* b = exposures.data() + i * factors;
+            for (std::size_t c = 0; c < factors; ++c)
+                f[c] += x[i] * b[c];
+        }
+    }
+
+    // y = Σ x.
+    void multiply(const double* x, double* y) const {
+        std::vector<double> f(factors), g(factors, 0.0);
+        factor_exposure(x, f.data());
+        for (std::size_t a = 0; a < factors; ++a)
+            for (std::size_t c = 0; c < factors; ++c)
+                g[a] += factor_covariance[a * factors + c] * f[c];
+        for (std::size_t i = 0; i < assets; ++i) {
+            const double* b = exposures.data() + i * factors;
+            double s = 0.0;
+            for (std::size_t c = 0; c < factors; ++c)
+                s += b[c] * g[c];
+            y[i] = s + specific_variance[i] * x[i];
+        }
+    }
+
+    // xᵀ Σ x = fᵀ F f + Σ d_i x_i².
+    double variance(const double* x) const {
+        std::vector<double> f(factors);
+        factor_exposure(x, f.data());
+        double v = 0.0;
+        for (std::size_t a = 0; a < factors; ++a)
+            for (std::size_t c = 0; c < factors; ++c)
+                v += f[a] * factor_covariance[a * factors + c] * f[c];
+        for (std::size_t i = 0; i < assets; ++i)
+            v += specific_variance[i] * x[i] * x[i];
+        return v;
+    }
+
+    // Dense Σ in packed form (O(n² k); for checks and small universes).
+    void to_packed(PackedSymmetric& out) const {
+        out.resize(assets);
+        std::vector<double> bf(assets * factors, 0.0);
+        for (std::size_t i = 0; i < assets; ++i)
+            for (std::size_t a = 0; a < factors; ++a)
+                for (std::size_t c = 0; c < factors; ++c)
+                    bf[i * factors + c] +=
+                        exposures[i * factors + a] * factor_covariance[a * factors + c];
+        detail::for_each_row(assets, [&](std::size_t i, std::size_t j0, std::size_t j1) {
+            double* r = out.row(i);
+            const double* bi = bf.data() + i * factors;
+            for (std::size_t j = j0; j < j1; ++j) {
+                const double* bj = exposures.data() + j * factors;
+                double s = 0.0;
+                for (std::size_t c = 0; c < factors; ++c)
+                    s += bi[c] * bj[c];
+                r[j] = s;
+            }
+            r[i] += specific_variance[i];
+        });
+    }
+};
+
+} // namespace qf
+
+#endif // QF_COVARIANCE_H
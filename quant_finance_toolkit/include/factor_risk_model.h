@@ -0,0 +1,485 @@
+#ifndef QF_FACTOR_RISK_MODEL_H
+#define QF_FACTOR_RISK_MODEL_H
+
+/**
+ * @file factor_risk_model.h
+ * @author John Jacobson
+ * @brief Fundamental factor risk model: daily cross-sectional regressions
+ *        for factor and specific returns, EWMA factor covariance and
+ *        specific risk, and portfolio risk decomposition.
+ *
+ * Each date t regresses the asset returns on the asset exposures X_t with
+ * regression weights v (typically √ market cap):
+ *
+ *     f_t = (Xᵀ V X)⁻¹ Xᵀ V r_t,   e_t = r_t − X f_t
+ *
+ * Exposures change slowly (monthly or quarterly rebalanced styles,
+ * industry memberships), so they are registered once as snapshots, and
+ * many dates share one snapshot. The Cholesky factor of Xᵀ V X is
+ * computed once per snapshot and reused for every date that uses it. A
+ * date with missing returns downdates the Gram matrix by the missing
+ * names (O(m k²) for m of them) instead of rebuilding it. The per-date
+ * right-hand sides and residuals are computed for blocks of dates in one
+ * pass over X, and blocks run across the shared thread pool.
+ *
+ * Factor returns feed an EWMA factor covariance and residuals an EWMA
+ * specific variance per asset. Both are bias-corrected (divided by the
+ * sum of the weights), so early estimates are not pulled toward zero.
+ * covariance() packages them with a snapshot's exposures as a
+ * FactorCovariance for the portfolio optimizer.
+ *
+ * decompose_risk() splits wᵀΣw into factor and specific parts and per
+ * factor and per asset contributions. It aggregates the exposures
+ * x = Bᵀw once (O(nk)), after which the factor risk is O(k²), never O(n²).
+ *
+ * Returns are passed date-major (one row of n per day). Non-finite
+ * returns mark a name as missing that day: it is left out of the
+ * regression and of the specific-risk update.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "covariance.h"
+#include "thread_pool.h"
+#include "trace.h"
+
+namespace qf {
+
+// =======================
+// Configuration
+// =======================
+
+struct FactorRiskModelConfig {
+    double factor_lambda = 0.97;    // EWMA decay of the factor covariance
+    double specific_lambda = 0.97;  // EWMA decay of the specific variances
+    double ridge = 1e-10;           // relative to the mean of diag(Xᵀ V X); keeps
+                                    // collinear factors (industries + market) solvable
+};
+
+namespace detail {
+
+constexpr std::size_t kRiskDateBlock = 8;  // dates per pass over the exposures
+
+/**
+ * In-place lower Cholesky of a k × k row-major matrix. A pivot at or
+ * below `tol` (a factor with no weight that day) leaves a zero column and
+ * risk_solve() returns 0 for that factor. The upper triangle is ignored.
+ */
+inline void risk_cholesky(double* a, std::size_t k, double tol) {
+    for (std::size_t j = 0; j < k; ++j) {
+        double* aj = a + j * k;
+        double d = aj[j];
+        for (std::size_t p = 0; p < j; ++p)
+            d -= aj[p] * aj[p];
+        if (!(d > tol)) {
+            for (std::size_t i = j; i < k; ++i)
+                a[i * k + j] = 0.0;
+            continue;
+        }
+        d = std::sqrt(d);
+        aj[j] = d;
+        for (std::size_t i = j + 1; i < k; ++i) {
+            double* ai = a + i * k;
+            double s = ai[j];
+            for (std::size_t p = 0; p < j; ++p)
+                s -= ai[p] * aj[p];
+            ai[j] = s / d;
+        }
+    }
+}
+
+// L Lᵀ x = b in place; factors with a zero pivot come out as 0.
+inline void risk_solve(const double* L, std::size_t k, double* x) {
+    for (std::size_t i = 0; i < k; ++i) {
+        const double* li = L + i * k;
+        if (li[i] == 0.0) {
+            x[i] = 0.0;
+            continue;
+        }
+        double s = x[i];
+        for (std::size_t p = 0; p < i; ++p)
+            s -= li[p] * x[p];
+        x[i] = s / li[i];
+    }
+    for (std::size_t i = k; i-- > 0;) {
+        const double lii = L[i * k + i];
+        if (lii == 0.0) {
+            x[i] = 0.0;
+            continue;
+        }
+        double s = x[i];
+        for (std::size_t p = i + 1; p < k; ++p)
+            s -= L[p * k + i] * x[p];
+        x[i] = s / lii;
+    }
+}
+
+} // namespace detail
+
+// =======================
+// Risk decomposition
+// =======================
+
+struct RiskDecomposition {
+    double variance = 0.0;                     // wᵀ Σ w
+    double factor_variance = 0.0;              // xᵀ F x, x = Bᵀ w
+    double specific_variance = 0.0;            // Σ d_i w_i²
+    std::vector<double> exposures;             // x (k)
+    std::vector<double> factor_contributions;  // x_a (F x)_a, sums to factor_variance
+    std::vector<double> asset_contributions;   // w_i (Σ w)_i, sums to variance
+};
+
+/**
+ * @brief Factor/specific split of a portfolio's variance under a factor
+ * covariance. O(nk) to aggregate exposures and asset contributions, O(k²)
+ * for the factor part.
+ */
+inline RiskDecomposition decompose_risk(const FactorCovariance& cov, const double* weights) {
+    QF_TRACE_SCOPE_CAT("decompose_risk", "risk");
+    cov.validate();
+    const std::size_t n = cov.assets, k = cov.factors;
+    RiskDecomposition out;
+    out.exposures.resize(k);
+    cov.factor_exposure(weights, out.exposures.data());
+
+    std::vector<double> fx(k, 0.0);
+    for (std::size_t a = 0; a < k; ++a)
+        for (std::size_t c = 0; c < k; ++c)
+            fx[a] += cov.factor_covariance[a * k + c] * out.exposures[c];
+    out.factor_contributions.resize(k);
+    for (std::size_t a = 0; a < k; ++a) {
+        out.factor_contributions[a] = out.exposures[a] * fx[a];
+        out.factor_variance += out.factor_contributions[a];
+    }
+
+    out.asset_contributions.resize(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        const double* b = cov.exposures.data() + i * k;
+        double s = 0.0;
+        for (std::size_t c = 0; c < k; ++c)
+            s += b[c] * fx[c];
+        const double spec = cov.specific_variance[i] * weights[i] * weights[i];
+        out.specific_variance += spec;
+        out.asset_contributions[i] = weights[i] * s + spec;
+    }
+    out.variance = out.factor_variance + out.specific_variance;
+    return out;
+}
+
+// =======================
+// Factor risk model
+// =======================
+
+/**
+ * Cross-sectional regressions plus EWMA factor and specific risk for a
+ * fixed universe of n assets and k factors.
+ */
+class FactorRiskModel {
+public:
+    FactorRiskModel(std::size_t assets, std::size_t factors, FactorRiskModelConfig cfg = {})
+        : n_(assets), k_(factors), cfg_(cfg), factor_num_(factors * factors, 0.0),
+          specific_num_(assets, 0.0), specific_den_(assets, 0.0) {
+        if (n_ == 0 || k_ == 0)
+            throw std::runtime_error("FactorRiskModel: need at least one asset and one factor");
+        if (!(cfg_.factor_lambda > 0.0 && cfg_.factor_lambda < 1.0) ||
+            !(cfg_.specific_lambda > 0.0 && cfg_.specific_lambda < 1.0))
+            throw std::runtime_error("FactorRiskModel: lambdas must be in (0, 1)");
+        if (!(cfg_.ridge >= 0.0))
+            throw std::runtime_error("FactorRiskModel: ridge must be non-negative");
+    }
+
+    std::size_t assets() const { return n_; }
+    std::size_t factors() const { return k_; }
+    std::size_t snapshots() const { return snapshots_.size(); }
+    std::size_t observations() const { return days_; }
+
+    /**
+     * Register exposures (n × k, asset-major) with regression weights (n,
+     * null = equal) and return the snapshot id. A name with a non-finite
+     * exposure gets zero exposures and weight 0, so it is left out of the
+     * regression and its residual is its whole return.
+     */
+    std::size_t add_exposures(const double* exposures, const double* weights = nullptr) {
+        snapshots_.emplace_back();
+        set_exposures(snapshots_.size() - 1, exposures, weights);
+        return snapshots_.size() - 1;
+    }
+
+    // Overwrite snapshot `id` in place, e.g. to reuse one slot per month.
+    void set_exposures(std::size_t id, const double* exposures, const double* weights = nullptr) {
+        QF_TRACE_SCOPE_CAT("factor_model_exposures", "risk");
+        if (id >= snapshots_.size())
+            throw std::runtime_error("FactorRiskModel: unknown exposure snapshot");
+        Snapshot& s = snapshots_[id];
+        s.exposures.assign(exposures, exposures + n_ * k_);
+        s.weights.assign(n_, 1.0);
+        for (std::size_t i = 0; i < n_; ++i) {
+            double& v = s.weights[i];
+            if (weights)
+                v = weights[i];
+            if (!(v >= 0.0) || !std::isfinite(v))
+                throw std::runtime_error("FactorRiskModel: weights must be finite and non-negative");
+            double* x = s.exposures.data() + i * k_;
+            if (!std::all_of(x, x + k_, [](double e) { return std::isfinite(e); })) {
+                std::fill(x, x + k_, 0.0);
+                v = 0.0;
+            }
+        }
+
+        // Xᵀ V X by a deterministic parallel reduction over names.
+        const std::size_t kk = k_ * k_;
+        s.gram = parallel_reduce(
+            default_thread_pool(), 0, n_, 256, std::vector<double>(kk, 0.0),
+            [&](std::size_t lo, std::size_t hi) {
+                std::vector<double> g(kk, 0.0);
+                for (std::size_t i = lo; i < hi; ++i)
+                    add_outer(g.data(), s.exposures.data() + i * k_, s.weights[i]);
+                return g;
+            },
+            [](std::vector<double> a, const std::vector<double>& b) {
+                for (std::size_t j = 0; j < a.size(); ++j)
+                    a[j] += b[j];
+                return a;
+            });
+        double trace = 0.0;
+        for (std::size_t a = 0; a < k_; ++a)
+            trace += s.gram[a * k_ + a];
+        s.ridge = cfg_.ridge * trace / static_cast<double>(k_);
+        for (std::size_t a = 0; a < k_; ++a)
+            s.gram[a * k_ + a] += s.ridge;
+        s.chol = s.gram;
+        detail::risk_cholesky(s.chol.data(), k_, s.ridge * 0.5);
+    }
+
+    /**
+     * Regress `days` dates (row t of returns at returns + t * stride,
+     * stride 0 = n) on the exposures of snapshot[t], then update the EWMA
+     * factor covariance and specific variances in date order.
+     *
+     * Optional outputs: factor_returns (days × k), specific_returns
+     * (days × n, NaN where the return is missing) and r_squared (days,
+     * weighted and uncentered).
+     */
+    void update(const double* returns, std::size_t days, const std::size_t* snapshot,
+                std::size_t stride = 0, double* factor_returns = nullptr,
+                double* specific_returns = nullptr, double* r_squared = nullptr) {
+        QF_TRACE_SCOPE_CAT("factor_model_update", "risk");
+        if (stride == 0)
+            stride = n_;
+        for (std::size_t t = 0; t < days; ++t)
+            if (snapshot[t] >= snapshots_.size())
+                throw std::runtime_error("FactorRiskModel: unknown exposure snapshot");
+
+        f_.resize(days * k_);
+        e_.resize(days * n_);
+        r2_.resize(days);
+
+        // Blocks of up to kRiskDateBlock consecutive dates on one snapshot.
+        blocks_.clear();
+        for (std::size_t t = 0; t < days;) {
+            std::size_t end = t + 1;
+            while (end < days && end - t < detail::kRiskDateBlock && snapshot[end] == snapshot[t])
+                ++end;
+            blocks_.push_back(t);
+            t = end;
+        }
+        blocks_.push_back(days);
+        parallel_for(default_thread_pool(), 0, blocks_.size() - 1, 1, [&](std::size_t b) {
+            const std::size_t t0 = blocks_[b], t1 = blocks_[b + 1];
+            regress(snapshots_[snapshot[t0]], returns + t0 * stride, stride, t1 - t0,
+                    f_.data() + t0 * k_, e_.data() + t0 * n_, r2_.data() + t0);
+        });
+
+        for (std::size_t t = 0; t < days; ++t)
+            accumulate(f_.data() + t * k_, e_.data() + t * n_);
+        days_ += days;
+
+        if (factor_returns)
+            std::copy(f_.begin(), f_.end(), factor_returns);
+        if (specific_returns)
+            std::copy(e_.begin(), e_.end(), specific_returns);
+        if (r_squared)
+            std::copy(r2_.begin(), r2_.end(), r_squared);
+    }
+
+    // One date on one snapshot.
+    void update(const double* returns, std::size_t snapshot) { update(returns, 1, &snapshot); }
+
+    // EWMA factor covariance F (k × k, row-major).
+    std::vector<double> factor_covariance() const {
+        std::vector<double> f(factor_num_);
+        const double den = factor_den_ > 0.0 ? factor_den_ : 1.0;
+        for (double& x : f)
+            x /= den;
+        return f;
+    }
+
+    /**
+     * EWMA specific variances. A name never observed gets the mean of the
+     * observed ones, so the result is usable as a diagonal.
+     */
+    std::vector<double> specific_variance() const {
+        std::vector<double> d(n_, 0.0);
+        double sum = 0.0;
+        std::size_t seen = 0;
+        for (std::size_t i = 0; i < n_; ++i) {
+            if (specific_den_[i] > 0.0) {
+                d[i] = specific_num_[i] / specific_den_[i];
+                sum += d[i];
+                ++seen;
+            }
+        }
+        const double fill = seen ? sum / static_cast<double>(seen) : 0.0;
+        for (std::size_t i = 0; i < n_; ++i)
+            if (!(specific_den_[i] > 0.0))
+                d[i] = fill;
+        return d;
+    }
+
+    // Σ = B F Bᵀ + D with B from `snapshot` (the latest by default).
+    FactorCovariance covariance(std::size_t snapshot = std::numeric_limits<std::size_t>::max()) const {
+        if (snapshots_.empty())
+            throw std::runtime_error("FactorRiskModel: no exposures registered");
+        if (snapshot == std::numeric_limits<std::size_t>::max())
+            snapshot = snapshots_.size() - 1;
+        if (snapshot >= snapshots_.size())
+            throw std::runtime_error("FactorRiskModel: unknown exposure snapshot");
+        FactorCovariance cov(n_, k_);
+        cov.exposures = snapshots_[snapshot].exposures;
+        cov.factor_covariance = factor_covariance();
+        cov.specific_variance = specific_variance();
+        return cov;
+    }
+
+private:
+    struct Snapshot {
+        std::vector<double> exposures;  // n × k
+        std::vector<double> weights;    // regression weights v
+        std::vector<double> gram;       // Xᵀ V X + ridge I
+        std::vector<double> chol;       // its Cholesky factor
+        double ridge = 0.0;
+    };
+
+    // g += v x xᵀ (lower triangle only; the Cholesky reads nothing else).
+    void add_outer(double* g, const double* x, double v) const {
+        if (v == 0.0)
+            return;
+        for (std::size_t a = 0; a < k_; ++a) {
+            const double va = v * x[a];
+            double* ga = g + a * k_;
+            for (std::size_t c = 0; c <= a; ++c)
+                ga[c] += va * x[c];
+        }
+    }
+
+    /**
+     * WLS for m ≤ kRiskDateBlock consecutive dates on one snapshot. The
+     * right-hand sides Xᵀ V r_t and the residuals each take one pass over
+     * X for the whole block.
+     */
+    void regress(const Snapshot& s, const double* r, std::size_t stride, std::size_t m,
+                 double* f, double* e, double* r2) const {
+        constexpr std::size_t B = detail::kRiskDateBlock;
+        double tss[B] = {};
+        std::size_t missing[B] = {};
+        std::fill(f, f + m * k_, 0.0);
+        for (std::size_t i = 0; i < n_; ++i) {
+            const double* x = s.exposures.data() + i * k_;
+            const double v = s.weights[i];
+            for (std::size_t d = 0; d < m; ++d) {
+                const double ri = r[d * stride + i];
+                if (!std::isfinite(ri)) {
+                    missing[d] += v > 0.0;
+                    continue;
+                }
+                const double vr = v * ri;
+                tss[d] += vr * ri;
+                double* fd = f + d * k_;
+                for (std::size_t a = 0; a < k_; ++a)
+                    fd[a] += vr * x[a];
+            }
+        }
+
+        std::vector<double> g;
+        for (std::size_t d = 0; d < m; ++d) {
+            if (missing[d] == 0) {
+                detail::risk_solve(s.chol.data(), k_, f + d * k_);
+                continue;
+            }
+            // Downdate by the missing names, or rebuild when most are missing.
+            const double* rd = r + d * stride;
+            if (2 * missing[d] < n_) {
+                g = s.gram;
+                for (std::size_t i = 0; i < n_; ++i)
+                    if (!std::isfinite(rd[i]))
+                        add_outer(g.data(), s.exposures.data() + i * k_, -s.weights[i]);
+            } else {
+                g.assign(k_ * k_, 0.0);
+                for (std::size_t i = 0; i < n_; ++i)
+                    if (std::isfinite(rd[i]))
+                        add_outer(g.data(), s.exposures.data() + i * k_, s.weights[i]);
+                for (std::size_t a = 0; a < k_; ++a)
+                    g[a * k_ + a] += s.ridge;
+            }
+            detail::risk_cholesky(g.data(), k_, s.ridge * 0.5);
+            detail::risk_solve(g.data(), k_, f + d * k_);
+        }
+
+        double rss[B] = {};
+        for (std::size_t i = 0; i < n_; ++i) {
+            const double* x = s.exposures.data() + i * k_;
+            for (std::size_t d = 0; d < m; ++d) {
+                const double ri = r[d * stride + i];
+                if (!std::isfinite(ri)) {
+                    e[d * n_ + i] = std::numeric_limits<double>::quiet_NaN();
+                    continue;
+                }
+                const double* fd = f + d * k_;
+                double fit = 0.0;
+                for (std::size_t a = 0; a < k_; ++a)
+                    fit += x[a] * fd[a];
+                const double res = ri - fit;
+                e[d * n_ + i] = res;
+                rss[d] += s.weights[i] * res * res;
+            }
+        }
+        for (std::size_t d = 0; d < m; ++d)
+            r2[d] = tss[d] > 0.0 ? 1.0 - rss[d] / tss[d] : 0.0;
+    }
+
+    // One date into the EWMA sums (zero-mean, as in EwmaCovariance).
+    void accumulate(const double* f, const double* e) {
+        const double lf = cfg_.factor_lambda;
+        for (std::size_t a = 0; a < k_; ++a)
+            for (std::size_t c = 0; c < k_; ++c)
+                factor_num_[a * k_ + c] = lf * factor_num_[a * k_ + c] + f[a] * f[c];
+        factor_den_ = lf * factor_den_ + 1.0;
+
+        const double ls = cfg_.specific_lambda;
+        for (std::size_t i = 0; i < n_; ++i) {
+            if (!std::isfinite(e[i]))
+                continue;
+            specific_num_[i] = ls * specific_num_[i] + e[i] * e[i];
+            specific_den_[i] = ls * specific_den_[i] + 1.0;
+        }
+    }
+
+    std::size_t n_, k_;
+    FactorRiskModelConfig cfg_;
+    std::vector<Snapshot> snapshots_;
+    std::vector<double> factor_num_;
+    double factor_den_ = 0.0;
+    std::vector<double> specific_num_, specific_den_;
+    std::size_t days_ = 0;
+    std::vector<double> f_, e_, r2_;
+    std::vector<std::size_t> blocks_;
+};
+
+} // namespace qf
+
+#endif // QF_FACTOR_RISK_MODEL_H
@@ -0,0 +1,289 @@
+#ifndef QF_FAST_ORDERBOOK_H
+#define QF_FAST_ORDERBOOK_H
+
+/**
+ * @file fast_orderbook.h
+ * @author John Jacobson
+ * @brief Flat-array limit order book, a drop-in for qf::OrderBook.
+ *
+ * OrderBook keeps levels in std::map, FIFOs in std::deque and the order
+ * index in an unordered_map; every add touches three node containers and a
+ * cancel scans its level. This version keeps the same matching rules and
+ * the same interface, with flat storage instead:
+ *
+ *   - each side is a sorted vector of levels with the best price at the
+ *     back, so consuming the top of book is a pop_back and most inserts land
+ *     near the end
+ *   - orders live in a pooled slot array (free list reuse) and each level
+ *     holds an intrusive doubly linked FIFO of slot indices
+ *   - order IDs are sequential, so the ID → slot index is a plain vector
+ *   - cancel unlinks in O(1) after a binary search for the level
+ *
+ * Its output must match OrderBook exactly (trades, best prices, depth);
+ * tools/orderbook_diff.cpp checks that on randomized command streams.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "orderbook_simulator.h"
+
+namespace qf {
+
+class FastOrderBook {
+public:
+    FastOrderBook() = default;
+
+    std::uint64_t next_order_id() const {
+        return next_id_;
+    }
+
+    std::pair<std::uint64_t, std::vector<Trade>>
+    add_limit_order(Side side, double price, std::uint64_t quantity) {
+        std::vector<Trade> trades;
+        std::uint64_t id = add_limit_order(side, price, quantity, trades);
+        return {id, std::move(trades)};
+    }
+
+    template <typename TradeVec>
+    std::uint64_t add_limit_order(Side side, double price, std::uint64_t quantity,
+                                  TradeVec& trades) {
+        std::uint64_t id = next_id_++;
+        std::uint64_t remaining = quantity;
+
+        if (side == Side::Buy)
+            remaining = match(asks_, id, price, remaining, Side::Buy, trades);
+        else
+            remaining = match(bids_, id, price, remaining, Side::Sell, trades);
+
+        slot_of_.push_back(kNone);
+        if (remaining > 0)
+            rest(side, id, price, remaining);
+        return id;
+    }
+
+    bool cancel_order(std::uint64_t id) {
+        if (id == 0 || id >= next_id_)
+            return false;
+        std::uint32_t s = slot_of_[id - 1];
+        if (s == kNone)
+            return false;
+
+        const Slot& o = slots_[s];
+        Levels& levels = (o.side == Side::Buy) ? bids_ : asks_;
+        std::size_t li = find_level(levels, o.side, o.price);
+        Level& lv = levels[li];
+        lv.quantity -= o.remaining;
+        --lv.orders;
+        unlink(lv, s);
+        release(id, s);
+        if (lv.orders == 0)
+            levels.erase(levels.begin() + static_cast<std::ptrdiff_t>(li));
+        return true;
+    }
+
+    template <typename TradeVec>
+    bool modify_order(std::uint64_t id, double price, std::uint64_t quantity,
+                      TradeVec& trades) {
+        if (id == 0 || id >= next_id_)
+            return false;
+        std::uint32_t s = slot_of_[id - 1];
+        if (s == kNone)
+            return false;
+        if (quantity == 0)
+            return cancel_order(id);
+
+        Slot& o = slots_[s];
+        const Side side = o.side;
+        if (price == o.price && quantity <= o.remaining) {
+            Levels& levels = (side == Side::Buy) ? bids_ : asks_;
+            levels[find_level(levels, side, price)].quantity -= o.remaining - quantity;
+            o.remaining = quantity;
+            return true;
+        }
+
+        cancel_order(id);
+        std::uint64_t remaining = (side == Side::Buy)
+                                      ? match(asks_, id, price, quantity, Side::Buy, trades)
+                                      : match(bids_, id, price, quantity, Side::Sell, trades);
+        if (remaining > 0)
+            rest(side, id, price, remaining);
+        return true;
+    }
+
+    std::optional<double> best_bid() const {
+        if (bids_.empty()) return std::nullopt;
+        return bids_.back().price;
+    }
+
+    std::optional<double> best_ask() const {
+        if (asks_.empty()) return std::nullopt;
+        return asks_.back().price;
+    }
+
+    void depth(Side side, std::size_t max_levels, std::vector<DepthLevel>& out) const {
+        const Levels& levels = (side == Side::Buy) ? bids_ : asks_;
+        out.clear();
+        for (auto it = levels.rbegin(); it != levels.rend() && out.size() < max_levels; ++it)
+            out.push_back({it->price, it->quantity, it->orders});
+    }
+
+    std::vector<DepthLevel> depth(Side side, std::size_t max_levels) const {
+        std::vector<DepthLevel> out;
+        depth(side, max_levels, out);
+        return out;
+    }
+
+    std::size_t order_count() const {
+        return live_;
+    }
+
+    bool empty() const {
+        return bids_.empty() && asks_.empty();
+    }
+
+private:
+    static constexpr std::uint32_t kNone = ~std::uint32_t{0};
+
+    struct Slot {
+        std::uint64_t id;
+        double price;
+        std::uint64_t remaining;
+        std::uint32_t prev;
+        std::uint32_t next;  // also the free-list link
+        Side side;
+    };
+
+    struct Level {
+        double price;
+        std::uint64_t quantity;
+        std::uint32_t orders;
+        std::uint32_t head;
+        std::uint32_t tail;
+    };
+
+    // Sorted so the best price is at the back: bids ascending, asks
+    // descending.
+    using Levels = std::vector<Level>;
+
+    Levels bids_;
+    Levels asks_;
+    std::vector<Slot> slots_;
+    std::vector<std::uint32_t> slot_of_;  // order ID - 1 → slot, kNone when not resting
+    std::uint32_t free_ = kNone;
+    std::size_t live_ = 0;
+    std::uint64_t next_id_ = 1;
+
+    // True when `a` is a worse price than `b` on this side, i.e. sorts first.
+    static bool worse(Side side, double a, double b) {
+        return side == Side::Buy ? a < b : a > b;
+    }
+
+    static std::size_t lower_level(const Levels& levels, Side side, double price) {
+        auto it = std::lower_bound(levels.begin(), levels.end(), price,
+                                   [side](const Level& l, double p) { return worse(side, l.price, p); });
+        return static_cast<std::size_t>(it - levels.begin());
+    }
+
+    static std::size_t find_level(const Levels& levels, Side side, double price) {
+        // Most activity is near the top of book, so check the back first.
+        std::size_t n = levels.size();
+        if (n > 0 && levels[n - 1].price == price)
+            return n - 1;
+        return lower_level(levels, side, price);
+    }
+
+    std::uint32_t acquire() {
+        if (free_ != kNone) {
+            std::uint32_t s = free_;
+            free_ = slots_[s].next;
+            return s;
+        }
+        slots_.push_back(Slot{});
+        return static_cast<std::uint32_t>(slots_.size() - 1);
+    }
+
+    void release(std::uint64_t id, std::uint32_t s) {
+        slot_of_[id - 1] = kNone;
+        slots_[s].next = free_;
+        free_ = s;
+        --live_;
+    }
+
+    void unlink(Level& lv, std::uint32_t s) {
+        const Slot& o = slots_[s];
+        if (o.prev != kNone) slots_[o.prev].next = o.next;
+        else lv.head = o.next;
+        if (o.next != kNone) slots_[o.next].prev = o.prev;
+        else lv.tail = o.prev;
+    }
+
+    void rest(Side side, std::uint64_t id, double price, std::uint64_t remaining) {
+        Levels& levels = (side == Side::Buy) ? bids_ : asks_;
+        std::size_t li = find_level(levels, side, price);
+        if (li == levels.size() || levels[li].price != price) {
+            levels.insert(levels.begin() + static_cast<std::ptrdiff_t>(li),
+                          Level{price, 0, 0, kNone, kNone});
+        }
+        Level& lv = levels[li];
+
+        std::uint32_t s = acquire();
+        slots_[s] = Slot{id, price, remaining, lv.tail, kNone, side};
+        if (lv.tail != kNone) slots_[lv.tail].next = s;
+        else lv.head = s;
+        lv.tail = s;
+        lv.quantity += remaining;
+        ++lv.orders;
+
+        slot_of_[id - 1] = s;
+        ++live_;
+    }
+
+    /**
+     * Match an incoming order against the opposite side (`book`), best level
+     * first, FIFO within a level. Returns the unfilled quantity.
+     */
+    template <typename TradeVec>
+    std::uint64_t match(Levels& book, std::uint64_t id, double price, std::uint64_t remaining,
+                        Side incoming_side, TradeVec& trades) {
+        while (remaining > 0 && !book.empty()) {
+            Level& lv = book.back();
+            if (incoming_side == Side::Buy ? price < lv.price : price > lv.price)
+                break;
+
+            while (remaining > 0 && lv.head != kNone) {
+                std::uint32_t s = lv.head;
+                Slot& resting = slots_[s];
+                std::uint64_t qty = std::min(remaining, resting.remaining);
+
+                if (incoming_side == Side::Buy)
+                    trades.push_back({id, resting.id, lv.price, qty});
+                else
+                    trades.push_back({resting.id, id, lv.price, qty});
+
+                remaining -= qty;
+                resting.remaining -= qty;
+                lv.quantity -= qty;
+
+                if (resting.remaining == 0) {
+                    lv.head = resting.next;
+                    if (lv.head != kNone) slots_[lv.head].prev = kNone;
+                    else lv.tail = kNone;
+                    --lv.orders;
+                    release(resting.id, s);
+                }
+            }
+
+            if (lv.head == kNone)
+                book.pop_back();
+        }
+        return remaining;
+    }
+};
+
+} // namespace qf
+
+#endif // QF_FAST_ORDERBOOK_H
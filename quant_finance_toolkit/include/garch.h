@@ -0,0 +1,905 @@
+#ifndef QF_GARCH_H
+#define QF_GARCH_H
+
+/**
+ * @file garch.h
+ * @author John Jacobson
+ * @brief Batch maximum-likelihood estimation of GARCH(1,1), GJR-GARCH(1,1)
+ *        and EGARCH(1,1) over thousands of return series.
+ *
+ * With ε_t = r_t − μ and z_t = ε_t / σ_t (Gaussian likelihood):
+ *
+ *   GARCH   σ²_t = ω + α ε²_{t−1} + β σ²_{t−1}
+ *   GJR     σ²_t = ω + (α + γ 1[ε_{t−1} < 0]) ε²_{t−1} + β σ²_{t−1}
+ *   EGARCH  ln σ²_t = ω + α (|z_{t−1}| − √(2/π)) + γ z_{t−1} + β ln σ²_{t−1}
+ *
+ * Returns come date-major (returns[t * stride + i] for series i), which is
+ * how a dates × symbols frame is laid out. Series are packed kGarchLanes at
+ * a time into [t][lane] blocks, so each step of the variance recursion is
+ * a short loop across lanes that the compiler vectorizes. The likelihood
+ * and its analytic gradient come out of the same forward pass by carrying
+ * ∂σ²_t/∂θ along with σ²_t; nothing of length T is kept besides the
+ * packed returns.
+ *
+ * Every lane runs its own BFGS, in lockstep with the other lanes of its
+ * block: one pass over the block evaluates all lanes at their own trial
+ * points. The parameters are mapped to an unconstrained vector (ω > 0,
+ * α, γ, β ≥ 0 and persistence below 1 for GARCH/GJR; |β| < 1 for EGARCH),
+ * so the search needs no projection. Blocks are independent and are spread
+ * over the shared thread pool.
+ *
+ * Each series is standardized before fitting and the parameters are mapped
+ * back, so ω is of order one and one set of tolerances suits every series.
+ * Missing values (NaN) are skipped: the recursion uses E[ε²] = σ² in their
+ * place and they do not enter the likelihood, so series with different
+ * listing dates can share a block.
+ *
+ * A nightly refit can start from yesterday's fits. It reuses their
+ * parameters and their BFGS curvature, so most series converge in two or
+ * three iterations instead of twenty. garch_forecast() gives
+ * σ²_{T+1..T+H}; garch_filter() gives the one-step-ahead variance path
+ * aligned with the returns, which is what a backtest scales positions by
+ * (qf_native.garch_fit returns both to Python).
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "metrics.h"
+#include "thread_pool.h"
+#include "trace.h"
+
+namespace qf {
+
+enum class GarchModel {
+    Garch,
+    Gjr,
+    Egarch
+};
+
+// Series per block; 8 doubles fill one AVX-512 register or two AVX2 ones.
+constexpr std::size_t kGarchLanes = 8;
+
+// Parameters in the units of the input returns.
+struct GarchParams {
+    double mu = 0.0;     // mean removed before the variance recursion
+    double omega = 0.0;
+    double alpha = 0.0;
+    double gamma = 0.0;  // asymmetry (GJR, EGARCH); 0 for GARCH
+    double beta = 0.0;
+};
+
+enum class GarchStatus : std::uint8_t {
+    Converged,
+    MaxIterations,
+    LineSearchFailed,  // no further decrease found, usually at the optimum to rounding
+    InsufficientData
+};
+
+struct GarchConfig {
+    GarchModel model = GarchModel::Garch;
+    bool demean = true;                  // μ = sample mean, else μ = 0
+    std::size_t min_observations = 100;  // fewer finite returns → InsufficientData
+    std::size_t max_iterations = 200;
+    double ftol = 1e-10;  // stop when the mean −2 log L / n changes by less (relative)
+    double gtol = 1e-6;   // or when max |gradient| falls below this
+};
+
+struct GarchFit {
+    GarchParams params;
+    double log_likelihood = std::numeric_limits<double>::quiet_NaN();
+    double next_variance = std::numeric_limits<double>::quiet_NaN();  // σ²_{T+1}
+    std::size_t observations = 0;
+    std::uint32_t iterations = 0;
+    GarchStatus status = GarchStatus::InsufficientData;
+
+    // Final BFGS inverse-Hessian estimate in the internal parametrization.
+    // A warm start from this fit reuses it instead of relearning the curvature.
+    double inverse_hessian[4][4] = {};
+};
+
+/**
+ * @brief Long-run variance. For EGARCH this is exp(E[ln σ²]), which
+ * understates E[σ²] by the Jensen term.
+ */
+inline double garch_unconditional_variance(GarchModel model, const GarchParams& p) {
+    switch (model) {
+    case GarchModel::Garch:
+        return p.omega / (1.0 - p.alpha - p.beta);
+    case GarchModel::Gjr:
+        return p.omega / (1.0 - p.alpha - 0.5 * p.gamma - p.beta);
+    case GarchModel::Egarch:
+        return std::exp(p.omega / (1.0 - p.beta));
+    }
+    return std::numeric_limits<double>::quiet_NaN();
+}
+
+namespace detail {
+
+constexpr double kGarchMaxPersistence = 0.9999;
+constexpr double kAbsMeanNormal = 0.79788456080286536;  // E|z| = √(2/π)
+
+inline std::size_t garch_dim(GarchModel m) {
+    return m == GarchModel::Garch ? 3 : 4;
+}
+
+// =======================
+// Packed blocks
+// =======================
+
+/**
+ * Up to kGarchLanes series, standardized and laid out [t][lane]. Missing
+ * values and unused lanes have x = 0 and m = 0.
+ */
+struct GarchBlock {
+    static constexpr std::size_t L = kGarchLanes;
+
+    std::size_t T = 0;
+    std::size_t lanes = 0;
+    std::vector<double> x;  // (r − μ) / s
+    std::vector<double> m;  // 1 observed, 0 missing
+    double mu[L] = {};
+    double var[L] = {};     // s², also the starting σ² (backcast)
+    double count[L] = {};
+
+    /**
+     * Packs series first .. first + lanes − 1. μ is taken from `mu` when
+     * given, else the sample mean (demean) or 0.
+     */
+    void pack(const double* returns, std::size_t T_, std::size_t stride, std::size_t first,
+              std::size_t lanes_, bool demean, const double* mu_in = nullptr) {
+        T = T_;
+        lanes = lanes_;
+        x.assign(T * L, 0.0);
+        m.assign(T * L, 0.0);
+        for (std::size_t l = 0; l < L; ++l) {
+            mu[l] = 0.0;
+            var[l] = 0.0;
+            count[l] = 0.0;
+        }
+        for (std::size_t t = 0; t < T; ++t) {
+            const double* row = returns + t * stride + first;
+            for (std::size_t l = 0; l < lanes; ++l) {
+                if (std::isfinite(row[l])) {
+                    mu[l] += row[l];
+                    count[l] += 1.0;
+                }
+            }
+        }
+        for (std::size_t l = 0; l < lanes; ++l) {
+            if (mu_in)
+                mu[l] = mu_in[l];
+            else
+                mu[l] = demean && count[l] > 0.0 ? mu[l] / count[l] : 0.0;
+        }
+        for (std::size_t t = 0; t < T; ++t) {
+            const double* row = returns + t * stride + first;
+            for (std::size_t l = 0; l < lanes; ++l) {
+                if (std::isfinite(row[l])) {
+                    const double e = row[l] - mu[l];
+                    var[l] += e * e;
+                }
+            }
+        }
+        for (std::size_t l = 0; l < lanes; ++l) {
+            var[l] = count[l] > 0.0 ? var[l] / count[l] : 0.0;
+            const double inv = var[l] > 0.0 ? 1.0 / std::sqrt(var[l]) : 0.0;
+            for (std::size_t t = 0; t < T; ++t) {
+                const double r = returns[t * stride + first + l];
+                if (std::isfinite(r) && inv > 0.0) {
+                    x[t * L + l] = (r - mu[l]) * inv;
+                    m[t * L + l] = 1.0;
+                }
+            }
+        }
+    }
+};
+
+// Natural parameters in standardized units, one per lane.
+struct GarchLaneParams {
+    double omega[kGarchLanes], alpha[kGarchLanes], gamma[kGarchLanes], beta[kGarchLanes];
+};
+
+struct GarchLaneEval {
+    double nll[kGarchLanes];      // mean of ln σ² + ε²/σ² over the observations
+    double grad[4][kGarchLanes];  // ∂nll/∂(ω, α, γ, β)
+    double next[kGarchLanes];     // σ²_{T+1} (standardized)
+};
+
+// =======================
+// Likelihood passes
+// =======================
+
+/**
+ * GARCH (Asym = false) or GJR forward pass over a block: likelihood,
+ * gradient and final variance for every lane, and the variance path if
+ * `path` is given. ln σ² is summed as the log of a running product,
+ * flushed every 16 steps, so the pass takes one log per 16 observations.
+ */
+template <bool Asym, bool Path>
+void garch_pass(const GarchBlock& b, const GarchLaneParams& p, GarchLaneEval& out,
+                double* path = nullptr) {
+    constexpr std::size_t L = kGarchLanes;
+    double h[L], d0[L], d1[L], d2[L], d3[L];
+    double q[L], g0[L], g1[L], g2[L], g3[L], prod[L], logs[L];
+    for (std::size_t l = 0; l < L; ++l) {
+        h[l] = 1.0;
+        d0[l] = d1[l] = d2[l] = d3[l] = 0.0;
+        q[l] = g0[l] = g1[l] = g2[l] = g3[l] = logs[l] = 0.0;
+        prod[l] = 1.0;
+    }
+
+    for (std::size_t t = 0; t < b.T; ++t) {
+        const double* x = &b.x[t * L];
+        const double* m = &b.m[t * L];
+        if constexpr (Path) {
+            for (std::size_t l = 0; l < L; ++l)
+                path[t * L + l] = h[l];
+        }
+        for (std::size_t l = 0; l < L; ++l) {
+            const double e2 = x[l] * x[l];
+            const double ih = 1.0 / h[l];
+            const double miss = 1.0 - m[l];
+
+            // Term m (ln σ² + ε²/σ²) and its derivative along ∂σ²/∂θ.
+            prod[l] *= m[l] * h[l] + miss;
+            q[l] += m[l] * e2 * ih;
+            const double s = m[l] * ih * (1.0 - e2 * ih);
+            g0[l] += s * d0[l];
+            g1[l] += s * d1[l];
+            if constexpr (Asym)
+                g2[l] += s * d2[l];
+            g3[l] += s * d3[l];
+
+            // Step to t + 1. A missing ε² is replaced by σ² (and 1[ε < 0] by ½),
+            // which makes σ²_{t+1} depend on σ²_t through the ARCH term too.
+            const double a = m[l] * e2 + miss * h[l];
+            double arch = p.alpha[l];
+            double neg = 0.0;
+            if constexpr (Asym) {
+                // 1[ε < 0] as a sign-bit operation so the loop stays branch
+                // free; at ε = 0 it multiplies ε² = 0 anyway.
+                neg = 0.5 * (1.0 - m[l] * std::copysign(1.0, x[l]));
+                arch += p.gamma[l] * neg;
+            }
+            const double carry = p.beta[l] + miss * arch;
+            d0[l] = 1.0 + carry * d0[l];
+            d1[l] = a + carry * d1[l];
+            if constexpr (Asym)
+                d2[l] = neg * a + carry * d2[l];
+            d3[l] = h[l] + carry * d3[l];
+            h[l] = p.omega[l] + arch * a + p.beta[l] * h[l];
+        }
+        if ((t & 15) == 15) {
+            for (std::size_t l = 0; l < L; ++l) {
+                logs[l] += std::log(prod[l]);
+                prod[l] = 1.0;
+            }
+        }
+    }
+
+    for (std::size_t l = 0; l < L; ++l) {
+        const double inv = b.count[l] > 0.0 ? 1.0 / b.count[l] : 0.0;
+        out.nll[l] = (logs[l] + std::log(prod[l]) + q[l]) * inv;
+        out.grad[0][l] = g0[l] * inv;
+        out.grad[1][l] = g1[l] * inv;
+        out.grad[2][l] = Asym ? g2[l] * inv : 0.0;
+        out.grad[3][l] = g3[l] * inv;
+        out.next[l] = h[l];
+    }
+}
+
+/**
+ * EGARCH forward pass. The recursion runs on g = ln σ², and z depends on
+ * the parameters through σ, so ∂g_{t+1}/∂g_t = β − ½ m (α|z| + γ z).
+ */
+template <bool Path>
+void egarch_pass(const GarchBlock& b, const GarchLaneParams& p, GarchLaneEval& out,
+                 double* path = nullptr) {
+    constexpr std::size_t L = kGarchLanes;
+    double g[L], d0[L], d1[L], d2[L], d3[L];
+    double q[L], g0[L], g1[L], g2[L], g3[L];
+    for (std::size_t l = 0; l < L; ++l) {
+        g[l] = 0.0;
+        d0[l] = d1[l] = d2[l] = d3[l] = 0.0;
+        q[l] = g0[l] = g1[l] = g2[l] = g3[l] = 0.0;
+    }
+
+    for (std::size_t t = 0; t < b.T; ++t) {
+        const double* x = &b.x[t * L];
+        const double* m = &b.m[t * L];
+        for (std::size_t l = 0; l < L; ++l) {
+            const double inv_sd = std::exp(-0.5 * g[l]);
+            if constexpr (Path)
+                path[t * L + l] = 1.0 / (inv_sd * inv_sd);
+            const double z = x[l] * inv_sd;
+            const double z2 = z * z;
+
+            q[l] += m[l] * (g[l] + z2);
+            const double s = m[l] * (1.0 - z2);
+            g0[l] += s * d0[l];
+            g1[l] += s * d1[l];
+            g2[l] += s * d2[l];
+            g3[l] += s * d3[l];
+
+            const double az = std::abs(z) - kAbsMeanNormal;
+            const double carry = p.beta[l] - 0.5 * m[l] * (p.alpha[l] * std::abs(z) + p.gamma[l] * z);
+            d0[l] = 1.0 + carry * d0[l];
+            d1[l] = m[l] * az + carry * d1[l];
+            d2[l] = m[l] * z + carry * d2[l];
+            d3[l] = g[l] + carry * d3[l];
+            g[l] = p.omega[l] + m[l] * (p.alpha[l] * az + p.gamma[l] * z) + p.beta[l] * g[l];
+        }
+    }
+
+    for (std::size_t l = 0; l < L; ++l) {
+        const double inv = b.count[l] > 0.0 ? 1.0 / b.count[l] : 0.0;
+        out.nll[l] = q[l] * inv;
+        out.grad[0][l] = g0[l] * inv;
+        out.grad[1][l] = g1[l] * inv;
+        out.grad[2][l] = g2[l] * inv;
+        out.grad[3][l] = g3[l] * inv;
+        out.next[l] = std::exp(g[l]);
+    }
+}
+
+template <bool Path>
+void garch_model_pass(GarchModel model, const GarchBlock& b, const GarchLaneParams& p,
+                      GarchLaneEval& out, double* path = nullptr) {
+    switch (model) {
+    case GarchModel::Garch:
+        garch_pass<false, Path>(b, p, out, path);
+        break;
+    case GarchModel::Gjr:
+        garch_pass<true, Path>(b, p, out, path);
+        break;
+    case GarchModel::Egarch:
+        egarch_pass<Path>(b, p, out, path);
+        break;
+    }
+}
+
+// =======================
+// Parameter transforms
+// =======================
+
+inline double logistic(double u) {
+    return 1.0 / (1.0 + std::exp(-u));
+}
+
+/**
+ * θ = (ω, α, γ, β) in standardized units from the unconstrained vector u,
+ * with J[i][j] = ∂θ_i/∂u_j.
+ *
+ *   GARCH   ω = e^{u0}, p = P·σ(u1), (α, β) = p·(s, 1 − s), s = σ(u2)
+ *   GJR     ω = e^{u0}, p = P·σ(u1), (α, γ/2, β) = p·softmax(u2, u3, 0)
+ *   EGARCH  (ω, α, γ) = (u0, u1, u2), β = P·tanh(u3)
+ *
+ * where p is the persistence and P = kGarchMaxPersistence.
+ */
+inline void garch_from_u(GarchModel model, const double* u, double* th, double J[4][4]) {
+    constexpr double P = kGarchMaxPersistence;
+    for (int i = 0; i < 4; ++i)
+        for (int j = 0; j < 4; ++j)
+            J[i][j] = 0.0;
+
+    if (model == GarchModel::Egarch) {
+        const double tb = std::tanh(u[3]);
+        th[0] = u[0];
+        th[1] = u[1];
+        th[2] = u[2];
+        th[3] = P * tb;
+        J[0][0] = J[1][1] = J[2][2] = 1.0;
+        J[3][3] = P * (1.0 - tb * tb);
+        return;
+    }
+
+    th[0] = std::exp(u[0]);
+    J[0][0] = th[0];
+    const double sp = logistic(u[1]);
+    const double p = P * sp;
+    const double dp = P * sp * (1.0 - sp);
+
+    if (model == GarchModel::Garch) {
+        const double s = logistic(u[2]);
+        const double ds = s * (1.0 - s);
+        th[1] = p * s;
+        th[2] = 0.0;
+        th[3] = p * (1.0 - s);
+        J[1][1] = s * dp;
+        J[1][2] = p * ds;
+        J[3][1] = (1.0 - s) * dp;
+        J[3][2] = -p * ds;
+        return;
+    }
+
+    const double top = std::max({u[2], u[3], 0.0});
+    const double ea = std::exp(u[2] - top), eg = std::exp(u[3] - top), eb = std::exp(-top);
+    const double sum = ea + eg + eb;
+    const double sa = ea / sum, sg = eg / sum, sb = eb / sum;
+    th[1] = p * sa;
+    th[2] = 2.0 * p * sg;
+    th[3] = p * sb;
+    J[1][1] = sa * dp;
+    J[2][1] = 2.0 * sg * dp;
+    J[3][1] = sb * dp;
+    J[1][2] = p * sa * (1.0 - sa);
+    J[1][3] = -p * sa * sg;
+    J[2][2] = -2.0 * p * sg * sa;
+    J[2][3] = 2.0 * p * sg * (1.0 - sg);
+    J[3][2] = -p * sb * sa;
+    J[3][3] = -p * sb * sg;
+}
+
+// Inverse of garch_from_u, clamping θ into the interior first.
+inline void garch_to_u(GarchModel model, const double* th, double* u) {
+    constexpr double P = kGarchMaxPersistence;
+    auto logit = [](double s) { return std::log(s / (1.0 - s)); };
+
+    if (model == GarchModel::Egarch) {
+        u[0] = th[0];
+        u[1] = th[1];
+        u[2] = th[2];
+        u[3] = std::atanh(std::clamp(th[3] / P, -0.999, 0.999));
+        return;
+    }
+
+    u[0] = std::log(std::max(th[0], 1e-8));
+    const double a = std::max(th[1], 0.0);
+    const double g = model == GarchModel::Gjr ? std::max(0.5 * th[2], 0.0) : 0.0;
+    const double b = std::max(th[3], 0.0);
+    const double p = std::clamp(a + g + b, 1e-3, 0.999 * P);
+    u[1] = logit(p / P);
+
+    if (model == GarchModel::Garch) {
+        u[2] = logit(std::clamp(a / std::max(a + b, 1e-12), 1e-3, 1.0 - 1e-3));
+        u[3] = 0.0;
+        return;
+    }
+    const double total = std::max(a + g + b, 1e-12);
+    const double sa = std::max(a / total, 1e-3), sg = std::max(g / total, 1e-3),
+                 sb = std::max(b / total, 1e-3);
+    u[2] = std::log(sa / sb);
+    u[3] = std::log(sg / sb);
+}
+
+// Starting point in standardized units (unit long-run variance).
+inline void garch_default_start(GarchModel model, double* th) {
+    switch (model) {
+    case GarchModel::Garch:
+        th[0] = 0.05, th[1] = 0.05, th[2] = 0.0, th[3] = 0.90;
+        break;
+    case GarchModel::Gjr:
+        th[0] = 0.05, th[1] = 0.02, th[2] = 0.06, th[3] = 0.90;
+        break;
+    case GarchModel::Egarch:
+        th[0] = 0.0, th[1] = 0.10, th[2] = -0.05, th[3] = 0.95;
+        break;
+    }
+}
+
+// Input-unit parameters ↔ standardized θ for a series with variance s².
+inline void garch_standardize(GarchModel model, const GarchParams& p, double var, double* th) {
+    th[1] = p.alpha;
+    th[2] = p.gamma;
+    th[3] = p.beta;
+    th[0] = model == GarchModel::Egarch ? p.omega - std::log(var) * (1.0 - p.beta)
+                                        : p.omega / var;
+}
+
+inline GarchParams garch_unstandardize(GarchModel model, const double* th, double mu, double var) {
+    GarchParams p;
+    p.mu = mu;
+    p.alpha = th[1];
+    p.gamma = model == GarchModel::Garch ? 0.0 : th[2];
+    p.beta = th[3];
+    p.omega = model == GarchModel::Egarch ? th[0] + std::log(var) * (1.0 - th[3]) : th[0] * var;
+    return p;
+}
+
+inline bool garch_params_usable(GarchModel model, const GarchParams& p) {
+    if (!std::isfinite(p.omega) || !std::isfinite(p.alpha) || !std::isfinite(p.gamma) ||
+        !std::isfinite(p.beta))
+        return false;
+    return model == GarchModel::Egarch ? std::abs(p.beta) < 1.0 : p.omega > 0.0;
+}
+
+// =======================
+// Lockstep BFGS over a block
+// =======================
+
+/**
+ * Negative log-likelihood (mean, standardized) and its gradient in u for
+ * every lane, each at its own u. Non-finite values come back as +inf so
+ * the line search rejects the step.
+ */
+inline void garch_eval_u(GarchModel model, const GarchBlock& b, const double (*u)[4],
+                         double* f, double (*gu)[4], double* next) {
+    constexpr std::size_t L = kGarchLanes;
+    GarchLaneParams p;
+    double J[L][4][4];
+    for (std::size_t l = 0; l < L; ++l) {
+        double th[4];
+        garch_from_u(model, u[l], th, J[l]);
+        p.omega[l] = th[0];
+        p.alpha[l] = th[1];
+        p.gamma[l] = th[2];
+        p.beta[l] = th[3];
+    }
+    GarchLaneEval ev;
+    garch_model_pass<false>(model, b, p, ev);
+    for (std::size_t l = 0; l < L; ++l) {
+        f[l] = std::isfinite(ev.nll[l]) ? ev.nll[l] : std::numeric_limits<double>::infinity();
+        for (int j = 0; j < 4; ++j) {
+            double s = 0.0;
+            for (int i = 0; i < 4; ++i)
+                s += J[l][i][j] * ev.grad[i][l];
+            gu[l][j] = s;
+        }
+        if (next)
+            next[l] = ev.next[l];
+    }
+}
+
+/**
+ * Fits one block. `warm` (parameters) or `warm_fit` (parameters and
+ * curvature) may give a start per lane; both may be null.
+ */
+inline void fit_garch_block(const GarchConfig& cfg, const GarchBlock& b, const GarchParams* warm,
+                            const GarchFit* warm_fit, GarchFit* out) {
+    constexpr std::size_t L = kGarchLanes;
+    const std::size_t k = garch_dim(cfg.model);
+    const double inf = std::numeric_limits<double>::infinity();
+
+    double u[L][4], g[L][4], H[L][4][4], f[L];
+    double ut[L][4], gt[L][4], ft[L], d[L][4], step[L], slope[L];
+    bool active[L], pending[L], scaled[L];
+    std::uint32_t iters[L];
+    GarchStatus status[L];
+
+    for (std::size_t l = 0; l < L; ++l) {
+        double th[4] = {};
+        const bool enough = l < b.lanes && b.var[l] > 0.0 &&
+                            b.count[l] >= static_cast<double>(cfg.min_observations);
+        const GarchParams* start = warm_fit ? &warm_fit[l].params : warm ? &warm[l] : nullptr;
+        const bool from_warm = enough && start && garch_params_usable(cfg.model, *start);
+        if (from_warm)
+            garch_standardize(cfg.model, *start, b.var[l], th);
+        else
+            garch_default_start(cfg.model, th);
+        garch_to_u(cfg.model, th, u[l]);
+        for (std::size_t i = 0; i < 4; ++i)
+            for (std::size_t j = 0; j < 4; ++j)
+                H[l][i][j] = i == j ? 1.0 : 0.0;
+        scaled[l] = false;
+        if (from_warm && warm_fit && warm_fit[l].inverse_hessian[0][0] > 0.0) {
+            bool finite = true;
+            for (std::size_t i = 0; i < 4; ++i)
+                for (std::size_t j = 0; j < 4; ++j)
+                    finite = finite && std::isfinite(warm_fit[l].inverse_hessian[i][j]);
+            if (finite) {
+                for (std::size_t i = 0; i < 4; ++i)
+                    for (std::size_t j = 0; j < 4; ++j)
+                        H[l][i][j] = warm_fit[l].inverse_hessian[i][j];
+                scaled[l] = true;
+            }
+        }
+        active[l] = enough;
+        iters[l] = 0;
+        status[l] = enough ? GarchStatus::MaxIterations : GarchStatus::InsufficientData;
+    }
+
+    garch_eval_u(cfg.model, b, u, f, g, nullptr);
+
+    for (std::size_t it = 0; it < cfg.max_iterations; ++it) {
+        bool any = false;
+        for (std::size_t l = 0; l < L; ++l) {
+            if (active[l] && !std::isfinite(f[l])) {
+                active[l] = false;
+                status[l] = GarchStatus::LineSearchFailed;
+            }
+            if (!active[l]) {
+                pending[l] = false;
+                for (std::size_t j = 0; j < 4; ++j)
+                    ut[l][j] = u[l][j];
+                continue;
+            }
+            any = true;
+
+            // d = −H g, falling back to steepest descent if H has drifted.
+            double gd = 0.0, dmax = 0.0;
+            for (std::size_t i = 0; i < k; ++i) {
+                double s = 0.0;
+                for (std::size_t j = 0; j < k; ++j)
+                    s -= H[l][i][j] * g[l][j];
+                d[l][i] = s;
+                gd += g[l][i] * s;
+            }
+            if (!(gd < 0.0)) {
+                gd = 0.0;
+                for (std::size_t i = 0; i < k; ++i) {
+                    for (std::size_t j = 0; j < k; ++j)
+                        H[l][i][j] = i == j ? 1.0 : 0.0;
+                    d[l][i] = -g[l][i];
+                    gd -= g[l][i] * g[l][i];
+                }
+            }
+            for (std::size_t i = 0; i < k; ++i)
+                dmax = std::max(dmax, std::abs(d[l][i]));
+            step[l] = dmax > 2.0 ? 2.0 / dmax : 1.0;  // no more than 2 in any coordinate
+            slope[l] = gd;
+            pending[l] = true;
+            for (std::size_t j = 0; j < 4; ++j)
+                ut[l][j] = u[l][j] + (j < k ? step[l] * d[l][j] : 0.0);
+        }
+        if (!any)
+            break;
+
+        // Backtracking (Armijo), all lanes evaluated together. Lanes that
+        // have accepted keep their trial point, so re-evaluating them is
+        // redundant but harmless.
+        for (int bt = 0; bt < 40; ++bt) {
+            garch_eval_u(cfg.model, b, ut, ft, gt, nullptr);
+            bool waiting = false;
+            for (std::size_t l = 0; l < L; ++l) {
+                if (!pending[l])
+                    continue;
+                if (ft[l] <= f[l] + 1e-4 * step[l] * slope[l]) {
+                    pending[l] = false;
+                    continue;
+                }
+                step[l] *= 0.5;
+                for (std::size_t j = 0; j < k; ++j)
+                    ut[l][j] = u[l][j] + step[l] * d[l][j];
+                waiting = true;
+            }
+            if (!waiting)
+                break;
+        }
+
+        for (std::size_t l = 0; l < L; ++l) {
+            if (!active[l])
+                continue;
+            if (pending[l]) {
+                active[l] = false;
+                status[l] = GarchStatus::LineSearchFailed;
+                continue;
+            }
+            ++iters[l];
+
+            // BFGS update of the inverse Hessian.
+            double s[4], y[4], sy = 0.0;
+            for (std::size_t i = 0; i < k; ++i) {
+                s[i] = ut[l][i] - u[l][i];
+                y[i] = gt[l][i] - g[l][i];
+                sy += s[i] * y[i];
+            }
+            if (sy > 1e-12) {
+                if (!scaled[l]) {
+                    // Shanno–Phua scaling of the initial identity.
+                    double yy = 0.0;
+                    for (std::size_t i = 0; i < k; ++i)
+                        yy += y[i] * y[i];
+                    for (std::size_t i = 0; i < k; ++i)
+                        H[l][i][i] = sy / yy;
+                    scaled[l] = true;
+                }
+                double Hy[4], yHy = 0.0;
+                for (std::size_t i = 0; i < k; ++i) {
+                    Hy[i] = 0.0;
+                    for (std::size_t j = 0; j < k; ++j)
+                        Hy[i] += H[l][i][j] * y[j];
+                    yHy += y[i] * Hy[i];
+                }
+                const double rho = 1.0 / sy;
+                for (std::size_t i = 0; i < k; ++i)
+                    for (std::size_t j = 0; j < k; ++j)
+                        H[l][i][j] += rho * ((1.0 + rho * yHy) * s[i] * s[j] -
+                                             Hy[i] * s[j] - s[i] * Hy[j]);
+            }
+
+            const double f_old = f[l];
+            double gmax = 0.0;
+            for (std::size_t j = 0; j < 4; ++j) {
+                u[l][j] = ut[l][j];
+                g[l][j] = gt[l][j];
+            }
+            for (std::size_t j = 0; j < k; ++j)
+                gmax = std::max(gmax, std::abs(g[l][j]));
+            f[l] = ft[l];
+            if (f_old - f[l] <= cfg.ftol * (1.0 + std::abs(f[l])) || gmax < cfg.gtol) {
+                active[l] = false;
+                status[l] = GarchStatus::Converged;
+            }
+        }
+    }
+
+    // Final pass for σ²_{T+1} at the accepted parameters.
+    double next[L];
+    garch_eval_u(cfg.model, b, u, f, g, next);
+    for (std::size_t l = 0; l < b.lanes; ++l) {
+        GarchFit& r = out[l];
+        r = GarchFit{};
+        r.observations = static_cast<std::size_t>(b.count[l]);
+        r.status = status[l];
+        if (status[l] == GarchStatus::InsufficientData) {
+            r.params.mu = b.mu[l];
+            r.params.omega = r.params.alpha = r.params.gamma = r.params.beta =
+                std::numeric_limits<double>::quiet_NaN();
+            continue;
+        }
+        double th[4], J[4][4];
+        garch_from_u(cfg.model, u[l], th, J);
+        r.params = garch_unstandardize(cfg.model, th, b.mu[l], b.var[l]);
+        r.iterations = iters[l];
+        for (std::size_t i = 0; i < 4; ++i)
+            for (std::size_t j = 0; j < 4; ++j)
+                r.inverse_hessian[i][j] = H[l][i][j];
+        r.next_variance = next[l] * b.var[l];
+        // −2 ln L = n (ln 2π + ln s²) + n · mean(ln σ² + ε²/σ²) in standardized units.
+        const double n = b.count[l];
+        r.log_likelihood = f[l] < inf ? -0.5 * n * (std::log(2.0 * M_PI) + std::log(b.var[l]) + f[l])
+                                      : -inf;
+    }
+}
+
+} // namespace detail
+
+// =======================
+// Estimation
+// =======================
+
+namespace detail {
+
+inline std::vector<GarchFit> fit_garch_impl(const double* returns, std::size_t T, std::size_t N,
+                                            std::size_t stride, const GarchConfig& cfg,
+                                            const GarchParams* warm, const GarchFit* warm_fit) {
+    QF_TRACE_SCOPE_CAT("fit_garch", "garch");
+    if (stride < N)
+        throw std::runtime_error("fit_garch: stride must be at least the number of series");
+    if (cfg.min_observations < 2)
+        throw std::runtime_error("fit_garch: min_observations must be at least 2");
+
+    std::vector<GarchFit> fits(N);
+    const std::size_t blocks = (N + kGarchLanes - 1) / kGarchLanes;
+    parallel_for(default_thread_pool(), 0, blocks, 1, [&](std::size_t blk) {
+        const std::size_t first = blk * kGarchLanes;
+        GarchBlock b;
+        b.pack(returns, T, stride, first, std::min(kGarchLanes, N - first), cfg.demean);
+        fit_garch_block(cfg, b, warm ? warm + first : nullptr,
+                        warm_fit ? warm_fit + first : nullptr, fits.data() + first);
+    });
+
+    QF_METRIC_ADD("qf_garch_fits_total", "Series fitted by fit_garch", N);
+    QF_METRIC_ADD("qf_garch_unconverged_total", "GARCH fits that did not converge",
+                  std::count_if(fits.begin(), fits.end(), [](const GarchFit& f) {
+                      return f.status != GarchStatus::Converged;
+                  }));
+    return fits;
+}
+
+} // namespace detail
+
+/**
+ * @brief Fits cfg.model to N series of T returns each, stored date-major
+ * (returns[t * stride + i]; NaN = missing).
+ *
+ * `warm`, if given, holds N parameter sets to start from. Entries that are
+ * unusable (NaN, ω ≤ 0, |β| ≥ 1 for EGARCH) fall back to the default
+ * start. Results come back in series order.
+ */
+inline std::vector<GarchFit> fit_garch(const double* returns, std::size_t T, std::size_t N,
+                                       std::size_t stride, const GarchConfig& cfg = {},
+                                       const GarchParams* warm = nullptr) {
+    return detail::fit_garch_impl(returns, T, N, stride, cfg, warm, nullptr);
+}
+
+/**
+ * @brief Nightly refit from yesterday's fits, one per series. Starts from
+ * their parameters and inverse-Hessian estimates.
+ */
+inline std::vector<GarchFit> fit_garch(const double* returns, std::size_t T, std::size_t N,
+                                       std::size_t stride, const GarchConfig& cfg,
+                                       const std::vector<GarchFit>& yesterday) {
+    if (yesterday.size() != N)
+        throw std::runtime_error("fit_garch: need one warm start per series");
+    return detail::fit_garch_impl(returns, T, N, stride, cfg, nullptr, yesterday.data());
+}
+
+// =======================
+// Forecasts
+// =======================
+
+/**
+ * @brief σ²_{T+1} .. σ²_{T+H} into out[0 .. H). GARCH/GJR forecasts mean
+ * revert at rate α + γ/2 + β; EGARCH forecasts iterate E[ln σ²] and
+ * exponentiate (omitting the Jensen correction).
+ */
+inline void garch_forecast(GarchModel model, const GarchFit& fit, std::size_t horizon,
+                           double* out) {
+    const GarchParams& p = fit.params;
+    if (fit.status == GarchStatus::InsufficientData || !std::isfinite(fit.next_variance)) {
+        std::fill(out, out + horizon, std::numeric_limits<double>::quiet_NaN());
+        return;
+    }
+    if (model == GarchModel::Egarch) {
+        double g = std::log(fit.next_variance);
+        for (std::size_t h = 0; h < horizon; ++h) {
+            out[h] = std::exp(g);
+            g = p.omega + p.beta * g;
+        }
+        return;
+    }
+    const double persistence = p.alpha + p.beta + (model == GarchModel::Gjr ? 0.5 * p.gamma : 0.0);
+    const double lr = p.omega / (1.0 - persistence);
+    double decay = 1.0;
+    for (std::size_t h = 0; h < horizon; ++h) {
+        out[h] = lr + decay * (fit.next_variance - lr);
+        decay *= persistence;
+    }
+}
+
+// Forecasts for N fits, row-major N × horizon.
+inline void garch_forecast(GarchModel model, const GarchFit* fits, std::size_t N,
+                           std::size_t horizon, double* out) {
+    for (std::size_t i = 0; i < N; ++i)
+        garch_forecast(model, fits[i], horizon, out + i * horizon);
+}
+
+/**
+ * @brief One-step-ahead conditional variances σ²_t (using returns up to
+ * t − 1) for every date and series, written date-major like the input
+ * (variance[t * out_stride + i]). The recursion starts from the variance
+ * of the series about params[i].mu, as in fit_garch, so a path built with
+ * the fitted parameters is the one the fit maximized. That start value
+ * uses the whole sample, which matters only for the first few dates.
+ */
+inline void garch_filter(GarchModel model, const GarchParams* params, const double* returns,
+                         std::size_t T, std::size_t N, std::size_t stride, double* variance,
+                         std::size_t out_stride) {
+    QF_TRACE_SCOPE_CAT("garch_filter", "garch");
+    if (stride < N || out_stride < N)
+        throw std::runtime_error("garch_filter: strides must be at least the number of series");
+
+    const std::size_t blocks = (N + kGarchLanes - 1) / kGarchLanes;
+    parallel_for(default_thread_pool(), 0, blocks, 1, [&](std::size_t blk) {
+        constexpr std::size_t L = kGarchLanes;
+        const std::size_t first = blk * L;
+        const std::size_t lanes = std::min(L, N - first);
+        double mu[L] = {};
+        for (std::size_t l = 0; l < lanes; ++l)
+            mu[l] = params[first + l].mu;
+
+        detail::GarchBlock b;
+        b.pack(returns, T, stride, first, lanes, false, mu);
+        detail::GarchLaneParams p;
+        for (std::size_t l = 0; l < L; ++l) {
+            double th[4] = {};
+            if (l < lanes && b.var[l] > 0.0)
+                detail::garch_standardize(model, params[first + l], b.var[l], th);
+            else
+                detail::garch_default_start(model, th);
+            p.omega[l] = th[0];
+            p.alpha[l] = th[1];
+            p.gamma[l] = model == GarchModel::Garch ? 0.0 : th[2];
+            p.beta[l] = th[3];
+        }
+        std::vector<double> path(T * L);
+        detail::GarchLaneEval ev;
+        detail::garch_model_pass<true>(model, b, p, ev, path.data());
+        for (std::size_t t = 0; t < T; ++t)
+            for (std::size_t l = 0; l < lanes; ++l)
+                variance[t * out_stride + first + l] =
+                    b.var[l] > 0.0 ? path[t * L + l] * b.var[l]
+                                   : std::numeric_limits<double>::quiet_NaN();
+    });
+}
+
+} // namespace qf
+
+#endif // QF_GARCH_H
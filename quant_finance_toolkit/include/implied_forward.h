@@ -0,0 +1,331 @@
+#ifndef QF_IMPLIED_FORWARD_H
+#define QF_IMPLIED_FORWARD_H
+
+/**
+ * @file implied_forward.h
+ * @author John Jacobson
+ * @brief Implied forward and discount factor per expiry from put–call parity.
+ *
+ * For European options on the same expiry, put–call parity gives
+ *
+ *     C(K) − P(K) = D · (F − K)
+ *
+ * so regressing the mid-price difference on strike over the matched pairs
+ * gives the discount factor D = −slope and the forward F = intercept / D.
+ * This replaces supplying spot and rate by hand: dividends, borrow and
+ * funding all end up in the implied F and D.
+ *
+ * A few stale or crossed quotes should not move the fit, so the regression
+ * is iteratively reweighted: Huber weights inside `reject` robust standard
+ * deviations (scaled by the MAD of the residuals) and zero weight beyond.
+ * Pairs can also be weighted by the inverse square of their combined
+ * bid/ask width, so tight at-the-money pairs dominate.
+ *
+ * The core kernel fits one expiry from flat strike / difference / weight
+ * arrays. implied_forward_batch() runs it over many expiries stored back
+ * to back (CSR offsets), and implied_forwards() builds those arrays from
+ * OptionQuote rows. apply_implied_forwards() and implied_vol_batch_forward()
+ * feed the result to the surface detector and the IV solver.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <map>
+#include <vector>
+
+#include "metrics.h"
+#include "options_greeks.h"
+#include "trace.h"
+#include "vol_surface_arbitrage.h"
+
+namespace qf {
+
+struct ForwardFitConfig {
+    double huber = 1.5;            // full weight inside this many robust sigmas
+    double reject = 4.0;           // zero weight beyond this many robust sigmas
+    int max_iter = 20;             // reweighting passes
+    std::size_t min_pairs = 3;     // fewer matched pairs than this fails the fit
+    bool spread_weights = true;    // weight pairs by 1 / (call spread + put spread)^2
+};
+
+struct ImpliedForward {
+    double maturity = 0.0;
+    double forward = std::numeric_limits<double>::quiet_NaN();
+    double discount = std::numeric_limits<double>::quiet_NaN();
+    double rate = std::numeric_limits<double>::quiet_NaN();  // −ln(D) / T
+    double residual_rms = 0.0;     // weighted RMS of the inlier residuals
+    std::size_t pairs = 0;         // matched put/call pairs
+    std::size_t outliers = 0;      // pairs given zero weight
+    bool ok = false;
+
+    // Spot equivalent for Black–Scholes inputs: S = D · F with rate `rate`.
+    double spot_equivalent() const { return discount * forward; }
+};
+
+namespace detail {
+
+// Weighted least squares y = a + b x over points with w > 0.
+inline bool weighted_line(std::size_t n, const double* x, const double* y, const double* w,
+                          double& a, double& b) {
+    double sw = 0.0, sx = 0.0, sy = 0.0;
+    for (std::size_t i = 0; i < n; ++i) {
+        sw += w[i];
+        sx += w[i] * x[i];
+        sy += w[i] * y[i];
+    }
+    if (!(sw > 0.0))
+        return false;
+    const double mx = sx / sw, my = sy / sw;
+
+    // Centered sums keep the slope accurate when strikes are large.
+    double sxx = 0.0, sxy = 0.0;
+    for (std::size_t i = 0; i < n; ++i) {
+        const double dx = x[i] - mx;
+        sxx += w[i] * dx * dx;
+        sxy += w[i] * dx * (y[i] - my);
+    }
+    if (!(sxx > 0.0))
+        return false;
+    b = sxy / sxx;
+    a = my - b * mx;
+    return true;
+}
+
+inline double median_in_place(std::vector<double>& v) {
+    const std::size_t mid = v.size() / 2;
+    std::nth_element(v.begin(), v.begin() + static_cast<std::ptrdiff_t>(mid), v.end());
+    double m = v[mid];
+    if (v.size() % 2 == 0)
+        m = 0.5 * (m + *std::max_element(v.begin(), v.begin() + static_cast<std::ptrdiff_t>(mid)));
+    return m;
+}
+
+} // namespace detail
+
+// =======================
+// Single expiry
+// =======================
+
+/**
+ * @brief Robust fit of C − P = D (F − K) for one expiry.
+ *
+ * `strike` and `c_minus_p` hold the n matched pairs; `weight` may be null
+ * for equal weights. Returns false (and out.ok = false) when there are too
+ * few pairs, the strikes do not vary, or the fit gives D ≤ 0 or F ≤ 0.
+ */
+inline bool fit_implied_forward(std::size_t n, const double* strike, const double* c_minus_p,
+                                const double* weight, double maturity, ImpliedForward& out,
+                                const ForwardFitConfig& cfg = {}) {
+    out = ImpliedForward{};
+    out.maturity = maturity;
+    out.pairs = n;
+    if (n < std::max<std::size_t>(cfg.min_pairs, 2))
+        return false;
+
+    std::vector<double> base(n, 1.0), w(n), resid(n), scratch(n);
+    if (weight)
+        base.assign(weight, weight + n);
+    w = base;
+
+    // Residual scale floor, so exact data does not turn rounding noise into
+    // outliers.
+    double y_max = 0.0;
+    for (std::size_t i = 0; i < n; ++i)
+        y_max = std::max(y_max, std::fabs(c_minus_p[i]));
+    const double floor = 1e-9 * (1.0 + y_max);
+
+    double a = 0.0, b = 0.0;
+    if (!detail::weighted_line(n, strike, c_minus_p, w.data(), a, b))
+        return false;
+
+    for (int it = 0; it < cfg.max_iter; ++it) {
+        for (std::size_t i = 0; i < n; ++i) {
+            resid[i] = (c_minus_p[i] - a - b * strike[i]) * std::sqrt(base[i]);
+            scratch[i] = std::fabs(resid[i]);
+        }
+        const double scale = std::max(1.4826 * detail::median_in_place(scratch), floor);
+
+        std::size_t rejected = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+            const double u = std::fabs(resid[i]) / scale;
+            double h = u <= cfg.huber ? 1.0 : cfg.huber / u;
+            if (u > cfg.reject) {
+                h = 0.0;
+                ++rejected;
+            }
+            w[i] = base[i] * h;
+        }
+
+        double a_new, b_new;
+        if (!detail::weighted_line(n, strike, c_minus_p, w.data(), a_new, b_new))
+            return false;
+        const bool done = std::fabs(a_new - a) <= 1e-12 * (1.0 + std::fabs(a)) &&
+                          std::fabs(b_new - b) <= 1e-12;
+        a = a_new;
+        b = b_new;
+        out.outliers = rejected;
+        if (done)
+            break;
+    }
+
+    double ssr = 0.0, sw = 0.0;
+    for (std::size_t i = 0; i < n; ++i) {
+        const double e = c_minus_p[i] - a - b * strike[i];
+        ssr += w[i] * e * e;
+        sw += w[i];
+    }
+    out.residual_rms = sw > 0.0 ? std::sqrt(ssr / sw) : 0.0;
+
+    const double D = -b;
+    if (!(D > 0.0) || !(a / D > 0.0))
+        return false;
+    out.discount = D;
+    out.forward = a / D;
+    out.rate = maturity > 0.0 ? -std::log(D) / maturity : 0.0;
+    out.ok = n - out.outliers >= std::max<std::size_t>(cfg.min_pairs, 2);
+    return out.ok;
+}
+
+// =======================
+// Many expiries
+// =======================
+
+/**
+ * @brief Fits every expiry of a chain stored back to back: expiry e owns
+ * pairs [offsets[e], offsets[e + 1]) of `strike`, `c_minus_p` and
+ * `weight` (null for equal weights). `out` receives n_expiries results.
+ * Returns how many fits succeeded.
+ */
+inline std::size_t implied_forward_batch(std::size_t n_expiries, const std::size_t* offsets,
+                                         const double* maturity, const double* strike,
+                                         const double* c_minus_p, const double* weight,
+                                         ImpliedForward* out, const ForwardFitConfig& cfg = {}) {
+    QF_TRACE_SCOPE_CAT("implied_forward_batch", "implied_forward");
+    std::size_t ok = 0;
+    for (std::size_t e = 0; e < n_expiries; ++e) {
+        const std::size_t lo = offsets[e], hi = offsets[e + 1];
+        if (fit_implied_forward(hi - lo, strike + lo, c_minus_p + lo,
+                                weight ? weight + lo : nullptr, maturity[e], out[e], cfg))
+            ++ok;
+    }
+    QF_METRIC_ADD("qf_forward_fits_total", "Implied forward fits attempted", n_expiries);
+    QF_METRIC_ADD("qf_forward_fit_failures_total", "Implied forward fits that failed",
+                  n_expiries - ok);
+    return ok;
+}
+
+/**
+ * @brief Implied forward for every maturity in `quotes`, in increasing
+ * maturity order.
+ *
+ * Calls and puts of one maturity are matched on strike (within a relative
+ * 1e-9) and use mid prices. Quotes with a non-positive bid or a crossed
+ * market are skipped. Maturities with too few pairs come back with
+ * ok = false.
+ */
+inline std::vector<ImpliedForward> implied_forwards(const std::vector<OptionQuote>& quotes,
+                                                    const ForwardFitConfig& cfg = {}) {
+    std::map<double, std::vector<const OptionQuote*>> calls, puts;
+    for (const auto& q : quotes) {
+        if (!(q.bid > 0.0) || q.ask < q.bid)
+            continue;
+        (q.option_type == 'P' ? puts : calls)[q.maturity].push_back(&q);
+        puts[q.maturity];  // every maturity gets an entry, even with no puts
+    }
+
+    auto by_strike = [](const OptionQuote* a, const OptionQuote* b) {
+        return a->strike < b->strike;
+    };
+
+    std::vector<double> maturity, strike, diff, weight;
+    std::vector<std::size_t> offsets{0};
+    for (auto& kv : puts) {
+        auto& ps = kv.second;
+        auto& cs = calls[kv.first];
+        std::sort(ps.begin(), ps.end(), by_strike);
+        std::sort(cs.begin(), cs.end(), by_strike);
+
+        std::size_t i = 0, j = 0;
+        while (i < cs.size() && j < ps.size()) {
+            const OptionQuote& c = *cs[i];
+            const OptionQuote& p = *ps[j];
+            const double tol = 1e-9 * std::max(std::fabs(c.strike), 1.0);
+            if (c.strike < p.strike - tol) {
+                ++i;
+            } else if (p.strike < c.strike - tol) {
+                ++j;
+            } else {
+                strike.push_back(c.strike);
+                diff.push_back(0.5 * (c.bid + c.ask) - 0.5 * (p.bid + p.ask));
+                const double width = std::max((c.ask - c.bid) + (p.ask - p.bid), 1e-6);
+                weight.push_back(cfg.spread_weights ? 1.0 / (width * width) : 1.0);
+                ++i;
+                ++j;
+            }
+        }
+        maturity.push_back(kv.first);
+        offsets.push_back(strike.size());
+    }
+
+    std::vector<ImpliedForward> out(maturity.size());
+    implied_forward_batch(maturity.size(), offsets.data(), maturity.data(), strike.data(),
+                          diff.data(), weight.data(), out.data(), cfg);
+    return out;
+}
+
+// =======================
+// Consumers
+// =======================
+
+/**
+ * @brief Rewrites spot and rate of every quote whose maturity has a
+ * successful fit to S = D · F and r = −ln(D) / T, so Black–Scholes on
+ * (spot, rate) prices off the implied forward. Returns the number of
+ * quotes updated.
+ */
+inline std::size_t apply_implied_forwards(std::vector<OptionQuote>& quotes,
+                                          const std::vector<ImpliedForward>& forwards) {
+    std::map<double, const ImpliedForward*> by_maturity;
+    for (const auto& f : forwards)
+        if (f.ok)
+            by_maturity[f.maturity] = &f;
+
+    std::size_t updated = 0;
+    for (auto& q : quotes) {
+        auto it = by_maturity.find(q.maturity);
+        if (it == by_maturity.end())
+            continue;
+        q.spot = it->second->spot_equivalent();
+        q.rate = it->second->rate;
+        ++updated;
+    }
+    return updated;
+}
+
+/**
+ * @brief Implied vols off a forward and discount factor per option
+ * (Black-76), NaN where the solve fails. Same solver as
+ * implied_vol_batch(), with S = D · F and r = −ln(D) / T.
+ */
+inline void implied_vol_batch_forward(std::size_t n, bool is_call, StridedView price,
+                                      StridedView F, StridedView K, StridedView T,
+                                      StridedView D, double* out, double tol = 1e-6,
+                                      int max_iter = 100) {
+    for (std::size_t i = 0; i < n; ++i) {
+        const double S = D[i] * F[i];
+        const double r = T[i] > 0.0 ? -std::log(D[i]) / T[i] : 0.0;
+        double p = price[i];
+        if (!is_call)
+            p += D[i] * (F[i] - K[i]);
+        double sigma;
+        out[i] = try_implied_vol_call(p, S, K[i], T[i], r, sigma, 0.20, tol, max_iter)
+                     ? sigma
+                     : std::numeric_limits<double>::quiet_NaN();
+    }
+}
+
+} // namespace qf
+
+#endif // QF_IMPLIED_FORWARD_H
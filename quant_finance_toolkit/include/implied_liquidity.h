@@ -0,0 +1,314 @@
+#ifndef QF_IMPLIED_LIQUIDITY_H
+#define QF_IMPLIED_LIQUIDITY_H
+
+/**
+ * @file implied_liquidity.h
+ * @author John Jacobson
+ * @brief First-generation implied-in / implied-out matching between futures
+ *        outrights and calendar spreads, on top of OrderBook.
+ *
+ * A calendar spread (near, far) is bought by buying the near expiry and
+ * selling the far one, at price near − far. Two resting markets always
+ * imply a third:
+ *
+ *   implied-in   spread (i, j)  ask = ask_i − bid_j      bid = bid_i − ask_j
+ *   implied-out  outright i     ask = spread_ask(i, j) + ask_j
+ *                                   = ask_k − spread_bid(k, i)
+ *                               bid = spread_bid(i, j) + bid_j
+ *                                   = bid_k − spread_ask(k, i)
+ *
+ * "First generation" means only real resting orders are combined; implied
+ * prices are never built from other implied prices.
+ *
+ * Every instrument (outright or spread) keeps a list of routes. A route is
+ * a pair of (book, side to take) legs whose top-of-book prices and sizes
+ * give one implied price. The engine also keeps a reverse index from each
+ * book to the instruments whose routes read it. A top-of-book change in one
+ * book re-prices only those dependants, each by scanning its own routes.
+ * The cost of an update therefore depends on how many spreads are listed
+ * per expiry, not on the number of expiries.
+ *
+ * add_order() matches an incoming order against the real book and the best
+ * implied route level by level, with real orders winning ties. Implied
+ * trades are atomic: both legs are sent at their top price with a size
+ * that fits inside the top level, so both fill completely.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory_resource>
+#include <stdexcept>
+#include <vector>
+
+#include "complex_orderbook.h"
+#include "metrics.h"
+#include "orderbook_simulator.h"
+#include "trace.h"
+
+namespace qf {
+
+struct ImpliedEngineConfig {
+    double tick = 0.01;  // implied prices are rounded to this
+};
+
+/**
+ * Outcome of one add_order(). `trades` are fills against real orders in
+ * the instrument's own book; `implied_fills` are the leg trades of implied
+ * fills. `order_id` is the ID of the resting remainder, 0 if none.
+ */
+struct ImpliedExecution {
+    std::uint32_t instrument = 0;
+    std::uint64_t order_id = 0;
+    std::uint64_t filled = 0;
+    std::uint64_t implied_filled = 0;
+    std::vector<Trade> trades;
+    std::vector<LegFill> implied_fills;
+};
+
+class ImpliedMatchingEngine {
+public:
+    /**
+     * @brief Creates `expiries` outright books with instrument IDs
+     * 0 .. expiries − 1, front month first.
+     */
+    explicit ImpliedMatchingEngine(std::size_t expiries, const ImpliedEngineConfig& cfg = {},
+                                   std::pmr::memory_resource* mr = std::pmr::get_default_resource())
+        : cfg_(cfg), mr_(mr), expiries_(expiries) {
+        if (!(cfg_.tick > 0.0))
+            throw std::runtime_error("ImpliedMatchingEngine: tick must be positive");
+        for (std::size_t i = 0; i < expiries; ++i)
+            instruments_.emplace_back(mr_);
+    }
+
+    /**
+     * @brief Lists the calendar spread near − far and returns its
+     * instrument ID. Wires the implied-in routes of the spread and the
+     * implied-out routes of both outrights.
+     */
+    std::uint32_t add_calendar_spread(std::uint32_t near, std::uint32_t far) {
+        if (near >= expiries_ || far >= expiries_ || near == far)
+            throw std::runtime_error("add_calendar_spread: need two distinct expiries");
+        const auto s = static_cast<std::uint32_t>(instruments_.size());
+        instruments_.emplace_back(mr_);
+        Instrument& sp = instruments_.back();
+        sp.near = near;
+        sp.far = far;
+
+        // Implied-in: buy near, sell far.
+        add_route(s, Side::Buy, {near, Side::Buy, 1.0}, {far, Side::Sell, -1.0});
+        add_route(s, Side::Sell, {near, Side::Sell, 1.0}, {far, Side::Buy, -1.0});
+        // Implied-out into the near leg: the spread plus the far outright.
+        add_route(near, Side::Buy, {s, Side::Buy, 1.0}, {far, Side::Buy, 1.0});
+        add_route(near, Side::Sell, {s, Side::Sell, 1.0}, {far, Side::Sell, 1.0});
+        // Implied-out into the far leg: the near outright against the spread.
+        add_route(far, Side::Buy, {near, Side::Buy, 1.0}, {s, Side::Sell, -1.0});
+        add_route(far, Side::Sell, {near, Side::Sell, 1.0}, {s, Side::Buy, -1.0});
+
+        for (std::uint32_t t : {s, near, far})
+            evaluate(t);
+        return s;
+    }
+
+    std::size_t expiries() const { return expiries_; }
+    std::size_t instruments() const { return instruments_.size(); }
+    bool is_spread(std::uint32_t id) const { return id >= expiries_; }
+    std::uint32_t near_leg(std::uint32_t spread) const { return instruments_[spread].near; }
+    std::uint32_t far_leg(std::uint32_t spread) const { return instruments_[spread].far; }
+
+    OrderBook& book(std::uint32_t id) { return instruments_[id].book; }
+    const OrderBook& book(std::uint32_t id) const { return instruments_[id].book; }
+
+    // Best first-generation implied market into instrument `id`.
+    const ImpliedQuote& implied(std::uint32_t id) const { return instruments_[id].implied; }
+
+    // Implied re-evaluations performed so far (for monitoring the cost).
+    std::uint64_t evaluations() const { return evaluations_; }
+
+    /**
+     * @brief Tells the engine that book `id` may have changed outside
+     * add_order(). Dependants are re-priced only if its top moved.
+     */
+    void on_book_update(std::uint32_t id) {
+        Instrument& in = instruments_[id];
+        const detail::TopOfBook t = detail::read_top(in.book, level_);
+        if (t == in.top)
+            return;
+        in.top = t;
+        for (std::uint32_t d : in.dependents)
+            evaluate(d);
+    }
+
+    /**
+     * @brief Submits a limit order to outright or spread `id`, matching it
+     * against real orders and implied liquidity best price first. Any
+     * remainder rests in the book.
+     */
+    ImpliedExecution add_order(std::uint32_t id, Side side, double price, std::uint64_t quantity) {
+        QF_TRACE_SCOPE_CAT("implied_add_order", "implied_liquidity");
+        ImpliedExecution ex;
+        ex.instrument = id;
+        Instrument& in = instruments_[id];
+        std::uint64_t remaining = quantity;
+
+        while (remaining > 0) {
+            const ImpliedQuote& imp = in.implied;
+            const double imp_px = side == Side::Buy ? imp.ask : imp.bid;
+            const std::uint64_t imp_qty = side == Side::Buy ? imp.ask_size : imp.bid_size;
+            const double real_px = side == Side::Buy ? in.top.ask : in.top.bid;
+            const std::uint64_t real_qty = side == Side::Buy ? in.top.ask_qty : in.top.bid_qty;
+
+            const bool real_ok = real_qty > 0 && crosses(side, price, real_px);
+            const bool implied_ok = imp_qty > 0 && crosses(side, price, imp_px);
+
+            if (real_ok && !(implied_ok && strictly_better(side, imp_px, real_px))) {
+                const std::uint64_t q = std::min(remaining, real_qty);
+                trades_.clear();
+                in.book.add_limit_order(side, real_px, q, trades_);
+                ex.trades.insert(ex.trades.end(), trades_.begin(), trades_.end());
+                remaining -= q;
+                ex.filled += q;
+                on_book_update(id);
+            } else if (implied_ok) {
+                const std::uint64_t q = std::min(remaining, imp_qty);
+                const Route& r = (side == Side::Buy ? in.buy_routes : in.sell_routes)
+                    [side == Side::Buy ? in.best_buy : in.best_sell];
+                execute(r, q, ex);
+                remaining -= q;
+                ex.filled += q;
+                ex.implied_filled += q;
+            } else {
+                break;
+            }
+        }
+
+        if (remaining > 0) {
+            trades_.clear();
+            ex.order_id = in.book.add_limit_order(side, price, remaining, trades_);
+            on_book_update(id);
+        }
+        QF_METRIC_ADD("qf_implied_fills_total", "Contracts filled against implied liquidity",
+                      ex.implied_filled);
+        return ex;
+    }
+
+    bool cancel_order(std::uint32_t id, std::uint64_t order_id) {
+        const bool ok = instruments_[id].book.cancel_order(order_id);
+        on_book_update(id);
+        return ok;
+    }
+
+private:
+    // Take the top of `instrument` on `take` (Buy lifts the ask, Sell hits
+    // the bid); the route price adds coef × that top price.
+    struct RouteLeg {
+        std::uint32_t instrument;
+        Side take;
+        double coef;
+    };
+
+    struct Route {
+        RouteLeg a, b;
+    };
+
+    struct Instrument {
+        explicit Instrument(std::pmr::memory_resource* mr) : book(mr) {}
+
+        OrderBook book;
+        std::uint32_t near = 0, far = 0;  // spreads only
+        detail::TopOfBook top;
+        std::vector<Route> buy_routes, sell_routes;  // implied ask / bid
+        std::vector<std::uint32_t> dependents;       // instruments reading this book
+        ImpliedQuote implied;
+        std::size_t best_buy = 0, best_sell = 0;
+    };
+
+    void add_route(std::uint32_t target, Side side, RouteLeg a, RouteLeg b) {
+        Instrument& t = instruments_[target];
+        (side == Side::Buy ? t.buy_routes : t.sell_routes).push_back({a, b});
+        for (std::uint32_t src : {a.instrument, b.instrument}) {
+            auto& deps = instruments_[src].dependents;
+            if (std::find(deps.begin(), deps.end(), target) == deps.end())
+                deps.push_back(target);
+        }
+    }
+
+    bool crosses(Side side, double limit, double px) const {
+        const double eps = 1e-6 * cfg_.tick;
+        return side == Side::Buy ? px <= limit + eps : px >= limit - eps;
+    }
+
+    bool strictly_better(Side side, double a, double b) const {
+        const double eps = 1e-6 * cfg_.tick;
+        return side == Side::Buy ? a < b - eps : a > b + eps;
+    }
+
+    // Price and size of a route from the current tops; size 0 if a leg
+    // has nothing on the side it needs.
+    std::uint64_t route_quote(const Route& r, double& px) const {
+        px = 0.0;
+        std::uint64_t size = ~std::uint64_t{0};
+        for (const RouteLeg& l : {r.a, r.b}) {
+            const detail::TopOfBook& t = instruments_[l.instrument].top;
+            const bool lift = l.take == Side::Buy;
+            px += l.coef * (lift ? t.ask : t.bid);
+            size = std::min(size, lift ? t.ask_qty : t.bid_qty);
+        }
+        px = std::round(px / cfg_.tick) * cfg_.tick;
+        return size;
+    }
+
+    void evaluate(std::uint32_t id) {
+        ++evaluations_;
+        Instrument& in = instruments_[id];
+        ImpliedQuote q;
+        for (std::size_t k = 0; k < in.buy_routes.size(); ++k) {
+            double px;
+            const std::uint64_t sz = route_quote(in.buy_routes[k], px);
+            if (sz > 0 && (q.ask_size == 0 || px < q.ask)) {
+                q.ask = px;
+                q.ask_size = sz;
+                in.best_buy = k;
+            }
+        }
+        for (std::size_t k = 0; k < in.sell_routes.size(); ++k) {
+            double px;
+            const std::uint64_t sz = route_quote(in.sell_routes[k], px);
+            if (sz > 0 && (q.bid_size == 0 || px > q.bid)) {
+                q.bid = px;
+                q.bid_size = sz;
+                in.best_sell = k;
+            }
+        }
+        in.implied = q;
+    }
+
+    // Both legs of a route for q contracts, each inside its top level.
+    void execute(const Route& r, std::uint64_t q, ImpliedExecution& ex) {
+        for (const RouteLeg& l : {r.a, r.b}) {
+            Instrument& src = instruments_[l.instrument];
+            const bool lift = l.take == Side::Buy;
+            trades_.clear();
+            src.book.add_limit_order(l.take, lift ? src.top.ask : src.top.bid, q, trades_);
+            for (const Trade& t : trades_)
+                ex.implied_fills.push_back({l.instrument, t});
+        }
+        on_book_update(r.a.instrument);
+        on_book_update(r.b.instrument);
+    }
+
+    ImpliedEngineConfig cfg_;
+    std::pmr::memory_resource* mr_;
+    std::size_t expiries_;
+    std::deque<Instrument> instruments_;
+    std::uint64_t evaluations_ = 0;
+
+    std::vector<DepthLevel> level_;
+    std::vector<Trade> trades_;
+};
+
+} // namespace qf
+
+#endif // QF_IMPLIED_LIQUIDITY_H
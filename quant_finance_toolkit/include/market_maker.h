@@ -0,0 +1,326 @@
+#ifndef QF_MARKET_MAKER_H
+#define QF_MARKET_MAKER_H
+
+/**
+ * @file market_maker.h
+ * @author John Jacobson
+ * @brief Options market-making quote engine: surface-driven theoretical
+ *        values, inventory skew, and diffed order management on OrderBook.
+ *
+ * QuoteEngine owns one OrderBook per listed contract and keeps a two-sided
+ * quote in each. A requote(spot, vols) does three passes over the chain:
+ *
+ *   1. Batch Black–Scholes: theo, delta and vega for every contract, with
+ *      d1 computed once per contract.
+ *   2. Inventory: portfolio delta Δ = Σ pos·δ and vega V = Σ pos·ν, and a
+ *      skewed reservation price per contract,
+ *
+ *          reservation = theo − delta_skew · Δ · δ − vega_skew · V · ν
+ *
+ *      so a long-delta book lowers its bids and offers in the contracts
+ *      that add delta. The half spread is half_spread_vol vol points of
+ *      vega, with a floor in ticks. Bids round down and asks round up to
+ *      the tick.
+ *   3. Diff: the target quote is compared in integer ticks with the live
+ *      order on each side. Only the differences become commands: New where
+ *      nothing rests, Modify where price or size changed by at least
+ *      requote_ticks, and Cancel where the side is no longer quoted (price
+ *      below one tick, or the position limit reached).
+ *
+ * plan() stops after the diff and leaves the books alone. apply() sends
+ * the commands, and requote() does both. Fills against our orders, from
+ * apply() or from other flow the caller routes through book(i), are
+ * booked with on_trades().
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "metrics.h"
+#include "options_greeks.h"
+#include "orderbook_simulator.h"
+#include "trace.h"
+
+namespace qf {
+
+struct QuotedContract {
+    double strike;
+    double maturity;
+    bool is_call;
+};
+
+struct QuoteEngineConfig {
+    double tick = 0.01;
+    std::uint64_t size = 10;                // contracts per side
+    double half_spread_vol = 0.005;         // half spread in vol (×vega)
+    std::uint32_t min_half_spread_ticks = 1;
+    double delta_skew = 0.0;                // price per unit Δ per unit δ
+    double vega_skew = 0.0;                 // price per unit V per unit ν
+    std::int64_t max_position = 500;        // stop adding beyond ±this
+    std::uint32_t requote_ticks = 1;        // min price move to modify
+};
+
+struct QuoteCommand {
+    enum Kind : std::uint8_t { New, Modify, Cancel };
+
+    Kind kind;
+    Side side;
+    std::uint32_t contract;
+    double price;
+    std::uint64_t quantity;
+    std::uint64_t order_id;  // 0 for New until apply() assigns one
+};
+
+struct RequoteStats {
+    std::size_t news = 0, modifies = 0, cancels = 0, unchanged = 0;
+
+    std::size_t commands() const { return news + modifies + cancels; }
+};
+
+class QuoteEngine {
+public:
+    struct LiveOrder {
+        std::uint64_t id = 0;  // 0 = no order resting
+        std::int64_t ticks = 0;
+        std::uint64_t remaining = 0;
+    };
+
+    QuoteEngine(std::vector<QuotedContract> contracts, double rate,
+                const QuoteEngineConfig& cfg = {},
+                std::pmr::memory_resource* mr = std::pmr::get_default_resource())
+        : contracts_(std::move(contracts)), rate_(rate), cfg_(cfg) {
+        if (!(cfg_.tick > 0.0) || cfg_.size == 0)
+            throw std::runtime_error("QuoteEngine: tick and size must be positive");
+        const std::size_t n = contracts_.size();
+        for (const auto& c : contracts_)
+            if (!(c.strike > 0.0) || !(c.maturity > 0.0))
+                throw std::runtime_error("QuoteEngine: strike and maturity must be positive");
+        books_.reserve(n);
+        for (std::size_t i = 0; i < n; ++i)
+            books_.emplace_back(mr);
+        theo_.resize(n);
+        delta_.resize(n);
+        vega_.resize(n);
+        position_.assign(n, 0);
+        bids_.resize(n);
+        asks_.resize(n);
+    }
+
+    std::size_t size() const { return contracts_.size(); }
+    const QuotedContract& contract(std::size_t i) const { return contracts_[i]; }
+    const QuoteEngineConfig& config() const { return cfg_; }
+
+    OrderBook& book(std::size_t i) { return books_[i]; }
+    const OrderBook& book(std::size_t i) const { return books_[i]; }
+
+    double theo(std::size_t i) const { return theo_[i]; }
+    double delta(std::size_t i) const { return delta_[i]; }
+    double vega(std::size_t i) const { return vega_[i]; }
+    std::int64_t position(std::size_t i) const { return position_[i]; }
+    const LiveOrder& live(std::size_t i, Side side) const {
+        return side == Side::Buy ? bids_[i] : asks_[i];
+    }
+
+    // Portfolio delta and vega at the last requote.
+    double portfolio_delta() const { return portfolio_delta_; }
+    double portfolio_vega() const { return portfolio_vega_; }
+
+    /**
+     * @brief Recomputes theos and quotes at `spot` with one vol per
+     * contract, and appends the commands needed to move the live orders
+     * there to `out`. The books are not touched.
+     */
+    RequoteStats plan(double spot, StridedView vol, std::vector<QuoteCommand>& out) {
+        QF_TRACE_SCOPE_CAT("plan_quotes", "market_maker");
+        const std::size_t n = size();
+        price_chain(spot, vol);
+
+        double pd = 0.0, pv = 0.0;
+        for (std::size_t i = 0; i < n; ++i) {
+            const double q = static_cast<double>(position_[i]);
+            pd += q * delta_[i];
+            pv += q * vega_[i];
+        }
+        portfolio_delta_ = pd;
+        portfolio_vega_ = pv;
+
+        const double inv_tick = 1.0 / cfg_.tick;
+        const double min_half = cfg_.tick * cfg_.min_half_spread_ticks;
+        const double skew_d = cfg_.delta_skew * pd, skew_v = cfg_.vega_skew * pv;
+
+        RequoteStats stats;
+        for (std::size_t i = 0; i < n; ++i) {
+            const double res = theo_[i] - skew_d * delta_[i] - skew_v * vega_[i];
+            const double half = std::max(cfg_.half_spread_vol * vega_[i], min_half);
+            const std::int64_t bid = static_cast<std::int64_t>(std::floor((res - half) * inv_tick));
+            const std::int64_t ask = static_cast<std::int64_t>(std::ceil((res + half) * inv_tick));
+            const bool quote_bid = bid >= 1 && position_[i] < cfg_.max_position;
+            const bool quote_ask = ask >= 1 && position_[i] > -cfg_.max_position;
+            // Move the leading side first so the pair never crosses itself.
+            if (bids_[i].id != 0 && bid > bids_[i].ticks) {
+                diff(i, Side::Sell, quote_ask, ask, asks_[i], out, stats);
+                diff(i, Side::Buy, quote_bid, bid, bids_[i], out, stats);
+            } else {
+                diff(i, Side::Buy, quote_bid, bid, bids_[i], out, stats);
+                diff(i, Side::Sell, quote_ask, ask, asks_[i], out, stats);
+            }
+        }
+
+        QF_METRIC_INC("qf_mm_requotes_total", "Chain requotes planned");
+        QF_METRIC_ADD("qf_mm_quote_commands_total", "Quote commands generated", stats.commands());
+        return stats;
+    }
+
+    /**
+     * @brief Sends commands to the books and updates the live orders. New
+     * orders get their book-assigned ID written back into the command.
+     * Fills generated on the way in are booked as by on_trades().
+     */
+    void apply(std::vector<QuoteCommand>& commands) {
+        QF_TRACE_SCOPE_CAT("apply_quotes", "market_maker");
+        for (auto& c : commands) {
+            OrderBook& ob = books_[c.contract];
+            LiveOrder& live = c.side == Side::Buy ? bids_[c.contract] : asks_[c.contract];
+            trades_.clear();
+            switch (c.kind) {
+            case QuoteCommand::New:
+                c.order_id = ob.add_limit_order(c.side, c.price, c.quantity, trades_);
+                live = {c.order_id, ticks_of(c.price), c.quantity};
+                break;
+            case QuoteCommand::Modify:
+                if (ob.modify_order(c.order_id, c.price, c.quantity, trades_))
+                    live = {c.order_id, ticks_of(c.price), c.quantity};
+                else
+                    live = {};
+                break;
+            case QuoteCommand::Cancel:
+                ob.cancel_order(c.order_id);
+                live = {};
+                break;
+            }
+            if (!trades_.empty())
+                on_trades(c.contract, trades_);
+        }
+    }
+
+    // plan() followed by apply().
+    RequoteStats requote(double spot, StridedView vol) {
+        commands_.clear();
+        RequoteStats stats = plan(spot, vol, commands_);
+        apply(commands_);
+        return stats;
+    }
+
+    // Requote with vols read from a surface callable iv(T, K).
+    template <typename ImpliedVol, typename = decltype(std::declval<const ImpliedVol&>()(0.0, 0.0))>
+    RequoteStats requote(double spot, const ImpliedVol& iv) {
+        vol_.resize(size());
+        for (std::size_t i = 0; i < size(); ++i)
+            vol_[i] = iv(contracts_[i].maturity, contracts_[i].strike);
+        return requote(spot, StridedView(vol_.data()));
+    }
+
+    // Commands sent by the last requote().
+    const std::vector<QuoteCommand>& last_commands() const { return commands_; }
+
+    /**
+     * @brief Books fills against our orders in contract i: positions move
+     * and live orders shrink, or clear when fully filled. Trades between
+     * other participants are ignored.
+     */
+    template <typename TradeVec>
+    void on_trades(std::size_t i, const TradeVec& trades) {
+        LiveOrder& bid = bids_[i];
+        LiveOrder& ask = asks_[i];
+        for (const Trade& t : trades) {
+            if (bid.id != 0 && t.buy_id == bid.id) {
+                position_[i] += static_cast<std::int64_t>(t.quantity);
+                bid.remaining -= std::min(bid.remaining, t.quantity);
+                if (bid.remaining == 0)
+                    bid = {};
+            }
+            if (ask.id != 0 && t.sell_id == ask.id) {
+                position_[i] -= static_cast<std::int64_t>(t.quantity);
+                ask.remaining -= std::min(ask.remaining, t.quantity);
+                if (ask.remaining == 0)
+                    ask = {};
+            }
+        }
+    }
+
+private:
+    std::int64_t ticks_of(double price) const {
+        return static_cast<std::int64_t>(std::llround(price / cfg_.tick));
+    }
+
+    // Theo, delta and vega for every contract, sharing d1 per contract.
+    void price_chain(double S, StridedView vol) {
+        QF_TRACE_SCOPE_CAT("price_chain", "market_maker");
+        const double r = rate_;
+        for (std::size_t i = 0; i < size(); ++i) {
+            const QuotedContract& c = contracts_[i];
+            const double sigma = vol[i];
+            const double st = std::sqrt(c.maturity), sst = sigma * st;
+            const double df = std::exp(-r * c.maturity);
+            const double d1 = (std::log(S / c.strike) + (r + 0.5 * sigma * sigma) * c.maturity) / sst;
+            const double Nd1 = norm_cdf(d1), Nd2 = norm_cdf(d1 - sst);
+            const double call = S * Nd1 - c.strike * df * Nd2;
+            theo_[i] = c.is_call ? call : call - S + c.strike * df;
+            delta_[i] = c.is_call ? Nd1 : Nd1 - 1.0;
+            vega_[i] = S * norm_pdf(d1) * st;
+        }
+    }
+
+    void diff(std::size_t i, Side side, bool quoted, std::int64_t ticks, const LiveOrder& live,
+              std::vector<QuoteCommand>& out, RequoteStats& stats) const {
+        const auto contract = static_cast<std::uint32_t>(i);
+        if (!quoted) {
+            if (live.id != 0) {
+                out.push_back({QuoteCommand::Cancel, side, contract, 0.0, 0, live.id});
+                ++stats.cancels;
+            }
+            return;
+        }
+        const double price = static_cast<double>(ticks) * cfg_.tick;
+        if (live.id == 0) {
+            out.push_back({QuoteCommand::New, side, contract, price, cfg_.size, 0});
+            ++stats.news;
+            return;
+        }
+        const std::int64_t moved = ticks > live.ticks ? ticks - live.ticks : live.ticks - ticks;
+        const bool reprice =
+            moved >= static_cast<std::int64_t>(std::max<std::uint32_t>(cfg_.requote_ticks, 1));
+        const bool resize = live.remaining != cfg_.size;
+        if (reprice || resize) {
+            // A size top-up below the requote threshold keeps the resting price.
+            const double send = reprice ? price : static_cast<double>(live.ticks) * cfg_.tick;
+            out.push_back({QuoteCommand::Modify, side, contract, send, cfg_.size, live.id});
+            ++stats.modifies;
+            return;
+        }
+        ++stats.unchanged;
+    }
+
+    std::vector<QuotedContract> contracts_;
+    double rate_;
+    QuoteEngineConfig cfg_;
+    std::vector<OrderBook> books_;
+
+    std::vector<double> theo_, delta_, vega_, vol_;
+    std::vector<std::int64_t> position_;
+    std::vector<LiveOrder> bids_, asks_;
+    double portfolio_delta_ = 0.0, portfolio_vega_ = 0.0;
+
+    std::vector<QuoteCommand> commands_;
+    std::vector<Trade> trades_;
+};
+
+} // namespace qf
+
+#endif // QF_MARKET_MAKER_H
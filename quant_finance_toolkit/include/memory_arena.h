@@ -0,0 +1,348 @@
+#ifndef QF_MEMORY_ARENA_H
+#define QF_MEMORY_ARENA_H
+
+/**
+ * @file memory_arena.h
+ * @author John Jacobson
+ * @brief Monotonic arena, node pool and huge-page backing for toolkit containers.
+ *
+ * The toolkit containers (order book levels and index, detector scratch)
+ * allocate through std::pmr::memory_resource, so any resource here can be
+ * plugged in without changing their types:
+ *
+ *   - HugePageResource: upstream that maps memory in 2 MB aligned blocks,
+ *     asking for explicit huge pages (MAP_HUGETLB) first, then transparent
+ *     huge pages (madvise), then ordinary pages. Large books span far fewer
+ *     TLB entries this way.
+ *   - MonotonicArena: bump allocator for per-batch scratch. reset() makes
+ *     all memory reusable at once and keeps the first chunk, so a steady
+ *     stream of batches stops calling malloc entirely.
+ *   - PoolResource: per-size-class free lists for node-based containers
+ *     (std::map / std::unordered_map nodes and buckets, deque blocks), where
+ *     memory is freed piecemeal and a monotonic arena would only grow.
+ *
+ * None of these are thread safe; use one per thread (or per worker, see
+ * WorkerArenas in numa_placement.h).
+ */
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+namespace qf {
+
+// =======================
+// Huge-page backing
+// =======================
+
+class HugePageResource : public std::pmr::memory_resource {
+public:
+    static constexpr std::size_t kHugePage = std::size_t{2} << 20;
+
+    enum class Backing { HugeTLB, Transparent, Regular };
+
+    HugePageResource() = default;
+
+    ~HugePageResource() override {
+        for (const auto& m : mappings_)
+            unmap(m);
+    }
+
+    HugePageResource(const HugePageResource&) = delete;
+    HugePageResource& operator=(const HugePageResource&) = delete;
+
+    // How the most recent mapping was backed.
+    Backing last_backing() const { return last_; }
+
+    std::size_t bytes_mapped() const {
+        std::size_t n = 0;
+        for (const auto& m : mappings_)
+            n += m.size;
+        return n;
+    }
+
+protected:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+        std::size_t size = (std::max(bytes, alignment) + kHugePage - 1) / kHugePage * kHugePage;
+        Mapping m = map(size);
+        mappings_.push_back(m);
+        last_ = m.backing;
+        return m.user;
+    }
+
+    void do_deallocate(void* p, std::size_t, std::size_t) override {
+        for (std::size_t i = 0; i < mappings_.size(); ++i) {
+            if (mappings_[i].user == p) {
+                unmap(mappings_[i]);
+                mappings_[i] = mappings_.back();
+                mappings_.pop_back();
+                return;
+            }
+        }
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+private:
+    struct Mapping {
+        void* base;      // what was mapped
+        std::size_t mapped;
+        void* user;      // 2 MB aligned start handed out
+        std::size_t size;
+        Backing backing;
+    };
+
+    std::vector<Mapping> mappings_;
+    Backing last_ = Backing::Regular;
+
+    static Mapping map(std::size_t size) {
+#if defined(__linux__)
+#ifdef MAP_HUGETLB
+        void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED)
+            return {p, size, p, size, Backing::HugeTLB};
+#endif
+        // Over-map by one huge page so the block can be 2 MB aligned, which
+        // transparent huge pages need.
+        std::size_t mapped = size + kHugePage;
+        void* raw = mmap(nullptr, mapped, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw == MAP_FAILED)
+            throw std::bad_alloc();
+        auto addr = reinterpret_cast<std::uintptr_t>(raw);
+        auto aligned = (addr + kHugePage - 1) & ~(std::uintptr_t{kHugePage} - 1);
+        void* user = reinterpret_cast<void*>(aligned);
+        Backing backing = Backing::Regular;
+#ifdef MADV_HUGEPAGE
+        if (madvise(user, size, MADV_HUGEPAGE) == 0)
+            backing = Backing::Transparent;
+#endif
+        return {raw, mapped, user, size, backing};
+#else
+        void* p = ::operator new(size, std::align_val_t(kHugePage));
+        return {p, size, p, size, Backing::Regular};
+#endif
+    }
+
+    static void unmap(const Mapping& m) {
+#if defined(__linux__)
+        munmap(m.base, m.mapped);
+#else
+        ::operator delete(m.base, std::align_val_t(kHugePage));
+#endif
+    }
+};
+
+// =======================
+// Monotonic arena
+// =======================
+
+class MonotonicArena : public std::pmr::memory_resource {
+public:
+    explicit MonotonicArena(std::size_t chunk_bytes = 64 * 1024,
+                            std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+        : chunk_bytes_(std::max<std::size_t>(chunk_bytes, 256)), upstream_(upstream) {}
+
+    ~MonotonicArena() override { release(); }
+
+    MonotonicArena(const MonotonicArena&) = delete;
+    MonotonicArena& operator=(const MonotonicArena&) = delete;
+
+    /**
+     * @brief Make all memory reusable. Everything allocated from the arena
+     * must be dead by now. The largest chunk is kept for the next batch.
+     */
+    void reset() {
+        if (chunks_.empty())
+            return;
+        auto largest = std::max_element(chunks_.begin(), chunks_.end(),
+                                        [](const Chunk& a, const Chunk& b) { return a.size < b.size; });
+        std::swap(*largest, chunks_.front());
+        for (std::size_t i = 1; i < chunks_.size(); ++i)
+            upstream_->deallocate(chunks_[i].base, chunks_[i].size, alignof(std::max_align_t));
+        chunks_.resize(1);
+        used_ = 0;
+    }
+
+    // Return every chunk to the upstream resource.
+    void release() {
+        for (const auto& c : chunks_)
+            upstream_->deallocate(c.base, c.size, alignof(std::max_align_t));
+        chunks_.clear();
+        used_ = 0;
+    }
+
+    std::size_t bytes_reserved() const {
+        std::size_t n = 0;
+        for (const auto& c : chunks_)
+            n += c.size;
+        return n;
+    }
+
+protected:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+        if (!chunks_.empty()) {
+            Chunk& c = chunks_.back();
+            auto base = reinterpret_cast<std::uintptr_t>(c.base);
+            std::uintptr_t p = (base + used_ + alignment - 1) & ~(std::uintptr_t{alignment} - 1);
+            if (p + bytes <= base + c.size) {
+                used_ = static_cast<std::size_t>(p + bytes - base);
+                return reinterpret_cast<void*>(p);
+            }
+        }
+
+        // Geometric growth keeps the number of chunks logarithmic.
+        std::size_t size = std::max(chunk_bytes_, bytes + alignment);
+        if (!chunks_.empty())
+            size = std::max(size, chunks_.back().size * 2);
+        void* base = upstream_->allocate(size, alignof(std::max_align_t));
+        chunks_.push_back({base, size});
+
+        auto b = reinterpret_cast<std::uintptr_t>(base);
+        std::uintptr_t p = (b + alignment - 1) & ~(std::uintptr_t{alignment} - 1);
+        used_ = static_cast<std::size_t>(p + bytes - b);
+        return reinterpret_cast<void*>(p);
+    }
+
+    void do_deallocate(void*, std::size_t, std::size_t) override {}
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+private:
+    struct Chunk {
+        void* base;
+        std::size_t size;
+    };
+
+    std::size_t chunk_bytes_;
+    std::pmr::memory_resource* upstream_;
+    std::vector<Chunk> chunks_;
+    std::size_t used_ = 0;
+};
+
+// =======================
+// Size-class pool
+// =======================
+
+/**
+ * Free lists for small blocks in 16-byte size classes (map / list nodes,
+ * deque blocks) and for medium blocks in power-of-two classes (hash bucket
+ * arrays, which are reallocated on every rehash). Both are carved from
+ * slabs obtained from the upstream resource, for big books a
+ * HugePageResource with slab_bytes = HugePageResource::kHugePage. Requests
+ * larger than half a slab go straight upstream.
+ */
+class PoolResource : public std::pmr::memory_resource {
+public:
+    static constexpr std::size_t kGranule = 16;
+    static constexpr std::size_t kMaxSmall = 1024;
+
+    explicit PoolResource(std::pmr::memory_resource* upstream = std::pmr::new_delete_resource(),
+                          std::size_t slab_bytes = 256 * 1024)
+        : upstream_(upstream), slab_bytes_(std::max<std::size_t>(slab_bytes, 4 * kMaxSmall)) {
+        free_.fill(nullptr);
+    }
+
+    ~PoolResource() override {
+        for (const auto& s : slabs_)
+            upstream_->deallocate(s.base, s.size, alignof(std::max_align_t));
+    }
+
+    PoolResource(const PoolResource&) = delete;
+    PoolResource& operator=(const PoolResource&) = delete;
+
+protected:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+        std::size_t cls = size_class(bytes);
+        if (cls == kNoClass || alignment > kGranule)
+            return upstream_->allocate(bytes, alignment);
+
+        if (FreeBlock* b = free_[cls]) {
+            free_[cls] = b->next;
+            return b;
+        }
+        return carve(class_size(cls));
+    }
+
+    void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override {
+        std::size_t cls = size_class(bytes);
+        if (cls == kNoClass || alignment > kGranule) {
+            upstream_->deallocate(p, bytes, alignment);
+            return;
+        }
+        auto* b = static_cast<FreeBlock*>(p);
+        b->next = free_[cls];
+        free_[cls] = b;
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+private:
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    struct Slab {
+        void* base;
+        std::size_t size;
+    };
+
+    static constexpr std::size_t kSmallClasses = kMaxSmall / kGranule;
+    static constexpr std::size_t kMediumClasses = 40;
+    static constexpr std::size_t kNoClass = ~std::size_t{0};
+
+    std::pmr::memory_resource* upstream_;
+    std::size_t slab_bytes_;
+    std::array<FreeBlock*, kSmallClasses + kMediumClasses> free_;
+    std::vector<Slab> slabs_;
+    char* cursor_ = nullptr;
+    char* end_ = nullptr;
+
+    std::size_t size_class(std::size_t bytes) const {
+        if (bytes <= kMaxSmall)
+            return (std::max<std::size_t>(bytes, 1) + kGranule - 1) / kGranule - 1;
+        if (bytes > slab_bytes_ / 2)
+            return kNoClass;
+        std::size_t k = 0;
+        while ((kMaxSmall << (k + 1)) < bytes)
+            ++k;
+        return kSmallClasses + k;
+    }
+
+    static std::size_t class_size(std::size_t cls) {
+        if (cls < kSmallClasses)
+            return (cls + 1) * kGranule;
+        return kMaxSmall << (cls - kSmallClasses + 1);
+    }
+
+    void* carve(std::size_t block) {
+        if (cursor_ == nullptr || static_cast<std::size_t>(end_ - cursor_) < block) {
+            void* base = upstream_->allocate(slab_bytes_, kGranule);
+            slabs_.push_back({base, slab_bytes_});
+            cursor_ = static_cast<char*>(base);
+            end_ = cursor_ + slab_bytes_;
+        }
+        void* p = cursor_;
+        cursor_ += block;
+        return p;
+    }
+};
+
+} // namespace qf
+
+#endif // QF_MEMORY_ARENA_H
@@ -0,0 +1,388 @@
+#ifndef QF_METRICS_H
+#define QF_METRICS_H
+
+/**
+ * @file metrics.h
+ * @author John Jacobson
+ * @brief Lock-free counters, gauges and histograms with Prometheus text export.
+ *
+ * For a live system I want to see order rates, match latency, IV solver
+ * failures and arbitrage flags without attaching a profiler. The hot path
+ * must not notice, so:
+ *
+ *   - Counters and histograms are sharded: each thread increments its own
+ *     cache-line padded slot with a relaxed atomic add, so writers never
+ *     contend. Shards are merged only when the registry is scraped.
+ *   - The module hooks (QF_METRIC_* macros) compile to nothing unless
+ *     QF_ENABLE_METRICS is defined.
+ *   - A metric is looked up once per call site (function-local static);
+ *     after that an update is a single relaxed add.
+ *
+ * render_prometheus() produces the Prometheus text exposition format;
+ * metrics_http.h serves it over HTTP on localhost.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace qf {
+namespace metrics {
+
+constexpr std::size_t kShards = 64;
+
+// Each thread gets a shard index the first time it records anything.
+inline std::size_t shard_index() {
+    static std::atomic<std::size_t> next{0};
+    thread_local std::size_t idx = next.fetch_add(1, std::memory_order_relaxed) % kShards;
+    return idx;
+}
+
+struct alignas(64) PaddedCounter {
+    std::atomic<std::uint64_t> value{0};
+};
+
+// =======================
+// Counter
+// =======================
+
+class Counter {
+public:
+    void inc(std::uint64_t n = 1) {
+        shards_[shard_index()].value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    std::uint64_t value() const {
+        std::uint64_t total = 0;
+        for (const auto& s : shards_)
+            total += s.value.load(std::memory_order_relaxed);
+        return total;
+    }
+
+private:
+    PaddedCounter shards_[kShards];
+};
+
+// =======================
+// Gauge
+// =======================
+
+class Gauge {
+public:
+    void set(double v) { value_.store(v, std::memory_order_relaxed); }
+
+    void add(double d) {
+        double cur = value_.load(std::memory_order_relaxed);
+        while (!value_.compare_exchange_weak(cur, cur + d, std::memory_order_relaxed))
+            ;
+    }
+
+    double value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<double> value_{0.0};
+};
+
+// =======================
+// Histogram
+// =======================
+
+/**
+ * Fixed upper bounds chosen at registration. Each shard keeps a count per
+ * bucket plus a sum (stored in fixed point so it can be a plain atomic
+ * integer add).
+ */
+class Histogram {
+public:
+    explicit Histogram(std::vector<double> upper_bounds)
+        : bounds_(std::move(upper_bounds)) {
+        std::sort(bounds_.begin(), bounds_.end());
+        std::size_t n = bounds_.size() + 1;  // last bucket is +Inf
+        for (auto& s : shards_)
+            s.reset(new Shard(n));
+    }
+
+    void observe(double v) {
+        // First bound >= v, matching Prometheus' `le` buckets.
+        std::size_t b = static_cast<std::size_t>(
+            std::upper_bound(bounds_.begin(), bounds_.end(), v, [](double x, double bound) {
+                return x <= bound;
+            }) - bounds_.begin());
+        Shard& s = *shards_[shard_index()];
+        s.buckets[b].fetch_add(1, std::memory_order_relaxed);
+        s.sum_fixed.fetch_add(static_cast<std::int64_t>(std::llround(v * kSumScale)),
+                              std::memory_order_relaxed);
+    }
+
+    const std::vector<double>& bounds() const { return bounds_; }
+
+    // Merged per-bucket counts (not cumulative); last entry is +Inf.
+    std::vector<std::uint64_t> bucket_counts() const {
+        std::vector<std::uint64_t> out(bounds_.size() + 1, 0);
+        for (const auto& s : shards_)
+            for (std::size_t i = 0; i < out.size(); ++i)
+                out[i] += s->buckets[i].load(std::memory_order_relaxed);
+        return out;
+    }
+
+    double sum() const {
+        std::int64_t total = 0;
+        for (const auto& s : shards_)
+            total += s->sum_fixed.load(std::memory_order_relaxed);
+        return static_cast<double>(total) / kSumScale;
+    }
+
+    /**
+     * @brief Quantile estimate by linear interpolation inside the bucket,
+     * the same way Prometheus' histogram_quantile() does it.
+     */
+    double quantile(double q) const {
+        auto counts = bucket_counts();
+        std::uint64_t total = 0;
+        for (auto c : counts) total += c;
+        if (total == 0) return 0.0;
+
+        double rank = q * static_cast<double>(total);
+        std::uint64_t cum = 0;
+        for (std::size_t i = 0; i < counts.size(); ++i) {
+            std::uint64_t prev = cum;
+            cum += counts[i];
+            if (static_cast<double>(cum) >= rank) {
+                if (i == bounds_.size())
+                    return bounds_.empty() ? 0.0 : bounds_.back();
+                double lo = (i == 0) ? 0.0 : bounds_[i - 1];
+                double hi = bounds_[i];
+                double frac = counts[i] ? (rank - static_cast<double>(prev)) / counts[i] : 0.0;
+                return lo + (hi - lo) * frac;
+            }
+        }
+        return bounds_.empty() ? 0.0 : bounds_.back();
+    }
+
+    // Exponential bounds: start, start*factor, ... (count of them).
+    static std::vector<double> exponential_bounds(double start, double factor, int count) {
+        std::vector<double> b;
+        double v = start;
+        for (int i = 0; i < count; ++i, v *= factor)
+            b.push_back(v);
+        return b;
+    }
+
+    static std::vector<double> linear_bounds(double start, double width, int count) {
+        std::vector<double> b;
+        for (int i = 0; i < count; ++i)
+            b.push_back(start + width * i);
+        return b;
+    }
+
+private:
+    static constexpr double kSumScale = 1e9;  // sums kept in nano-units
+
+    struct alignas(64) Shard {
+        std::unique_ptr<std::atomic<std::uint64_t>[]> buckets;
+        std::atomic<std::int64_t> sum_fixed{0};
+
+        explicit Shard(std::size_t n) : buckets(new std::atomic<std::uint64_t>[n]) {
+            for (std::size_t i = 0; i < n; ++i)
+                buckets[i].store(0, std::memory_order_relaxed);
+        }
+    };
+
+    std::vector<double> bounds_;
+    std::unique_ptr<Shard> shards_[kShards];
+};
+
+// =======================
+// Registry
+// =======================
+
+class Registry {
+public:
+    static Registry& instance() {
+        static Registry r;
+        return r;
+    }
+
+    // Registration takes a lock; call sites cache the returned reference.
+    Counter& counter(const std::string& name, const std::string& help) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Entry& e = entry(name, help, Type::Counter);
+        if (!e.counter) e.counter = std::make_unique<Counter>();
+        return *e.counter;
+    }
+
+    Gauge& gauge(const std::string& name, const std::string& help) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Entry& e = entry(name, help, Type::Gauge);
+        if (!e.gauge) e.gauge = std::make_unique<Gauge>();
+        return *e.gauge;
+    }
+
+    Histogram& histogram(const std::string& name, const std::string& help,
+                         std::vector<double> bounds) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Entry& e = entry(name, help, Type::Histogram);
+        if (!e.histogram) e.histogram = std::make_unique<Histogram>(std::move(bounds));
+        return *e.histogram;
+    }
+
+    /**
+     * @brief Merge all shards and format every metric in the Prometheus
+     * text exposition format (version 0.0.4).
+     */
+    std::string render_prometheus() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::string out;
+        char buf[128];
+        auto num = [&](double v) {
+            if (std::isinf(v)) return std::string(v > 0 ? "+Inf" : "-Inf");
+            std::snprintf(buf, sizeof(buf), "%.10g", v);
+            return std::string(buf);
+        };
+
+        for (const auto& kv : entries_) {
+            const std::string& name = kv.first;
+            const Entry& e = kv.second;
+            out += "# HELP " + name + " " + e.help + "\n";
+            switch (e.type) {
+            case Type::Counter:
+                out += "# TYPE " + name + " counter\n";
+                out += name + " " + std::to_string(e.counter->value()) + "\n";
+                break;
+            case Type::Gauge:
+                out += "# TYPE " + name + " gauge\n";
+                out += name + " " + num(e.gauge->value()) + "\n";
+                break;
+            case Type::Histogram: {
+                out += "# TYPE " + name + " histogram\n";
+                auto counts = e.histogram->bucket_counts();
+                const auto& bounds = e.histogram->bounds();
+                std::uint64_t cum = 0;
+                for (std::size_t i = 0; i < counts.size(); ++i) {
+                    cum += counts[i];
+                    std::string le = (i < bounds.size()) ? num(bounds[i]) : "+Inf";
+                    out += name + "_bucket{le=\"" + le + "\"} " + std::to_string(cum) + "\n";
+                }
+                out += name + "_sum " + num(e.histogram->sum()) + "\n";
+                out += name + "_count " + std::to_string(cum) + "\n";
+                break;
+            }
+            }
+        }
+        return out;
+    }
+
+private:
+    enum class Type { Counter, Gauge, Histogram };
+
+    struct Entry {
+        Type type;
+        std::string help;
+        std::unique_ptr<Counter> counter;
+        std::unique_ptr<Gauge> gauge;
+        std::unique_ptr<Histogram> histogram;
+    };
+
+    mutable std::mutex mutex_;
+    std::map<std::string, Entry> entries_;
+
+    Entry& entry(const std::string& name, const std::string& help, Type type) {
+        auto it = entries_.find(name);
+        if (it == entries_.end()) {
+            Entry e;
+            e.type = type;
+            e.help = help;
+            it = entries_.emplace(name, std::move(e)).first;
+        } else if (it->second.type != type) {
+            throw std::runtime_error("metric '" + name + "' already registered with another type");
+        }
+        return it->second;
+    }
+};
+
+inline Registry& registry() {
+    return Registry::instance();
+}
+
+// Latency buckets from 100 ns to ~1.6 ms, in seconds.
+inline std::vector<double> latency_bounds() {
+    return Histogram::exponential_bounds(100e-9, 2.0, 15);
+}
+
+// Small integer counts: 0, 1, 2, 4, ..., 1024.
+inline std::vector<double> count_bounds() {
+    std::vector<double> b{0.0};
+    for (double v : Histogram::exponential_bounds(1.0, 2.0, 11))
+        b.push_back(v);
+    return b;
+}
+
+inline std::uint64_t monotonic_ns() {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+constexpr bool enabled() {
+#ifdef QF_ENABLE_METRICS
+    return true;
+#else
+    return false;
+#endif
+}
+
+} // namespace metrics
+} // namespace qf
+
+// =======================
+// Module hooks
+// =======================
+
+#ifdef QF_ENABLE_METRICS
+
+#define QF_METRIC_INC(name, help)                                                  \
+    do {                                                                           \
+        static ::qf::metrics::Counter& qf_metric_c_ =                              \
+            ::qf::metrics::registry().counter(name, help);                         \
+        qf_metric_c_.inc();                                                        \
+    } while (0)
+
+#define QF_METRIC_ADD(name, help, n)                                               \
+    do {                                                                           \
+        static ::qf::metrics::Counter& qf_metric_c_ =                              \
+            ::qf::metrics::registry().counter(name, help);                         \
+        qf_metric_c_.inc(n);                                                       \
+    } while (0)
+
+#define QF_METRIC_OBSERVE(name, help, bounds, value)                               \
+    do {                                                                           \
+        static ::qf::metrics::Histogram& qf_metric_h_ =                            \
+            ::qf::metrics::registry().histogram(name, help, bounds);               \
+        qf_metric_h_.observe(value);                                               \
+    } while (0)
+
+// Start / stop a latency measurement around a block.
+#define QF_METRIC_TIMER_START(var) const std::uint64_t var = ::qf::metrics::monotonic_ns()
+#define QF_METRIC_TIMER_OBSERVE(var, name, help)                                   \
+    QF_METRIC_OBSERVE(name, help, ::qf::metrics::latency_bounds(),                 \
+                      1e-9 * static_cast<double>(::qf::metrics::monotonic_ns() - var))
+
+#else
+
+#define QF_METRIC_INC(name, help) ((void)0)
+#define QF_METRIC_ADD(name, help, n) ((void)0)
+#define QF_METRIC_OBSERVE(name, help, bounds, value) ((void)0)
+#define QF_METRIC_TIMER_START(var) ((void)0)
+#define QF_METRIC_TIMER_OBSERVE(var, name, help) ((void)0)
+
+#endif
+
+#endif // QF_METRICS_H
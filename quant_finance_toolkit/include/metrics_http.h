@@ -0,0 +1,190 @@
+#ifndef QF_METRICS_HTTP_H
+#define QF_METRICS_HTTP_H
+
+/**
+ * @file metrics_http.h
+ * @author John Jacobson
+ * @brief Minimal HTTP endpoint serving the metrics registry to Prometheus.
+ *
+ * One background thread accepts connections on 127.0.0.1 and answers
+ * GET /metrics with Registry::render_prometheus(). Everything else gets a
+ * 404. It is deliberately tiny: one request per connection, no keep-alive,
+ * no TLS. Scraping only reads the sharded counters, so the threads doing the
+ * real work are never blocked by it.
+ *
+ *     qf::metrics::MetricsServer server(9464);
+ *     server.start();
+ *     // ... curl http://127.0.0.1:9464/metrics
+ *
+ * POSIX only; on other platforms start() throws.
+ */
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define QF_HAVE_POSIX_SOCKETS 1
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+#endif
+
+#include "metrics.h"
+
+namespace qf {
+namespace metrics {
+
+class MetricsServer {
+public:
+    /**
+     * @param port Port to listen on (0 picks a free one, see port()).
+     * @param registry Registry to export.
+     */
+    explicit MetricsServer(std::uint16_t port = 9464, Registry& registry = metrics::registry())
+        : port_(port), registry_(registry) {}
+
+    ~MetricsServer() { stop(); }
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    /**
+     * @brief Bind to 127.0.0.1 and start serving. Throws std::runtime_error
+     * when the socket cannot be set up (e.g. the port is taken).
+     */
+    void start() {
+#ifdef QF_HAVE_POSIX_SOCKETS
+        if (running_.load())
+            return;
+
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0)
+            throw std::runtime_error(std::string("MetricsServer: socket: ") + std::strerror(errno));
+
+        int one = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+        sockaddr_in addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port_);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+            ::listen(fd, 16) < 0) {
+            std::string err = std::strerror(errno);
+            ::close(fd);
+            throw std::runtime_error("MetricsServer: cannot listen on port " +
+                                     std::to_string(port_) + ": " + err);
+        }
+
+        socklen_t len = sizeof(addr);
+        if (::getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len) == 0)
+            port_ = ntohs(addr.sin_port);
+
+        listen_fd_ = fd;
+        running_.store(true);
+        thread_ = std::thread([this] { serve(); });
+#else
+        throw std::runtime_error("MetricsServer: sockets are not supported on this platform");
+#endif
+    }
+
+    void stop() {
+        if (!running_.exchange(false))
+            return;
+        if (thread_.joinable())
+            thread_.join();
+#ifdef QF_HAVE_POSIX_SOCKETS
+        ::close(listen_fd_);
+        listen_fd_ = -1;
+#endif
+    }
+
+    bool running() const { return running_.load(); }
+
+    std::uint16_t port() const { return port_; }
+
+private:
+    std::uint16_t port_;
+    Registry& registry_;
+    std::atomic<bool> running_{false};
+    std::thread thread_;
+    int listen_fd_ = -1;
+
+#ifdef QF_HAVE_POSIX_SOCKETS
+    void serve() {
+        // Poll with a timeout so stop() is noticed without closing the
+        // socket from under the accept call.
+        while (running_.load()) {
+            pollfd p{listen_fd_, POLLIN, 0};
+            if (::poll(&p, 1, 100) <= 0)
+                continue;
+            int client = ::accept(listen_fd_, nullptr, nullptr);
+            if (client < 0)
+                continue;
+            handle(client);
+            ::close(client);
+        }
+    }
+
+    void handle(int client) {
+        // Read until the end of the request headers (or give up after a
+        // short wait; a scraper sends the whole request at once).
+        std::string request;
+        char buf[1024];
+        while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192) {
+            pollfd p{client, POLLIN, 0};
+            if (::poll(&p, 1, 1000) <= 0)
+                return;
+            ssize_t n = ::recv(client, buf, sizeof(buf), 0);
+            if (n <= 0)
+                return;
+            request.append(buf, static_cast<std::size_t>(n));
+        }
+
+        std::string line = request.substr(0, request.find("\r\n"));
+        bool is_get = line.compare(0, 4, "GET ") == 0;
+        std::string path = is_get ? line.substr(4, line.find(' ', 4) - 4) : std::string();
+
+        if (is_get && (path == "/metrics" || path.compare(0, 9, "/metrics?") == 0)) {
+            respond(client, "200 OK", "text/plain; version=0.0.4; charset=utf-8",
+                    registry_.render_prometheus());
+        } else if (!is_get) {
+            respond(client, "405 Method Not Allowed", "text/plain", "only GET is supported\n");
+        } else {
+            respond(client, "404 Not Found", "text/plain", "try /metrics\n");
+        }
+    }
+
+    static void respond(int client, const char* status, const char* type,
+                        const std::string& body) {
+        std::string out = std::string("HTTP/1.1 ") + status + "\r\n" +
+                          "Content-Type: " + type + "\r\n" +
+                          "Content-Length: " + std::to_string(body.size()) + "\r\n" +
+                          "Connection: close\r\n\r\n" + body;
+        std::size_t sent = 0;
+        while (sent < out.size()) {
+            ssize_t n = ::send(client, out.data() + sent, out.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0)
+                return;
+            sent += static_cast<std::size_t>(n);
+        }
+    }
+#endif
+};
+
+} // namespace metrics
+} // namespace qf
+
+#endif // QF_METRICS_HTTP_H
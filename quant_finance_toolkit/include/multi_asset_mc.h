@@ -0,0 +1,777 @@
+#ifndef QF_MULTI_ASSET_MC_H
+#define QF_MULTI_ASSET_MC_H
+
+/**
+ * @file multi_asset_mc.h
+ * @author John Jacobson
+ * @brief Correlated multi-asset Monte Carlo with closed-form approximations
+ *        for basket, spread and worst-of options.
+ *
+ * Baskets, spreads and worst-of notes depend on the joint distribution of
+ * several correlated lognormal assets. This module has three layers:
+ *
+ *   - CorrelationFactor: a factor matrix L with L Lᵀ = correlation,
+ *     computed once per matrix by Cholesky, or by PCA (Jacobi eigensolve)
+ *     when the matrix is not positive definite or should be truncated to
+ *     a few factors.
+ *   - CorrelatedPathGenerator: fills blocks of GBM paths. Values are laid
+ *     out [step][asset][path], so every inner loop (factor loadings, drift,
+ *     payoff reductions across assets) runs over contiguous paths.
+ *   - mc_price(): a block-parallel estimator with antithetic pairs and an
+ *     optional control variate, on top of parallel_reduce(). Blocks are
+ *     seeded from (seed, block index), so results do not depend on the
+ *     number of threads.
+ *
+ * Closed forms give fast prices and exact control means:
+ *
+ *   - Kirk (1995) for spread options and Margrabe (1978) for exchange
+ *     options (a spread with K = 0).
+ *   - Lévy (1992) moment matching for arithmetic baskets: the basket is
+ *     replaced by a lognormal with the same first two moments.
+ *   - The geometric basket, which is exactly lognormal.
+ *
+ * Kirk and Lévy are approximations, so their prices are not exact
+ * expectations of any simulated payoff. The control variates are therefore
+ * the exact ones: the geometric basket for baskets and worst-ofs, and
+ * Margrabe for spreads. The geometric basket needs positive weights, so a
+ * long/short basket is priced without a control variate.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "metrics.h"
+#include "options_greeks.h"
+#include "thread_pool.h"
+#include "trace.h"
+
+namespace qf {
+
+// =======================
+// Correlation factorization
+// =======================
+
+/**
+ * Factor loadings L (assets × factors, row-major) with L Lᵀ equal to the
+ * correlation matrix, or to its nearest positive semidefinite truncation
+ * for pca().
+ */
+class CorrelationFactor {
+public:
+    /**
+     * @brief Cholesky factor of a row-major n × n correlation matrix.
+     * Throws if the matrix is not symmetric with a unit diagonal, or not
+     * positive definite (use pca() for those).
+     */
+    static CorrelationFactor cholesky(const std::vector<double>& corr, std::size_t n) {
+        validate(corr, n);
+        CorrelationFactor f(n, n);
+        std::vector<double>& L = f.L_;
+        for (std::size_t j = 0; j < n; ++j) {
+            double d = corr[j * n + j];
+            for (std::size_t k = 0; k < j; ++k)
+                d -= L[j * n + k] * L[j * n + k];
+            if (!(d > 1e-14))
+                throw std::runtime_error(
+                    "CorrelationFactor::cholesky: matrix is not positive definite");
+            const double ljj = std::sqrt(d);
+            L[j * n + j] = ljj;
+            for (std::size_t i = j + 1; i < n; ++i) {
+                double s = corr[i * n + j];
+                for (std::size_t k = 0; k < j; ++k)
+                    s -= L[i * n + k] * L[j * n + k];
+                L[i * n + j] = s / ljj;
+            }
+        }
+        return f;
+    }
+
+    /**
+     * @brief Principal-component factor with the `factors` largest
+     * eigenvalues (0 keeps all of them). Negative eigenvalues are dropped
+     * and each row is rescaled to unit length, so the implied correlation
+     * keeps a unit diagonal.
+     */
+    static CorrelationFactor pca(const std::vector<double>& corr, std::size_t n,
+                                 std::size_t factors = 0) {
+        validate(corr, n);
+        if (factors == 0 || factors > n)
+            factors = n;
+
+        std::vector<double> values, vectors;
+        jacobi_eigen(corr, n, values, vectors);
+
+        std::vector<std::size_t> order(n);
+        for (std::size_t i = 0; i < n; ++i)
+            order[i] = i;
+        std::sort(order.begin(), order.end(),
+                  [&](std::size_t a, std::size_t b) { return values[a] > values[b]; });
+
+        CorrelationFactor f(n, factors);
+        for (std::size_t c = 0; c < factors; ++c) {
+            const double s = std::sqrt(std::max(values[order[c]], 0.0));
+            for (std::size_t i = 0; i < n; ++i)
+                f.L_[i * factors + c] = vectors[i * n + order[c]] * s;
+        }
+        for (std::size_t i = 0; i < n; ++i) {
+            double norm = 0.0;
+            for (std::size_t c = 0; c < factors; ++c)
+                norm += f.L_[i * factors + c] * f.L_[i * factors + c];
+            if (!(norm > 0.0))
+                throw std::runtime_error("CorrelationFactor::pca: asset has no factor loading");
+            const double inv = 1.0 / std::sqrt(norm);
+            for (std::size_t c = 0; c < factors; ++c)
+                f.L_[i * factors + c] *= inv;
+        }
+        return f;
+    }
+
+    std::size_t assets() const { return n_; }
+    std::size_t factors() const { return k_; }
+    double loading(std::size_t asset, std::size_t factor) const { return L_[asset * k_ + factor]; }
+
+    // Correlation implied by the factor, (L Lᵀ)_ij.
+    double correlation(std::size_t i, std::size_t j) const {
+        double s = 0.0;
+        for (std::size_t c = 0; c < k_; ++c)
+            s += L_[i * k_ + c] * L_[j * k_ + c];
+        return s;
+    }
+
+    /**
+     * @brief Correlated normals for a block: out[a · m + p] =
+     * Σ_f L[a][f] · z[f · m + p] for p < m. The loop over p is contiguous.
+     */
+    void correlate(const double* z, std::size_t m, double* out) const {
+        for (std::size_t a = 0; a < n_; ++a) {
+            double* row = out + a * m;
+            std::fill(row, row + m, 0.0);
+            // Cholesky rows are zero past the diagonal.
+            for (std::size_t c = 0; c < k_; ++c) {
+                const double l = L_[a * k_ + c];
+                if (l == 0.0)
+                    continue;
+                const double* zc = z + c * m;
+                for (std::size_t p = 0; p < m; ++p)
+                    row[p] += l * zc[p];
+            }
+        }
+    }
+
+private:
+    std::size_t n_ = 0, k_ = 0;
+    std::vector<double> L_;
+
+    CorrelationFactor(std::size_t n, std::size_t k) : n_(n), k_(k), L_(n * k, 0.0) {}
+
+    static void validate(const std::vector<double>& corr, std::size_t n) {
+        if (n == 0 || corr.size() != n * n)
+            throw std::runtime_error("CorrelationFactor: matrix must be n x n with n > 0");
+        for (std::size_t i = 0; i < n; ++i) {
+            if (std::fabs(corr[i * n + i] - 1.0) > 1e-12)
+                throw std::runtime_error("CorrelationFactor: diagonal must be 1");
+            for (std::size_t j = 0; j < i; ++j)
+                if (std::fabs(corr[i * n + j] - corr[j * n + i]) > 1e-12 ||
+                    std::fabs(corr[i * n + j]) > 1.0)
+                    throw std::runtime_error(
+                        "CorrelationFactor: matrix must be symmetric with entries in [-1, 1]");
+        }
+    }
+
+    // Cyclic Jacobi eigen-decomposition; eigenvectors are the columns of
+    // `vectors` (row-major n × n).
+    static void jacobi_eigen(const std::vector<double>& m, std::size_t n,
+                             std::vector<double>& values, std::vector<double>& vectors) {
+        std::vector<double> a = m;
+        vectors.assign(n * n, 0.0);
+        for (std::size_t i = 0; i < n; ++i)
+            vectors[i * n + i] = 1.0;
+
+        for (int sweep = 0; sweep < 100; ++sweep) {
+            double off = 0.0;
+            for (std::size_t i = 0; i < n; ++i)
+                for (std::size_t j = i + 1; j < n; ++j)
+                    off += a[i * n + j] * a[i * n + j];
+            if (off < 1e-30)
+                break;
+
+            for (std::size_t p = 0; p < n; ++p) {
+                for (std::size_t q = p + 1; q < n; ++q) {
+                    const double apq = a[p * n + q];
+                    if (std::fabs(apq) < 1e-300)
+                        continue;
+                    const double theta = (a[q * n + q] - a[p * n + p]) / (2.0 * apq);
+                    const double t = (theta >= 0.0 ? 1.0 : -1.0) /
+                                     (std::fabs(theta) + std::sqrt(theta * theta + 1.0));
+                    const double c = 1.0 / std::sqrt(t * t + 1.0), s = t * c;
+                    for (std::size_t k = 0; k < n; ++k) {
+                        const double akp = a[k * n + p], akq = a[k * n + q];
+                        a[k * n + p] = c * akp - s * akq;
+                        a[k * n + q] = s * akp + c * akq;
+                    }
+                    for (std::size_t k = 0; k < n; ++k) {
+                        const double apk = a[p * n + k], aqk = a[q * n + k];
+                        a[p * n + k] = c * apk - s * aqk;
+                        a[q * n + k] = s * apk + c * aqk;
+                    }
+                    for (std::size_t k = 0; k < n; ++k) {
+                        const double vkp = vectors[k * n + p], vkq = vectors[k * n + q];
+                        vectors[k * n + p] = c * vkp - s * vkq;
+                        vectors[k * n + q] = s * vkp + c * vkq;
+                    }
+                }
+            }
+        }
+        values.resize(n);
+        for (std::size_t i = 0; i < n; ++i)
+            values[i] = a[i * n + i];
+    }
+};
+
+// =======================
+// Market and paths
+// =======================
+
+// Lognormal assets with constant vols and continuous dividend yields.
+struct MultiAssetMarket {
+    std::vector<double> spot, vol, dividend_yield;
+    double rate = 0.0;
+
+    std::size_t assets() const { return spot.size(); }
+    double forward(std::size_t i, double T) const {
+        return spot[i] * std::exp((rate - dividend_yield[i]) * T);
+    }
+};
+
+/**
+ * One block of simulated paths: asset a at step s (s = 1..steps, step
+ * `steps` being maturity) for path p is at data[((s − 1) · assets + a) ·
+ * paths + p].
+ */
+struct PathBlock {
+    std::size_t paths = 0, assets = 0, steps = 0;
+    double dt = 0.0;
+    const double* data = nullptr;
+    const double* spot = nullptr;  // initial values, one per asset
+
+    const double* row(std::size_t step, std::size_t asset) const {
+        return data + ((step - 1) * assets + asset) * paths;
+    }
+    const double* terminal(std::size_t asset) const { return row(steps, asset); }
+    double value(std::size_t step, std::size_t asset, std::size_t p) const {
+        return step == 0 ? spot[asset] : row(step, asset)[p];
+    }
+};
+
+namespace detail {
+
+inline std::uint64_t splitmix64(std::uint64_t& x) {
+    std::uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// xoshiro256+ (Blackman & Vigna), seeded through splitmix64.
+class Xoshiro256 {
+public:
+    Xoshiro256(std::uint64_t seed, std::uint64_t stream) {
+        std::uint64_t x = seed ^ (stream * 0xD1B54A32D192ED03ull);
+        for (auto& w : s_)
+            w = splitmix64(x);
+    }
+
+    std::uint64_t next() {
+        const std::uint64_t result = s_[0] + s_[3];
+        const std::uint64_t t = s_[1] << 17;
+        s_[2] ^= s_[0];
+        s_[3] ^= s_[1];
+        s_[1] ^= s_[2];
+        s_[0] ^= s_[3];
+        s_[2] ^= t;
+        s_[3] = (s_[3] << 45) | (s_[3] >> 19);
+        return result;
+    }
+
+    // Uniform in (0, 1].
+    double uniform() { return static_cast<double>((next() >> 11) + 1) * 0x1.0p-53; }
+
+private:
+    std::uint64_t s_[4];
+};
+
+// Standard normals by Box–Muller, two per pair of uniforms.
+inline void fill_normals(Xoshiro256& rng, double* out, std::size_t n) {
+    constexpr double two_pi = 6.283185307179586476925;
+    std::size_t i = 0;
+    for (; i + 1 < n; i += 2) {
+        const double r = std::sqrt(-2.0 * std::log(rng.uniform()));
+        const double a = two_pi * rng.uniform();
+        out[i] = r * std::cos(a);
+        out[i + 1] = r * std::sin(a);
+    }
+    if (i < n)
+        out[i] = std::sqrt(-2.0 * std::log(rng.uniform())) * std::cos(two_pi * rng.uniform());
+}
+
+} // namespace detail
+
+// Per-thread buffers for CorrelatedPathGenerator::generate().
+struct PathWorkspace {
+    std::vector<double> z, x, paths;
+};
+
+/**
+ * @brief GBM paths for every asset of a market on a uniform time grid,
+ * correlated through a CorrelationFactor.
+ *
+ * With `antithetic`, the second half of each block reuses the first half's
+ * normals with the sign flipped, so path p and p + paths / 2 are a pair.
+ */
+class CorrelatedPathGenerator {
+public:
+    CorrelatedPathGenerator(const MultiAssetMarket& market, const CorrelationFactor& factor,
+                            double maturity, std::size_t steps = 1, std::size_t block = 512,
+                            bool antithetic = true)
+        : market_(market), factor_(factor), T_(maturity), steps_(steps),
+          block_(antithetic ? block + block % 2 : block), antithetic_(antithetic) {
+        const std::size_t n = market.assets();
+        if (n == 0 || factor.assets() != n || market.vol.size() != n ||
+            market.dividend_yield.size() != n)
+            throw std::runtime_error("CorrelatedPathGenerator: market and factor sizes differ");
+        if (!(maturity > 0.0) || steps == 0 || block == 0)
+            throw std::runtime_error("CorrelatedPathGenerator: need T > 0, steps > 0, block > 0");
+
+        dt_ = T_ / static_cast<double>(steps_);
+        drift_.resize(n);
+        diffusion_.resize(n);
+        log_spot_.resize(n);
+        for (std::size_t a = 0; a < n; ++a) {
+            const double s = market.vol[a];
+            drift_[a] = (market.rate - market.dividend_yield[a] - 0.5 * s * s) * dt_;
+            diffusion_[a] = s * std::sqrt(dt_);
+            log_spot_[a] = std::log(market.spot[a]);
+        }
+    }
+
+    std::size_t block_size() const { return block_; }
+    std::size_t steps() const { return steps_; }
+    double maturity() const { return T_; }
+    bool antithetic() const { return antithetic_; }
+    const MultiAssetMarket& market() const { return market_; }
+    const CorrelationFactor& factor() const { return factor_; }
+    double discount_factor() const { return std::exp(-market_.rate * T_); }
+
+    /**
+     * @brief Fills `ws` with block number `index` of the stream `seed` and
+     * returns a view of it. The same (seed, index) always gives the same
+     * paths.
+     */
+    PathBlock generate(std::uint64_t seed, std::uint64_t index, PathWorkspace& ws) const {
+        const std::size_t n = market_.assets(), k = factor_.factors(), m = block_;
+        const std::size_t half = antithetic_ ? m / 2 : m;
+        ws.z.resize(k * half);
+        ws.x.resize(n * half);
+        ws.paths.resize(steps_ * n * m);
+
+        detail::Xoshiro256 rng(seed, index);
+        for (std::size_t s = 0; s < steps_; ++s) {
+            detail::fill_normals(rng, ws.z.data(), k * half);
+            factor_.correlate(ws.z.data(), half, ws.x.data());
+
+            for (std::size_t a = 0; a < n; ++a) {
+                const double* x = ws.x.data() + a * half;
+                double* out = ws.paths.data() + (s * n + a) * m;
+                const double* prev = s == 0 ? nullptr : out - n * m;
+                const double mu = drift_[a], vol = diffusion_[a];
+
+                // Log increments first (vectorizable), then one exp each.
+                for (std::size_t p = 0; p < half; ++p)
+                    out[p] = mu + vol * x[p];
+                if (antithetic_)
+                    for (std::size_t p = 0; p < half; ++p)
+                        out[half + p] = mu - vol * x[p];
+                if (prev) {
+                    for (std::size_t p = 0; p < m; ++p)
+                        out[p] = prev[p] * std::exp(out[p]);
+                } else {
+                    for (std::size_t p = 0; p < m; ++p)
+                        out[p] = std::exp(log_spot_[a] + out[p]);
+                }
+            }
+        }
+
+        PathBlock b;
+        b.paths = m;
+        b.assets = n;
+        b.steps = steps_;
+        b.dt = dt_;
+        b.data = ws.paths.data();
+        b.spot = market_.spot.data();
+        return b;
+    }
+
+private:
+    MultiAssetMarket market_;
+    CorrelationFactor factor_;
+    double T_, dt_ = 0.0;
+    std::size_t steps_, block_;
+    bool antithetic_;
+    std::vector<double> drift_, diffusion_, log_spot_;
+};
+
+// =======================
+// Estimator
+// =======================
+
+struct McConfig {
+    std::size_t paths = 1u << 16;     // rounded up to whole blocks
+    std::uint64_t seed = 42;
+    std::size_t blocks_per_task = 8;  // parallel_reduce grain
+};
+
+struct McResult {
+    double price = 0.0;
+    double std_error = 0.0;
+    double raw_price = 0.0;       // without the control variate
+    double raw_std_error = 0.0;
+    double beta = 0.0;            // control variate coefficient
+    std::size_t paths = 0;
+};
+
+namespace detail {
+
+// Sample moments of (y, x) pairs, merged across blocks.
+struct McMoments {
+    double n = 0.0, sy = 0.0, syy = 0.0, sx = 0.0, sxx = 0.0, sxy = 0.0;
+
+    McMoments& operator+=(const McMoments& o) {
+        n += o.n;
+        sy += o.sy;
+        syy += o.syy;
+        sx += o.sx;
+        sxx += o.sxx;
+        sxy += o.sxy;
+        return *this;
+    }
+};
+
+} // namespace detail
+
+/**
+ * @brief Monte Carlo price with a control variate.
+ *
+ * `payoff` and `control` are called as f(const PathBlock&, double* out)
+ * and write one undiscounted payoff per path of the block. `control_mean`
+ * is the exact discounted price of the control. Antithetic pairs are
+ * averaged before the statistics, so the standard errors are valid with
+ * them on.
+ *
+ * Any generator with the interface of CorrelatedPathGenerator works
+ * (block_size(), antithetic(), discount_factor() and generate()), e.g.
+ * SlvPathGenerator from slv_calibration.h.
+ */
+template <typename Generator, typename Payoff, typename Control>
+McResult mc_price(const Generator& gen, Payoff&& payoff, Control&& control,
+                  double control_mean, const McConfig& cfg = {}) {
+    QF_TRACE_SCOPE_CAT("mc_price", "multi_asset_mc");
+    const std::size_t m = gen.block_size();
+    const std::size_t blocks = std::max<std::size_t>(1, (cfg.paths + m - 1) / m);
+    const double D = gen.discount_factor();
+
+    auto map = [&](std::size_t lo, std::size_t hi) {
+        PathWorkspace ws;
+        std::vector<double> y(m), x(m);
+        detail::McMoments acc;
+        for (std::size_t b = lo; b < hi; ++b) {
+            PathBlock block = gen.generate(cfg.seed, b, ws);
+            payoff(static_cast<const PathBlock&>(block), y.data());
+            control(static_cast<const PathBlock&>(block), x.data());
+
+            const std::size_t samples = gen.antithetic() ? m / 2 : m;
+            for (std::size_t p = 0; p < samples; ++p) {
+                double yi = y[p], xi = x[p];
+                if (gen.antithetic()) {
+                    yi = 0.5 * (yi + y[p + samples]);
+                    xi = 0.5 * (xi + x[p + samples]);
+                }
+                acc.sy += yi;
+                acc.syy += yi * yi;
+                acc.sx += xi;
+                acc.sxx += xi * xi;
+                acc.sxy += xi * yi;
+            }
+            acc.n += static_cast<double>(samples);
+        }
+        return acc;
+    };
+    auto combine = [](detail::McMoments a, const detail::McMoments& b) { return a += b; };
+    detail::McMoments s = parallel_reduce(default_thread_pool(), 0, blocks,
+                                          std::max<std::size_t>(cfg.blocks_per_task, 1),
+                                          detail::McMoments{}, map, combine);
+
+    const double n = s.n;
+    const double my = s.sy / n, mx = s.sx / n;
+    const double vy = std::max(s.syy / n - my * my, 0.0) * n / std::max(n - 1.0, 1.0);
+    const double vx = std::max(s.sxx / n - mx * mx, 0.0) * n / std::max(n - 1.0, 1.0);
+    const double cxy = (s.sxy / n - mx * my) * n / std::max(n - 1.0, 1.0);
+
+    McResult r;
+    r.paths = blocks * m;
+    r.raw_price = D * my;
+    r.raw_std_error = D * std::sqrt(vy / n);
+    r.beta = vx > 0.0 ? cxy / vx : 0.0;
+    r.price = D * (my - r.beta * (mx - control_mean / D));
+    r.std_error = D * std::sqrt(std::max(vy - r.beta * cxy, 0.0) / n);
+
+    QF_METRIC_ADD("qf_mc_paths_total", "Monte Carlo paths simulated", r.paths);
+    return r;
+}
+
+// Plain Monte Carlo price, no control variate.
+template <typename Generator, typename Payoff>
+McResult mc_price(const Generator& gen, Payoff&& payoff, const McConfig& cfg = {}) {
+    McResult r = mc_price(
+        gen, std::forward<Payoff>(payoff),
+        [](const PathBlock& b, double* out) { std::fill(out, out + b.paths, 0.0); }, 0.0, cfg);
+    r.price = r.raw_price;
+    r.std_error = r.raw_std_error;
+    return r;
+}
+
+// =======================
+// Closed forms
+// =======================
+
+namespace detail {
+
+// Black formula on a forward, discounted with D.
+inline double black_price(bool is_call, double F, double K, double s, double D) {
+    if (!(s > 0.0) || !(K > 0.0))
+        return D * std::max(is_call ? F - K : K - F, 0.0);
+    const double d1 = (std::log(F / K) + 0.5 * s * s) / s, d2 = d1 - s;
+    return is_call ? D * (F * norm_cdf(d1) - K * norm_cdf(d2))
+                   : D * (K * norm_cdf(-d2) - F * norm_cdf(-d1));
+}
+
+} // namespace detail
+
+/**
+ * @brief Kirk's approximation for an option on S1 − S2 with strike K:
+ * S2 + K is treated as lognormal, so the option becomes an exchange option.
+ * Exact for K = 0 (Margrabe).
+ */
+inline double kirk_spread_option(bool is_call, double S1, double S2, double K, double T,
+                                 double r, double q1, double q2, double sigma1, double sigma2,
+                                 double rho) {
+    const double D = std::exp(-r * T);
+    const double F1 = S1 * std::exp((r - q1) * T), F2 = S2 * std::exp((r - q2) * T);
+    const double a = F2 + K;
+    if (!(a > 0.0))
+        throw std::runtime_error("kirk_spread_option: needs F2 + K > 0");
+    const double w = F2 / a;
+    const double var = sigma1 * sigma1 - 2.0 * rho * sigma1 * sigma2 * w +
+                       sigma2 * sigma2 * w * w;
+    const double call = detail::black_price(true, F1, a, std::sqrt(std::max(var, 0.0) * T), D);
+    return is_call ? call : call - D * (F1 - F2 - K);
+}
+
+// Margrabe: exchange option paying max(S1 − S2, 0).
+inline double margrabe_exchange(double S1, double S2, double T, double r, double q1, double q2,
+                                double sigma1, double sigma2, double rho) {
+    return kirk_spread_option(true, S1, S2, 0.0, T, r, q1, q2, sigma1, sigma2, rho);
+}
+
+/**
+ * @brief Exact price of an option on the weighted geometric basket
+ * W · Π S_i^{w_i / W}, W = Σ w_i (weights must be positive). It is
+ * lognormal, which makes it the control variate for arithmetic baskets.
+ */
+inline double geometric_basket_option(bool is_call, const MultiAssetMarket& mkt,
+                                      const CorrelationFactor& corr,
+                                      const std::vector<double>& weights, double K, double T) {
+    const std::size_t n = mkt.assets();
+    if (weights.size() != n)
+        throw std::runtime_error("geometric_basket_option: one weight per asset");
+    double W = 0.0;
+    for (double w : weights) {
+        if (!(w > 0.0))
+            throw std::runtime_error("geometric_basket_option: weights must be positive");
+        W += w;
+    }
+
+    double mean = 0.0, var = 0.0;
+    for (std::size_t i = 0; i < n; ++i) {
+        const double wi = weights[i] / W, si = mkt.vol[i];
+        mean += wi * (std::log(mkt.spot[i]) +
+                      (mkt.rate - mkt.dividend_yield[i] - 0.5 * si * si) * T);
+        for (std::size_t j = 0; j < n; ++j)
+            var += wi * (weights[j] / W) * corr.correlation(i, j) * si * mkt.vol[j];
+    }
+    var *= T;
+    const double F = std::exp(mean + 0.5 * var);
+    return W * detail::black_price(is_call, F, K / W, std::sqrt(var), std::exp(-mkt.rate * T));
+}
+
+/**
+ * @brief Lévy's moment-matching approximation for an option on the
+ * arithmetic basket Σ w_i S_i(T) (weights must be non-negative).
+ */
+inline double levy_basket_option(bool is_call, const MultiAssetMarket& mkt,
+                                 const CorrelationFactor& corr,
+                                 const std::vector<double>& weights, double K, double T) {
+    const std::size_t n = mkt.assets();
+    if (weights.size() != n)
+        throw std::runtime_error("levy_basket_option: one weight per asset");
+    std::vector<double> wf(n);
+    double m1 = 0.0;
+    for (std::size_t i = 0; i < n; ++i) {
+        if (weights[i] < 0.0)
+            throw std::runtime_error("levy_basket_option: weights must be non-negative");
+        wf[i] = weights[i] * mkt.forward(i, T);
+        m1 += wf[i];
+    }
+    double m2 = 0.0;
+    for (std::size_t i = 0; i < n; ++i)
+        for (std::size_t j = 0; j < n; ++j)
+            m2 += wf[i] * wf[j] * std::exp(corr.correlation(i, j) * mkt.vol[i] * mkt.vol[j] * T);
+    const double s = std::sqrt(std::max(std::log(m2 / (m1 * m1)), 0.0));
+    return detail::black_price(is_call, m1, K, s, std::exp(-mkt.rate * T));
+}
+
+// =======================
+// Products
+// =======================
+
+/**
+ * @brief Option on the arithmetic basket Σ w_i S_i(T), controlled by the
+ * geometric basket with the same weights. That control only exists when
+ * every weight is positive; with a zero or negative weight the plain
+ * antithetic estimator is used.
+ */
+inline McResult basket_option_mc(bool is_call, const MultiAssetMarket& mkt,
+                                 const CorrelationFactor& corr,
+                                 const std::vector<double>& weights, double K, double T,
+                                 const McConfig& cfg = {}) {
+    const std::size_t n = mkt.assets();
+    if (weights.size() != n)
+        throw std::runtime_error("basket_option_mc: one weight per asset");
+    CorrelatedPathGenerator gen(mkt, corr, T);
+    double W = 0.0;
+    for (double w : weights)
+        W += w;
+    const double sign = is_call ? 1.0 : -1.0;
+
+    auto payoff = [&](const PathBlock& b, double* out) {
+        std::fill(out, out + b.paths, 0.0);
+        for (std::size_t a = 0; a < n; ++a) {
+            const double* s = b.terminal(a);
+            for (std::size_t p = 0; p < b.paths; ++p)
+                out[p] += weights[a] * s[p];
+        }
+        for (std::size_t p = 0; p < b.paths; ++p)
+            out[p] = std::max(sign * (out[p] - K), 0.0);
+    };
+    if (!std::all_of(weights.begin(), weights.end(), [](double w) { return w > 0.0; }))
+        return mc_price(gen, payoff, cfg);
+
+    const double control_mean = geometric_basket_option(is_call, mkt, corr, weights, K, T);
+    auto control = [&](const PathBlock& b, double* out) {
+        std::fill(out, out + b.paths, 0.0);
+        for (std::size_t a = 0; a < n; ++a) {
+            const double* s = b.terminal(a);
+            const double w = weights[a] / W;
+            for (std::size_t p = 0; p < b.paths; ++p)
+                out[p] += w * std::log(s[p]);
+        }
+        for (std::size_t p = 0; p < b.paths; ++p)
+            out[p] = std::max(sign * (W * std::exp(out[p]) - K), 0.0);
+    };
+    return mc_price(gen, payoff, control, control_mean, cfg);
+}
+
+/**
+ * @brief Option on S_0(T) − S_1(T) − K (the first two assets of the
+ * market), controlled by the Margrabe exchange option.
+ */
+inline McResult spread_option_mc(bool is_call, const MultiAssetMarket& mkt,
+                                 const CorrelationFactor& corr, double K, double T,
+                                 const McConfig& cfg = {}) {
+    if (mkt.assets() < 2)
+        throw std::runtime_error("spread_option_mc: needs two assets");
+    const double rho = corr.correlation(0, 1);
+    double control_mean = margrabe_exchange(mkt.spot[0], mkt.spot[1], T, mkt.rate,
+                                            mkt.dividend_yield[0], mkt.dividend_yield[1],
+                                            mkt.vol[0], mkt.vol[1], rho);
+    // A put on the spread is controlled by the exchange option the other way round.
+    if (!is_call)
+        control_mean = margrabe_exchange(mkt.spot[1], mkt.spot[0], T, mkt.rate,
+                                         mkt.dividend_yield[1], mkt.dividend_yield[0],
+                                         mkt.vol[1], mkt.vol[0], rho);
+    CorrelatedPathGenerator gen(mkt, corr, T);
+    const double sign = is_call ? 1.0 : -1.0;
+
+    auto payoff = [&](const PathBlock& b, double* out) {
+        const double *s1 = b.terminal(0), *s2 = b.terminal(1);
+        for (std::size_t p = 0; p < b.paths; ++p)
+            out[p] = std::max(sign * (s1[p] - s2[p] - K), 0.0);
+    };
+    auto control = [&](const PathBlock& b, double* out) {
+        const double *s1 = b.terminal(0), *s2 = b.terminal(1);
+        for (std::size_t p = 0; p < b.paths; ++p)
+            out[p] = std::max(sign * (s1[p] - s2[p]), 0.0);
+    };
+    return mc_price(gen, payoff, control, control_mean, cfg);
+}
+
+/**
+ * @brief Option on the worst performance min_i S_i(T) / S_i(0) with
+ * strike K (e.g. K = 1 for an at-the-money worst-of put), controlled by
+ * the equally weighted geometric basket of performances.
+ */
+inline McResult worst_of_option_mc(bool is_call, const MultiAssetMarket& mkt,
+                                   const CorrelationFactor& corr, double K, double T,
+                                   const McConfig& cfg = {}) {
+    const std::size_t n = mkt.assets();
+    MultiAssetMarket perf = mkt;
+    perf.spot.assign(n, 1.0);
+    const std::vector<double> equal(n, 1.0 / static_cast<double>(n));
+    const double control_mean = geometric_basket_option(is_call, perf, corr, equal, K, T);
+    CorrelatedPathGenerator gen(mkt, corr, T);
+    const double sign = is_call ? 1.0 : -1.0;
+    std::vector<double> inv_spot(n);
+    for (std::size_t a = 0; a < n; ++a)
+        inv_spot[a] = 1.0 / mkt.spot[a];
+
+    auto payoff = [&](const PathBlock& b, double* out) {
+        std::fill(out, out + b.paths, std::numeric_limits<double>::infinity());
+        for (std::size_t a = 0; a < n; ++a) {
+            const double* s = b.terminal(a);
+            for (std::size_t p = 0; p < b.paths; ++p)
+                out[p] = std::min(out[p], s[p] * inv_spot[a]);
+        }
+        for (std::size_t p = 0; p < b.paths; ++p)
+            out[p] = std::max(sign * (out[p] - K), 0.0);
+    };
+    auto control = [&](const PathBlock& b, double* out) {
+        std::fill(out, out + b.paths, 0.0);
+        for (std::size_t a = 0; a < n; ++a) {
+            const double* s = b.terminal(a);
+            for (std::size_t p = 0; p < b.paths; ++p)
+                out[p] += equal[a] * std::log(s[p] * inv_spot[a]);
+        }
+        for (std::size_t p = 0; p < b.paths; ++p)
+            out[p] = std::max(sign * (std::exp(out[p]) - K), 0.0);
+    };
+    return mc_price(gen, payoff, control, control_mean, cfg);
+}
+
+} // namespace qf
+
+#endif // QF_MULTI_ASSET_MC_H
@@ -0,0 +1,460 @@
+#ifndef QF_NUMA_PLACEMENT_H
+#define QF_NUMA_PLACEMENT_H
+
+/**
+ * @file numa_placement.h
+ * @author John Jacobson
+ * @brief NUMA topology, node-aware arenas and worker thread placement.
+ *
+ * On a dual-socket machine, a worker that matches a book shard or revalues
+ * a position slice living on the other socket pays remote-memory latency
+ * on every access. This module keeps each worker's data on its own node:
+ *
+ *   - NumaTopology reads the node -> CPU map from sysfs (no libnuma needed)
+ *     and falls back to a single node when sysfs is not there.
+ *   - thread_placement_cpus() orders CPUs for ThreadPoolOptions::cpus, either
+ *     compact (fill one node first) or scatter (round-robin over nodes).
+ *   - NumaArena is a monotonic std::pmr::memory_resource whose pages are
+ *     placed by a MemoryPolicy (local node, interleaved, bound, or plain
+ *     first touch) and pre-faulted on creation.
+ *   - WorkerArenas gives every pool slot (calling thread + workers) its own
+ *     arena on that worker's node, for book shards, position slices and
+ *     scratch buffers.
+ *
+ * Placement uses the mbind(2) system call directly. If the kernel or
+ * container refuses it, the arena still works and falls back to first-touch
+ * placement by the thread that creates it.
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "thread_pool.h"
+
+namespace qf {
+
+// =======================
+// Topology
+// =======================
+
+class NumaTopology {
+public:
+    NumaTopology() { discover(); }
+
+    std::size_t num_nodes() const { return node_cpus_.size(); }
+
+    const std::vector<int>& cpus_of(int node) const {
+        return node_cpus_[static_cast<std::size_t>(node)];
+    }
+
+    // NUMA node of a CPU (0 when unknown).
+    int node_of_cpu(int cpu) const {
+        if (cpu < 0 || static_cast<std::size_t>(cpu) >= cpu_node_.size())
+            return 0;
+        return cpu_node_[static_cast<std::size_t>(cpu)];
+    }
+
+    // Node the calling thread is currently running on.
+    int current_node() const {
+#if defined(__linux__)
+        return node_of_cpu(sched_getcpu());
+#else
+        return 0;
+#endif
+    }
+
+    // Parse a sysfs CPU or node list such as "0-3,8,10-11".
+    static std::vector<int> parse_cpu_list(const std::string& text) {
+        std::vector<int> cpus;
+        std::stringstream ss(text);
+        std::string part;
+        while (std::getline(ss, part, ',')) {
+            if (part.empty() || part == "\n") continue;
+            std::size_t dash = part.find('-');
+            try {
+                if (dash == std::string::npos) {
+                    cpus.push_back(std::stoi(part));
+                } else {
+                    int lo = std::stoi(part.substr(0, dash));
+                    int hi = std::stoi(part.substr(dash + 1));
+                    for (int c = lo; c <= hi; ++c)
+                        cpus.push_back(c);
+                }
+            } catch (const std::exception&) {
+                // ignore malformed fragments
+            }
+        }
+        return cpus;
+    }
+
+private:
+    std::vector<std::vector<int>> node_cpus_;
+    std::vector<int> cpu_node_;
+
+    void discover() {
+        std::vector<int> allowed = allowed_cpus();
+
+#if defined(__linux__)
+        std::ifstream online("/sys/devices/system/node/online");
+        std::string nodes_line;
+        if (online)
+            std::getline(online, nodes_line);
+
+        for (int node : parse_cpu_list(nodes_line)) {
+            std::ifstream in("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+            if (!in)
+                continue;
+            std::string line;
+            std::getline(in, line);
+            std::vector<int> cpus;
+            for (int c : parse_cpu_list(line))
+                if (std::find(allowed.begin(), allowed.end(), c) != allowed.end())
+                    cpus.push_back(c);
+            node_cpus_.resize(static_cast<std::size_t>(node) + 1);
+            node_cpus_[static_cast<std::size_t>(node)] = cpus;
+        }
+#endif
+
+        if (node_cpus_.empty())
+            node_cpus_.push_back(allowed);
+
+        int max_cpu = 0;
+        for (const auto& cpus : node_cpus_)
+            for (int c : cpus)
+                max_cpu = std::max(max_cpu, c);
+        cpu_node_.assign(static_cast<std::size_t>(max_cpu) + 1, 0);
+        for (std::size_t n = 0; n < node_cpus_.size(); ++n)
+            for (int c : node_cpus_[n])
+                cpu_node_[static_cast<std::size_t>(c)] = static_cast<int>(n);
+    }
+};
+
+// =======================
+// Thread placement
+// =======================
+
+enum class ThreadPlacement {
+    Compact,   // fill all CPUs of node 0, then node 1, ...
+    Scatter    // round-robin across nodes: spreads memory bandwidth
+};
+
+/**
+ * @brief CPU order for a pool of `threads` threads (calling thread first).
+ * Pass the result to ThreadPoolOptions::cpus with pin_threads = true.
+ */
+inline std::vector<int> thread_placement_cpus(const NumaTopology& topo,
+                                              ThreadPlacement placement,
+                                              std::size_t threads) {
+    std::vector<int> order;
+    if (placement == ThreadPlacement::Compact) {
+        for (std::size_t n = 0; n < topo.num_nodes(); ++n)
+            for (int c : topo.cpus_of(static_cast<int>(n)))
+                order.push_back(c);
+    } else {
+        std::size_t longest = 0;
+        for (std::size_t n = 0; n < topo.num_nodes(); ++n)
+            longest = std::max(longest, topo.cpus_of(static_cast<int>(n)).size());
+        for (std::size_t i = 0; i < longest; ++i)
+            for (std::size_t n = 0; n < topo.num_nodes(); ++n) {
+                const auto& cpus = topo.cpus_of(static_cast<int>(n));
+                if (i < cpus.size())
+                    order.push_back(cpus[i]);
+            }
+    }
+    if (order.empty())
+        order.push_back(0);
+
+    std::vector<int> out;
+    for (std::size_t i = 0; i < threads; ++i)
+        out.push_back(order[i % order.size()]);
+    return out;
+}
+
+// =======================
+// Memory policy
+// =======================
+
+enum class MemoryPlacement {
+    FirstTouch,  // kernel default: the first thread to touch a page owns it
+    Local,       // preferred on `node`
+    Interleave,  // pages round-robin across all nodes
+    Bind         // strictly on `node`
+};
+
+struct MemoryPolicy {
+    MemoryPlacement placement = MemoryPlacement::FirstTouch;
+    int node = 0;
+
+    static MemoryPolicy first_touch() { return {MemoryPlacement::FirstTouch, 0}; }
+    static MemoryPolicy local(int node) { return {MemoryPlacement::Local, node}; }
+    static MemoryPolicy interleave() { return {MemoryPlacement::Interleave, 0}; }
+    static MemoryPolicy bind(int node) { return {MemoryPlacement::Bind, node}; }
+};
+
+inline const char* memory_placement_name(MemoryPlacement p) {
+    switch (p) {
+    case MemoryPlacement::FirstTouch: return "first_touch";
+    case MemoryPlacement::Local: return "local";
+    case MemoryPlacement::Interleave: return "interleave";
+    case MemoryPlacement::Bind: return "bind";
+    }
+    return "unknown";
+}
+
+/**
+ * @brief Apply a placement policy to a page-aligned range before it is
+ * touched. Returns false when the policy could not be applied (then the
+ * kernel default, first touch, is in effect).
+ */
+inline bool apply_memory_policy(void* addr, std::size_t len, const MemoryPolicy& policy,
+                                const NumaTopology& topo) {
+#if defined(__linux__) && defined(SYS_mbind)
+    // Mode values from <linux/mempolicy.h>.
+    constexpr int kMpolPreferred = 1;
+    constexpr int kMpolBind = 2;
+    constexpr int kMpolInterleave = 3;
+
+    if (policy.placement == MemoryPlacement::FirstTouch)
+        return true;
+
+    if ((policy.placement == MemoryPlacement::Local || policy.placement == MemoryPlacement::Bind) &&
+        (policy.node < 0 || static_cast<std::size_t>(policy.node) >= topo.num_nodes()))
+        return false;
+
+    constexpr std::size_t kBits = 8 * sizeof(unsigned long);
+    std::vector<unsigned long> mask((std::max<std::size_t>(topo.num_nodes(), 1) + kBits - 1) / kBits, 0);
+    auto set = [&](std::size_t n) { mask[n / kBits] |= 1ul << (n % kBits); };
+
+    int mode = kMpolPreferred;
+    switch (policy.placement) {
+    case MemoryPlacement::Local:
+        mode = kMpolPreferred;
+        set(static_cast<std::size_t>(policy.node));
+        break;
+    case MemoryPlacement::Bind:
+        mode = kMpolBind;
+        set(static_cast<std::size_t>(policy.node));
+        break;
+    case MemoryPlacement::Interleave:
+        mode = kMpolInterleave;
+        for (std::size_t n = 0; n < topo.num_nodes(); ++n)
+            set(n);
+        break;
+    default:
+        break;
+    }
+    long rc = syscall(SYS_mbind, addr, len, mode, mask.data(),
+                      static_cast<unsigned long>(mask.size() * kBits + 1), 0u);
+    return rc == 0;
+#else
+    (void)addr; (void)len; (void)topo;
+    return policy.placement == MemoryPlacement::FirstTouch;
+#endif
+}
+
+// =======================
+// Node-aware arena
+// =======================
+
+/**
+ * Monotonic arena backed by mmap'd regions placed by a MemoryPolicy. Usable
+ * directly (allocate / reset) or as a std::pmr::memory_resource for
+ * toolkit containers. Not thread safe: give each worker its own.
+ */
+class NumaArena : public std::pmr::memory_resource {
+public:
+    NumaArena(std::size_t region_bytes, MemoryPolicy policy,
+              const NumaTopology& topo, bool prefault = true)
+        : region_bytes_(round_to_page(std::max<std::size_t>(region_bytes, 1))),
+          policy_(policy), topo_(&topo), prefault_(prefault) {
+        add_region(region_bytes_);
+    }
+
+    ~NumaArena() override {
+        for (auto& r : regions_)
+            unmap(r.base, r.size);
+    }
+
+    NumaArena(const NumaArena&) = delete;
+    NumaArena& operator=(const NumaArena&) = delete;
+
+    // Drop everything allocated so far; keeps the first region mapped.
+    void reset() {
+        for (std::size_t i = 1; i < regions_.size(); ++i)
+            unmap(regions_[i].base, regions_[i].size);
+        regions_.resize(1);
+        used_ = 0;
+    }
+
+    // True when the kernel accepted the placement policy for every region.
+    bool policy_applied() const { return policy_applied_; }
+
+    const MemoryPolicy& policy() const { return policy_; }
+
+    std::size_t bytes_used() const {
+        std::size_t total = used_;
+        for (std::size_t i = 0; i + 1 < regions_.size(); ++i)
+            total += regions_[i].size;
+        return total;
+    }
+
+    template <typename T>
+    T* allocate_array(std::size_t n) {
+        return static_cast<T*>(allocate(n * sizeof(T), alignof(T)));
+    }
+
+protected:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+        Region& r = regions_.back();
+        std::size_t p = (used_ + alignment - 1) & ~(alignment - 1);
+        if (p + bytes > r.size) {
+            add_region(std::max(region_bytes_, round_to_page(bytes + alignment)));
+            p = 0;
+        }
+        used_ = p + bytes;
+        return static_cast<char*>(regions_.back().base) + p;
+    }
+
+    void do_deallocate(void*, std::size_t, std::size_t) override {}
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+private:
+    struct Region {
+        void* base;
+        std::size_t size;
+    };
+
+    std::size_t region_bytes_;
+    MemoryPolicy policy_;
+    const NumaTopology* topo_;
+    bool prefault_;
+    bool policy_applied_ = true;
+    std::vector<Region> regions_;
+    std::size_t used_ = 0;
+
+    static std::size_t page_size() {
+#if defined(__linux__)
+        static const std::size_t ps = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+        return ps;
+#else
+        return 4096;
+#endif
+    }
+
+    static std::size_t round_to_page(std::size_t n) {
+        std::size_t ps = page_size();
+        return (n + ps - 1) / ps * ps;
+    }
+
+    void add_region(std::size_t bytes) {
+        void* p = nullptr;
+#if defined(__linux__)
+        p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED)
+            throw std::bad_alloc();
+#else
+        p = ::operator new(bytes);
+#endif
+        if (!apply_memory_policy(p, bytes, policy_, *topo_))
+            policy_applied_ = false;
+
+        if (prefault_) {
+            // Touch one byte per page so the pages are placed now, by the
+            // policy or (first touch) by this thread, not on the hot path.
+            std::size_t ps = page_size();
+            for (std::size_t off = 0; off < bytes; off += ps)
+                static_cast<volatile char*>(p)[off] = 0;
+        }
+
+        regions_.push_back({p, bytes});
+        used_ = 0;
+    }
+
+    static void unmap(void* p, std::size_t bytes) {
+#if defined(__linux__)
+        munmap(p, bytes);
+#else
+        (void)bytes;
+        ::operator delete(p);
+#endif
+    }
+};
+
+// =======================
+// Per-worker arenas
+// =======================
+
+/**
+ * One NumaArena per pool slot: slot 0 is any thread that is not a worker
+ * (typically the caller), slot i + 1 is worker i. With
+ * MemoryPlacement::Local each arena sits on the node of the CPU its worker
+ * is pinned to; Interleave and Bind apply the same policy to every arena.
+ *
+ * Under MemoryPlacement::FirstTouch the arenas are not pre-faulted: the
+ * constructing thread would otherwise own every page. A page lands on the
+ * node of the thread that first writes it, not the one that allocates it,
+ * so each worker must allocate through local() and write its memory
+ * before anything is timed.
+ */
+class WorkerArenas {
+public:
+    WorkerArenas(const ThreadPool& pool, const NumaTopology& topo,
+                 MemoryPlacement placement, std::size_t bytes_per_slot,
+                 int bind_node = 0)
+        : pool_(&pool) {
+        std::size_t slots = pool.num_workers() + 1;
+        arenas_.reserve(slots);
+        for (std::size_t s = 0; s < slots; ++s) {
+            int cpu = (s == 0) ? -1 : pool.worker_cpu(s - 1);
+            int node = (cpu >= 0) ? topo.node_of_cpu(cpu) : topo.current_node();
+            MemoryPolicy policy{placement, placement == MemoryPlacement::Bind ? bind_node : node};
+            const bool prefault = placement != MemoryPlacement::FirstTouch;
+            arenas_.push_back(std::make_unique<NumaArena>(bytes_per_slot, policy, topo, prefault));
+            nodes_.push_back(node);
+        }
+    }
+
+    std::size_t slots() const { return arenas_.size(); }
+
+    NumaArena& slot(std::size_t s) { return *arenas_[s]; }
+
+    // Arena of the calling thread (its worker slot, or slot 0).
+    NumaArena& local() {
+        int w = pool_->current_worker();
+        return *arenas_[w >= 0 ? static_cast<std::size_t>(w) + 1 : 0];
+    }
+
+    int node_of_slot(std::size_t s) const { return nodes_[s]; }
+
+    void reset_all() {
+        for (auto& a : arenas_)
+            a->reset();
+    }
+
+private:
+    const ThreadPool* pool_;
+    std::vector<std::unique_ptr<NumaArena>> arenas_;
+    std::vector<int> nodes_;
+};
+
+} // namespace qf
+
+#endif // QF_NUMA_PLACEMENT_H
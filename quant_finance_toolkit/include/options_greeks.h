@@ -14,14 +14,20 @@
  *   - Black–Scholes call and put pricing
  *   - Analytical Greeks (Delta, Gamma, Vega, Theta, Rho)
  *   - Newton–Raphson implied volatility solver
+ *   - Batch kernels over strided arrays (used by the Python bindings)
  *
  * This module is used by the examples and can be extended into surfaces,
  * calibration tools, or portfolio risk analysis.
  */
 
 #include <cmath>
+#include <cstddef>
+#include <limits>
 #include <stdexcept>
 
+#include "metrics.h"
+#include "trace.h"
+
 namespace qf {
 
 static constexpr double INV_SQRT_2PI = 0.39894228040143267794;
@@ -136,19 +142,29 @@ inline Greeks put_greeks(double S, double K, double T, double r, double sigma) {
 // Implied Volatility (Call)
 // =======================
 
-inline double implied_vol_call(double market_price,
-                               double S, double K, double T, double r,
-                               double initial_guess = 0.20,
-                               double tol = 1e-6,
-                               int max_iter = 100) {
-    double sigma = initial_guess;
+/**
+ * @brief Newton–Raphson solve for the call volatility matching `market_price`.
+ *
+ * Non-throwing core of implied_vol_call(): returns false (and leaves
+ * `sigma` at the last iterate) when the solve does not converge, so batch
+ * callers can mark that option instead of aborting the whole batch.
+ */
+inline bool try_implied_vol_call(double market_price,
+                                 double S, double K, double T, double r,
+                                 double& sigma,
+                                 double initial_guess = 0.20,
+                                 double tol = 1e-6,
+                                 int max_iter = 100) {
+    QF_TRACE_SCOPE_CAT("implied_vol_call", "options_greeks");
+    QF_METRIC_INC("qf_iv_solves_total", "Implied volatility solves attempted");
+    sigma = initial_guess;
 
     for (int i = 0; i < max_iter; ++i) {
         double price = bs_call(S, K, T, r, sigma);
         double diff = price - market_price;
 
         if (std::fabs(diff) < tol)
-            return sigma;
+            return true;
 
         Greeks g = call_greeks(S, K, T, r, sigma);
 
@@ -161,7 +177,99 @@ inline double implied_vol_call(double market_price,
             sigma = 1e-4;
     }
 
-    throw std::runtime_error("implied_vol_call: did not converge");
+    QF_METRIC_INC("qf_iv_nonconvergence_total", "Implied volatility solves that did not converge");
+    return false;
+}
+
+inline double implied_vol_call(double market_price,
+                               double S, double K, double T, double r,
+                               double initial_guess = 0.20,
+                               double tol = 1e-6,
+                               int max_iter = 100) {
+    double sigma;
+    if (!try_implied_vol_call(market_price, S, K, T, r, sigma, initial_guess, tol, max_iter))
+        throw std::runtime_error("implied_vol_call: did not converge");
+    return sigma;
+}
+
+// =======================
+// Batch kernels
+// =======================
+
+/**
+ * Read-only view of doubles with a stride in elements. A stride of 0
+ * broadcasts a single value, so a batch can mix per-option arrays with a
+ * scalar spot or rate without materializing copies. This is also how the
+ * Python bindings pass NumPy arrays through without copying them.
+ */
+struct StridedView {
+    const double* data;
+    std::ptrdiff_t stride;
+
+    StridedView(const double* p, std::ptrdiff_t s = 1) : data(p), stride(s) {}
+
+    double operator[](std::size_t i) const {
+        return data[static_cast<std::ptrdiff_t>(i) * stride];
+    }
+
+    // View starting at element `i` (for splitting a batch into chunks).
+    StridedView from(std::size_t i) const {
+        return StridedView(data + static_cast<std::ptrdiff_t>(i) * stride, stride);
+    }
+};
+
+// Destination arrays for greeks_batch; any of them may be null.
+struct GreeksBatchOut {
+    double* delta = nullptr;
+    double* gamma = nullptr;
+    double* vega = nullptr;
+    double* theta = nullptr;
+    double* rho = nullptr;
+};
+
+inline void bs_call_batch(std::size_t n, StridedView S, StridedView K, StridedView T,
+                          StridedView r, StridedView sigma, double* out) {
+    for (std::size_t i = 0; i < n; ++i)
+        out[i] = bs_call(S[i], K[i], T[i], r[i], sigma[i]);
+}
+
+inline void bs_put_batch(std::size_t n, StridedView S, StridedView K, StridedView T,
+                         StridedView r, StridedView sigma, double* out) {
+    for (std::size_t i = 0; i < n; ++i)
+        out[i] = bs_put(S[i], K[i], T[i], r[i], sigma[i]);
+}
+
+inline void greeks_batch(std::size_t n, bool is_call, StridedView S, StridedView K,
+                         StridedView T, StridedView r, StridedView sigma,
+                         const GreeksBatchOut& out) {
+    for (std::size_t i = 0; i < n; ++i) {
+        Greeks g = is_call ? call_greeks(S[i], K[i], T[i], r[i], sigma[i])
+                           : put_greeks(S[i], K[i], T[i], r[i], sigma[i]);
+        if (out.delta) out.delta[i] = g.delta;
+        if (out.gamma) out.gamma[i] = g.gamma;
+        if (out.vega) out.vega[i] = g.vega;
+        if (out.theta) out.theta[i] = g.theta;
+        if (out.rho) out.rho[i] = g.rho;
+    }
+}
+
+/**
+ * @brief Implied vols for a batch of call (or put) prices. Options whose
+ * solve does not converge get NaN instead of throwing. Puts are converted to
+ * calls by put–call parity first.
+ */
+inline void implied_vol_batch(std::size_t n, bool is_call, StridedView price, StridedView S,
+                              StridedView K, StridedView T, StridedView r, double* out,
+                              double tol = 1e-6, int max_iter = 100) {
+    for (std::size_t i = 0; i < n; ++i) {
+        double p = price[i];
+        if (!is_call)
+            p += S[i] - K[i] * std::exp(-r[i] * T[i]);
+        double sigma;
+        out[i] = try_implied_vol_call(p, S[i], K[i], T[i], r[i], sigma, 0.20, tol, max_iter)
+                     ? sigma
+                     : std::numeric_limits<double>::quiet_NaN();
+    }
 }
 
 } // namespace qf
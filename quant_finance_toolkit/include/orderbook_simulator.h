@@ -15,18 +15,28 @@
  *   - Limit orders (buy and sell)
  *   - FIFO matching at each price level
  *   - Partial fills
- *   - Best bid/ask querying
+ *   - Best bid/ask and depth querying
  *   - Order cancellation by ID
+ *   - Order modification by ID (size cuts keep priority)
+ *
+ * All internal containers allocate through a std::pmr::memory_resource
+ * passed to the constructor (default: the global heap). A PoolResource from
+ * memory_arena.h, optionally over huge pages, keeps malloc off the matching
+ * path for large books.
  */
 
 #include <map>
 #include <deque>
 #include <cstdint>
+#include <memory_resource>
 #include <optional>
 #include <unordered_map>
 #include <vector>
 #include <algorithm>
 
+#include "metrics.h"
+#include "trace.h"
+
 namespace qf {
 
 enum class Side {
@@ -41,6 +51,18 @@ struct Trade {
     std::uint64_t quantity;
 };
 
+// Aggregated view of one price level.
+struct DepthLevel {
+    double price;
+    std::uint64_t quantity;  // total remaining quantity at this price
+    std::uint32_t orders;    // number of resting orders
+
+    bool operator==(const DepthLevel& o) const {
+        return price == o.price && quantity == o.quantity && orders == o.orders;
+    }
+    bool operator!=(const DepthLevel& o) const { return !(*this == o); }
+};
+
 struct Order {
     std::uint64_t id;
     Side side;
@@ -58,32 +80,68 @@ private:
         }
     };
 
+    using Level = std::pmr::deque<Order>;
+
     // Bids: highest price first
-    std::map<double, std::deque<Order>, Descending> bids_;
+    std::pmr::map<double, Level, Descending> bids_;
 
     // Asks: lowest price first
-    std::map<double, std::deque<Order>> asks_;
+    std::pmr::map<double, Level> asks_;
 
-    // Order lookup (ID → pointer)
-    std::unordered_map<std::uint64_t, Order*> index_;
+    // Order lookup (ID → side and price level). Storing a pointer into the
+    // deque is not safe: erasing from the middle of a level invalidates it.
+    struct Locator {
+        Side side;
+        double price;
+    };
+    std::pmr::unordered_map<std::uint64_t, Locator> index_;
 
     std::uint64_t next_id_ = 1;
     std::uint64_t next_seq_ = 1;
 
     void add_to_book(Order&& o) {
-        auto& book = (o.side == Side::Buy ? bids_ : asks_);
-        auto& queue = book[o.price];
-        queue.push_back(o);
-        index_[o.id] = &queue.back();
+        index_[o.id] = Locator{o.side, o.price};
+        if (o.side == Side::Buy)
+            bids_[o.price].push_back(o);
+        else
+            asks_[o.price].push_back(o);
+    }
+
+    template <typename Book>
+    static bool remove_from_level(Book& book, double price, std::uint64_t id) {
+        auto level = book.find(price);
+        if (level == book.end())
+            return false;
+
+        auto& queue = level->second;
+        bool removed = false;
+        for (auto qi = queue.begin(); qi != queue.end(); ++qi) {
+            if (qi->id == id) {
+                queue.erase(qi);
+                removed = true;
+                break;
+            }
+        }
+
+        if (queue.empty())
+            book.erase(level);
+        return removed;
     }
 
-    void clean_price_level(std::map<double, std::deque<Order>>& book, double price) {
-        auto it = book.find(price);
-        if (it != book.end() && it->second.empty())
-            book.erase(it);
+    template <typename Book>
+    static void collect_depth(const Book& book, std::size_t max_levels,
+                              std::vector<DepthLevel>& out) {
+        out.clear();
+        for (auto it = book.begin(); it != book.end() && out.size() < max_levels; ++it) {
+            DepthLevel d{it->first, 0, static_cast<std::uint32_t>(it->second.size())};
+            for (const Order& o : it->second)
+                d.quantity += o.remaining;
+            out.push_back(d);
+        }
     }
 
-    void match_buy(Order& incoming, std::vector<Trade>& trades) {
+    template <typename TradeVec>
+    void match_buy(Order& incoming, TradeVec& trades) {
         while (incoming.remaining > 0 && !asks_.empty()) {
             auto it = asks_.begin();
             double ask_price = it->first;
@@ -114,7 +172,8 @@ private:
         }
     }
 
-    void match_sell(Order& incoming, std::vector<Trade>& trades) {
+    template <typename TradeVec>
+    void match_sell(Order& incoming, TradeVec& trades) {
         while (incoming.remaining > 0 && !bids_.empty()) {
             auto it = bids_.begin();
             double bid_price = it->first;
@@ -146,6 +205,13 @@ private:
     }
 
 public:
+    explicit OrderBook(std::pmr::memory_resource* mr = std::pmr::get_default_resource())
+        : bids_(mr), asks_(mr), index_(mr) {}
+
+    std::pmr::memory_resource* resource() const {
+        return index_.get_allocator().resource();
+    }
+
     std::uint64_t next_order_id() const {
         return next_id_;
     }
@@ -155,6 +221,22 @@ public:
      */
     std::pair<std::uint64_t, std::vector<Trade>>
     add_limit_order(Side side, double price, std::uint64_t quantity) {
+        std::vector<Trade> trades;
+        std::uint64_t id = add_limit_order(side, price, quantity, trades);
+        return {id, std::move(trades)};
+    }
+
+    /**
+     * @brief Submit a new limit order, appending fills to `trades`.
+     *
+     * Lets the caller reuse one (possibly arena-backed) trade buffer across
+     * orders instead of allocating a vector per call. Returns the order ID.
+     */
+    template <typename TradeVec>
+    std::uint64_t add_limit_order(Side side, double price, std::uint64_t quantity,
+                                  TradeVec& trades) {
+        QF_TRACE_SCOPE_CAT("add_limit_order", "orderbook");
+        QF_METRIC_TIMER_START(match_start);
         Order incoming;
         incoming.id = next_id_++;
         incoming.side = side;
@@ -163,44 +245,96 @@ public:
         incoming.remaining = quantity;
         incoming.sequence = next_seq_++;
 
-        std::vector<Trade> trades;
-
+        [[maybe_unused]] const std::size_t trades_before = trades.size();
         if (side == Side::Buy)
             match_buy(incoming, trades);
         else
             match_sell(incoming, trades);
 
+        QF_METRIC_TIMER_OBSERVE(match_start, "qf_orderbook_match_latency_seconds",
+                                "Time to match one incoming limit order");
+        QF_METRIC_INC("qf_orderbook_orders_total", "Limit orders submitted");
+        QF_METRIC_ADD("qf_orderbook_trades_total", "Fills generated by matching",
+                      trades.size() - trades_before);
+
         if (incoming.remaining > 0)
             add_to_book(std::move(incoming));
 
-        return {incoming.id, trades};
+        return incoming.id;
     }
 
     /**
      * @brief Cancel an existing order by ID.
      */
     bool cancel_order(std::uint64_t id) {
+        QF_TRACE_SCOPE_CAT("cancel_order", "orderbook");
+        QF_METRIC_INC("qf_orderbook_cancels_total", "Cancel requests received");
         auto it = index_.find(id);
         if (it == index_.end())
             return false;
 
-        Order* ptr = it->second;
+        const Locator loc = it->second;
+        index_.erase(it);
 
-        auto& book = (ptr->side == Side::Buy ? bids_ : asks_);
-        auto level = book.find(ptr->price);
-        if (level == book.end())
-            return false;
+        if (loc.side == Side::Buy)
+            return remove_from_level(bids_, loc.price, id);
+        return remove_from_level(asks_, loc.price, id);
+    }
 
-        auto& queue = level->second;
-        for (auto qi = queue.begin(); qi != queue.end(); ++qi) {
-            if (qi->id == id) {
-           	    queue.erase(qi);
-                break;
-            }
-        }
+    /**
+     * @brief Change the price and/or open quantity of a resting order,
+     * keeping its ID.
+     *
+     * Reducing the quantity at an unchanged price keeps time priority.
+     * Any other change re-queues the order behind its new level, and the
+     * order may match on the way in, exactly like a fresh limit order. A
+     * quantity of 0 cancels. Returns false if the order is not resting.
+     */
+    template <typename TradeVec>
+    bool modify_order(std::uint64_t id, double price, std::uint64_t quantity,
+                      TradeVec& trades) {
+        QF_TRACE_SCOPE_CAT("modify_order", "orderbook");
+        QF_METRIC_INC("qf_orderbook_modifies_total", "Modify requests received");
+        auto it = index_.find(id);
+        if (it == index_.end())
+            return false;
+        if (quantity == 0)
+            return cancel_order(id);
+
+        const Locator loc = it->second;
+        auto shrink = [&](auto& book) {
+            auto& queue = book.find(loc.price)->second;
+            auto qi = std::find_if(queue.begin(), queue.end(),
+                                   [&](const Order& o) { return o.id == id; });
+            if (qi->remaining < quantity)
+                return false;
+            qi->quantity -= qi->remaining - quantity;
+            qi->remaining = quantity;
+            return true;
+        };
+        if (price == loc.price &&
+            (loc.side == Side::Buy ? shrink(bids_) : shrink(asks_)))
+            return true;
 
-        clean_price_level(book, ptr->price);
         index_.erase(it);
+        if (loc.side == Side::Buy)
+            remove_from_level(bids_, loc.price, id);
+        else
+            remove_from_level(asks_, loc.price, id);
+
+        Order moved;
+        moved.id = id;
+        moved.side = loc.side;
+        moved.price = price;
+        moved.quantity = quantity;
+        moved.remaining = quantity;
+        moved.sequence = next_seq_++;
+        if (loc.side == Side::Buy)
+            match_buy(moved, trades);
+        else
+            match_sell(moved, trades);
+        if (moved.remaining > 0)
+            add_to_book(std::move(moved));
         return true;
     }
 
@@ -214,6 +348,35 @@ public:
         return asks_.begin()->first;
     }
 
+    // Order with time priority at the best price on one side, or null.
+    const Order* front_order(Side side) const {
+        if (side == Side::Buy)
+            return bids_.empty() ? nullptr : &bids_.begin()->second.front();
+        return asks_.empty() ? nullptr : &asks_.begin()->second.front();
+    }
+
+    /**
+     * @brief Best `max_levels` price levels on one side, best first, written
+     * into `out` (cleared first) so the caller can reuse the buffer.
+     */
+    void depth(Side side, std::size_t max_levels, std::vector<DepthLevel>& out) const {
+        if (side == Side::Buy)
+            collect_depth(bids_, max_levels, out);
+        else
+            collect_depth(asks_, max_levels, out);
+    }
+
+    std::vector<DepthLevel> depth(Side side, std::size_t max_levels) const {
+        std::vector<DepthLevel> out;
+        depth(side, max_levels, out);
+        return out;
+    }
+
+    // Number of resting orders.
+    std::size_t order_count() const {
+        return index_.size();
+    }
+
     bool empty() const {
         return bids_.empty() && asks_.empty();
     }
@@ -0,0 +1,201 @@
+#ifndef QF_PERF_COUNTERS_H
+#define QF_PERF_COUNTERS_H
+
+/**
+ * @file perf_counters.h
+ * @author John Jacobson
+ * @brief Hardware performance counters via Linux perf_event_open.
+ *
+ * Wall time says how slow something is; counters say why. I use these to
+ * tell a cache-miss bound order book walk from a compute bound pricing loop
+ * (instructions per cycle, L1 / last-level cache misses, branch misses).
+ *
+ * Each counter is opened on its own for the calling thread, user space only,
+ * and is inherited by threads created after it (so a pool started inside a
+ * measured benchmark is counted too). Any counter the kernel or container
+ * refuses (no PMU access, paranoid setting, seccomp, unsupported event) is
+ * simply marked unavailable; the rest keep working, and on other platforms
+ * everything reports unavailable.
+ * When the kernel multiplexes counters, values are scaled by
+ * time_enabled / time_running.
+ */
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/perf_event.h>)
+#define QF_HAVE_PERF_EVENTS 1
+#include <cerrno>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#endif
+
+namespace qf {
+
+enum class PerfEvent : int {
+    Cycles = 0,
+    Instructions,
+    L1DMisses,
+    LLCMisses,
+    BranchMisses,
+    Count
+};
+
+constexpr std::size_t kPerfEventCount = static_cast<std::size_t>(PerfEvent::Count);
+
+inline const char* perf_event_name(PerfEvent e) {
+    switch (e) {
+    case PerfEvent::Cycles: return "cycles";
+    case PerfEvent::Instructions: return "instructions";
+    case PerfEvent::L1DMisses: return "l1d_misses";
+    case PerfEvent::LLCMisses: return "llc_misses";
+    case PerfEvent::BranchMisses: return "branch_misses";
+    default: return "unknown";
+    }
+}
+
+struct PerfSample {
+    std::array<bool, kPerfEventCount> valid{};
+    std::array<double, kPerfEventCount> value{};
+
+    bool has(PerfEvent e) const { return valid[static_cast<std::size_t>(e)]; }
+    double get(PerfEvent e) const { return value[static_cast<std::size_t>(e)]; }
+};
+
+class PerfCounters {
+public:
+    PerfCounters() {
+        fds_.fill(-1);
+#ifdef QF_HAVE_PERF_EVENTS
+        for (std::size_t i = 0; i < kPerfEventCount; ++i) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.inherit = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            configure(static_cast<PerfEvent>(i), attr);
+
+            long fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+            if (fd < 0) {
+                if (reason_.empty())
+                    reason_ = std::string(perf_event_name(static_cast<PerfEvent>(i))) +
+                              ": " + std::strerror(errno);
+                continue;
+            }
+            fds_[i] = static_cast<int>(fd);
+        }
+#else
+        reason_ = "perf_event_open is not available on this platform";
+#endif
+    }
+
+    ~PerfCounters() {
+#ifdef QF_HAVE_PERF_EVENTS
+        for (int fd : fds_)
+            if (fd >= 0)
+                close(fd);
+#endif
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    // True when at least one counter could be opened.
+    bool available() const {
+        for (int fd : fds_)
+            if (fd >= 0)
+                return true;
+        return false;
+    }
+
+    bool available(PerfEvent e) const { return fds_[static_cast<std::size_t>(e)] >= 0; }
+
+    // First error seen while opening counters (empty when all opened).
+    const std::string& unavailable_reason() const { return reason_; }
+
+    void start() {
+#ifdef QF_HAVE_PERF_EVENTS
+        for (int fd : fds_) {
+            if (fd < 0) continue;
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    void stop() {
+#ifdef QF_HAVE_PERF_EVENTS
+        for (int fd : fds_)
+            if (fd >= 0)
+                ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+#endif
+    }
+
+    PerfSample read() const {
+        PerfSample s;
+#ifdef QF_HAVE_PERF_EVENTS
+        for (std::size_t i = 0; i < kPerfEventCount; ++i) {
+            if (fds_[i] < 0) continue;
+            std::uint64_t buf[3] = {0, 0, 0};  // value, time_enabled, time_running
+            if (::read(fds_[i], buf, sizeof(buf)) != static_cast<ssize_t>(sizeof(buf)))
+                continue;
+            if (buf[2] == 0)
+                continue;  // never scheduled on the PMU
+            double scale = static_cast<double>(buf[1]) / static_cast<double>(buf[2]);
+            s.valid[i] = true;
+            s.value[i] = static_cast<double>(buf[0]) * scale;
+        }
+#endif
+        return s;
+    }
+
+private:
+    std::array<int, kPerfEventCount> fds_;
+    std::string reason_;
+
+#ifdef QF_HAVE_PERF_EVENTS
+    static void configure(PerfEvent e, perf_event_attr& attr) {
+        auto cache = [](std::uint64_t id, std::uint64_t op, std::uint64_t result) {
+            return id | (op << 8) | (result << 16);
+        };
+        switch (e) {
+        case PerfEvent::Cycles:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CPU_CYCLES;
+            break;
+        case PerfEvent::Instructions:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+            break;
+        case PerfEvent::L1DMisses:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = cache(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ,
+                                PERF_COUNT_HW_CACHE_RESULT_MISS);
+            break;
+        case PerfEvent::LLCMisses:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CACHE_MISSES;
+            break;
+        case PerfEvent::BranchMisses:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+            break;
+        default:
+            break;
+        }
+    }
+#endif
+};
+
+} // namespace qf
+
+#endif // QF_PERF_COUNTERS_H
@@ -0,0 +1,1251 @@
+#ifndef QF_PORTFOLIO_OPTIMIZER_H
+#define QF_PORTFOLIO_OPTIMIZER_H
+
+/**
+ * @file portfolio_optimizer.h
+ * @author John Jacobson
+ * @brief Mean-variance (box constraints, budget, turnover costs) and
+ *        risk-parity portfolio construction for per-rebalance use in
+ *        backtests.
+ *
+ * Mean-variance solves
+ *
+ *     min  ½ γ wᵀ Σ w − αᵀ w + Σ_i κ_i |w_i − w⁰_i|
+ *     s.t. Σ w = budget (optional),  lo ≤ w ≤ hi
+ *
+ * with an exact active-set method: guess which assets sit on a bound or on
+ * their previous weight, solve the equality-constrained quadratic on the
+ * rest, and repeat until the guess is consistent (detail::ActiveSet). With
+ * a factor covariance Σ = B F Bᵀ + D each solve is a k × k Cholesky via
+ * Woodbury, O(nk + m k²) for m free assets. A dense PackedSymmetric Σ is
+ * factored in O(m³/6) and suits a few hundred names. ADMM with the split
+ * x = z (prox of the box and the L1 turnover term in the z-step) is the
+ * fallback when the active set does not settle, and its iterate is then
+ * polished by the active set.
+ *
+ * Yesterday's PortfolioResult warm-starts the weights and the ADMM dual.
+ * After small changes in α or Σ most assets keep their state, so a
+ * rebalance takes one to a few active-set steps.
+ *
+ * Risk parity finds w > 0, Σ w = 1, with risk contributions
+ * w_i (Σ w)_i / wᵀΣw equal to budgets b_i, by cyclical coordinate descent
+ * on ½ yᵀΣy − Σ b_i ln y_i (Griveau-Billion, Richard and Roncalli 2013).
+ * Each coordinate step is a scalar quadratic; with factor structure it
+ * costs O(k).
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "covariance.h"
+#include "metrics.h"
+#include "thread_pool.h"
+#include "trace.h"
+
+namespace qf {
+
+// =======================
+// Problem and result
+// =======================
+
+enum class OptimizerStatus : std::uint8_t {
+    Converged,
+    MaxIterations,
+    Infeasible,  // budget outside [Σ lo, Σ hi]
+};
+
+struct MeanVarianceConfig {
+    double risk_aversion = 1.0;     // γ
+    bool fully_invested = true;     // impose Σ w = budget
+    double budget = 1.0;
+    double lower = 0.0;             // bounds where the problem has none (long-only)
+    double upper = 1.0;
+    double turnover_penalty = 0.0;  // κ where the problem has no per-asset costs
+    double rho = 0.0;               // ADMM penalty; 0 = 2 γ tr(Σ) / n
+    bool adaptive_rho = true;       // rebalance ρ from the residuals (refactors)
+    double relaxation = 1.6;        // over-relaxation in (0, 2)
+    double tolerance = 1e-7;        // primal in weight units, dual relative to the gradient
+    std::size_t max_iterations = 5000;
+    bool active_set = true;         // try the exact active-set solver first
+    std::size_t max_active_set_steps = 200;
+    // Phase 2 (primal active set) moves few assets per step, so once phase
+    // 1 has stalled it is only given this many before ADMM takes over.
+    std::size_t max_primal_steps = 30;
+};
+
+/**
+ * Per-rebalance inputs. Empty vectors take the config defaults: zero
+ * expected returns (minimum variance), the config box, a turnover
+ * reference of all cash and the config turnover penalty.
+ */
+struct MeanVarianceProblem {
+    std::vector<double> expected_returns;  // α
+    std::vector<double> previous_weights;  // w⁰
+    std::vector<double> lower;
+    std::vector<double> upper;
+    std::vector<double> turnover_cost;     // κ_i
+};
+
+struct RiskParityConfig {
+    double tolerance = 1e-8;  // max_i |RC_i / b_i − 1|
+    std::size_t max_sweeps = 10000;
+};
+
+struct PortfolioResult {
+    std::vector<double> weights;
+    std::vector<double> dual;  // scaled ADMM dual (mean-variance), for warm starts
+    double rho = 0.0;
+    double variance = 0.0;         // wᵀ Σ w
+    double expected_return = 0.0;  // αᵀ w
+    double turnover = 0.0;         // Σ |w − w⁰|
+    double primal_residual = 0.0;
+    double dual_residual = 0.0;
+    std::size_t iterations = 0;    // ADMM iterations or CCD sweeps
+    std::size_t active_set_steps = 0;
+    OptimizerStatus status = OptimizerStatus::MaxIterations;
+};
+
+// =======================
+// Linear algebra
+// =======================
+
+namespace detail {
+
+/**
+ * In-place lower Cholesky of a k × k row-major PSD matrix. A pivot that is
+ * not positive (a rank-deficient factor covariance) leaves a zero column,
+ * so L Lᵀ still reproduces the matrix. The upper triangle is zeroed.
+ */
+inline void cholesky_psd(double* a, std::size_t k) {
+    double scale = 0.0;
+    for (std::size_t i = 0; i < k; ++i)
+        scale = std::max(scale, std::abs(a[i * k + i]));
+    const double floor = 1e-14 * scale;
+    for (std::size_t j = 0; j < k; ++j) {
+        double d = a[j * k + j];
+        for (std::size_t p = 0; p < j; ++p)
+            d -= a[j * k + p] * a[j * k + p];
+        const double l = d > floor ? std::sqrt(d) : 0.0;
+        a[j * k + j] = l;
+        for (std::size_t i = j + 1; i < k; ++i) {
+            double s = a[i * k + j];
+            for (std::size_t p = 0; p < j; ++p)
+                s -= a[i * k + p] * a[j * k + p];
+            a[i * k + j] = l > 0.0 ? s / l : 0.0;
+        }
+        for (std::size_t i = 0; i < j; ++i)
+            a[i * k + j] = 0.0;
+    }
+}
+
+// Solves L Lᵀ x = b in place for a full-rank lower factor.
+inline void cholesky_solve(const double* L, std::size_t k, double* x) {
+    for (std::size_t i = 0; i < k; ++i) {
+        double s = x[i];
+        for (std::size_t p = 0; p < i; ++p)
+            s -= L[i * k + p] * x[p];
+        x[i] = s / L[i * k + i];
+    }
+    for (std::size_t i = k; i-- > 0;) {
+        double s = x[i];
+        for (std::size_t p = i + 1; p < k; ++p)
+            s -= L[p * k + i] * x[p];
+        x[i] = s / L[i * k + i];
+    }
+}
+
+/**
+ * γ Σ + ρ I for Σ = B F Bᵀ + D, as D_ρ + R Rᵀ with R = √γ B chol(F) and
+ * D_ρ = γ D + ρ I. Woodbury gives
+ *   (D_ρ + R Rᵀ)⁻¹ v = D_ρ⁻¹ (v − R K⁻¹ Rᵀ D_ρ⁻¹ v),  K = I + Rᵀ D_ρ⁻¹ R,
+ * so factoring is O(nk²) and a solve is O(nk + k²).
+ */
+class FactorSystem {
+public:
+    FactorSystem(const FactorCovariance& cov, double gamma)
+        : n_(cov.assets), k_(cov.factors), root_(n_ * k_, 0.0), diag_(n_), inv_(n_),
+          chol_(k_ * k_), q_(n_), t_(k_) {
+        cov.validate();
+        std::vector<double> L = cov.factor_covariance;
+        cholesky_psd(L.data(), k_);
+        const double sg = std::sqrt(gamma);
+        parallel_for_range(default_thread_pool(), 0, n_, 256, [&](std::size_t lo, std::size_t hi) {
+            for (std::size_t i = lo; i < hi; ++i) {
+                const double* b = cov.exposures.data() + i * k_;
+                double* r = root_.data() + i * k_;
+                for (std::size_t a = 0; a < k_; ++a) {
+                    const double ba = sg * b[a];
+                    for (std::size_t c = 0; c <= a; ++c)
+                        r[c] += ba * L[a * k_ + c];
+                }
+                diag_[i] = gamma * cov.specific_variance[i];
+            }
+        });
+    }
+
+    std::size_t assets() const { return n_; }
+
+    // Mean diagonal of γ Σ.
+    double mean_diagonal() const {
+        double s = 0.0;
+        for (std::size_t i = 0; i < n_; ++i) {
+            const double* r = root_.data() + i * k_;
+            double d = diag_[i];
+            for (std::size_t c = 0; c < k_; ++c)
+                d += r[c] * r[c];
+            s += d;
+        }
+        return n_ ? s / static_cast<double>(n_) : 0.0;
+    }
+
+    void factor(double rho) {
+        QF_TRACE_SCOPE_CAT("factor_system_factor", "portfolio");
+        for (std::size_t i = 0; i < n_; ++i)
+            inv_[i] = 1.0 / (diag_[i] + rho);
+        const std::size_t kk = k_ * k_;
+        std::vector<double> K = parallel_reduce(
+            default_thread_pool(), 0, n_, 512, std::vector<double>(kk, 0.0),
+            [&](std::size_t lo, std::size_t hi) {
+                std::vector<double> acc(kk, 0.0);
+                for (std::size_t i = lo; i < hi; ++i) {
+                    const double* r = root_.data() + i * k_;
+                    for (std::size_t a = 0; a < k_; ++a) {
+                        const double ra = inv_[i] * r[a];
+                        for (std::size_t c = 0; c <= a; ++c)
+                            acc[a * k_ + c] += ra * r[c];
+                    }
+                }
+                return acc;
+            },
+            [kk](std::vector<double> a, const std::vector<double>& b) {
+                for (std::size_t x = 0; x < kk; ++x)
+                    a[x] += b[x];
+                return a;
+            });
+        for (std::size_t a = 0; a < k_; ++a) {
+            K[a * k_ + a] += 1.0;
+            for (std::size_t c = 0; c < a; ++c)
+                K[c * k_ + a] = K[a * k_ + c];
+        }
+        chol_ = std::move(K);
+        cholesky_psd(chol_.data(), k_);
+        std::vector<double> ones(n_, 1.0);
+        solve(ones.data(), q_.data());
+    }
+
+    // out = (γ Σ + ρ I)⁻¹ v.
+    void solve(const double* v, double* out) {
+        std::fill(t_.begin(), t_.end(), 0.0);
+        for (std::size_t i = 0; i < n_; ++i) {
+            const double* r = root_.data() + i * k_;
+            const double s = inv_[i] * v[i];
+            for (std::size_t c = 0; c < k_; ++c)
+                t_[c] += r[c] * s;
+        }
+        cholesky_solve(chol_.data(), k_, t_.data());
+        for (std::size_t i = 0; i < n_; ++i) {
+            const double* r = root_.data() + i * k_;
+            double s = 0.0;
+            for (std::size_t c = 0; c < k_; ++c)
+                s += r[c] * t_[c];
+            out[i] = inv_[i] * (v[i] - s);
+        }
+    }
+
+    // (γ Σ + ρ I)⁻¹ 1, for the budget multiplier.
+    const double* ones_solution() const { return q_.data(); }
+
+    // (γ Σ)_ii.
+    double diagonal(std::size_t i) const {
+        const double* r = root_.data() + i * k_;
+        double d = diag_[i];
+        for (std::size_t c = 0; c < k_; ++c)
+            d += r[c] * r[c];
+        return d;
+    }
+
+    /**
+     * Factors γ Σ_FF for the assets in `free` (no ρ), the same Woodbury
+     * form with D_F in place of D_ρ. Returns false if a free asset has no
+     * specific variance.
+     */
+    bool factor_subset(const std::vector<std::size_t>& free) {
+        sub_ = &free;
+        for (std::size_t i : free)
+            if (!(diag_[i] > 0.0))
+                return false;
+        const std::size_t kk = k_ * k_;
+        std::vector<double> K = parallel_reduce(
+            default_thread_pool(), 0, free.size(), 512, std::vector<double>(kk, 0.0),
+            [&](std::size_t lo, std::size_t hi) {
+                std::vector<double> acc(kk, 0.0);
+                for (std::size_t f = lo; f < hi; ++f) {
+                    const std::size_t i = free[f];
+                    const double* r = root_.data() + i * k_;
+                    for (std::size_t a = 0; a < k_; ++a) {
+                        const double ra = r[a] / diag_[i];
+                        for (std::size_t c = 0; c <= a; ++c)
+                            acc[a * k_ + c] += ra * r[c];
+                    }
+                }
+                return acc;
+            },
+            [kk](std::vector<double> a, const std::vector<double>& b) {
+                for (std::size_t x = 0; x < kk; ++x)
+                    a[x] += b[x];
+                return a;
+            });
+        for (std::size_t a = 0; a < k_; ++a) {
+            K[a * k_ + a] += 1.0;
+            for (std::size_t c = 0; c < a; ++c)
+                K[c * k_ + a] = K[a * k_ + c];
+        }
+        sub_chol_ = std::move(K);
+        cholesky_psd(sub_chol_.data(), k_);
+        return true;
+    }
+
+    // out = (γ Σ_FF)⁻¹ v, v and out indexed like `free`.
+    void solve_subset(const double* v, double* out) {
+        const std::vector<std::size_t>& free = *sub_;
+        std::fill(t_.begin(), t_.end(), 0.0);
+        for (std::size_t f = 0; f < free.size(); ++f) {
+            const double* r = root_.data() + free[f] * k_;
+            const double s = v[f] / diag_[free[f]];
+            for (std::size_t c = 0; c < k_; ++c)
+                t_[c] += r[c] * s;
+        }
+        cholesky_solve(sub_chol_.data(), k_, t_.data());
+        for (std::size_t f = 0; f < free.size(); ++f) {
+            const double* r = root_.data() + free[f] * k_;
+            double s = 0.0;
+            for (std::size_t c = 0; c < k_; ++c)
+                s += r[c] * t_[c];
+            out[f] = (v[f] - s) / diag_[free[f]];
+        }
+    }
+
+    // y = γ Σ x.
+    void multiply(const double* x, double* y) {
+        std::fill(t_.begin(), t_.end(), 0.0);
+        for (std::size_t i = 0; i < n_; ++i) {
+            const double* r = root_.data() + i * k_;
+            for (std::size_t c = 0; c < k_; ++c)
+                t_[c] += r[c] * x[i];
+        }
+        for (std::size_t i = 0; i < n_; ++i) {
+            const double* r = root_.data() + i * k_;
+            double s = 0.0;
+            for (std::size_t c = 0; c < k_; ++c)
+                s += r[c] * t_[c];
+            y[i] = s + diag_[i] * x[i];
+        }
+    }
+
+private:
+    std::size_t n_, k_;
+    std::vector<double> root_;  // R, n × k
+    std::vector<double> diag_;  // γ d
+    std::vector<double> inv_;   // 1 / (γ d + ρ)
+    std::vector<double> chol_;  // chol(K), k × k
+    std::vector<double> q_;
+    std::vector<double> t_;
+    const std::vector<std::size_t>* sub_ = nullptr;
+    std::vector<double> sub_chol_;  // chol(I + R_Fᵀ D_F⁻¹ R_F)
+};
+
+/**
+ * γ Σ + ρ I for a dense packed Σ, Cholesky-factored in packed storage.
+ * Each refactor is O(n³/6).
+ */
+class DenseSystem {
+public:
+    DenseSystem(const PackedSymmetric& cov, double gamma)
+        : cov_(cov), gamma_(gamma), chol_(cov.dim()), q_(cov.dim()) {}
+
+    std::size_t assets() const { return cov_.dim(); }
+
+    double mean_diagonal() const {
+        double s = 0.0;
+        for (std::size_t i = 0; i < cov_.dim(); ++i)
+            s += cov_(i, i);
+        return cov_.dim() ? gamma_ * s / static_cast<double>(cov_.dim()) : 0.0;
+    }
+
+    void factor(double rho) {
+        QF_TRACE_SCOPE_CAT("dense_system_factor", "portfolio");
+        const std::size_t n = cov_.dim();
+        for (std::size_t i = 0; i < n; ++i) {
+            const double* c = cov_.row(i);
+            double* l = chol_.row(i);
+            for (std::size_t j = 0; j <= i; ++j) {
+                double s = gamma_ * c[j] + (i == j ? rho : 0.0);
+                const double* lj = chol_.row(j);
+                for (std::size_t p = 0; p < j; ++p)
+                    s -= l[p] * lj[p];
+                if (j < i) {
+                    l[j] = s / lj[j];
+                } else {
+                    if (!(s > 0.0))
+                        throw std::runtime_error(
+                            "optimize_mean_variance: covariance is not positive semidefinite");
+                    l[i] = std::sqrt(s);
+                }
+            }
+        }
+        std::vector<double> ones(n, 1.0);
+        solve(ones.data(), q_.data());
+    }
+
+    void solve(const double* v, double* out) { packed_solve(chol_, v, out); }
+
+    const double* ones_solution() const { return q_.data(); }
+
+    double diagonal(std::size_t i) const { return gamma_ * cov_(i, i); }
+
+    // Cholesky of γ Σ_FF; false if it is not positive definite.
+    bool factor_subset(const std::vector<std::size_t>& free) {
+        const std::size_t m = free.size();
+        sub_.resize(m);
+        for (std::size_t a = 0; a < m; ++a) {
+            double* l = sub_.row(a);
+            for (std::size_t b = 0; b <= a; ++b) {
+                double s = gamma_ * cov_(free[a], free[b]);
+                const double* lb = sub_.row(b);
+                for (std::size_t p = 0; p < b; ++p)
+                    s -= l[p] * lb[p];
+                if (b < a) {
+                    l[b] = s / lb[b];
+                } else {
+                    if (!(s > 0.0))
+                        return false;
+                    l[a] = std::sqrt(s);
+                }
+            }
+        }
+        return true;
+    }
+
+    void solve_subset(const double* v, double* out) { packed_solve(sub_, v, out); }
+
+    void multiply(const double* x, double* y) {
+        cov_.multiply(x, y);
+        for (std::size_t i = 0; i < cov_.dim(); ++i)
+            y[i] *= gamma_;
+    }
+
+private:
+    // L Lᵀ out = v for a packed lower factor.
+    static void packed_solve(const PackedSymmetric& L, const double* v, double* out) {
+        const std::size_t n = L.dim();
+        for (std::size_t i = 0; i < n; ++i) {
+            const double* l = L.row(i);
+            double s = v[i];
+            for (std::size_t p = 0; p < i; ++p)
+                s -= l[p] * out[p];
+            out[i] = s / l[i];
+        }
+        for (std::size_t i = n; i-- > 0;) {
+            const double* l = L.row(i);
+            out[i] /= l[i];
+            const double xi = out[i];
+            for (std::size_t p = 0; p < i; ++p)
+                out[p] -= l[p] * xi;
+        }
+    }
+
+    const PackedSymmetric& cov_;
+    double gamma_;
+    PackedSymmetric chol_;
+    PackedSymmetric sub_;
+    std::vector<double> q_;
+};
+
+inline double inf_norm(const std::vector<double>& v) {
+    double m = 0.0;
+    for (double x : v)
+        m = std::max(m, std::abs(x));
+    return m;
+}
+
+// Per-asset problem data with the config defaults filled in.
+struct MeanVarianceData {
+    std::vector<double> alpha, prev, lo, hi, kappa;
+};
+
+inline void per_asset(const std::vector<double>& v, std::size_t n, double fallback,
+                      std::vector<double>& out, const char* name) {
+    if (v.empty()) {
+        out.assign(n, fallback);
+        return;
+    }
+    if (v.size() != n)
+        throw std::runtime_error(std::string("optimize_mean_variance: ") + name +
+                                 " has the wrong length");
+    out = v;
+}
+
+/**
+ * Where each asset sits in the piecewise-quadratic objective: fixed at a
+ * bound, fixed at its previous weight (the kink of the turnover cost), or
+ * free on one side of the previous weight with linear cost ±κ.
+ */
+enum class AssetState : std::uint8_t { Lower, Upper, Anchor, Above, Below };
+
+inline bool is_free(AssetState s) { return s == AssetState::Above || s == AssetState::Below; }
+
+/**
+ * State of prox_i(v) = clip(w⁰ + soft(v − w⁰, c κ), lo, hi), the prox of the
+ * box and the turnover cost with step c. Near a boundary (within eps) the
+ * current state is kept, so rounding cannot make the active set cycle.
+ */
+inline AssetState prox_state(const MeanVarianceData& d, std::size_t i, double v, double c,
+                             AssetState current) {
+    constexpr double eps = 1e-12;
+    const double dv = v - d.prev[i];
+    const double t = c * d.kappa[i];
+    AssetState st;
+    double w;
+    if (std::abs(dv) < t || (current == AssetState::Anchor && std::abs(dv) <= t + eps)) {
+        st = AssetState::Anchor;
+        w = d.prev[i];
+    } else if (dv > 0.0) {
+        st = AssetState::Above;
+        w = v - t;
+    } else {
+        st = AssetState::Below;
+        w = v + t;
+    }
+    const double lo_tol = current == AssetState::Lower ? eps : -eps;
+    const double hi_tol = current == AssetState::Upper ? eps : -eps;
+    if (w <= d.lo[i] + lo_tol)
+        return AssetState::Lower;
+    if (w >= d.hi[i] - hi_tol)
+        return AssetState::Upper;
+    return st;
+}
+
+inline double prox_value(const MeanVarianceData& d, std::size_t i, double v, double c) {
+    const double dv = v - d.prev[i];
+    const double s = std::copysign(std::max(std::abs(dv) - c * d.kappa[i], 0.0), dv);
+    return std::clamp(d.prev[i] + s, d.lo[i], d.hi[i]);
+}
+
+// Root of a non-increasing function, by bracketing and bisection.
+template <typename F>
+double bisect_decreasing(F&& f) {
+    double lo = -1.0, hi = 1.0;
+    for (int k = 0; k < 200 && f(lo) < 0.0; ++k)
+        lo *= 2.0;
+    for (int k = 0; k < 200 && f(hi) > 0.0; ++k)
+        hi *= 2.0;
+    for (int k = 0; k < 200 && hi - lo > 1e-15 * std::max(1.0, std::abs(lo)); ++k) {
+        const double mid = 0.5 * (lo + hi);
+        (f(mid) > 0.0 ? lo : hi) = mid;
+    }
+    return 0.5 * (lo + hi);
+}
+
+inline double fixed_value(const MeanVarianceData& d, std::size_t i, AssetState s) {
+    switch (s) {
+    case AssetState::Lower:
+        return d.lo[i];
+    case AssetState::Upper:
+        return d.hi[i];
+    default:
+        return std::clamp(d.prev[i], d.lo[i], d.hi[i]);
+    }
+}
+
+/**
+ * Exact active-set solver. Each asset is fixed (at a bound, or at w⁰ where
+ * the turnover cost has its kink) or free on one side of w⁰. For fixed
+ * states the problem is an equality-constrained quadratic on the free
+ * assets, solved directly with System::factor_subset / solve_subset.
+ *
+ * Phase 1 is the primal–dual active set method (a semismooth Newton method
+ * on the prox fixed point w = prox(w − c (∇f + ν)), c = 1 / (γΣ)_ii). Each
+ * step solves for the current states and re-derives every state from one
+ * prox-gradient step at the result. It changes many states at once, so it
+ * usually settles in 3–20 steps cold and 1–3 from yesterday's weights.
+ * Unchanged states mean the KKT conditions hold, and the result is exact
+ * to rounding.
+ *
+ * Phase 1 can cycle or stall when Σ is far from diagonally dominant, and
+ * then phase 2, the classic primal active set method (Nocedal & Wright
+ * §16.3), restarts from the guess. It projects onto the feasible set, then
+ * either steps toward the solution for the current states until a free
+ * asset hits a bound or w⁰, or, once no asset blocks, frees the fixed
+ * assets whose multipliers have the wrong sign. The objective decreases on
+ * every step that is not blocked at once, so it terminates.
+ */
+template <typename System>
+class ActiveSet {
+public:
+    ActiveSet(System& sys, const MeanVarianceData& d, const MeanVarianceConfig& cfg)
+        : sys_(sys), d_(d), cfg_(cfg), n_(sys.assets()), state_(n_), c_(n_), fixed_(n_), y_(n_),
+          g_(n_), target_(n_) {
+        for (std::size_t i = 0; i < n_; ++i)
+            c_[i] = 1.0 / sys.diagonal(i);
+    }
+
+    // Solves from the guess in w; false if neither phase settles in
+    // cfg.max_active_set_steps, or phase 2 not in cfg.max_primal_steps.
+    bool solve(std::vector<double>& w, std::size_t& steps, double& violation) {
+        QF_TRACE_SCOPE_CAT("active_set", "portfolio");
+        steps = 0;
+        guess_states(w);
+        const std::vector<double> guess = w;
+        const int phase1 = primal_dual(w, steps);
+        if (phase1 == 0)
+            w = guess;
+        const std::size_t limit =
+            std::min(cfg_.max_active_set_steps, steps + cfg_.max_primal_steps);
+        const bool ok = phase1 > 0 || (phase1 == 0 && primal(w, steps, limit));
+        if (!ok)
+            return false;
+        violation = 0.0;
+        for (std::size_t i = 0; i < n_; ++i) {
+            violation = std::max({violation, d_.lo[i] - w[i], w[i] - d_.hi[i]});
+            w[i] = std::clamp(w[i], d_.lo[i], d_.hi[i]);
+        }
+        return true;
+    }
+
+private:
+    /**
+     * Minimizer for the current states into target_, with the budget
+     * multiplier in nu_ and γ Σ target_ in g_. With no free asset, ν is the
+     * value for which the prox step meets the budget.
+     */
+    bool newton() {
+        free_.clear();
+        double fixed_sum = 0.0;
+        for (std::size_t i = 0; i < n_; ++i) {
+            if (is_free(state_[i])) {
+                free_.push_back(i);
+                fixed_[i] = 0.0;
+            } else {
+                fixed_[i] = fixed_value(d_, i, state_[i]);
+                fixed_sum += fixed_[i];
+            }
+        }
+        target_ = fixed_;
+        nu_ = 0.0;
+        if (free_.empty()) {
+            sys_.multiply(target_.data(), g_.data());
+            if (cfg_.fully_invested)
+                nu_ = bisect_decreasing([&](double nu) {
+                    double s = 0.0;
+                    for (std::size_t i = 0; i < n_; ++i)
+                        s += prox_value(d_, i, step(i, nu), c_[i]);
+                    return s - cfg_.budget;
+                });
+            return true;
+        }
+        if (!sys_.factor_subset(free_))
+            return false;
+
+        // γ Σ_FF w_F + ν 1 = α_F − κ_F s_F − γ Σ_FC w_C,  1ᵀ w_F = budget − 1ᵀ w_C.
+        sys_.multiply(fixed_.data(), y_.data());
+        const std::size_t m = free_.size();
+        rhs_.resize(m);
+        p_.resize(m);
+        for (std::size_t f = 0; f < m; ++f) {
+            const std::size_t i = free_[f];
+            const double sign = state_[i] == AssetState::Above ? 1.0 : -1.0;
+            rhs_[f] = d_.alpha[i] - sign * d_.kappa[i] - y_[i];
+        }
+        sys_.solve_subset(rhs_.data(), p_.data());
+        if (cfg_.fully_invested) {
+            q_.assign(m, 1.0);
+            sys_.solve_subset(q_.data(), q_.data());
+            double sp = 0.0, sq = 0.0;
+            for (std::size_t f = 0; f < m; ++f) {
+                sp += p_[f];
+                sq += q_[f];
+            }
+            nu_ = (sp - (cfg_.budget - fixed_sum)) / sq;
+            for (std::size_t f = 0; f < m; ++f)
+                p_[f] -= nu_ * q_[f];
+        }
+        for (std::size_t f = 0; f < m; ++f)
+            target_[free_[f]] = p_[f];
+        sys_.multiply(target_.data(), g_.data());
+        return true;
+    }
+
+    // Fixed where w sits on a bound or on w⁰, otherwise free on its side.
+    void guess_states(const std::vector<double>& w) {
+        for (std::size_t i = 0; i < n_; ++i) {
+            const bool kink = d_.kappa[i] > 0.0;
+            if (w[i] <= d_.lo[i])
+                state_[i] = AssetState::Lower;
+            else if (w[i] >= d_.hi[i])
+                state_[i] = AssetState::Upper;
+            else if (kink && w[i] == d_.prev[i])
+                state_[i] = AssetState::Anchor;
+            else
+                state_[i] = kink && w[i] < d_.prev[i] ? AssetState::Below : AssetState::Above;
+        }
+    }
+
+    // Prox-gradient point w_i − c_i (∇f_i + ν) at target_.
+    double step(std::size_t i, double nu) const {
+        return target_[i] - c_[i] * (g_[i] - d_.alpha[i] + nu);
+    }
+
+    // Phase 1: 1 = settled, 0 = cycled (phase 2 continues), −1 = failed.
+    // A repeated state vector, or no new low in the number of state changes
+    // for kStall steps, counts as cycling.
+    int primal_dual(std::vector<double>& w, std::size_t& steps) {
+        constexpr std::size_t kStall = 8;
+        std::vector<std::uint64_t> seen;
+        std::size_t fewest = n_ + 1, since = 0;
+        while (steps < cfg_.max_active_set_steps) {
+            ++steps;
+            if (!newton())
+                return -1;
+            w = target_;
+            std::size_t changes = 0;
+            std::uint64_t h = 1469598103934665603ull;  // FNV-1a over the new states
+            for (std::size_t i = 0; i < n_; ++i) {
+                const AssetState next = prox_state(d_, i, step(i, nu_), c_[i], state_[i]);
+                changes += next != state_[i];
+                state_[i] = next;
+                h = (h ^ static_cast<std::uint64_t>(next)) * 1099511628211ull;
+            }
+            if (changes == 0)
+                return 1;
+            if (changes < fewest) {
+                fewest = changes;
+                since = 0;
+            } else if (++since == kStall) {
+                return 0;
+            }
+            if (std::find(seen.begin(), seen.end(), h) != seen.end())
+                return 0;
+            seen.push_back(h);
+        }
+        return -1;
+    }
+
+    // Phase 2 from the caller's guess w, typically yesterday's weights, so
+    // few assets start free. Gives up once `steps` reaches `limit`.
+    bool primal(std::vector<double>& w, std::size_t& steps, std::size_t limit) {
+        // Project onto the box and the budget: clip(w − t) with Σ = budget.
+        double t = 0.0;
+        if (cfg_.fully_invested)
+            t = bisect_decreasing([&](double s) {
+                double sum = 0.0;
+                for (std::size_t i = 0; i < n_; ++i)
+                    sum += std::clamp(w[i] - s, d_.lo[i], d_.hi[i]);
+                return sum - cfg_.budget;
+            });
+        for (std::size_t i = 0; i < n_; ++i)
+            w[i] = std::clamp(w[i] - t, d_.lo[i], d_.hi[i]);
+        guess_states(w);
+
+        while (steps < limit) {
+            ++steps;
+            if (!newton())
+                return false;
+
+            // Ratio test: the longest step toward target_ that keeps every
+            // free asset inside its box and on its side of w⁰. Every asset
+            // that blocks at that length is fixed where it stops; one within
+            // rounding of its edge blocks at once.
+            const auto edge = [&](std::size_t i, AssetState& at) {
+                const double dw = target_[i] - w[i];
+                const bool kink = d_.kappa[i] > 0.0;
+                const bool above = state_[i] == AssetState::Above;
+                if (dw < 0.0) {
+                    const bool anchor = kink && above && d_.prev[i] > d_.lo[i];
+                    at = anchor ? AssetState::Anchor : AssetState::Lower;
+                    const double room = w[i] - fixed_value(d_, i, at);
+                    return room > 1e-12 ? room / -dw : 0.0;
+                }
+                if (dw > 0.0) {
+                    const bool anchor = kink && !above && d_.prev[i] < d_.hi[i];
+                    at = anchor ? AssetState::Anchor : AssetState::Upper;
+                    const double room = fixed_value(d_, i, at) - w[i];
+                    return room > 1e-12 ? room / dw : 0.0;
+                }
+                return std::numeric_limits<double>::infinity();
+            };
+            double alpha = 1.0;
+            AssetState at = AssetState::Lower;
+            for (std::size_t i : free_)
+                alpha = std::min(alpha, edge(i, at));
+            if (alpha < 1.0) {
+                for (std::size_t i : free_) {
+                    if (edge(i, at) <= alpha) {
+                        w[i] = fixed_value(d_, i, at);
+                        state_[i] = at;
+                    } else {
+                        w[i] += alpha * (target_[i] - w[i]);
+                    }
+                }
+                continue;
+            }
+
+            // Full step: free every fixed asset whose prox step leaves its
+            // state. Some may then move the wrong way; the ratio test fixes
+            // those again at α = 0, and at least one keeps descending.
+            w = target_;
+            bool optimal = true;
+            for (std::size_t i = 0; i < n_; ++i) {
+                if (is_free(state_[i]))
+                    continue;
+                const double v = step(i, nu_);
+                if (prox_state(d_, i, v, c_[i], state_[i]) == state_[i])
+                    continue;
+                const double moved = prox_value(d_, i, v, c_[i]);
+                if (moved == w[i])
+                    continue;
+                const bool kink = d_.kappa[i] > 0.0;
+                if (moved > w[i])
+                    state_[i] = kink && w[i] < d_.prev[i] ? AssetState::Below : AssetState::Above;
+                else
+                    state_[i] = kink && w[i] > d_.prev[i] ? AssetState::Above : AssetState::Below;
+                optimal = false;
+            }
+            if (optimal)
+                return true;
+        }
+        return false;
+    }
+
+    System& sys_;
+    const MeanVarianceData& d_;
+    const MeanVarianceConfig& cfg_;
+    std::size_t n_;
+    std::vector<AssetState> state_;
+    std::vector<double> c_, fixed_, y_, g_, target_, rhs_, p_, q_;
+    std::vector<std::size_t> free_;
+    double nu_ = 0.0;
+};
+
+/**
+ * ADMM on x = z: x carries the quadratic and the budget, z the box and the
+ * turnover cost. Runs from (z, u, ρ) to cfg.tolerance or the iteration
+ * limit, leaving the final iterate in z and u.
+ */
+template <typename System>
+void admm(System& sys, const MeanVarianceData& d, const MeanVarianceConfig& cfg,
+          std::vector<double>& z, std::vector<double>& u, double& rho, PortfolioResult& res) {
+    QF_TRACE_SCOPE_CAT("admm", "portfolio");
+    const std::size_t n = sys.assets();
+    std::vector<double> x(n), xh(n), rhs(n), zold(n), g(n);
+    const double alpha_norm = inf_norm(d.alpha);
+    const double a = cfg.relaxation;
+    std::size_t last_adapt = 0;
+    constexpr std::size_t kCheckEvery = 5;
+    sys.factor(rho);
+
+    std::size_t it = 0;
+    for (; it < cfg.max_iterations; ++it) {
+        // x-step: (γΣ + ρI) x = α + ρ (z − u) − ν 1 with Σ x = budget.
+        for (std::size_t i = 0; i < n; ++i)
+            rhs[i] = d.alpha[i] + rho * (z[i] - u[i]);
+        sys.solve(rhs.data(), x.data());
+        if (cfg.fully_invested) {
+            const double* q = sys.ones_solution();
+            double sp = 0.0, sq = 0.0;
+            for (std::size_t i = 0; i < n; ++i) {
+                sp += x[i];
+                sq += q[i];
+            }
+            const double nu = (sp - cfg.budget) / sq;
+            for (std::size_t i = 0; i < n; ++i)
+                x[i] -= nu * q[i];
+        }
+
+        // z-step: prox of the box and κ |z − w⁰| at x̂ + u, per asset.
+        zold.swap(z);
+        for (std::size_t i = 0; i < n; ++i) {
+            xh[i] = a * x[i] + (1.0 - a) * zold[i];
+            const double v = xh[i] + u[i] - d.prev[i];
+            const double t = d.kappa[i] / rho;
+            const double s = std::copysign(std::max(std::abs(v) - t, 0.0), v);
+            z[i] = std::clamp(d.prev[i] + s, d.lo[i], d.hi[i]);
+            u[i] += xh[i] - z[i];
+        }
+
+        if ((it + 1) % kCheckEvery != 0)
+            continue;
+        double rp = 0.0, rd = 0.0, xn = 0.0, zn = 0.0;
+        for (std::size_t i = 0; i < n; ++i) {
+            rp = std::max(rp, std::abs(x[i] - z[i]));
+            rd = std::max(rd, std::abs(z[i] - zold[i]));
+            xn = std::max(xn, std::abs(x[i]));
+            zn = std::max(zn, std::abs(z[i]));
+        }
+        rd *= rho;
+        sys.multiply(z.data(), g.data());
+        const double grad = std::max({inf_norm(g), alpha_norm, rho * inf_norm(u), 1e-300});
+        res.primal_residual = rp;
+        res.dual_residual = rd / grad;
+        if (rp <= cfg.tolerance && res.dual_residual <= cfg.tolerance) {
+            ++it;
+            res.status = OptimizerStatus::Converged;
+            break;
+        }
+        // Residual balancing (as in OSQP): move ρ toward equal relative
+        // primal and dual residuals, at most every 25 iterations.
+        if (cfg.adaptive_rho && it + 1 - last_adapt >= 25) {
+            const double ratio =
+                std::sqrt((rp / std::max({xn, zn, 1e-300})) / std::max(res.dual_residual, 1e-300));
+            if (ratio > 5.0 || ratio < 0.2) {
+                const double next = std::clamp(rho * ratio, 1e-12, 1e12);
+                for (double& ui : u)
+                    ui *= rho / next;
+                rho = next;
+                sys.factor(rho);
+                last_adapt = it + 1;
+            }
+        }
+    }
+    res.iterations += it;
+}
+
+template <typename System>
+PortfolioResult mean_variance(System& sys, const MeanVarianceProblem& problem,
+                              const MeanVarianceConfig& cfg, const PortfolioResult* warm) {
+    const std::size_t n = sys.assets();
+    if (!(cfg.risk_aversion > 0.0))
+        throw std::runtime_error("optimize_mean_variance: risk_aversion must be positive");
+    if (!(cfg.relaxation > 0.0 && cfg.relaxation < 2.0))
+        throw std::runtime_error("optimize_mean_variance: relaxation must be in (0, 2)");
+
+    MeanVarianceData d;
+    per_asset(problem.expected_returns, n, 0.0, d.alpha, "expected_returns");
+    per_asset(problem.previous_weights, n, 0.0, d.prev, "previous_weights");
+    per_asset(problem.lower, n, cfg.lower, d.lo, "lower");
+    per_asset(problem.upper, n, cfg.upper, d.hi, "upper");
+    per_asset(problem.turnover_cost, n, cfg.turnover_penalty, d.kappa, "turnover_cost");
+
+    PortfolioResult res;
+    double lo_sum = 0.0, hi_sum = 0.0;
+    for (std::size_t i = 0; i < n; ++i) {
+        if (d.lo[i] > d.hi[i])
+            throw std::runtime_error("optimize_mean_variance: lower bound above upper bound");
+        if (d.kappa[i] < 0.0)
+            throw std::runtime_error("optimize_mean_variance: turnover costs must be non-negative");
+        lo_sum += d.lo[i];
+        hi_sum += d.hi[i];
+    }
+    if (cfg.fully_invested && (cfg.budget < lo_sum - 1e-12 || cfg.budget > hi_sum + 1e-12)) {
+        res.status = OptimizerStatus::Infeasible;
+        return res;
+    }
+
+    // Start from yesterday's solution (weights and dual), else from the
+    // turnover reference, else from an equal split of the budget.
+    std::vector<double> w(n), u(n, 0.0);
+    double rho = cfg.rho > 0.0 ? cfg.rho : 2.0 * std::max(sys.mean_diagonal(), 1e-12);
+    if (warm && warm->weights.size() == n) {
+        w = warm->weights;
+        if (warm->dual.size() == n && warm->rho > 0.0) {
+            rho = warm->rho;
+            u = warm->dual;
+        }
+    } else if (!problem.previous_weights.empty()) {
+        w = d.prev;
+    } else {
+        std::fill(w.begin(), w.end(), cfg.fully_invested ? cfg.budget / static_cast<double>(n) : 0.0);
+    }
+    for (std::size_t i = 0; i < n; ++i)
+        w[i] = std::clamp(w[i], d.lo[i], d.hi[i]);
+
+    std::vector<double> polished = w;
+    double violation = 0.0;
+    ActiveSet<System> exact(sys, d, cfg);
+    if (cfg.active_set && exact.solve(polished, res.active_set_steps, violation)) {
+        w.swap(polished);
+        res.status = OptimizerStatus::Converged;
+        res.primal_residual = violation;
+        res.dual_residual = 0.0;
+    } else {
+        // ADMM, then one more active-set attempt from its (now close)
+        // iterate to finish exactly.
+        admm(sys, d, cfg, w, u, rho, res);
+        std::size_t polish_steps = 0;
+        polished = w;
+        if (cfg.active_set && exact.solve(polished, polish_steps, violation)) {
+            w.swap(polished);
+            res.status = OptimizerStatus::Converged;
+            res.primal_residual = violation;
+            res.dual_residual = 0.0;
+        }
+        res.active_set_steps += polish_steps;
+    }
+
+    res.rho = rho;
+    res.weights = std::move(w);
+    res.dual = std::move(u);
+    for (std::size_t i = 0; i < n; ++i) {
+        res.expected_return += d.alpha[i] * res.weights[i];
+        res.turnover += std::abs(res.weights[i] - d.prev[i]);
+    }
+    if (res.status != OptimizerStatus::Converged)
+        QF_METRIC_INC("qf_portfolio_unconverged_total",
+                      "Portfolio optimizations that stopped at the iteration limit");
+    return res;
+}
+
+// Normalized risk budgets (uniform when empty).
+inline std::vector<double> risk_budgets(const std::vector<double>& budgets, std::size_t n) {
+    if (budgets.empty())
+        return std::vector<double>(n, 1.0 / static_cast<double>(n));
+    if (budgets.size() != n)
+        throw std::runtime_error("risk_parity: budgets has the wrong length");
+    double s = 0.0;
+    for (double b : budgets) {
+        if (!(b > 0.0))
+            throw std::runtime_error("risk_parity: budgets must be positive");
+        s += b;
+    }
+    std::vector<double> out(budgets);
+    for (double& b : out)
+        b /= s;
+    return out;
+}
+
+/**
+ * One CCD coordinate: the positive root of s_ii y² + c y − b = 0, the
+ * minimizer of ½ yᵀΣy − b ln y in y_i with the others fixed.
+ */
+inline double ccd_step(double sii, double c, double b) {
+    return (-c + std::sqrt(c * c + 4.0 * sii * b)) / (2.0 * sii);
+}
+
+/**
+ * Starting point: warm weights where positive, else inverse volatility,
+ * scaled by 1 / √(yᵀΣy). Weights sum to 1 but the CCD iterate satisfies
+ * yᵀΣy = Σ b = 1 at the optimum, so an unscaled warm start sits a factor
+ * of 1 / σ_p away and spends most of its sweeps just growing to scale.
+ * `quad(y)` returns yᵀΣy.
+ */
+template <typename Quad>
+std::vector<double> ccd_start(const std::vector<double>& diag, const PortfolioResult* warm,
+                              Quad&& quad) {
+    const std::size_t n = diag.size();
+    std::vector<double> y(n);
+    const bool use_warm = warm && warm->weights.size() == n;
+    for (std::size_t i = 0; i < n; ++i) {
+        if (!(diag[i] > 0.0))
+            throw std::runtime_error("risk_parity: every asset needs positive variance");
+        y[i] = use_warm && warm->weights[i] > 0.0 ? warm->weights[i] : 1.0 / std::sqrt(diag[i]);
+    }
+    const double v = quad(y);
+    if (v > 0.0) {
+        const double scale = 1.0 / std::sqrt(v);
+        for (double& x : y)
+            x *= scale;
+    }
+    return y;
+}
+
+// Finishes a risk-parity result: w = y / Σ y, contributions error, status.
+inline void ccd_finish(PortfolioResult& res, std::vector<double>& y, double variance) {
+    double s = 0.0;
+    for (double v : y)
+        s += v;
+    for (double& v : y)
+        v /= s;
+    res.variance = variance / (s * s);
+    res.weights = std::move(y);
+    if (res.status != OptimizerStatus::Converged)
+        QF_METRIC_INC("qf_portfolio_unconverged_total",
+                      "Portfolio optimizations that stopped at the iteration limit");
+}
+
+} // namespace detail
+
+// =======================
+// Mean-variance
+// =======================
+
+/**
+ * @brief Mean-variance weights under a factor covariance. Pass yesterday's
+ * result as `warm` to restart from its weights and ADMM dual.
+ */
+inline PortfolioResult optimize_mean_variance(const FactorCovariance& cov,
+                                              const MeanVarianceProblem& problem,
+                                              const MeanVarianceConfig& cfg = {},
+                                              const PortfolioResult* warm = nullptr) {
+    QF_TRACE_SCOPE_CAT("optimize_mean_variance", "portfolio");
+    detail::FactorSystem sys(cov, cfg.risk_aversion);
+    PortfolioResult res = detail::mean_variance(sys, problem, cfg, warm);
+    if (!res.weights.empty())
+        res.variance = cov.variance(res.weights.data());
+    return res;
+}
+
+// @brief Mean-variance weights under a dense covariance (small universes).
+inline PortfolioResult optimize_mean_variance(const PackedSymmetric& cov,
+                                              const MeanVarianceProblem& problem,
+                                              const MeanVarianceConfig& cfg = {},
+                                              const PortfolioResult* warm = nullptr) {
+    QF_TRACE_SCOPE_CAT("optimize_mean_variance", "portfolio");
+    detail::DenseSystem sys(cov, cfg.risk_aversion);
+    PortfolioResult res = detail::mean_variance(sys, problem, cfg, warm);
+    if (!res.weights.empty()) {
+        std::vector<double> g(cov.dim());
+        cov.multiply(res.weights.data(), g.data());
+        for (std::size_t i = 0; i < cov.dim(); ++i)
+            res.variance += res.weights[i] * g[i];
+    }
+    return res;
+}
+
+// =======================
+// Risk parity
+// =======================
+
+/**
+ * @brief Long-only weights (summing to 1) whose risk contributions match
+ * `budgets` (equal risk when empty), under a factor covariance. A coordinate
+ * step updates Rᵀy (R = B chol(F)) in O(k), so a sweep is O(nk).
+ */
+inline PortfolioResult risk_parity(const FactorCovariance& cov,
+                                   const std::vector<double>& budgets = {},
+                                   const RiskParityConfig& cfg = {},
+                                   const PortfolioResult* warm = nullptr) {
+    QF_TRACE_SCOPE_CAT("risk_parity", "portfolio");
+    cov.validate();
+    const std::size_t n = cov.assets, k = cov.factors;
+    const std::vector<double> b = detail::risk_budgets(budgets, n);
+
+    std::vector<double> L = cov.factor_covariance;
+    detail::cholesky_psd(L.data(), k);
+    std::vector<double> root(n * k, 0.0), diag(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        const double* e = cov.exposures.data() + i * k;
+        double* r = root.data() + i * k;
+        for (std::size_t a = 0; a < k; ++a)
+            for (std::size_t c = 0; c <= a; ++c)
+                r[c] += e[a] * L[a * k + c];
+        diag[i] = cov.specific_variance[i];
+        for (std::size_t c = 0; c < k; ++c)
+            diag[i] += r[c] * r[c];
+    }
+
+    std::vector<double> t(k);  // Rᵀ y
+    auto factor_root = [&](const std::vector<double>& y) {
+        std::fill(t.begin(), t.end(), 0.0);
+        for (std::size_t i = 0; i < n; ++i)
+            for (std::size_t c = 0; c < k; ++c)
+                t[c] += root[i * k + c] * y[i];
+    };
+    std::vector<double> y = detail::ccd_start(diag, warm, [&](const std::vector<double>& y0) {
+        factor_root(y0);
+        double v = 0.0;
+        for (std::size_t i = 0; i < n; ++i)
+            v += cov.specific_variance[i] * y0[i] * y0[i];
+        for (std::size_t c = 0; c < k; ++c)
+            v += t[c] * t[c];
+        return v;
+    });
+    factor_root(y);
+
+    PortfolioResult res;
+    double variance = 0.0;
+    for (std::size_t sweep = 0; sweep < cfg.max_sweeps; ++sweep) {
+        for (std::size_t i = 0; i < n; ++i) {
+            const double* r = root.data() + i * k;
+            double sy = cov.specific_variance[i] * y[i];  // (Σ y)_i
+            for (std::size_t c = 0; c < k; ++c)
+                sy += r[c] * t[c];
+            const double yi = detail::ccd_step(diag[i], sy - diag[i] * y[i], b[i]);
+            const double dy = yi - y[i];
+            for (std::size_t c = 0; c < k; ++c)
+                t[c] += r[c] * dy;
+            y[i] = yi;
+        }
+        // At the optimum y_i (Σ y)_i = b_i, and yᵀΣy = Σ b = 1.
+        double err = 0.0;
+        variance = 0.0;
+        for (std::size_t i = 0; i < n; ++i) {
+            const double* r = root.data() + i * k;
+            double sy = cov.specific_variance[i] * y[i];
+            for (std::size_t c = 0; c < k; ++c)
+                sy += r[c] * t[c];
+            variance += y[i] * sy;
+            err = std::max(err, std::abs(y[i] * sy / b[i] - 1.0));
+        }
+        res.iterations = sweep + 1;
+        res.primal_residual = err;
+        if (err <= cfg.tolerance) {
+            res.status = OptimizerStatus::Converged;
+            break;
+        }
+    }
+    detail::ccd_finish(res, y, variance);
+    return res;
+}
+
+// @brief Risk parity under a dense covariance; a sweep is O(n²).
+inline PortfolioResult risk_parity(const PackedSymmetric& cov,
+                                   const std::vector<double>& budgets = {},
+                                   const RiskParityConfig& cfg = {},
+                                   const PortfolioResult* warm = nullptr) {
+    QF_TRACE_SCOPE_CAT("risk_parity", "portfolio");
+    const std::size_t n = cov.dim();
+    const std::vector<double> b = detail::risk_budgets(budgets, n);
+    std::vector<double> diag(n);
+    for (std::size_t i = 0; i < n; ++i)
+        diag[i] = cov(i, i);
+
+    std::vector<double> g(n);  // g = Σ y
+    std::vector<double> y = detail::ccd_start(diag, warm, [&](const std::vector<double>& y0) {
+        cov.multiply(y0.data(), g.data());
+        double v = 0.0;
+        for (std::size_t i = 0; i < n; ++i)
+            v += y0[i] * g[i];
+        return v;
+    });
+    cov.multiply(y.data(), g.data());
+
+    PortfolioResult res;
+    double variance = 0.0;
+    for (std::size_t sweep = 0; sweep < cfg.max_sweeps; ++sweep) {
+        for (std::size_t i = 0; i < n; ++i) {
+            const double yi = detail::ccd_step(diag[i], g[i] - diag[i] * y[i], b[i]);
+            const double dy = yi - y[i];
+            // g += dy Σ e_i: row i below the diagonal, column i above it.
+            const double* r = cov.row(i);
+            for (std::size_t j = 0; j <= i; ++j)
+                g[j] += dy * r[j];
+            for (std::size_t j = i + 1; j < n; ++j)
+                g[j] += dy * cov.row(j)[i];
+            y[i] = yi;
+        }
+        double err = 0.0;
+        variance = 0.0;
+        for (std::size_t i = 0; i < n; ++i) {
+            variance += y[i] * g[i];
+            err = std::max(err, std::abs(y[i] * g[i] / b[i] - 1.0));
+        }
+        res.iterations = sweep + 1;
+        res.primal_residual = err;
+        if (err <= cfg.tolerance) {
+            res.status = OptimizerStatus::Converged;
+            break;
+        }
+    }
+    detail::ccd_finish(res, y, variance);
+    return res;
+}
+
+} // namespace qf
+
+#endif // QF_PORTFOLIO_OPTIMIZER_H
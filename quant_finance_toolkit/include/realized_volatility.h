@@ -0,0 +1,473 @@
+#ifndef QF_REALIZED_VOLATILITY_H
+#define QF_REALIZED_VOLATILITY_H
+
+/**
+ * @file realized_volatility.h
+ * @author John Jacobson
+ * @brief Streaming realized-volatility estimators over a trade tape or
+ *        replayed OHLC bars.
+ *
+ * Every estimator keeps running sums only. An update is O(1), or O(H) for
+ * the realized kernel with its fixed bandwidth H. Every estimator also
+ * has merge(), so per-day states can be combined into multi-day figures
+ * while a session is still running. Variances are in units of log-return²
+ * over the data fed in. annualized_vol() converts one to an annualized
+ * vol for comparison with implied vols.
+ *
+ * Tick estimators (fed with add(t, price) or add(t, Trade)):
+ *   - RealizedVariance: Σ r² of calendar-time sampled returns (previous
+ *     tick rule) at one interval, together with bipower variation
+ *     (π/2) Σ |r_i| |r_{i−1}|, which is robust to jumps. Use one per
+ *     sampling frequency.
+ *   - RealizedKernel: Barndorff-Nielsen, Hansen, Lunde & Shephard (2009),
+ *     Σ_{|h|≤H} k(h / (H+1)) γ_h with the Parzen weight, on tick-time or
+ *     sampled returns. It is robust to microstructure noise.
+ *
+ * Range estimators (fed with OHLC bars, from BarAggregator or a replay):
+ *   Parkinson, Garman–Klass, Rogers–Satchell and Yang–Zhang, in RangeVolatility.
+ *
+ * Merging treats the states as consecutive sessions. Sampled returns and
+ * kernel autocovariances do not cross the boundary; the overnight return
+ * (next open over previous close) does enter Yang–Zhang.
+ *
+ * Trade carries no timestamp, so callers pass the event time (any unit,
+ * e.g. seconds since the open) alongside it.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "orderbook_simulator.h"
+
+namespace qf {
+
+inline double annualized_vol(double variance, double periods_per_year) {
+    return std::sqrt(std::max(variance, 0.0) * periods_per_year);
+}
+
+// =======================
+// Calendar-time sampling
+// =======================
+
+namespace detail {
+
+/**
+ * Previous-tick sampler on a grid of step `interval` (0 = every tick). The
+ * price sampled at grid point g is the last price at or before g; empty
+ * grid cells produce zero returns and are skipped.
+ */
+class ReturnSampler {
+public:
+    explicit ReturnSampler(double interval = 0.0) : interval_(interval) {
+        if (interval_ < 0.0)
+            throw std::runtime_error("ReturnSampler: interval must be >= 0");
+    }
+
+    // Returns true and sets r when the tick (log price lp) closes a
+    // sampling interval.
+    bool add(double t, double lp, double& r) {
+        if (!started_) {
+            started_ = true;
+            last_ = sampled_ = lp;
+            next_ = interval_ > 0.0 ? (std::floor(t / interval_) + 1.0) * interval_ : t;
+            return false;
+        }
+        bool out = false;
+        if (interval_ == 0.0) {
+            r = lp - sampled_;
+            sampled_ = lp;
+            out = true;
+        } else if (t >= next_) {
+            // The tick at t comes after grid point(s) ≤ t: sample the
+            // previous price there.
+            r = last_ - sampled_;
+            sampled_ = last_;
+            next_ = (std::floor(t / interval_) + 1.0) * interval_;
+            out = true;
+        }
+        last_ = lp;
+        return out;
+    }
+
+    // Starts a new session: the next tick opens it without a return.
+    void reset() { started_ = false; }
+
+private:
+    double interval_;
+    bool started_ = false;
+    double last_ = 0.0, sampled_ = 0.0, next_ = 0.0;
+};
+
+} // namespace detail
+
+// =======================
+// Realized variance and bipower variation
+// =======================
+
+class RealizedVariance {
+public:
+    explicit RealizedVariance(double interval = 0.0) : interval_(interval), sampler_(interval) {}
+
+    double interval() const { return interval_; }
+
+    void add(double t, double price) {
+        if (price > 0.0)
+            add_log(t, std::log(price));
+    }
+    void add(double t, const Trade& trade) { add(t, trade.price); }
+
+    void add_log(double t, double log_price) {
+        double r;
+        if (sampler_.add(t, log_price, r))
+            add_return(r);
+    }
+
+    // Feeds a log return directly (e.g. from pre-sampled bars).
+    void add_return(double r) {
+        sum_sq_ += r * r;
+        const double a = std::fabs(r);
+        if (have_prev_)
+            sum_bp_ += a * prev_abs_;
+        prev_abs_ = a;
+        have_prev_ = true;
+        ++n_;
+    }
+
+    // Ends the session: the next tick starts a fresh sampling grid.
+    void end_session() {
+        sampler_.reset();
+        have_prev_ = false;
+    }
+
+    void merge(const RealizedVariance& o) {
+        sum_sq_ += o.sum_sq_;
+        sum_bp_ += o.sum_bp_;
+        n_ += o.n_;
+    }
+
+    std::size_t returns() const { return n_; }
+    double variance() const { return sum_sq_; }
+    double bipower() const { return 0.5 * M_PI * sum_bp_; }
+    // Share of variance from jumps, max(RV − BV, 0) / RV.
+    double jump_share() const {
+        return sum_sq_ > 0.0 ? std::max(sum_sq_ - bipower(), 0.0) / sum_sq_ : 0.0;
+    }
+
+private:
+    double interval_;
+    detail::ReturnSampler sampler_;
+    double sum_sq_ = 0.0, sum_bp_ = 0.0, prev_abs_ = 0.0;
+    bool have_prev_ = false;
+    std::size_t n_ = 0;
+};
+
+// =======================
+// Realized kernel
+// =======================
+
+/**
+ * Parzen realized kernel with bandwidth H. The last H returns sit in a ring
+ * buffer and γ_0 … γ_H accumulate as they arrive. End effects are handled
+ * by dropping autocovariances that would cross the session boundary, not
+ * by jittering.
+ */
+class RealizedKernel {
+public:
+    explicit RealizedKernel(std::size_t bandwidth, double interval = 0.0)
+        : H_(bandwidth), sampler_(interval), ring_(bandwidth + 1, 0.0), gamma_(bandwidth + 1, 0.0),
+          weight_(bandwidth + 1) {
+        for (std::size_t h = 0; h <= H_; ++h)
+            weight_[h] = parzen(static_cast<double>(h) / static_cast<double>(H_ + 1));
+    }
+
+    static double parzen(double x) {
+        if (x <= 0.5)
+            return 1.0 - 6.0 * x * x + 6.0 * x * x * x;
+        if (x <= 1.0)
+            return 2.0 * (1.0 - x) * (1.0 - x) * (1.0 - x);
+        return 0.0;
+    }
+
+    std::size_t bandwidth() const { return H_; }
+
+    void add(double t, double price) {
+        if (price > 0.0)
+            add_log(t, std::log(price));
+    }
+    void add(double t, const Trade& trade) { add(t, trade.price); }
+
+    void add_log(double t, double log_price) {
+        double r;
+        if (sampler_.add(t, log_price, r))
+            add_return(r);
+    }
+
+    void add_return(double r) {
+        // ring_[pos_ − h] for h = 1..lags, walked as two contiguous runs.
+        const std::size_t m = ring_.size();
+        const std::size_t lags = std::min(seen_, H_);
+        const std::size_t first = std::min(lags, pos_);
+        for (std::size_t h = 1; h <= first; ++h)
+            gamma_[h] += r * ring_[pos_ - h];
+        for (std::size_t h = first + 1; h <= lags; ++h)
+            gamma_[h] += r * ring_[pos_ + m - h];
+        gamma_[0] += r * r;
+        ring_[pos_] = r;
+        pos_ = pos_ + 1 == m ? 0 : pos_ + 1;
+        ++seen_;
+        ++n_;
+    }
+
+    /**
+     * @brief Bandwidth rule of BNHLS (2009) for the Parzen kernel,
+     * H* = 3.5134 ξ^{4/5} n^{3/5} with ξ² = ω² / IV: noise variance over
+     * integrated variance, e.g. ω² ≈ RV_tick / (2 n_tick) and IV from a
+     * sparse RV.
+     */
+    static std::size_t optimal_bandwidth(double noise_var, double integrated_var, std::size_t n) {
+        const double xi2 = noise_var / std::max(integrated_var, 1e-300);
+        const double h = 3.5134 * std::pow(xi2, 0.4) * std::pow(static_cast<double>(n), 0.6);
+        return std::max<std::size_t>(1, static_cast<std::size_t>(std::ceil(h)));
+    }
+
+    void end_session() {
+        sampler_.reset();
+        seen_ = 0;
+    }
+
+    void merge(const RealizedKernel& o) {
+        if (o.H_ != H_)
+            throw std::runtime_error("RealizedKernel::merge: bandwidths differ");
+        for (std::size_t h = 0; h <= H_; ++h)
+            gamma_[h] += o.gamma_[h];
+        n_ += o.n_;
+    }
+
+    std::size_t returns() const { return n_; }
+
+    double variance() const {
+        double k = gamma_[0];
+        for (std::size_t h = 1; h <= H_; ++h)
+            k += 2.0 * weight_[h] * gamma_[h];
+        return std::max(k, 0.0);
+    }
+
+private:
+    std::size_t H_;
+    detail::ReturnSampler sampler_;
+    std::vector<double> ring_, gamma_, weight_;
+    std::size_t pos_ = 0, seen_ = 0, n_ = 0;
+};
+
+// =======================
+// OHLC bars and range estimators
+// =======================
+
+struct Bar {
+    double open, high, low, close;
+};
+
+/**
+ * Builds OHLC bars of length `interval` from ticks. add() returns true and
+ * fills `out` when a tick opens a new bar, so the completed bar is the
+ * previous one; flush() emits the bar in progress at the end of a session.
+ */
+class BarAggregator {
+public:
+    explicit BarAggregator(double interval) : interval_(interval) {
+        if (!(interval_ > 0.0))
+            throw std::runtime_error("BarAggregator: interval must be positive");
+    }
+
+    bool add(double t, double price, Bar& out) {
+        const double slot = std::floor(t / interval_);
+        bool done = false;
+        if (open_ && slot != slot_) {
+            out = bar_;
+            done = true;
+            open_ = false;
+        }
+        if (!open_) {
+            bar_ = {price, price, price, price};
+            slot_ = slot;
+            open_ = true;
+        } else {
+            bar_.high = std::max(bar_.high, price);
+            bar_.low = std::min(bar_.low, price);
+            bar_.close = price;
+        }
+        return done;
+    }
+
+    bool flush(Bar& out) {
+        if (!open_)
+            return false;
+        out = bar_;
+        open_ = false;
+        return true;
+    }
+
+private:
+    double interval_;
+    double slot_ = 0.0;
+    bool open_ = false;
+    Bar bar_{};
+};
+
+/**
+ * Parkinson, Garman–Klass, Rogers–Satchell and Yang–Zhang variances per bar
+ * from running sums over bars. Yang–Zhang combines the overnight (open over
+ * previous close) variance, the open-to-close variance and Rogers–Satchell
+ * with k = 0.34 / (1.34 + (n + 1) / (n − 1)).
+ */
+class RangeVolatility {
+public:
+    void add_bar(const Bar& b) {
+        const double o = std::log(b.open), h = std::log(b.high), l = std::log(b.low),
+                     c = std::log(b.close);
+        if (n_ == 0) {
+            first_open_ = o;
+        } else {
+            const double on = o - last_close_;
+            s_on_ += on;
+            s_on2_ += on * on;
+            ++n_on_;
+        }
+        last_close_ = c;
+
+        const double hl = h - l, co = c - o;
+        s_pk_ += hl * hl;
+        s_gk_ += 0.5 * hl * hl - (2.0 * M_LN2 - 1.0) * co * co;
+        s_rs_ += (h - c) * (h - o) + (l - c) * (l - o);
+        s_oc_ += co;
+        s_oc2_ += co * co;
+        ++n_;
+    }
+
+    // Appends a later session; its first open against our last close is
+    // one more overnight return.
+    void merge(const RangeVolatility& o) {
+        if (o.n_ == 0)
+            return;
+        if (n_ > 0) {
+            const double on = o.first_open_ - last_close_;
+            s_on_ += on;
+            s_on2_ += on * on;
+            ++n_on_;
+        } else {
+            first_open_ = o.first_open_;
+        }
+        last_close_ = o.last_close_;
+        s_on_ += o.s_on_;
+        s_on2_ += o.s_on2_;
+        n_on_ += o.n_on_;
+        s_pk_ += o.s_pk_;
+        s_gk_ += o.s_gk_;
+        s_rs_ += o.s_rs_;
+        s_oc_ += o.s_oc_;
+        s_oc2_ += o.s_oc2_;
+        n_ += o.n_;
+    }
+
+    std::size_t bars() const { return n_; }
+
+    double parkinson() const { return n_ ? s_pk_ / (4.0 * M_LN2 * n_) : 0.0; }
+    double garman_klass() const { return n_ ? s_gk_ / n_ : 0.0; }
+    double rogers_satchell() const { return n_ ? s_rs_ / n_ : 0.0; }
+
+    double yang_zhang() const {
+        if (n_ < 2)
+            return rogers_satchell();
+        const double n = static_cast<double>(n_);
+        const double k = 0.34 / (1.34 + (n + 1.0) / (n - 1.0));
+        const double var_oc = sample_variance(s_oc_, s_oc2_, n);
+        const double var_on =
+            n_on_ >= 2 ? sample_variance(s_on_, s_on2_, static_cast<double>(n_on_)) : 0.0;
+        return var_on + k * var_oc + (1.0 - k) * rogers_satchell();
+    }
+
+private:
+    static double sample_variance(double s, double s2, double n) {
+        return std::max((s2 - s * s / n) / (n - 1.0), 0.0);
+    }
+
+    double first_open_ = 0.0, last_close_ = 0.0;
+    double s_on_ = 0.0, s_on2_ = 0.0;
+    double s_pk_ = 0.0, s_gk_ = 0.0, s_rs_ = 0.0, s_oc_ = 0.0, s_oc2_ = 0.0;
+    std::size_t n_ = 0, n_on_ = 0;
+};
+
+// =======================
+// Combined tracker
+// =======================
+
+struct RealizedVolConfig {
+    std::vector<double> intervals{1.0, 5.0, 60.0, 300.0};  // RV sampling steps
+    std::size_t kernel_bandwidth = 30;
+    double kernel_interval = 1.0;                           // 0 = tick time
+    double bar_interval = 300.0;                            // for range estimators
+};
+
+/**
+ * Every estimator above fed from one tape: RV / BV per interval, the
+ * realized kernel, and range estimators on bars built from the ticks.
+ */
+class RealizedVolTracker {
+public:
+    explicit RealizedVolTracker(const RealizedVolConfig& cfg = {})
+        : kernel_(cfg.kernel_bandwidth, cfg.kernel_interval), bars_(cfg.bar_interval) {
+        for (double dt : cfg.intervals)
+            rv_.emplace_back(dt);
+    }
+
+    void add(double t, double price) {
+        if (!(price > 0.0))
+            return;
+        const double lp = std::log(price);
+        for (auto& rv : rv_)
+            rv.add_log(t, lp);
+        kernel_.add_log(t, lp);
+        Bar b;
+        if (bars_.add(t, price, b))
+            range_.add_bar(b);
+    }
+    void add(double t, const Trade& trade) { add(t, trade.price); }
+
+    // Closes the session: flushes the open bar and cuts sampling.
+    void end_session() {
+        for (auto& rv : rv_)
+            rv.end_session();
+        kernel_.end_session();
+        Bar b;
+        if (bars_.flush(b))
+            range_.add_bar(b);
+    }
+
+    void merge(const RealizedVolTracker& o) {
+        if (o.rv_.size() != rv_.size())
+            throw std::runtime_error("RealizedVolTracker::merge: configurations differ");
+        for (std::size_t i = 0; i < rv_.size(); ++i)
+            rv_[i].merge(o.rv_[i]);
+        kernel_.merge(o.kernel_);
+        range_.merge(o.range_);
+    }
+
+    const std::vector<RealizedVariance>& realized() const { return rv_; }
+    const RealizedKernel& kernel() const { return kernel_; }
+    const RangeVolatility& range() const { return range_; }
+
+private:
+    std::vector<RealizedVariance> rv_;
+    RealizedKernel kernel_;
+    BarAggregator bars_;
+    RangeVolatility range_;
+};
+
+} // namespace qf
+
+#endif // QF_REALIZED_VOLATILITY_H
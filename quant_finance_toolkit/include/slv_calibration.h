@@ -0,0 +1,368 @@
+#ifndef QF_SLV_CALIBRATION_H
+#define QF_SLV_CALIBRATION_H
+
+/**
+ * @file slv_calibration.h
+ * @author John Jacobson
+ * @brief Stochastic local volatility: leverage calibration by the particle
+ *        method and a path generator for the Monte Carlo engine.
+ *
+ * The model is Heston with a leverage function L(t, S) on the spot
+ * diffusion:
+ *
+ *     dS / S = (r − q) dt + L(t, S) √v dW1
+ *     dv     = κ (θ − v) dt + ξ √v dW2,      d⟨W1, W2⟩ = ρ dt
+ *
+ * It reprices every vanilla when L² = σ_LV² / E[v | S_t = S], where σ_LV is
+ * the Dupire local vol of the implied surface (Gyöngy's theorem). The
+ * conditional expectation depends on L itself, so calibrate_slv()
+ * follows Guyon & Henry-Labordère (2012). It simulates N particles (x, v)
+ * step by step and estimates E[v | x] at t_k from the particles
+ * themselves. L(t_k, ·) is computed from that estimate before stepping
+ * the particles to t_{k+1}.
+ *
+ * Per step the estimate is a binned kernel regression in log-forward-
+ * moneyness x = ln(S / F(t)):
+ *
+ *   1. Each particle is linearly binned into the two nearest grid nodes
+ *      (Σ w and Σ w v per node). The particle update and the binning are
+ *      fused into one parallel_reduce over fixed chunks of particles, so
+ *      the histogram and the result do not depend on the thread count.
+ *   2. The node histograms are smoothed with a Gaussian kernel of
+ *      bandwidth h = bandwidth · σ_ATM √max(t, 0.25) · N^{−1/5}.
+ *
+ * The leverage is stored in LeverageGrid: one contiguous row of uniformly
+ * spaced x nodes per time step. A lookup is an index computation and one
+ * linear interpolation, with no search.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "metrics.h"
+#include "multi_asset_mc.h"
+#include "thread_pool.h"
+#include "trace.h"
+
+namespace qf {
+
+struct HestonParams {
+    double v0 = 0.04;     // initial variance
+    double kappa = 1.5;   // mean reversion speed
+    double theta = 0.04;  // long-run variance
+    double xi = 0.5;      // vol of variance
+    double rho = -0.7;    // spot / variance correlation
+};
+
+struct SlvConfig {
+    std::size_t particles = 1u << 16;
+    std::size_t steps_per_year = 100;
+    std::size_t x_nodes = 101;        // leverage grid nodes per time step
+    double x_width = 5.0;             // grid spans ±x_width σ_ATM √T in x
+    double bandwidth = 1.5;           // kernel bandwidth multiplier
+    double min_leverage = 0.01;
+    double max_leverage = 10.0;
+    std::size_t grain = 4096;         // particles per parallel chunk
+    std::uint64_t seed = 7;
+};
+
+// =======================
+// Leverage grid
+// =======================
+
+/**
+ * Piecewise-constant in time (L(t_k, ·) applies on [t_k, t_{k+1})) and
+ * piecewise-linear in x = ln(S / F(t)) on uniform nodes, flat outside.
+ * Values are stored [step][node].
+ */
+class LeverageGrid {
+public:
+    LeverageGrid() = default;
+    LeverageGrid(double spot, double r, double q, double dt, std::size_t steps, double x_min,
+                 double x_max, std::size_t nodes)
+        : spot_(spot), r_(r), q_(q), dt_(dt), steps_(steps), x_min_(x_min), nodes_(nodes),
+          dx_((x_max - x_min) / static_cast<double>(nodes - 1)), values_(steps * nodes, 1.0) {}
+
+    std::size_t steps() const { return steps_; }
+    std::size_t nodes() const { return nodes_; }
+    double dt() const { return dt_; }
+    double x_node(std::size_t j) const { return x_min_ + dx_ * static_cast<double>(j); }
+    double forward(double t) const { return spot_ * std::exp((r_ - q_) * t); }
+
+    double* row(std::size_t step) { return values_.data() + step * nodes_; }
+    const double* row(std::size_t step) const { return values_.data() + step * nodes_; }
+
+    // Leverage during step k at log-forward-moneyness x.
+    double at_step(std::size_t k, double x) const {
+        const double* v = row(std::min(k, steps_ - 1));
+        const double u = (x - x_min_) / dx_;
+        if (!(u > 0.0))
+            return v[0];
+        if (u >= static_cast<double>(nodes_ - 1))
+            return v[nodes_ - 1];
+        const std::size_t j = static_cast<std::size_t>(u);
+        const double f = u - static_cast<double>(j);
+        return v[j] + f * (v[j + 1] - v[j]);
+    }
+
+    double operator()(double t, double S) const {
+        const std::size_t k = t > 0.0 ? static_cast<std::size_t>(t / dt_) : 0;
+        return at_step(k, std::log(S / forward(t)));
+    }
+
+private:
+    double spot_ = 0.0, r_ = 0.0, q_ = 0.0, dt_ = 0.0;
+    std::size_t steps_ = 0;
+    double x_min_ = 0.0;
+    std::size_t nodes_ = 0;
+    double dx_ = 0.0;
+    std::vector<double> values_;
+};
+
+// =======================
+// Dupire local vol
+// =======================
+
+/**
+ * @brief Dupire local vol at time t and log-forward-moneyness y from an
+ * implied vol callable iv(T, K), through total implied variance
+ * w(y, T) = iv² T (Gatheral 2006, eq. 1.10). Derivatives are central
+ * differences. The local variance is floored at 1e-8 where the surface
+ * has calendar or butterfly arbitrage (∂w/∂T ≤ 0 or a non-positive
+ * denominator).
+ */
+template <typename ImpliedVol>
+double dupire_local_vol(const ImpliedVol& iv, double spot, double r, double q, double t,
+                        double y) {
+    auto w = [&](double yy, double T) {
+        const double K = spot * std::exp((r - q) * T + yy);
+        const double s = iv(T, K);
+        return s * s * T;
+    };
+    const double T = std::max(t, 1e-4);
+    const double dT = std::min(1e-3, 0.5 * T), dy = 1e-3;
+    const double w0 = w(y, T);
+    const double wT = (w(y, T + dT) - w(y, T - dT)) / (2.0 * dT);
+    const double wp = w(y + dy, T), wm = w(y - dy, T);
+    const double wy = (wp - wm) / (2.0 * dy);
+    const double wyy = (wp - 2.0 * w0 + wm) / (dy * dy);
+    const double den = 1.0 - y / w0 * wy + 0.25 * (-0.25 - 1.0 / w0 + y * y / (w0 * w0)) * wy * wy +
+                       0.5 * wyy;
+    if (!(wT > 0.0) || !(den > 0.0))
+        return 1e-4;
+    return std::sqrt(std::max(wT / den, 1e-8));
+}
+
+// =======================
+// Particle calibration
+// =======================
+
+namespace detail {
+
+// One Euler step of the SLV dynamics in (x, v), full truncation for v.
+inline void slv_step(double& x, double& v, double lev, const HestonParams& h, double dt,
+                     double sqrt_dt, double rho_bar, double z1, double z2) {
+    const double vp = std::max(v, 0.0);
+    const double sv = std::sqrt(vp) * sqrt_dt;
+    x += -0.5 * lev * lev * vp * dt + lev * sv * z1;
+    v += h.kappa * (h.theta - vp) * dt + h.xi * sv * (h.rho * z1 + rho_bar * z2);
+}
+
+} // namespace detail
+
+/**
+ * @brief Calibrates the leverage function so that the SLV model reprices
+ * the implied surface `iv(T, K)` up to `maturity`.
+ *
+ * Cost is O(particles · steps) for the simulation plus
+ * O(nodes · kernel width · steps) for the regressions; 65k particles over
+ * 100 steps take well under a second on one core.
+ */
+template <typename ImpliedVol>
+LeverageGrid calibrate_slv(double spot, double r, double q, double maturity,
+                           const HestonParams& heston, const ImpliedVol& iv,
+                           const SlvConfig& cfg = {}) {
+    QF_TRACE_SCOPE_CAT("calibrate_slv", "slv");
+    if (!(spot > 0.0) || !(maturity > 0.0) || cfg.particles == 0 || cfg.x_nodes < 3 ||
+        !(heston.v0 > 0.0))
+        throw std::runtime_error("calibrate_slv: need spot, maturity, v0 > 0 and >= 3 nodes");
+
+    const std::size_t steps = std::max<std::size_t>(
+        1, static_cast<std::size_t>(std::ceil(maturity * static_cast<double>(cfg.steps_per_year))));
+    const double dt = maturity / static_cast<double>(steps), sqrt_dt = std::sqrt(dt);
+    const double rho_bar = std::sqrt(std::max(1.0 - heston.rho * heston.rho, 0.0));
+
+    const double atm = iv(maturity, spot * std::exp((r - q) * maturity));
+    const double half_width = cfg.x_width * atm * std::sqrt(maturity);
+    const std::size_t nx = cfg.x_nodes;
+    LeverageGrid grid(spot, r, q, dt, steps, -half_width, half_width, nx);
+
+    // Local vol on the same nodes, at the start of every step.
+    std::vector<double> local_vol(steps * nx);
+    for (std::size_t k = 0; k < steps; ++k)
+        for (std::size_t j = 0; j < nx; ++j)
+            local_vol[k * nx + j] =
+                dupire_local_vol(iv, spot, r, q, std::max(static_cast<double>(k), 0.5) * dt,
+                                 grid.x_node(j));
+
+    const std::size_t n = cfg.particles;
+    std::vector<double> x(n, 0.0), v(n, heston.v0);
+    const double dx = grid.x_node(1) - grid.x_node(0);
+    const double inv_dx = 1.0 / dx;
+    const double x_min = grid.x_node(0);
+
+    // At t = 0 every particle has v = v0.
+    {
+        double* L = grid.row(0);
+        for (std::size_t j = 0; j < nx; ++j)
+            L[j] = std::clamp(local_vol[j] / std::sqrt(heston.v0), cfg.min_leverage,
+                              cfg.max_leverage);
+    }
+
+    std::vector<double> kernel;
+    for (std::size_t k = 0; k + 1 < steps; ++k) {
+        // Step every particle to t_{k+1} with L(t_k, ·) and bin the result
+        // as [Σ w | Σ w v] per node.
+        auto map = [&](std::size_t lo, std::size_t hi) {
+            std::vector<double> hist(2 * nx, 0.0);
+            detail::Xoshiro256 rng(cfg.seed, (static_cast<std::uint64_t>(k) << 32) | (lo / cfg.grain));
+            double z[2];
+            for (std::size_t i = lo; i < hi; ++i) {
+                detail::fill_normals(rng, z, 2);
+                detail::slv_step(x[i], v[i], grid.at_step(k, x[i]), heston, dt, sqrt_dt, rho_bar,
+                                 z[0], z[1]);
+
+                const double u = std::clamp((x[i] - x_min) * inv_dx, 0.0,
+                                            static_cast<double>(nx - 1) - 1e-9);
+                const std::size_t j = static_cast<std::size_t>(u);
+                const double f = u - static_cast<double>(j), vp = std::max(v[i], 0.0);
+                hist[j] += 1.0 - f;
+                hist[j + 1] += f;
+                hist[nx + j] += (1.0 - f) * vp;
+                hist[nx + j + 1] += f * vp;
+            }
+            return hist;
+        };
+        auto combine = [](std::vector<double> a, const std::vector<double>& b) {
+            for (std::size_t i = 0; i < a.size(); ++i)
+                a[i] += b[i];
+            return a;
+        };
+        std::vector<double> hist = parallel_reduce(default_thread_pool(), 0, n,
+                                                   std::max<std::size_t>(cfg.grain, 1),
+                                                   std::vector<double>(2 * nx, 0.0), map, combine);
+
+        // Gaussian kernel over node offsets, truncated at 4 bandwidths.
+        const double t = static_cast<double>(k + 1) * dt;
+        const double h = cfg.bandwidth * atm * std::sqrt(std::max(t, 0.25)) *
+                         std::pow(static_cast<double>(n), -0.2);
+        const std::size_t reach = std::min<std::size_t>(
+            nx - 1, static_cast<std::size_t>(std::ceil(4.0 * h * inv_dx)));
+        kernel.resize(reach + 1);
+        for (std::size_t d = 0; d <= reach; ++d) {
+            const double s = static_cast<double>(d) * dx / h;
+            kernel[d] = std::exp(-0.5 * s * s);
+        }
+
+        double total_w = 0.0, total_v = 0.0;
+        for (std::size_t j = 0; j < nx; ++j) {
+            total_w += hist[j];
+            total_v += hist[nx + j];
+        }
+        const double mean_v = total_v / total_w;
+
+        double* L = grid.row(k + 1);
+        const double* lv = local_vol.data() + (k + 1) * nx;
+        for (std::size_t j = 0; j < nx; ++j) {
+            const std::size_t lo = j >= reach ? j - reach : 0;
+            const std::size_t hi = std::min(nx - 1, j + reach);
+            double sw = 0.0, sv = 0.0;
+            for (std::size_t b = lo; b <= hi; ++b) {
+                const double kw = kernel[b > j ? b - j : j - b];
+                sw += kw * hist[b];
+                sv += kw * hist[nx + b];
+            }
+            // Thin tails fall back towards the unconditional mean.
+            const double prior = 1e-3 * static_cast<double>(n) / static_cast<double>(nx);
+            const double ev = (sv + prior * mean_v) / (sw + prior);
+            L[j] = std::clamp(lv[j] / std::sqrt(std::max(ev, 1e-10)), cfg.min_leverage,
+                              cfg.max_leverage);
+        }
+    }
+
+    QF_METRIC_INC("qf_slv_calibrations_total", "SLV leverage calibrations run");
+    return grid;
+}
+
+// =======================
+// Path generation
+// =======================
+
+/**
+ * @brief SLV paths of the spot on the leverage grid's time steps, as
+ * single-asset PathBlocks. Plugs into mc_price() and the payoff DSL, so
+ * barriers are monitored at every calibration step.
+ */
+class SlvPathGenerator {
+public:
+    SlvPathGenerator(double spot, double r, double q, const HestonParams& heston,
+                     LeverageGrid leverage, std::size_t block = 512)
+        : spot_(spot), r_(r), q_(q), heston_(heston), lev_(std::move(leverage)),
+          block_(block) {
+        if (lev_.steps() == 0 || block_ == 0)
+            throw std::runtime_error("SlvPathGenerator: empty leverage grid or block");
+    }
+
+    std::size_t block_size() const { return block_; }
+    std::size_t steps() const { return lev_.steps(); }
+    double maturity() const { return lev_.dt() * static_cast<double>(lev_.steps()); }
+    bool antithetic() const { return false; }
+    double discount_factor() const { return std::exp(-r_ * maturity()); }
+    const LeverageGrid& leverage() const { return lev_; }
+
+    PathBlock generate(std::uint64_t seed, std::uint64_t index, PathWorkspace& ws) const {
+        const std::size_t m = block_, steps = lev_.steps();
+        const double dt = lev_.dt(), sqrt_dt = std::sqrt(dt);
+        const double rho_bar = std::sqrt(std::max(1.0 - heston_.rho * heston_.rho, 0.0));
+        ws.x.assign(m, 0.0);
+        ws.z.assign(m, heston_.v0);  // variance per path
+        ws.paths.resize(steps * m);
+
+        detail::Xoshiro256 rng(seed, index);
+        double z[2];
+        for (std::size_t k = 0; k < steps; ++k) {
+            const double F = lev_.forward(static_cast<double>(k + 1) * dt);
+            double* out = ws.paths.data() + k * m;
+            for (std::size_t p = 0; p < m; ++p) {
+                detail::fill_normals(rng, z, 2);
+                detail::slv_step(ws.x[p], ws.z[p], lev_.at_step(k, ws.x[p]), heston_, dt, sqrt_dt,
+                                 rho_bar, z[0], z[1]);
+                out[p] = F * std::exp(ws.x[p]);
+            }
+        }
+
+        PathBlock b;
+        b.paths = m;
+        b.assets = 1;
+        b.steps = steps;
+        b.dt = dt;
+        b.data = ws.paths.data();
+        b.spot = &spot_;
+        return b;
+    }
+
+private:
+    double spot_, r_, q_;
+    HestonParams heston_;
+    LeverageGrid lev_;
+    std::size_t block_;
+};
+
+} // namespace qf
+
+#endif // QF_SLV_CALIBRATION_H
@@ -0,0 +1,655 @@
+#ifndef QF_STREAMING_PIPELINE_H
+#define QF_STREAMING_PIPELINE_H
+
+/**
+ * @file streaming_pipeline.h
+ * @author John Jacobson
+ * @brief Stage-based streaming pipeline: quotes → IV → surface → arbitrage alerts.
+ *
+ * Running quote handling, IV solving, surface updates and detect_arbitrage
+ * as one blocking loop means every step waits for the slowest one and most
+ * cores sit idle. Here each step is a stage with its own worker threads,
+ * connected by bounded queues:
+ *
+ *   ReplaySource ─▶ [IV ×N] ─▶ [surface ×1] ─▶ [detect ×M] ─▶ [sink ×1]
+ *
+ *   - Backpressure: a full queue blocks the producer, so a slow stage
+ *     throttles the feed instead of growing memory without bound.
+ *   - Batching: workers pop up to max_batch items at once, which amortizes
+ *     queue synchronization. The surface stage also conflates: one snapshot
+ *     per symbol per batch, however many ticks touched it.
+ *   - Stage parallelism: stateless stages (IV, detection) run several
+ *     workers; the stateful surface stage runs one.
+ *
+ * Stages use dedicated threads rather than the fork-join ThreadPool: they
+ * block on queues for their whole lifetime, which would starve pool tasks.
+ *
+ * C++17, so stages are threads plus queues rather than C++20 coroutines.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "memory_arena.h"
+#include "metrics.h"
+#include "options_greeks.h"
+#include "trace.h"
+#include "vol_surface_arbitrage.h"
+
+namespace qf {
+
+// =======================
+// Bounded queue
+// =======================
+
+/**
+ * Multi-producer / multi-consumer queue with a fixed capacity. push()
+ * blocks while the queue is full; pop_batch() takes everything available up
+ * to a limit, and push_batch() the reverse. close() wakes everyone: pushes
+ * fail and pops drain what is left, then return 0.
+ */
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(std::size_t capacity) : capacity_(std::max<std::size_t>(capacity, 1)) {}
+
+    bool push(T item) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (items_.size() >= capacity_) {
+            ++blocked_pushes_;
+            not_full_.wait(lock, [&] { return items_.size() < capacity_ || closed_; });
+        }
+        if (closed_)
+            return false;
+        items_.push_back(std::move(item));
+        high_water_ = std::max(high_water_, items_.size());
+        lock.unlock();
+        not_empty_.notify_one();
+        return true;
+    }
+
+    /**
+     * @brief Push all of `items` (moved from), taking the lock once per run
+     * of free space rather than once per item. Returns false if the queue
+     * was closed before everything went in.
+     */
+    bool push_batch(std::vector<T>& items) {
+        std::size_t i = 0;
+        while (i < items.size()) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (items_.size() >= capacity_) {
+                ++blocked_pushes_;
+                not_full_.wait(lock, [&] { return items_.size() < capacity_ || closed_; });
+            }
+            if (closed_)
+                return false;
+            std::size_t n = std::min(items.size() - i, capacity_ - items_.size());
+            for (std::size_t k = 0; k < n; ++k)
+                items_.push_back(std::move(items[i + k]));
+            i += n;
+            high_water_ = std::max(high_water_, items_.size());
+            lock.unlock();
+            not_empty_.notify_all();
+        }
+        return true;
+    }
+
+    // Blocks until at least one item is available or the queue is closed.
+    std::size_t pop_batch(std::vector<T>& out, std::size_t max_items) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_empty_.wait(lock, [&] { return !items_.empty() || closed_; });
+        std::size_t n = std::min(max_items, items_.size());
+        for (std::size_t i = 0; i < n; ++i) {
+            out.push_back(std::move(items_.front()));
+            items_.pop_front();
+        }
+        lock.unlock();
+        if (n > 0)
+            not_full_.notify_all();
+        return n;
+    }
+
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+        }
+        not_empty_.notify_all();
+        not_full_.notify_all();
+    }
+
+    std::size_t capacity() const { return capacity_; }
+
+    // Times a producer had to wait for space (backpressure events).
+    std::uint64_t blocked_pushes() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return blocked_pushes_;
+    }
+
+    std::size_t high_water() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return high_water_;
+    }
+
+private:
+    std::size_t capacity_;
+    std::deque<T> items_;
+    bool closed_ = false;
+    std::uint64_t blocked_pushes_ = 0;
+    std::size_t high_water_ = 0;
+    mutable std::mutex mutex_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+};
+
+// =======================
+// Stages
+// =======================
+
+struct StageStats {
+    std::string name;
+    std::size_t workers = 0;
+    std::uint64_t batches = 0;
+    std::uint64_t items_in = 0;
+    std::uint64_t items_out = 0;
+    std::uint64_t busy_ns = 0;          // summed over workers
+    std::uint64_t blocked_pushes = 0;   // on this stage's output queue
+    std::size_t queue_high_water = 0;   // of this stage's input queue
+    std::size_t queue_capacity = 0;
+};
+
+/**
+ * Owns the worker threads of a pipeline. Each stage reads batches from an
+ * input queue, hands them to a per-worker function and forwards the outputs
+ * to the next queue. When its input is closed and drained, the last worker
+ * of a stage closes the output, so shutdown flows downstream.
+ */
+class Pipeline {
+public:
+    template <typename In, typename Out>
+    using StageFn = std::function<void(std::vector<In>& batch, std::vector<Out>& out)>;
+
+    Pipeline() = default;
+    ~Pipeline() { join(); }
+
+    Pipeline(const Pipeline&) = delete;
+    Pipeline& operator=(const Pipeline&) = delete;
+
+    /**
+     * @brief Add a stage with `workers` threads. `make_worker` is called once
+     * per thread, so each worker can own private state (arenas, caches).
+     * `out` may be null for a sink.
+     */
+    template <typename In, typename Out>
+    void add_stage(std::string name, BoundedQueue<In>& in, BoundedQueue<Out>* out,
+                   std::size_t workers, std::size_t max_batch,
+                   std::function<StageFn<In, Out>()> make_worker) {
+        auto shared = std::make_shared<StageShared>();
+        shared->stats.name = std::move(name);
+        shared->stats.workers = std::max<std::size_t>(workers, 1);
+        shared->remaining = shared->stats.workers;
+        stages_.push_back(shared);
+
+        for (std::size_t w = 0; w < shared->stats.workers; ++w) {
+            threads_.emplace_back([shared, &in, out, max_batch, make_worker] {
+                StageFn<In, Out> fn = make_worker();
+                std::vector<In> batch;
+                std::vector<Out> results;
+                batch.reserve(max_batch);
+                std::uint64_t batches = 0, items_in = 0, items_out = 0, busy = 0;
+
+                while (in.pop_batch(batch, max_batch) > 0) {
+                    auto t0 = metrics::monotonic_ns();
+                    fn(batch, results);
+                    busy += metrics::monotonic_ns() - t0;
+                    ++batches;
+                    items_in += batch.size();
+                    items_out += results.size();
+                    if (out)
+                        out->push_batch(results);
+                    batch.clear();
+                    results.clear();
+                }
+
+                std::lock_guard<std::mutex> lock(shared->mutex);
+                shared->stats.batches += batches;
+                shared->stats.items_in += items_in;
+                shared->stats.items_out += items_out;
+                shared->stats.busy_ns += busy;
+                if (--shared->remaining == 0) {
+                    // Last worker out: the input is drained, record the
+                    // queue counters and pass shutdown downstream.
+                    shared->stats.queue_high_water = in.high_water();
+                    shared->stats.queue_capacity = in.capacity();
+                    if (out) {
+                        shared->stats.blocked_pushes = out->blocked_pushes();
+                        out->close();
+                    }
+                }
+            });
+        }
+    }
+
+    // Run a producer on its own thread (it should close its queue when done).
+    void add_source(std::function<void()> fn) {
+        threads_.emplace_back(std::move(fn));
+    }
+
+    void join() {
+        for (auto& t : threads_)
+            if (t.joinable())
+                t.join();
+        threads_.clear();
+    }
+
+    // Per-stage counters; call after join().
+    std::vector<StageStats> stats() const {
+        std::vector<StageStats> out;
+        for (const auto& s : stages_)
+            out.push_back(s->stats);
+        return out;
+    }
+
+private:
+    struct StageShared {
+        StageStats stats;
+        std::size_t remaining = 0;  // guarded by mutex
+        std::mutex mutex;
+    };
+
+    std::vector<std::shared_ptr<StageShared>> stages_;
+    std::vector<std::thread> threads_;
+};
+
+// =======================
+// Quote → alert pipeline
+// =======================
+
+struct QuoteTick {
+    std::uint64_t seq = 0;
+    std::uint32_t symbol = 0;
+    double strike = 0.0;
+    double maturity = 0.0;
+    double bid = 0.0;        // call quote
+    double ask = 0.0;
+    double spot = 0.0;
+    double rate = 0.0;
+    std::uint64_t ingest_ns = 0;  // stamped by the source
+};
+
+struct IvTick {
+    QuoteTick quote;
+    double implied_vol = 0.0;
+    bool converged = false;
+};
+
+struct SurfaceSnapshot {
+    std::uint32_t symbol = 0;
+    std::uint64_t version = 0;
+    std::vector<OptionQuote> quotes;
+    std::uint64_t oldest_ingest_ns = 0;  // oldest tick folded into this version
+    std::uint64_t newest_ingest_ns = 0;
+    std::size_t ticks = 0;
+};
+
+struct SurfaceCheck {
+    std::uint32_t symbol = 0;
+    std::uint64_t version = 0;
+    std::vector<ArbitrageOpportunity> found;
+    std::uint64_t oldest_ingest_ns = 0;
+    std::uint64_t newest_ingest_ns = 0;
+    std::uint64_t checked_ns = 0;
+};
+
+struct PipelineConfig {
+    std::size_t queue_capacity = 4096;
+    std::size_t max_batch = 256;
+    std::size_t iv_workers = 2;
+    std::size_t detect_workers = 2;
+};
+
+// Percentiles of a latency sample, in nanoseconds.
+struct LatencySummary {
+    std::size_t count = 0;
+    double p50 = 0, p90 = 0, p99 = 0, max = 0, mean = 0;
+
+    static LatencySummary of(std::vector<std::uint64_t> samples) {
+        LatencySummary s;
+        s.count = samples.size();
+        if (samples.empty())
+            return s;
+        std::sort(samples.begin(), samples.end());
+        auto pct = [&](double q) {
+            std::size_t i = static_cast<std::size_t>(q * static_cast<double>(samples.size() - 1));
+            return static_cast<double>(samples[i]);
+        };
+        double sum = 0;
+        for (auto v : samples) sum += static_cast<double>(v);
+        s.p50 = pct(0.50);
+        s.p90 = pct(0.90);
+        s.p99 = pct(0.99);
+        s.max = static_cast<double>(samples.back());
+        s.mean = sum / static_cast<double>(samples.size());
+        return s;
+    }
+};
+
+struct PipelineReport {
+    std::uint64_t ticks = 0;
+    std::uint64_t iv_failures = 0;
+    std::uint64_t stale_ticks = 0;  // arrived after a newer tick for the same point
+    std::uint64_t stale_checks = 0; // reached the sink after a newer version of the symbol
+    std::uint64_t snapshots = 0;
+    std::uint64_t alerts = 0;
+    double elapsed_s = 0.0;
+    // Oldest contributing tick → surface checked (every snapshot), and
+    // oldest contributing tick → alert delivered to the sink.
+    LatencySummary tick_to_check;
+    LatencySummary tick_to_alert;
+    std::vector<StageStats> stages;
+
+    void print(std::ostream& os) const {
+        os << "ticks=" << ticks << " iv_failures=" << iv_failures << " stale=" << stale_ticks
+           << " stale_checks=" << stale_checks
+           << " snapshots=" << snapshots
+           << " alerts=" << alerts << " elapsed=" << elapsed_s << "s ("
+           << (elapsed_s > 0 ? static_cast<double>(ticks) / elapsed_s : 0.0) << " ticks/s)\n";
+        auto lat = [&](const char* name, const LatencySummary& l) {
+            os << name << " (us, n=" << l.count << "): p50=" << l.p50 / 1e3
+               << " p90=" << l.p90 / 1e3 << " p99=" << l.p99 / 1e3 << " max=" << l.max / 1e3
+               << "\n";
+        };
+        lat("tick-to-check", tick_to_check);
+        lat("tick-to-alert", tick_to_alert);
+        for (const auto& s : stages) {
+            os << "  stage " << s.name << ": workers=" << s.workers << " batches=" << s.batches
+               << " avg_batch="
+               << (s.batches ? static_cast<double>(s.items_in) / static_cast<double>(s.batches) : 0.0)
+               << " busy_ms=" << static_cast<double>(s.busy_ns) / 1e6
+               << " in_queue_max=" << s.queue_high_water << "/" << s.queue_capacity
+               << " blocked_pushes=" << s.blocked_pushes << "\n";
+        }
+    }
+};
+
+/**
+ * @brief Replays recorded ticks through the pipeline.
+ *
+ * `ticks_per_second` paces the feed (0 replays as fast as backpressure
+ * allows). Each tick's ingest time is stamped when it enters the pipeline.
+ */
+class ReplaySource {
+public:
+    explicit ReplaySource(std::vector<QuoteTick> ticks, double ticks_per_second = 0.0)
+        : ticks_(std::move(ticks)), rate_(ticks_per_second) {}
+
+    void run(BoundedQueue<QuoteTick>& out) {
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < ticks_.size(); ++i) {
+            if (rate_ > 0.0) {
+                auto due = start + std::chrono::nanoseconds(
+                                       static_cast<std::int64_t>(1e9 * static_cast<double>(i) / rate_));
+                while (std::chrono::steady_clock::now() < due)
+                    std::this_thread::yield();
+            }
+            QuoteTick t = ticks_[i];
+            t.ingest_ns = metrics::monotonic_ns();
+            if (!out.push(t))
+                break;
+        }
+        out.close();
+    }
+
+    std::size_t size() const { return ticks_.size(); }
+
+private:
+    std::vector<QuoteTick> ticks_;
+    double rate_;
+};
+
+/**
+ * @brief Synthetic feed for replay: every symbol starts with a full grid of
+ * call quotes off a smile, followed by random single-quote updates. With
+ * probability `p_mispricing` an update overprices a call enough to break
+ * strike convexity, which the detector should flag until it is requoted.
+ */
+inline std::vector<QuoteTick> make_replay_ticks(std::size_t symbols, std::size_t maturities,
+                                                std::size_t strikes, std::size_t updates,
+                                                double p_mispricing = 0.01,
+                                                std::uint64_t seed = 42) {
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> u(0.0, 1.0);
+    const double spot = 100.0, rate = 0.01;
+
+    auto quote = [&](std::uint32_t sym, std::size_t ti, std::size_t ki, bool mispriced) {
+        double T = 0.25 * static_cast<double>(ti + 1);
+        double K = spot * (0.8 + 0.4 * static_cast<double>(ki) / static_cast<double>(std::max<std::size_t>(strikes - 1, 1)));
+        double m = std::log(K / spot);
+        double vol = 0.2 + 0.1 * m * m - 0.05 * m + 0.002 * (u(rng) - 0.5);
+        if (mispriced)
+            vol *= 1.5;
+        double px = bs_call(spot, K, T, rate, vol);
+        QuoteTick t;
+        t.symbol = sym;
+        t.strike = K;
+        t.maturity = T;
+        t.bid = px * 0.999;
+        t.ask = px * 1.001;
+        t.spot = spot;
+        t.rate = rate;
+        return t;
+    };
+
+    std::vector<QuoteTick> ticks;
+    ticks.reserve(symbols * maturities * strikes + updates);
+    for (std::uint32_t s = 0; s < symbols; ++s)
+        for (std::size_t ti = 0; ti < maturities; ++ti)
+            for (std::size_t ki = 0; ki < strikes; ++ki)
+                ticks.push_back(quote(s, ti, ki, false));
+
+    std::uniform_int_distribution<std::uint32_t> pick_sym(0, static_cast<std::uint32_t>(symbols - 1));
+    std::uniform_int_distribution<std::size_t> pick_t(0, maturities - 1);
+    std::uniform_int_distribution<std::size_t> pick_k(0, strikes - 1);
+    for (std::size_t i = 0; i < updates; ++i) {
+        std::size_t ki = pick_k(rng);
+        bool bad = u(rng) < p_mispricing && ki > 0 && ki + 1 < strikes;
+        ticks.push_back(quote(pick_sym(rng), pick_t(rng), ki, bad));
+    }
+    for (std::size_t i = 0; i < ticks.size(); ++i)
+        ticks[i].seq = i;
+    return ticks;
+}
+
+/**
+ * @brief Wires the quote → IV → surface → detection → sink stages and runs a
+ * replay through them.
+ */
+class ArbitragePipeline {
+public:
+    using AlertFn = std::function<void(const SurfaceCheck&)>;
+
+    explicit ArbitragePipeline(PipelineConfig cfg = {}) : cfg_(cfg) {}
+
+    /**
+     * @brief Replay `source` to completion. `on_alert` (optional) runs on the
+     * sink thread for every snapshot with at least one violation, in
+     * increasing version order per symbol.
+     */
+    PipelineReport run(ReplaySource& source, AlertFn on_alert = nullptr) {
+        BoundedQueue<QuoteTick> ticks_q(cfg_.queue_capacity);
+        BoundedQueue<IvTick> iv_q(cfg_.queue_capacity);
+        BoundedQueue<SurfaceSnapshot> snap_q(cfg_.queue_capacity);
+        BoundedQueue<SurfaceCheck> check_q(cfg_.queue_capacity);
+
+        std::atomic<std::uint64_t> iv_failures{0};
+        std::atomic<std::uint64_t> stale_ticks{0};
+        std::vector<std::uint64_t> check_lat, alert_lat;
+        std::uint64_t snapshots = 0, alerts = 0, stale_checks = 0;
+        std::map<std::uint32_t, std::uint64_t> delivered;  // sink: last version per symbol
+
+        auto t0 = std::chrono::steady_clock::now();
+        Pipeline p;
+
+        p.add_stage<QuoteTick, IvTick>("iv", ticks_q, &iv_q, cfg_.iv_workers, cfg_.max_batch, [&] {
+            return Pipeline::StageFn<QuoteTick, IvTick>(
+                [&](std::vector<QuoteTick>& batch, std::vector<IvTick>& out) {
+                    QF_TRACE_SCOPE_CAT("iv_batch", "pipeline");
+                    for (const auto& q : batch) {
+                        IvTick t;
+                        t.quote = q;
+                        t.converged = try_implied_vol_call(0.5 * (q.bid + q.ask), q.spot, q.strike,
+                                                           q.maturity, q.rate, t.implied_vol);
+                        if (!t.converged)
+                            iv_failures.fetch_add(1, std::memory_order_relaxed);
+                        else
+                            out.push_back(t);
+                    }
+                });
+        });
+
+        p.add_stage<IvTick, SurfaceSnapshot>("surface", iv_q, &snap_q, 1, cfg_.max_batch, [&] {
+            // Latest quote per (maturity, strike) for each symbol. Only the
+            // single surface worker touches it. The IV workers finish out of
+            // order, so a tick older (by seq) than the one already applied
+            // at its point is dropped rather than overwriting it.
+            auto surfaces = std::make_shared<std::map<std::uint32_t, Surface>>();
+            return Pipeline::StageFn<IvTick, SurfaceSnapshot>(
+                [surfaces, &stale_ticks](std::vector<IvTick>& batch,
+                                         std::vector<SurfaceSnapshot>& out) {
+                    QF_TRACE_SCOPE_CAT("surface_batch", "pipeline");
+                    std::map<std::uint32_t, std::pair<std::uint64_t, std::uint64_t>> touched;
+                    std::map<std::uint32_t, std::size_t> counts;
+                    for (const auto& t : batch) {
+                        const QuoteTick& q = t.quote;
+                        Surface& s = (*surfaces)[q.symbol];
+                        const std::pair<double, double> key{q.maturity, q.strike};
+                        auto applied = s.seq.find(key);
+                        if (applied != s.seq.end() && q.seq < applied->second) {
+                            stale_ticks.fetch_add(1, std::memory_order_relaxed);
+                            continue;
+                        }
+                        s.seq[key] = q.seq;
+                        s.grid[key] = OptionQuote{q.strike, q.maturity, t.implied_vol, 'C',
+                                                  q.bid,    q.ask,      q.spot,        q.rate};
+                        auto it = touched.find(q.symbol);
+                        if (it == touched.end())
+                            touched.emplace(q.symbol, std::make_pair(q.ingest_ns, q.ingest_ns));
+                        else {
+                            it->second.first = std::min(it->second.first, q.ingest_ns);
+                            it->second.second = std::max(it->second.second, q.ingest_ns);
+                        }
+                        ++counts[q.symbol];
+                    }
+                    // Conflate: one snapshot per touched symbol per batch.
+                    for (const auto& kv : touched) {
+                        Surface& s = (*surfaces)[kv.first];
+                        SurfaceSnapshot snap;
+                        snap.symbol = kv.first;
+                        snap.version = ++s.version;
+                        snap.quotes.reserve(s.grid.size());
+                        for (const auto& g : s.grid)
+                            snap.quotes.push_back(g.second);
+                        snap.oldest_ingest_ns = kv.second.first;
+                        snap.newest_ingest_ns = kv.second.second;
+                        snap.ticks = counts[kv.first];
+                        out.push_back(std::move(snap));
+                    }
+                });
+        });
+
+        p.add_stage<SurfaceSnapshot, SurfaceCheck>(
+            "detect", snap_q, &check_q, cfg_.detect_workers, cfg_.max_batch, [&] {
+                auto arena = std::make_shared<MonotonicArena>(256 * 1024);
+                return Pipeline::StageFn<SurfaceSnapshot, SurfaceCheck>(
+                    [arena](std::vector<SurfaceSnapshot>& batch, std::vector<SurfaceCheck>& out) {
+                        QF_TRACE_SCOPE_CAT("detect_batch", "pipeline");
+                        VolSurfaceArbitrageDetector detector;
+                        for (const auto& snap : batch) {
+                            SurfaceCheck c;
+                            c.symbol = snap.symbol;
+                            c.version = snap.version;
+                            c.found = detector.detect_arbitrage(snap.quotes, arena.get());
+                            arena->reset();
+                            c.oldest_ingest_ns = snap.oldest_ingest_ns;
+                            c.newest_ingest_ns = snap.newest_ingest_ns;
+                            c.checked_ns = metrics::monotonic_ns();
+                            out.push_back(std::move(c));
+                        }
+                    });
+            });
+
+        p.add_stage<SurfaceCheck, SurfaceCheck>("sink", check_q, nullptr, 1, cfg_.max_batch, [&] {
+            return Pipeline::StageFn<SurfaceCheck, SurfaceCheck>(
+                [&](std::vector<SurfaceCheck>& batch, std::vector<SurfaceCheck>&) {
+                    for (const auto& c : batch) {
+                        // Detect workers run in parallel, so an older version
+                        // of a symbol can arrive after a newer one.
+                        std::uint64_t& last = delivered[c.symbol];
+                        if (c.version <= last) {
+                            ++stale_checks;
+                            continue;
+                        }
+                        last = c.version;
+                        check_lat.push_back(c.checked_ns - c.oldest_ingest_ns);
+                        ++snapshots;
+                        if (c.found.empty())
+                            continue;
+                        ++alerts;
+                        // Tick to alert ends here, at delivery, not at detection.
+                        const std::uint64_t lat = metrics::monotonic_ns() - c.oldest_ingest_ns;
+                        alert_lat.push_back(lat);
+                        QF_METRIC_INC("qf_pipeline_alerts_total", "Snapshots that raised an alert");
+                        QF_METRIC_OBSERVE("qf_pipeline_tick_to_alert_seconds",
+                                          "Oldest contributing tick to alert",
+                                          ::qf::metrics::Histogram::exponential_bounds(1e-6, 2.0, 20),
+                                          1e-9 * static_cast<double>(lat));
+                        if (on_alert)
+                            on_alert(c);
+                    }
+                });
+        });
+
+        p.add_source([&] { source.run(ticks_q); });
+        p.join();
+
+        PipelineReport r;
+        r.elapsed_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        r.ticks = source.size();
+        r.iv_failures = iv_failures.load();
+        r.stale_ticks = stale_ticks.load();
+        r.stale_checks = stale_checks;
+        r.snapshots = snapshots;
+        r.alerts = alerts;
+        r.tick_to_check = LatencySummary::of(std::move(check_lat));
+        r.tick_to_alert = LatencySummary::of(std::move(alert_lat));
+        r.stages = p.stats();
+        return r;
+    }
+
+private:
+    struct Surface {
+        std::map<std::pair<double, double>, OptionQuote> grid;
+        std::map<std::pair<double, double>, std::uint64_t> seq;  // last applied per point
+        std::uint64_t version = 0;
+    };
+
+    PipelineConfig cfg_;
+};
+
+} // namespace qf
+
+#endif // QF_STREAMING_PIPELINE_H
@@ -0,0 +1,657 @@
+#ifndef QF_THREAD_POOL_H
+#define QF_THREAD_POOL_H
+
+/**
+ * @file thread_pool.h
+ * @author John Jacobson
+ * @brief Work-stealing thread pool with parallel_for / parallel_reduce.
+ *
+ * Every parallel feature in the toolkit (batch pricing, surface checks,
+ * sharded books, backtests) runs on this one scheduler instead of starting
+ * its own threads.
+ *
+ * Design:
+ *   - One Chase–Lev deque per worker. The owner pushes and pops at the
+ *     bottom (LIFO, cache-warm); idle workers steal from the top (FIFO,
+ *     the largest remaining pieces of work).
+ *   - Threads that are not workers submit through a small locked injection
+ *     queue.
+ *   - Waiting never blocks a worker: a thread waiting for a task group keeps
+ *     running other tasks, so parallel_for can be nested freely.
+ *   - Workers can be pinned to CPUs, following the process affinity mask so
+ *     cgroup / taskset limits are respected.
+ *   - parallel_reduce splits the range into chunks that depend only on the
+ *     grain size and combines partial results in chunk order, so the result
+ *     is bit-for-bit identical for any number of threads.
+ *
+ * The memory orderings in WorkStealingDeque follow Lê, Pop, Cohen and
+ * Zappa Nardelli, "Correct and Efficient Work-Stealing for Weak Memory
+ * Models" (PPoPP 2013).
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#include "trace.h"
+
+namespace qf {
+
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield" ::: "memory");
+#endif
+}
+
+// =======================
+// Tasks
+// =======================
+
+class TaskGroup;
+
+/**
+ * Type-erased unit of work. Tasks live on the stack of the thread that
+ * spawned them; that thread waits on the group before returning.
+ */
+struct Task {
+    void (*run)(Task*) = nullptr;
+    TaskGroup* group = nullptr;
+};
+
+/**
+ * Counts outstanding tasks and keeps the first exception thrown by one.
+ */
+class TaskGroup {
+public:
+    void add(std::size_t n = 1) { pending_.fetch_add(n, std::memory_order_relaxed); }
+
+    void done() { pending_.fetch_sub(1, std::memory_order_acq_rel); }
+
+    bool finished() const { return pending_.load(std::memory_order_acquire) == 0; }
+
+    void set_exception(std::exception_ptr e) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!error_)
+            error_ = std::move(e);
+    }
+
+    void rethrow_if_failed() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (error_) {
+            std::exception_ptr e = std::move(error_);
+            error_ = nullptr;
+            std::rethrow_exception(e);
+        }
+    }
+
+private:
+    std::atomic<std::size_t> pending_{0};
+    std::mutex mutex_;
+    std::exception_ptr error_;
+};
+
+inline void execute_task(Task* t) {
+    TaskGroup* g = t->group;
+    try {
+        t->run(t);
+    } catch (...) {
+        g->set_exception(std::current_exception());
+    }
+    g->done();
+}
+
+// =======================
+// Chase–Lev deque
+// =======================
+
+class WorkStealingDeque {
+public:
+    explicit WorkStealingDeque(std::int64_t log_capacity = 8) {
+        array_.store(new Array(log_capacity), std::memory_order_relaxed);
+    }
+
+    ~WorkStealingDeque() {
+        delete array_.load(std::memory_order_relaxed);
+        for (Array* a : retired_)
+            delete a;
+    }
+
+    WorkStealingDeque(const WorkStealingDeque&) = delete;
+    WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+    // Owner only.
+    void push(Task* task) {
+        std::int64_t b = bottom_.load(std::memory_order_relaxed);
+        std::int64_t t = top_.load(std::memory_order_acquire);
+        Array* a = array_.load(std::memory_order_relaxed);
+        if (b - t > a->capacity - 1)
+            a = grow(a, t, b);
+        a->put(b, task);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom_.store(b + 1, std::memory_order_relaxed);
+    }
+
+    // Owner only.
+    Task* pop() {
+        std::int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+        Array* a = array_.load(std::memory_order_relaxed);
+        bottom_.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::int64_t t = top_.load(std::memory_order_relaxed);
+
+        Task* task = nullptr;
+        if (t <= b) {
+            task = a->get(b);
+            if (t == b) {
+                // Last element: race against thieves for it.
+                if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                                  std::memory_order_relaxed))
+                    task = nullptr;
+                bottom_.store(b + 1, std::memory_order_relaxed);
+            }
+        } else {
+            bottom_.store(b + 1, std::memory_order_relaxed);
+        }
+        return task;
+    }
+
+    // Any thread.
+    Task* steal() {
+        std::int64_t t = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::int64_t b = bottom_.load(std::memory_order_acquire);
+
+        if (t < b) {
+            Array* a = array_.load(std::memory_order_acquire);
+            Task* task = a->get(t);
+            if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                              std::memory_order_relaxed))
+                return nullptr;
+            return task;
+        }
+        return nullptr;
+    }
+
+    bool empty() const {
+        std::int64_t b = bottom_.load(std::memory_order_relaxed);
+        std::int64_t t = top_.load(std::memory_order_relaxed);
+        return b <= t;
+    }
+
+private:
+    struct Array {
+        std::int64_t capacity;
+        std::int64_t mask;
+        std::unique_ptr<std::atomic<Task*>[]> slots;
+
+        explicit Array(std::int64_t log_cap)
+            : capacity(std::int64_t{1} << log_cap),
+              mask(capacity - 1),
+              slots(new std::atomic<Task*>[static_cast<std::size_t>(capacity)]) {}
+
+        Task* get(std::int64_t i) const {
+            return slots[static_cast<std::size_t>(i & mask)].load(std::memory_order_relaxed);
+        }
+
+        void put(std::int64_t i, Task* t) {
+            slots[static_cast<std::size_t>(i & mask)].store(t, std::memory_order_relaxed);
+        }
+    };
+
+    Array* grow(Array* old, std::int64_t t, std::int64_t b) {
+        std::int64_t log_cap = 0;
+        while ((std::int64_t{1} << log_cap) < old->capacity * 2)
+            ++log_cap;
+        Array* a = new Array(log_cap);
+        for (std::int64_t i = t; i < b; ++i)
+            a->put(i, old->get(i));
+        // Thieves may still read the old array, so it is retired, not freed.
+        retired_.push_back(old);
+        array_.store(a, std::memory_order_release);
+        return a;
+    }
+
+    alignas(64) std::atomic<std::int64_t> top_{0};
+    alignas(64) std::atomic<std::int64_t> bottom_{0};
+    alignas(64) std::atomic<Array*> array_{nullptr};
+    std::vector<Array*> retired_;
+};
+
+// =======================
+// Thread pool
+// =======================
+
+struct ThreadPoolOptions {
+    // Worker threads in addition to the calling thread, which also runs
+    // tasks while it waits. Defaults to hardware_concurrency() - 1.
+    std::size_t num_workers = default_workers();
+
+    // Pin worker i to the i-th CPU of the process affinity mask (or to
+    // cpus[i] when given). Linux only; ignored elsewhere.
+    bool pin_threads = false;
+    std::vector<int> cpus;
+
+    static std::size_t default_workers() {
+        unsigned hw = std::thread::hardware_concurrency();
+        return hw > 1 ? hw - 1 : 0;
+    }
+};
+
+/**
+ * @brief CPUs this process may run on, in ascending order.
+ */
+inline std::vector<int> allowed_cpus() {
+    std::vector<int> cpus;
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int c = 0; c < CPU_SETSIZE; ++c)
+            if (CPU_ISSET(c, &set))
+                cpus.push_back(c);
+    }
+#endif
+    if (cpus.empty()) {
+        unsigned hw = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned c = 0; c < hw; ++c)
+            cpus.push_back(static_cast<int>(c));
+    }
+    return cpus;
+}
+
+/**
+ * @brief Pin the calling thread to one CPU. Returns false when unsupported.
+ */
+inline bool pin_current_thread(int cpu) {
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+class ThreadPool {
+public:
+    explicit ThreadPool(ThreadPoolOptions opts = ThreadPoolOptions())
+        : opts_(std::move(opts)) {
+        std::size_t n = opts_.num_workers;
+        deques_.reserve(n);
+        for (std::size_t i = 0; i < n; ++i)
+            deques_.push_back(std::make_unique<WorkStealingDeque>());
+
+        // cpus[0] is left for the calling thread; worker i gets cpus[i + 1].
+        std::vector<int> cpus = opts_.cpus.empty() ? allowed_cpus() : opts_.cpus;
+        worker_cpus_.assign(n, -1);
+        if (opts_.pin_threads && !cpus.empty())
+            for (std::size_t i = 0; i < n; ++i)
+                worker_cpus_[i] = cpus[(i + 1) % cpus.size()];
+
+        threads_.reserve(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            int cpu = worker_cpus_[i];
+            threads_.emplace_back([this, i, cpu]() { worker_main(i, cpu); });
+        }
+    }
+
+    ~ThreadPool() {
+        running_.store(false, std::memory_order_seq_cst);
+        wake_all();
+        for (auto& t : threads_)
+            t.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    std::size_t num_workers() const { return threads_.size(); }
+
+    // Workers plus the calling thread.
+    std::size_t concurrency() const { return threads_.size() + 1; }
+
+    /**
+     * @brief CPU worker `i` is pinned to, or -1 when pinning is off.
+     */
+    int worker_cpu(std::size_t i) const { return worker_cpus_[i]; }
+
+    /**
+     * @brief Index of the calling worker in this pool, or -1 when the caller
+     * is not one of its workers.
+     */
+    int current_worker() const {
+        return (tls().pool == this) ? tls().index : -1;
+    }
+
+    /**
+     * @brief Queue a task. The caller must later wait() on task->group.
+     */
+    void spawn(Task* task) {
+        task->group->add();
+        int w = current_worker();
+        if (w >= 0) {
+            deques_[static_cast<std::size_t>(w)]->push(task);
+        } else {
+            std::lock_guard<std::mutex> lock(inject_mutex_);
+            injected_.push_back(task);
+        }
+        notify();
+    }
+
+    /**
+     * @brief Run tasks until the group is finished, then rethrow the first
+     * exception from the group, if any.
+     */
+    void wait(TaskGroup& group) {
+        int spins = 0;
+        while (!group.finished()) {
+            if (Task* t = find_task(current_worker())) {
+                execute_task(t);
+                spins = 0;
+            } else if (++spins < 64) {
+                cpu_relax();
+            } else {
+                std::this_thread::yield();
+            }
+        }
+        group.rethrow_if_failed();
+    }
+
+private:
+    struct ThreadState {
+        ThreadPool* pool = nullptr;
+        int index = -1;
+        std::uint64_t rng = 0x9E3779B97F4A7C15ull;
+    };
+
+    static ThreadState& tls() {
+        thread_local ThreadState state;
+        return state;
+    }
+
+    ThreadPoolOptions opts_;
+    std::vector<std::unique_ptr<WorkStealingDeque>> deques_;
+    std::vector<std::thread> threads_;
+    std::vector<int> worker_cpus_;
+
+    std::mutex inject_mutex_;
+    std::deque<Task*> injected_;
+
+    std::atomic<bool> running_{true};
+    std::atomic<std::uint64_t> epoch_{0};
+    std::atomic<int> sleepers_{0};
+    std::mutex sleep_mutex_;
+    std::condition_variable sleep_cv_;
+
+    Task* take_injected() {
+        std::lock_guard<std::mutex> lock(inject_mutex_);
+        if (injected_.empty())
+            return nullptr;
+        Task* t = injected_.front();
+        injected_.pop_front();
+        return t;
+    }
+
+    Task* find_task(int self) {
+        if (self >= 0) {
+            if (Task* t = deques_[static_cast<std::size_t>(self)]->pop())
+                return t;
+        }
+        if (Task* t = take_injected())
+            return t;
+
+        std::size_t n = deques_.size();
+        if (n == 0)
+            return nullptr;
+
+        // Random starting victim, then sweep all of them once.
+        std::uint64_t& x = tls().rng;
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        std::size_t start = static_cast<std::size_t>(x % n);
+        for (std::size_t k = 0; k < n; ++k) {
+            std::size_t v = (start + k) % n;
+            if (static_cast<int>(v) == self)
+                continue;
+            if (Task* t = deques_[v]->steal())
+                return t;
+        }
+        return nullptr;
+    }
+
+    void notify() {
+        epoch_.fetch_add(1, std::memory_order_seq_cst);
+        if (sleepers_.load(std::memory_order_seq_cst) > 0)
+            wake_all();
+    }
+
+    void wake_all() {
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex_);
+        }
+        sleep_cv_.notify_all();
+    }
+
+    void worker_main(std::size_t index, int cpu) {
+        ThreadState& st = tls();
+        st.pool = this;
+        st.index = static_cast<int>(index);
+        st.rng ^= (index + 1) * 0xBF58476D1CE4E5B9ull;
+
+        if (cpu >= 0)
+            pin_current_thread(cpu);
+
+        while (running_.load(std::memory_order_acquire)) {
+            std::uint64_t seen = epoch_.load(std::memory_order_seq_cst);
+
+            bool worked = false;
+            for (int spin = 0; spin < 256 && running_.load(std::memory_order_relaxed); ++spin) {
+                if (Task* t = find_task(st.index)) {
+                    execute_task(t);
+                    worked = true;
+                    break;
+                }
+                cpu_relax();
+            }
+            if (worked)
+                continue;
+
+            std::unique_lock<std::mutex> lock(sleep_mutex_);
+            sleepers_.fetch_add(1, std::memory_order_seq_cst);
+            sleep_cv_.wait(lock, [&]() {
+                return epoch_.load(std::memory_order_seq_cst) != seen ||
+                       !running_.load(std::memory_order_seq_cst);
+            });
+            sleepers_.fetch_sub(1, std::memory_order_seq_cst);
+        }
+    }
+};
+
+/**
+ * @brief Process-wide pool shared by all toolkit modules.
+ */
+inline ThreadPool& default_thread_pool() {
+    static ThreadPool pool;
+    return pool;
+}
+
+// =======================
+// parallel_for
+// =======================
+
+namespace detail {
+
+// Recursively split [lo, hi) chunks in half; the right half becomes a
+// stealable task and the left half is processed inline.
+template <typename ChunkFn>
+struct SplitTask : Task {
+    ThreadPool* pool;
+    const ChunkFn* fn;
+    std::size_t lo, hi;
+
+    static void run_split(ThreadPool& pool, const ChunkFn& fn,
+                          std::size_t lo, std::size_t hi) {
+        TaskGroup group;
+        SplitTask right;
+        bool spawned = false;
+        if (hi - lo > 1) {
+            std::size_t mid = lo + (hi - lo) / 2;
+            right.run = &SplitTask::invoke;
+            right.group = &group;
+            right.pool = &pool;
+            right.fn = &fn;
+            right.lo = mid;
+            right.hi = hi;
+            pool.spawn(&right);
+            spawned = true;
+            hi = mid;
+        }
+
+        try {
+            if (hi - lo > 1)
+                run_split(pool, fn, lo, hi);
+            else
+                fn(lo);
+        } catch (...) {
+            if (!spawned)
+                throw;
+            // The right half still references this stack frame.
+            group.set_exception(std::current_exception());
+        }
+
+        if (spawned)
+            pool.wait(group);
+    }
+
+    static void invoke(Task* t) {
+        auto* self = static_cast<SplitTask*>(t);
+        run_split(*self->pool, *self->fn, self->lo, self->hi);
+    }
+};
+
+inline std::size_t auto_grain(std::size_t n, const ThreadPool& pool) {
+    // About eight chunks per thread gives stealing room without much overhead.
+    std::size_t chunks = pool.concurrency() * 8;
+    return std::max<std::size_t>(1, (n + chunks - 1) / chunks);
+}
+
+} // namespace detail
+
+/**
+ * @brief Call body(lo, hi) over disjoint sub-ranges covering [begin, end).
+ *
+ * Sub-ranges are at most `grain` long (0 picks a grain automatically).
+ * Blocks until every sub-range has run; exceptions are rethrown here.
+ */
+template <typename Body>
+void parallel_for_range(ThreadPool& pool, std::size_t begin, std::size_t end,
+                        std::size_t grain, Body&& body) {
+    if (end <= begin)
+        return;
+    QF_TRACE_SCOPE_CAT("parallel_for", "thread_pool");
+
+    std::size_t n = end - begin;
+    if (grain == 0)
+        grain = detail::auto_grain(n, pool);
+    std::size_t chunks = (n + grain - 1) / grain;
+
+    if (chunks == 1 || pool.num_workers() == 0) {
+        body(begin, end);
+        return;
+    }
+
+    auto chunk_fn = [&](std::size_t c) {
+        std::size_t lo = begin + c * grain;
+        std::size_t hi = std::min(end, lo + grain);
+        body(lo, hi);
+    };
+    detail::SplitTask<decltype(chunk_fn)>::run_split(pool, chunk_fn, 0, chunks);
+}
+
+/**
+ * @brief Call body(i) for every i in [begin, end).
+ */
+template <typename Body>
+void parallel_for(ThreadPool& pool, std::size_t begin, std::size_t end,
+                  std::size_t grain, Body&& body) {
+    parallel_for_range(pool, begin, end, grain, [&](std::size_t lo, std::size_t hi) {
+        for (std::size_t i = lo; i < hi; ++i)
+            body(i);
+    });
+}
+
+template <typename Body>
+void parallel_for(std::size_t begin, std::size_t end, Body&& body) {
+    parallel_for(default_thread_pool(), begin, end, 0, std::forward<Body>(body));
+}
+
+// =======================
+// parallel_reduce
+// =======================
+
+/**
+ * @brief Deterministic reduction over [begin, end).
+ *
+ * The range is cut into chunks of exactly `grain` elements (the last may be
+ * shorter). Each chunk is reduced with map(lo, hi) -> T, and the partial
+ * results are folded left to right with combine(T, T) -> T starting from
+ * `identity`. Because the chunking does not depend on the number of
+ * threads, floating-point results are reproducible across machines.
+ */
+template <typename T, typename Map, typename Combine>
+T parallel_reduce(ThreadPool& pool, std::size_t begin, std::size_t end,
+                  std::size_t grain, T identity, Map&& map, Combine&& combine) {
+    if (end <= begin)
+        return identity;
+    if (grain == 0)
+        grain = 4096;
+
+    std::size_t n = end - begin;
+    std::size_t chunks = (n + grain - 1) / grain;
+    std::vector<T> partial(chunks, identity);
+
+    parallel_for(pool, 0, chunks, 1, [&](std::size_t c) {
+        std::size_t lo = begin + c * grain;
+        std::size_t hi = std::min(end, lo + grain);
+        partial[c] = map(lo, hi);
+    });
+
+    T acc = std::move(identity);
+    for (auto& p : partial)
+        acc = combine(std::move(acc), std::move(p));
+    return acc;
+}
+
+template <typename T, typename Map, typename Combine>
+T parallel_reduce(std::size_t begin, std::size_t end, std::size_t grain, T identity,
+                  Map&& map, Combine&& combine) {
+    return parallel_reduce(default_thread_pool(), begin, end, grain, std::move(identity),
+                           std::forward<Map>(map), std::forward<Combine>(combine));
+}
+
+} // namespace qf
+
+#endif // QF_THREAD_POOL_H
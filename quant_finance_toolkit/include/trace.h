@@ -0,0 +1,316 @@
+#ifndef QF_TRACE_H
+#define QF_TRACE_H
+
+/**
+ * @file trace.h
+ * @author John Jacobson
+ * @brief Low-overhead trace spans with Chrome / Perfetto trace export.
+ *
+ * When a risk run or a replay is slow, wall time alone does not say whether
+ * the time went into IV solving, surface checks or book matching. This
+ * module records named spans on a timeline that can be opened in
+ * chrome://tracing or https://ui.perfetto.dev.
+ *
+ * Design:
+ *   - Spans are compiled in only when QF_ENABLE_TRACING is defined; otherwise
+ *     QF_TRACE_SCOPE expands to nothing and costs nothing.
+ *   - Each thread writes into its own fixed-size ring buffer. The writer
+ *     never takes a lock: it fills a slot and publishes it with a release
+ *     store of the head counter. When the ring wraps, the oldest events are
+ *     overwritten.
+ *   - write_chrome_trace() may run while other threads are still recording.
+ *     It copies each ring and drops any slot that could have been
+ *     overwritten during the copy, including the one the writer may be
+ *     filling right now. Slot fields are relaxed atomics, so a torn copy
+ *     is discarded rather than being a data race.
+ *
+ * Span names must be string literals (or otherwise outlive the flush).
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifndef QF_TRACE_BUFFER_EVENTS
+#define QF_TRACE_BUFFER_EVENTS (1u << 16)  // per thread, must be a power of two
+#endif
+
+namespace qf {
+namespace trace {
+
+struct Event {
+    const char* name;
+    const char* category;
+    std::uint64_t start_ns;
+    std::uint64_t duration_ns;
+};
+
+// Write `s` as the body of a JSON string (quotes and backslashes escaped,
+// control characters as \uXXXX).
+inline void write_json_escaped(std::ostream& os, const char* s) {
+    for (; *s; ++s) {
+        char c = *s;
+        switch (c) {
+        case '"': os << "\\\""; break;
+        case '\\': os << "\\\\"; break;
+        case '\n': os << "\\n"; break;
+        case '\t': os << "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char buf[8];
+                std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                os << buf;
+            } else {
+                os << c;
+            }
+        }
+    }
+}
+
+inline std::uint64_t now_ns() {
+    using clock = std::chrono::steady_clock;
+    static const clock::time_point epoch = clock::now();
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - epoch).count());
+}
+
+// =======================
+// Per-thread ring buffer
+// =======================
+
+class ThreadBuffer {
+public:
+    static constexpr std::uint64_t capacity = QF_TRACE_BUFFER_EVENTS;
+    static_assert((capacity & (capacity - 1)) == 0, "trace buffer size must be a power of two");
+
+    explicit ThreadBuffer(std::uint32_t tid) : tid_(tid), slots_(new Slot[capacity]) {}
+
+    // Writer side: only the owning thread calls this.
+    void record(const char* name, const char* category,
+                std::uint64_t start_ns, std::uint64_t duration_ns) {
+        std::uint64_t h = head_.load(std::memory_order_relaxed);
+        Slot& s = slots_[h & (capacity - 1)];
+        s.name.store(name, std::memory_order_relaxed);
+        s.category.store(category, std::memory_order_relaxed);
+        s.start_ns.store(start_ns, std::memory_order_relaxed);
+        s.duration_ns.store(duration_ns, std::memory_order_relaxed);
+        head_.store(h + 1, std::memory_order_release);
+    }
+
+    // Reader side: copy events recorded since the last drain.
+    void drain(std::vector<Event>& out) {
+        std::uint64_t h = head_.load(std::memory_order_acquire);
+        std::uint64_t begin = read_;
+        if (h - begin > capacity)
+            begin = h - capacity;
+
+        std::size_t first = out.size();
+        for (std::uint64_t i = begin; i < h; ++i) {
+            const Slot& s = slots_[i & (capacity - 1)];
+            out.push_back(Event{s.name.load(std::memory_order_relaxed),
+                                s.category.load(std::memory_order_relaxed),
+                                s.start_ns.load(std::memory_order_relaxed),
+                                s.duration_ns.load(std::memory_order_relaxed)});
+        }
+
+        // Anything the writer may have lapped while we copied is discarded.
+        // Sequence h2 is in flight and shares its slot with h2 - capacity,
+        // so that one counts as lost too.
+        std::atomic_thread_fence(std::memory_order_acquire);
+        std::uint64_t h2 = head_.load(std::memory_order_relaxed);
+        if (h2 + 1 > capacity && h2 + 1 - capacity > begin) {
+            std::uint64_t lost = std::min(h2 + 1 - capacity - begin, h - begin);
+            out.erase(out.begin() + static_cast<std::ptrdiff_t>(first),
+                      out.begin() + static_cast<std::ptrdiff_t>(first + lost));
+        }
+        read_ = h;
+    }
+
+    void clear() { read_ = head_.load(std::memory_order_acquire); }
+
+    std::uint32_t tid() const { return tid_; }
+
+    std::string thread_name;  // guarded by the Registry mutex
+
+private:
+    struct Slot {
+        std::atomic<const char*> name{nullptr};
+        std::atomic<const char*> category{nullptr};
+        std::atomic<std::uint64_t> start_ns{0};
+        std::atomic<std::uint64_t> duration_ns{0};
+    };
+
+    std::uint32_t tid_;
+    std::unique_ptr<Slot[]> slots_;
+    std::atomic<std::uint64_t> head_{0};
+    std::uint64_t read_ = 0;  // only touched by the (locked) reader
+};
+
+// =======================
+// Registry of thread buffers
+// =======================
+
+class Registry {
+public:
+    static Registry& instance() {
+        static Registry r;
+        return r;
+    }
+
+    ThreadBuffer& local() {
+        thread_local ThreadBuffer* buf = nullptr;
+        if (!buf)
+            buf = register_thread();
+        return *buf;
+    }
+
+    /**
+     * Write every event recorded so far in Chrome trace-event JSON and
+     * consume them. Safe to call while other threads are tracing.
+     */
+    void write_chrome_trace(std::ostream& os) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        os << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+        bool first = true;
+        auto sep = [&]() {
+            if (!first) os << ",\n";
+            first = false;
+        };
+
+        std::vector<Event> events;
+        char buf[64];
+        for (auto& b : buffers_) {
+            if (!b->thread_name.empty()) {
+                sep();
+                os << "{\"ph\":\"M\",\"pid\":1,\"tid\":" << b->tid()
+                   << ",\"name\":\"thread_name\",\"args\":{\"name\":\"";
+                write_json_escaped(os, b->thread_name.c_str());
+                os << "\"}}";
+            }
+
+            events.clear();
+            b->drain(events);
+            for (const Event& e : events) {
+                sep();
+                // Chrome expects microseconds; keep ns resolution as decimals.
+                std::snprintf(buf, sizeof(buf), "%.3f", static_cast<double>(e.start_ns) / 1e3);
+                os << "{\"ph\":\"X\",\"pid\":1,\"tid\":" << b->tid()
+                   << ",\"name\":\"";
+                write_json_escaped(os, e.name);
+                os << "\",\"cat\":\"";
+                write_json_escaped(os, e.category);
+                os << "\",\"ts\":" << buf;
+                std::snprintf(buf, sizeof(buf), "%.3f", static_cast<double>(e.duration_ns) / 1e3);
+                os << ",\"dur\":" << buf << "}";
+            }
+        }
+        os << "\n]}\n";
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& b : buffers_)
+            b->clear();
+    }
+
+    // Under the mutex, since write_chrome_trace() reads names from any thread.
+    void set_thread_name(const std::string& name) {
+        ThreadBuffer& buf = local();
+        std::lock_guard<std::mutex> lock(mutex_);
+        buf.thread_name = name;
+    }
+
+private:
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers_;  // never freed: flush after thread exit works
+
+    ThreadBuffer* register_thread() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto tid = static_cast<std::uint32_t>(buffers_.size() + 1);
+        buffers_.push_back(std::make_unique<ThreadBuffer>(tid));
+        return buffers_.back().get();
+    }
+};
+
+// =======================
+// Span and public helpers
+// =======================
+
+/**
+ * RAII span: records [construction, destruction) on the calling thread.
+ */
+class Span {
+public:
+    explicit Span(const char* name, const char* category = "qf")
+        : name_(name), category_(category), start_(now_ns()) {}
+
+    ~Span() {
+        std::uint64_t end = now_ns();
+        Registry::instance().local().record(name_, category_, start_, end - start_);
+    }
+
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+
+private:
+    const char* name_;
+    const char* category_;
+    std::uint64_t start_;
+};
+
+/**
+ * @brief Label the calling thread in the trace viewer.
+ */
+inline void set_thread_name(const std::string& name) {
+    Registry::instance().set_thread_name(name);
+}
+
+inline void write_chrome_trace(std::ostream& os) {
+    Registry::instance().write_chrome_trace(os);
+}
+
+inline void write_chrome_trace(const std::string& path) {
+    std::ofstream out(path);
+    if (!out)
+        throw std::runtime_error("write_chrome_trace: cannot open " + path);
+    Registry::instance().write_chrome_trace(out);
+}
+
+inline void clear() {
+    Registry::instance().clear();
+}
+
+constexpr bool enabled() {
+#ifdef QF_ENABLE_TRACING
+    return true;
+#else
+    return false;
+#endif
+}
+
+} // namespace trace
+} // namespace qf
+
+#define QF_TRACE_CONCAT_INNER(a, b) a##b
+#define QF_TRACE_CONCAT(a, b) QF_TRACE_CONCAT_INNER(a, b)
+
+#ifdef QF_ENABLE_TRACING
+#define QF_TRACE_SCOPE(name) \
+    ::qf::trace::Span QF_TRACE_CONCAT(qf_trace_span_, __LINE__)(name)
+#define QF_TRACE_SCOPE_CAT(name, category) \
+    ::qf::trace::Span QF_TRACE_CONCAT(qf_trace_span_, __LINE__)(name, category)
+#else
+#define QF_TRACE_SCOPE(name) ((void)0)
+#define QF_TRACE_SCOPE_CAT(name, category) ((void)0)
+#endif
+
+#endif // QF_TRACE_H
@@ -16,6 +16,12 @@
  *   - Calendar spread arbitrage (time-value monotonicity)
  *
  * The implementation uses Black-Scholes call prices for internal consistency.
+ * Every quote is treated as a call; chains with puts should go through
+ * normalize_chain() in parity_normalization.h first.
+ *
+ * Scratch containers (the per-maturity grouping and sorted copies) can be
+ * placed in a caller-supplied std::pmr::memory_resource, typically a
+ * MonotonicArena that is reset after each batch of surfaces.
  */
 
 #include <vector>
@@ -23,8 +29,12 @@
 #include <cmath>
 #include <algorithm>
 #include <map>
+#include <memory_resource>
 #include <stdexcept>
 
+#include "metrics.h"
+#include "trace.h"
+
 struct OptionQuote {
     double strike;
     double maturity;   // Time to expiration in years
@@ -63,10 +73,12 @@ private:
         return S * norm_cdf(d1) - K * std::exp(-r * T) * norm_cdf(d2);
     }
 
-    bool check_butterfly(const std::vector<OptionQuote>& opts) const {
+    template <typename QuoteVec>
+    bool check_butterfly(const QuoteVec& opts) const {
         if (opts.size() < 3) return true;
 
-        auto sorted = opts;
+        std::pmr::vector<OptionQuote> sorted(opts.begin(), opts.end(),
+                                             opts.get_allocator());
         std::sort(sorted.begin(), sorted.end(),
                   [](const OptionQuote& a, const OptionQuote& b) {
                       return a.strike < b.strike;
@@ -104,10 +116,22 @@ private:
 public:
     std::vector<ArbitrageOpportunity>
     detect_arbitrage(const std::vector<OptionQuote>& quotes) const {
+        return detect_arbitrage(quotes, std::pmr::get_default_resource());
+    }
+
+    /**
+     * @brief Same as detect_arbitrage(quotes), with all scratch memory taken
+     * from `scratch`. Returned opportunities do not reference it, so the
+     * resource can be reset as soon as this returns.
+     */
+    std::vector<ArbitrageOpportunity>
+    detect_arbitrage(const std::vector<OptionQuote>& quotes,
+                     std::pmr::memory_resource* scratch) const {
+        QF_TRACE_SCOPE_CAT("detect_arbitrage", "vol_surface");
 
         std::vector<ArbitrageOpportunity> found;
 
-        std::map<double, std::vector<OptionQuote>> by_maturity;
+        std::pmr::map<double, std::pmr::vector<OptionQuote>> by_maturity(scratch);
         for (const auto& q : quotes)
             by_maturity[q.maturity].push_back(q);
 
@@ -116,7 +140,7 @@ public:
                 ArbitrageOpportunity a;
                 a.type = "BUTTERFLY";
                 a.description = "Strike convexity violation at T=" + std::to_string(kv.first);
-                a.involved = kv.second;
+                a.involved.assign(kv.second.begin(), kv.second.end());
                 found.push_back(a);
             }
         }
@@ -137,6 +161,11 @@ public:
             }
         }
 
+        QF_METRIC_INC("qf_arbitrage_snapshots_total", "Surface snapshots checked");
+        QF_METRIC_ADD("qf_arbitrage_flags_total", "Arbitrage violations flagged", found.size());
+        QF_METRIC_OBSERVE("qf_arbitrage_flags_per_snapshot", "Violations flagged per snapshot",
+                          ::qf::metrics::count_bounds(),
+                          static_cast<double>(found.size()));
         return found;
     }
 
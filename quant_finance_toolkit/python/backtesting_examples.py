@@ -7,8 +7,10 @@ Example strategies for the Backtester class.
 This file demonstrates:
     - A simple moving average crossover strategy
     - A mean-reversion z-score strategy
+    - Volatility targeting with GARCH forecasts from the C++ estimator
 
-Both return {-1, 0, 1} signals and run through the Backtester.
+The first two return {-1, 0, 1} signals. The volatility-targeted one
+returns fractional positions, which the Backtester handles the same way.
 """
 
 import numpy as np
@@ -49,7 +51,33 @@ def mean_reversion_strategy(prices, lookback=20, z_entry=1.0):
 
 
 # ============================================
-# 3. Example runner
+# 3. GARCH Volatility Targeting
+# ============================================
+
+def garch_vol_target_strategy(prices, target_vol=0.10, model="gjr", max_leverage=3.0):
+    """
+    Long position sized to target_vol annualized, using one-step-ahead
+    GARCH variances from qf_native.garch_fit (build with
+    -DQF_BUILD_PYTHON=ON and put the build directory on PYTHONPATH).
+
+    The parameters are fitted on the whole sample; refit on an expanding
+    window for an out-of-sample test.
+    """
+    import qf_native
+
+    rets = pd.Series(prices).pct_change().values[1:]
+    fit = qf_native.garch_fit(rets, model=model, filter=True)
+
+    # The Backtester applies signal[t] to the return of bar t + 1, so use
+    # the variance forecast for that bar: variance[:, 0] is aligned with
+    # rets (bar t + 1), next_variance is for the bar after the data.
+    var_next = np.append(fit["variance"][:, 0], fit["next_variance"][0])
+    vol = np.sqrt(252.0 * var_next)
+    return np.minimum(target_vol / vol, max_leverage)
+
+
+# ============================================
+# 4. Example runner
 # ============================================
 
 if __name__ == "__main__":
@@ -66,3 +94,13 @@ if __name__ == "__main__":
     bt2 = Backtester(prices, mean_reversion_strategy)
     strat_rets2, equity2, summary2 = bt2.run()
     print(summary2)
+
+    try:
+        import qf_native  # noqa: F401
+    except ImportError:
+        print("\n(qf_native not built; skipping the GARCH volatility-targeting example)")
+    else:
+        print("\n=== GARCH Volatility Targeting ===")
+        bt3 = Backtester(prices, garch_vol_target_strategy)
+        strat_rets3, equity3, summary3 = bt3.run()
+        print(summary3)
@@ -0,0 +1,1800 @@
+/**
+ * @file qf_native.cpp
+ * @author John Jacobson
+ * @brief Python extension exposing the C++ pricing, IV, surface, order book,
+ *        GARCH, portfolio and risk model code to NumPy.
+ *
+ * Calling the C++ headers once per option from Python throws away
+ * everything the C++ side is good at, so this module only exposes batch
+ * entry points:
+ *
+ *   bs_call(S, K, T, r, sigma)                  -> ndarray
+ *   bs_put(S, K, T, r, sigma)                   -> ndarray
+ *   greeks(S, K, T, r, sigma, kind="call")      -> dict of ndarrays
+ *   implied_vol(price, S, K, T, r, kind="call") -> ndarray (NaN = no convergence)
+ *   detect_arbitrage(strike, maturity, implied_vol, bid, ask, spot, rate,
+ *                    option_type=None)          -> list of dicts
+ *   OrderBook().submit(kind, side, price, qty, order_id)
+ *                                               -> (ids, ok, trades)
+ *   garch_fit(returns, model="garch", horizon=1, demean=True, warm=None,
+ *             filter=False)                     -> dict of ndarrays
+ *   mean_variance(cov, expected_returns=None, ..., warm=None)
+ *                                               -> dict (weights, ...)
+ *   risk_parity(cov, budgets=None, warm=None)   -> dict (weights, ...)
+ *   factor_risk_model(returns, exposures, weights=None, snapshot=None,
+ *                     factor_lambda=0.97, specific_lambda=0.97)
+ *                                               -> dict of ndarrays
+ *   FactorRiskModel(assets, factors).update(returns, snapshot=None)
+ *                                               -> dict of ndarrays
+ *   risk_decomposition(cov, weights)            -> dict
+ *
+ * Inputs are read through the buffer protocol, so contiguous or strided
+ * float64 arrays are used in place; scalars broadcast with stride 0. Only
+ * inputs of another dtype are converted (via numpy.asarray). Results are
+ * written straight into freshly allocated NumPy arrays. The GIL is released
+ * while the C++ code runs, and large batches are split across the shared
+ * thread pool.
+ *
+ * Written against the plain CPython API so it needs nothing beyond the
+ * Python headers to build (see QF_BUILD_PYTHON in CMakeLists.txt).
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "covariance.h"
+#include "factor_risk_model.h"
+#include "garch.h"
+#include "options_greeks.h"
+#include "orderbook_simulator.h"
+#include "parity_normalization.h"
+#include "portfolio_optimizer.h"
+#include "thread_pool.h"
+#include "vol_surface_arbitrage.h"
+
+namespace {
+
+// =======================
+// Small CPython helpers
+// =======================
+
+// Owning reference to a Python object.
+class Ref {
+public:
+    Ref() = default;
+    explicit Ref(PyObject* p) : p_(p) {}
+    ~Ref() { Py_XDECREF(p_); }
+    Ref(const Ref&) = delete;
+    Ref& operator=(const Ref&) = delete;
+    Ref(Ref&& o) noexcept : p_(o.p_) { o.p_ = nullptr; }
+    Ref& operator=(Ref&& o) noexcept {
+        std::swap(p_, o.p_);
+        return *this;
+    }
+
+    PyObject* get() const { return p_; }
+    PyObject* release() {
+        PyObject* p = p_;
+        p_ = nullptr;
+        return p;
+    }
+    explicit operator bool() const { return p_ != nullptr; }
+
+private:
+    PyObject* p_ = nullptr;
+};
+
+PyObject* numpy_attr(const char* name) {
+    static PyObject* np = nullptr;
+    if (!np) {
+        np = PyImport_ImportModule("numpy");
+        if (!np)
+            return nullptr;
+    }
+    return PyObject_GetAttrString(np, name);
+}
+
+// Elements of a 0- or 1-dimensional buffer, with the stride in elements
+// (0 for a scalar, which then broadcasts).
+template <typename T>
+class ArrayIn {
+public:
+    ArrayIn() = default;
+    ~ArrayIn() {
+        if (have_view_)
+            PyBuffer_Release(&view_);
+    }
+    ArrayIn(const ArrayIn&) = delete;
+    ArrayIn& operator=(const ArrayIn&) = delete;
+
+    /**
+     * Bind to `obj`. Float64 (or integer of the right width) arrays are
+     * used in place; anything else goes through numpy.asarray(obj, dtype).
+     */
+    bool bind(PyObject* obj, const char* name, const char* dtype) {
+        name_ = name;
+        if (!try_view(obj)) {
+            PyErr_Clear();
+            Ref asarray(numpy_attr("asarray"));
+            if (!asarray)
+                return false;
+            converted_ = Ref(PyObject_CallFunction(asarray.get(), "Os", obj, dtype));
+            if (!converted_)
+                return false;
+            if (!try_view(converted_.get())) {
+                if (!PyErr_Occurred())
+                    PyErr_Format(PyExc_TypeError, "%s: unsupported array", name);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    Py_ssize_t size() const { return size_; }
+    const T* data() const { return data_; }
+    std::ptrdiff_t stride() const { return stride_; }
+    T operator[](std::size_t i) const { return data_[static_cast<std::ptrdiff_t>(i) * stride_]; }
+    const char* name() const { return name_; }
+
+private:
+    Py_buffer view_{};
+    bool have_view_ = false;
+    Ref converted_;
+    const T* data_ = nullptr;
+    std::ptrdiff_t stride_ = 0;
+    Py_ssize_t size_ = 0;
+    const char* name_ = "";
+
+    static bool format_ok(const char* fmt) {
+        if (!fmt)
+            return false;
+        if (*fmt == '@' || *fmt == '=' || *fmt == '<')
+            ++fmt;
+        if (fmt[0] == '\0' || fmt[1] != '\0')
+            return false;
+        if (std::is_floating_point<T>::value)
+            return fmt[0] == 'd';
+        return std::strchr("bBhHiIlLqQ?", fmt[0]) != nullptr;
+    }
+
+    bool try_view(PyObject* obj) {
+        if (!PyObject_CheckBuffer(obj))
+            return false;
+        if (PyObject_GetBuffer(obj, &view_, PyBUF_STRIDES | PyBUF_FORMAT) != 0)
+            return false;
+        have_view_ = true;
+        if (!format_ok(view_.format) || view_.itemsize != static_cast<Py_ssize_t>(sizeof(T)) ||
+            view_.ndim > 1 || (view_.ndim == 1 && view_.strides[0] % view_.itemsize != 0)) {
+            PyBuffer_Release(&view_);
+            have_view_ = false;
+            return false;
+        }
+        data_ = static_cast<const T*>(view_.buf);
+        if (view_.ndim == 0) {
+            size_ = 1;
+            stride_ = 0;
+        } else {
+            size_ = view_.shape[0];
+            stride_ = view_.strides[0] / view_.itemsize;
+        }
+        return true;
+    }
+};
+
+// Python floats are not buffers; they go through numpy.asarray and come
+// back as 0-d arrays, which broadcast.
+bool bind_double(ArrayIn<double>& a, PyObject* obj, const char* name) {
+    return a.bind(obj, name, "float64");
+}
+
+/**
+ * Common length of a set of inputs: every input has that length or
+ * length 1 (broadcast). Length-1 inputs get stride 0.
+ */
+bool broadcast_size(std::initializer_list<const ArrayIn<double>*> inputs, std::size_t& n) {
+    const ArrayIn<double>* first = nullptr;
+    for (auto* a : inputs) {
+        if (a->size() == 1)
+            continue;
+        if (!first) {
+            first = a;
+        } else if (a->size() != first->size()) {
+            PyErr_Format(PyExc_ValueError, "%s has length %zd but %s has length %zd", a->name(),
+                         a->size(), first->name(), first->size());
+            return false;
+        }
+    }
+    n = first ? static_cast<std::size_t>(first->size()) : 1;
+    return true;
+}
+
+qf::StridedView view(const ArrayIn<double>& a) {
+    return qf::StridedView(a.data(), a.size() == 1 ? 0 : a.stride());
+}
+
+// New 1-d array of length n and the given dtype; `out` points at its data.
+PyObject* new_array(std::size_t n, const char* dtype, void** out) {
+    Ref empty(numpy_attr("empty"));
+    if (!empty)
+        return nullptr;
+    Ref arr(PyObject_CallFunction(empty.get(), "ns", static_cast<Py_ssize_t>(n), dtype));
+    if (!arr)
+        return nullptr;
+    Py_buffer v;
+    if (PyObject_GetBuffer(arr.get(), &v, PyBUF_WRITABLE | PyBUF_C_CONTIGUOUS) != 0)
+        return nullptr;
+    *out = v.buf;
+    PyBuffer_Release(&v);  // the array keeps the memory alive
+    return arr.release();
+}
+
+// New C-contiguous rows × cols array of the given dtype.
+PyObject* new_matrix(std::size_t rows, std::size_t cols, const char* dtype, void** out) {
+    Ref empty(numpy_attr("empty"));
+    if (!empty)
+        return nullptr;
+    Ref arr(PyObject_CallFunction(empty.get(), "(nn)s", static_cast<Py_ssize_t>(rows),
+                                  static_cast<Py_ssize_t>(cols), dtype));
+    if (!arr)
+        return nullptr;
+    Py_buffer v;
+    if (PyObject_GetBuffer(arr.get(), &v, PyBUF_WRITABLE | PyBUF_C_CONTIGUOUS) != 0)
+        return nullptr;
+    *out = v.buf;
+    PyBuffer_Release(&v);
+    return arr.release();
+}
+
+/**
+ * A float64 matrix, made C-contiguous with numpy.ascontiguousarray (a
+ * no-op for the usual C-ordered frame values). A 1-d input is one column.
+ */
+class MatrixIn {
+public:
+    MatrixIn() = default;
+    ~MatrixIn() {
+        if (have_view_)
+            PyBuffer_Release(&view_);
+    }
+    MatrixIn(const MatrixIn&) = delete;
+    MatrixIn& operator=(const MatrixIn&) = delete;
+
+    bool bind(PyObject* obj, const char* name) {
+        Ref contiguous(numpy_attr("ascontiguousarray"));
+        if (!contiguous)
+            return false;
+        arr_ = Ref(PyObject_CallFunction(contiguous.get(), "Os", obj, "float64"));
+        if (!arr_ || PyObject_GetBuffer(arr_.get(), &view_, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) != 0)
+            return false;
+        have_view_ = true;
+        if (view_.ndim < 1 || view_.ndim > 2) {
+            PyErr_Format(PyExc_ValueError, "%s must be 1- or 2-dimensional", name);
+            return false;
+        }
+        rows_ = static_cast<std::size_t>(view_.shape[0]);
+        cols_ = view_.ndim == 2 ? static_cast<std::size_t>(view_.shape[1]) : 1;
+        return true;
+    }
+
+    const double* data() const { return static_cast<const double*>(view_.buf); }
+    std::size_t rows() const { return rows_; }
+    std::size_t cols() const { return cols_; }
+
+private:
+    Py_buffer view_{};
+    bool have_view_ = false;
+    Ref arr_;
+    std::size_t rows_ = 0, cols_ = 0;
+};
+
+using Fields = std::initializer_list<std::pair<const char*, const char*>>;
+
+// New packed structured array of length n, e.g. {{"price", "<f8"}, ...}.
+PyObject* new_structured(std::size_t n, Fields fields, void** out) {
+    Ref spec(PyList_New(0));
+    if (!spec)
+        return nullptr;
+    for (const auto& f : fields) {
+        Ref item(Py_BuildValue("(ss)", f.first, f.second));
+        if (!item || PyList_Append(spec.get(), item.get()) != 0)
+            return nullptr;
+    }
+    Ref empty(numpy_attr("empty"));
+    if (!empty)
+        return nullptr;
+    Ref arr(PyObject_CallFunction(empty.get(), "nO", static_cast<Py_ssize_t>(n), spec.get()));
+    if (!arr)
+        return nullptr;
+    Py_buffer v;
+    if (PyObject_GetBuffer(arr.get(), &v, PyBUF_WRITABLE | PyBUF_C_CONTIGUOUS) != 0)
+        return nullptr;
+    *out = v.buf;
+    PyBuffer_Release(&v);
+    return arr.release();
+}
+
+// Split a batch across the shared pool; small batches run inline.
+template <typename Fn>
+void run_batch(std::size_t n, Fn&& fn) {
+    constexpr std::size_t kGrain = 4096;
+    if (n <= kGrain) {
+        fn(std::size_t{0}, n);
+        return;
+    }
+    qf::parallel_for_range(qf::default_thread_pool(), 0, n, kGrain, fn);
+}
+
+bool parse_kind(const char* kind, bool& is_call) {
+    if (std::strcmp(kind, "call") == 0 || std::strcmp(kind, "C") == 0) {
+        is_call = true;
+        return true;
+    }
+    if (std::strcmp(kind, "put") == 0 || std::strcmp(kind, "P") == 0) {
+        is_call = false;
+        return true;
+    }
+    PyErr_Format(PyExc_ValueError, "kind must be 'call' or 'put', got '%s'", kind);
+    return false;
+}
+
+// =======================
+// Pricing
+// =======================
+
+template <void (*Kernel)(std::size_t, qf::StridedView, qf::StridedView, qf::StridedView,
+                         qf::StridedView, qf::StridedView, double*)>
+PyObject* price_batch(PyObject*, PyObject* args, PyObject* kwargs) {
+    static const char* kw[] = {"S", "K", "T", "r", "sigma", nullptr};
+    PyObject *oS, *oK, *oT, *oR, *oV;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OOOOO", const_cast<char**>(kw), &oS, &oK,
+                                     &oT, &oR, &oV))
+        return nullptr;
+
+    ArrayIn<double> S, K, T, r, v;
+    std::size_t n;
+    if (!bind_double(S, oS, "S") || !bind_double(K, oK, "K") || !bind_double(T, oT, "T") ||
+        !bind_double(r, oR, "r") || !bind_double(v, oV, "sigma") ||
+        !broadcast_size({&S, &K, &T, &r, &v}, n))
+        return nullptr;
+
+    double* out;
+    PyObject* result = new_array(n, "float64", reinterpret_cast<void**>(&out));
+    if (!result)
+        return nullptr;
+
+    auto vs = view(S), vk = view(K), vt = view(T), vr = view(r), vv = view(v);
+    Py_BEGIN_ALLOW_THREADS
+    run_batch(n, [&](std::size_t lo, std::size_t hi) {
+        Kernel(hi - lo, vs.from(lo), vk.from(lo), vt.from(lo), vr.from(lo), vv.from(lo), out + lo);
+    });
+    Py_END_ALLOW_THREADS
+    return result;
+}
+
+PyObject* py_greeks(PyObject*, PyObject* args, PyObject* kwargs) {
+    static const char* kw[] = {"S", "K", "T", "r", "sigma", "kind", nullptr};
+    PyObject *oS, *oK, *oT, *oR, *oV;
+    const char* kind = "call";
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OOOOO|s", const_cast<char**>(kw), &oS, &oK,
+                                     &oT, &oR, &oV, &kind))
+        return nullptr;
+    bool is_call;
+    if (!parse_kind(kind, is_call))
+        return nullptr;
+
+    ArrayIn<double> S, K, T, r, v;
+    std::size_t n;
+    if (!bind_double(S, oS, "S") || !bind_double(K, oK, "K") || !bind_double(T, oT, "T") ||
+        !bind_double(r, oR, "r") || !bind_double(v, oV, "sigma") ||
+        !broadcast_size({&S, &K, &T, &r, &v}, n))
+        return nullptr;
+
+    static const char* names[] = {"delta", "gamma", "vega", "theta", "rho"};
+    double* ptr[5];
+    Ref dict(PyDict_New());
+    if (!dict)
+        return nullptr;
+    for (int i = 0; i < 5; ++i) {
+        Ref arr(new_array(n, "float64", reinterpret_cast<void**>(&ptr[i])));
+        if (!arr || PyDict_SetItemString(dict.get(), names[i], arr.get()) != 0)
+            return nullptr;
+    }
+
+    auto vs = view(S), vk = view(K), vt = view(T), vr = view(r), vv = view(v);
+    Py_BEGIN_ALLOW_THREADS
+    run_batch(n, [&](std::size_t lo, std::size_t hi) {
+        qf::GreeksBatchOut o;
+        o.delta = ptr[0] + lo;
+        o.gamma = ptr[1] + lo;
+        o.vega = ptr[2] + lo;
+        o.theta = ptr[3] + lo;
+        o.rho = ptr[4] + lo;
+        qf::greeks_batch(hi - lo, is_call, vs.from(lo), vk.from(lo), vt.from(lo), vr.from(lo),
+                         vv.from(lo), o);
+    });
+    Py_END_ALLOW_THREADS
+    return dict.release();
+}
+
+PyObject* py_implied_vol(PyObject*, PyObject* args, PyObject* kwargs) {
+    static const char* kw[] = {"price", "S", "K", "T", "r", "kind", "tol", "max_iter", nullptr};
+    PyObject *oP, *oS, *oK, *oT, *oR;
+    const char* kind = "call";
+    double tol = 1e-6;
+    int max_iter = 100;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OOOOO|sdi", const_cast<char**>(kw), &oP, &oS,
+                                     &oK, &oT, &oR, &kind, &tol, &max_iter))
+        return nullptr;
+    bool is_call;
+    if (!parse_kind(kind, is_call))
+        return nullptr;
+
+    ArrayIn<double> P, S, K, T, r;
+    std::size_t n;
+    if (!bind_double(P, oP, "price") || !bind_double(S, oS, "S") || !bind_double(K, oK, "K") ||
+        !bind_double(T, oT, "T") || !bind_double(r, oR, "r") ||
+        !broadcast_size({&P, &S, &K, &T, &r}, n))
+        return nullptr;
+
+    double* out;
+    PyObject* result = new_array(n, "float64", reinterpret_cast<void**>(&out));
+    if (!result)
+        return nullptr;
+
+    auto vp = view(P), vs = view(S), vk = view(K), vt = view(T), vr = view(r);
+    Py_BEGIN_ALLOW_THREADS
+    run_batch(n, [&](std::size_t lo, std::size_t hi) {
+        qf::implied_vol_batch(hi - lo, is_call, vp.from(lo), vs.from(lo), vk.from(lo),
+                              vt.from(lo), vr.from(lo), out + lo, tol, max_iter);
+    });
+    Py_END_ALLOW_THREADS
+    return result;
+}
+
+// =======================
+// Surface detector
+// =======================
+
+// Per-quote 'C' / 'P' codes: a str with one character per quote (or one
+// for all of them), or anything numpy.asarray(obj, "S1") accepts.
+bool parse_option_types(PyObject* obj, std::size_t n, std::string& codes) {
+    if (PyUnicode_Check(obj)) {
+        const char* s = PyUnicode_AsUTF8(obj);
+        if (!s)
+            return false;
+        codes = s;
+    } else {
+        Ref asarray(numpy_attr("asarray"));
+        if (!asarray)
+            return false;
+        Ref arr(PyObject_CallFunction(asarray.get(), "Os", obj, "S1"));
+        if (!arr)
+            return false;
+        Ref bytes(PyObject_CallMethod(arr.get(), "tobytes", nullptr));
+        if (!bytes)
+            return false;
+        codes.assign(PyBytes_AS_STRING(bytes.get()),
+                     static_cast<std::size_t>(PyBytes_GET_SIZE(bytes.get())));
+    }
+    if (codes.size() == 1)
+        codes.assign(n, codes[0]);
+    if (codes.size() != n) {
+        PyErr_Format(PyExc_ValueError, "option_type has length %zu but the chain has %zu quotes",
+                     codes.size(), n);
+        return false;
+    }
+    for (char& c : codes) {
+        if (c == 'c' || c == 'p')
+            c = static_cast<char>(c - 'a' + 'A');
+        if (c != 'C' && c != 'P') {
+            PyErr_SetString(PyExc_ValueError, "option_type entries must be 'C' or 'P'");
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * The detector prices every quote as a call. Without `option_type` the
+ * chain is taken as calls only; when it contains puts, the chain goes
+ * through normalize_chain() (put–call parity onto synthetic calls) and the
+ * columnar checks, so `involved` then holds the merged call rows.
+ */
+PyObject* py_detect_arbitrage(PyObject*, PyObject* args, PyObject* kwargs) {
+    static const char* kw[] = {"strike", "maturity", "implied_vol", "bid", "ask",
+                               "spot", "rate", "option_type", nullptr};
+    PyObject *oK, *oT, *oV, *oB, *oA, *oS, *oR, *oType = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OOOOOOO|O", const_cast<char**>(kw), &oK,
+                                     &oT, &oV, &oB, &oA, &oS, &oR, &oType))
+        return nullptr;
+
+    ArrayIn<double> K, T, V, B, A, S, R;
+    std::size_t n;
+    if (!bind_double(K, oK, "strike") || !bind_double(T, oT, "maturity") ||
+        !bind_double(V, oV, "implied_vol") || !bind_double(B, oB, "bid") ||
+        !bind_double(A, oA, "ask") || !bind_double(S, oS, "spot") || !bind_double(R, oR, "rate") ||
+        !broadcast_size({&K, &T, &V, &B, &A, &S, &R}, n))
+        return nullptr;
+    std::string types(n, 'C');
+    if (oType != Py_None && !parse_option_types(oType, n, types))
+        return nullptr;
+    const bool has_puts = types.find('P') != std::string::npos;
+
+    // The detector works on OptionQuote rows, so the columns are gathered
+    // once here (inside the GIL-free section).
+    std::vector<ArbitrageOpportunity> found;
+    std::string error;
+    auto vk = view(K), vt = view(T), vv = view(V), vb = view(B), va = view(A), vs = view(S),
+         vr = view(R);
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        std::vector<OptionQuote> quotes(n);
+        for (std::size_t i = 0; i < n; ++i)
+            quotes[i] = {vk[i], vt[i], vv[i], types[i], vb[i], va[i], vs[i], vr[i]};
+        if (has_puts) {
+            found = qf::detect_arbitrage(qf::normalize_chain(quotes));
+        } else {
+            VolSurfaceArbitrageDetector detector;
+            found = detector.detect_arbitrage(quotes);
+        }
+    } catch (const std::exception& e) {
+        error = e.what();
+    }
+    Py_END_ALLOW_THREADS
+    if (!error.empty()) {
+        PyErr_SetString(PyExc_RuntimeError, error.c_str());
+        return nullptr;
+    }
+
+    Ref list(PyList_New(static_cast<Py_ssize_t>(found.size())));
+    if (!list)
+        return nullptr;
+    for (std::size_t i = 0; i < found.size(); ++i) {
+        const auto& f = found[i];
+        double* rows;
+        Ref involved(new_structured(
+            f.involved.size(),
+            {{"strike", "<f8"}, {"maturity", "<f8"}, {"implied_vol", "<f8"}, {"bid", "<f8"},
+             {"ask", "<f8"}},
+            reinterpret_cast<void**>(&rows)));
+        if (!involved)
+            return nullptr;
+        for (std::size_t j = 0; j < f.involved.size(); ++j) {
+            const OptionQuote& q = f.involved[j];
+            double* row = rows + 5 * j;
+            row[0] = q.strike;
+            row[1] = q.maturity;
+            row[2] = q.implied_vol;
+            row[3] = q.bid;
+            row[4] = q.ask;
+        }
+        PyObject* d = Py_BuildValue("{s:s,s:s,s:O}", "type", f.type.c_str(), "description",
+                                    f.description.c_str(), "involved", involved.get());
+        if (!d)
+            return nullptr;
+        PyList_SET_ITEM(list.get(), static_cast<Py_ssize_t>(i), d);
+    }
+    return list.release();
+}
+
+// =======================
+// GARCH estimation
+// =======================
+
+bool parse_garch_model(const char* name, qf::GarchModel& model) {
+    if (std::strcmp(name, "garch") == 0)
+        model = qf::GarchModel::Garch;
+    else if (std::strcmp(name, "gjr") == 0)
+        model = qf::GarchModel::Gjr;
+    else if (std::strcmp(name, "egarch") == 0)
+        model = qf::GarchModel::Egarch;
+    else {
+        PyErr_Format(PyExc_ValueError, "model must be 'garch', 'gjr' or 'egarch', got '%s'", name);
+        return false;
+    }
+    return true;
+}
+
+// Yesterday's garch_fit() result as warm starts; `inverse_hessian` is optional.
+bool parse_garch_warm(PyObject* warm, std::size_t n, std::vector<qf::GarchFit>& out) {
+    if (!PyDict_Check(warm)) {
+        PyErr_SetString(PyExc_TypeError, "warm must be the dict returned by garch_fit");
+        return false;
+    }
+    out.assign(n, qf::GarchFit{});
+    static const char* names[] = {"mu", "omega", "alpha", "gamma", "beta"};
+    for (int k = 0; k < 5; ++k) {
+        PyObject* item = PyDict_GetItemString(warm, names[k]);
+        ArrayIn<double> a;
+        if (!item) {
+            PyErr_Format(PyExc_KeyError, "warm is missing '%s'", names[k]);
+            return false;
+        }
+        if (!bind_double(a, item, names[k]))
+            return false;
+        if (static_cast<std::size_t>(a.size()) != n) {
+            PyErr_Format(PyExc_ValueError, "warm['%s'] has length %zd, expected %zu", names[k],
+                         a.size(), n);
+            return false;
+        }
+        for (std::size_t i = 0; i < n; ++i) {
+            qf::GarchParams& p = out[i].params;
+            double* field[] = {&p.mu, &p.omega, &p.alpha, &p.gamma, &p.beta};
+            *field[k] = a[i];
+        }
+    }
+    if (PyObject* item = PyDict_GetItemString(warm, "inverse_hessian")) {
+        MatrixIn h;
+        if (!h.bind(item, "warm['inverse_hessian']"))
+            return false;
+        if (h.rows() != n || h.cols() != 16) {
+            PyErr_SetString(PyExc_ValueError, "warm['inverse_hessian'] must have shape (N, 16)");
+            return false;
+        }
+        for (std::size_t i = 0; i < n; ++i)
+            std::memcpy(out[i].inverse_hessian, h.data() + 16 * i, 16 * sizeof(double));
+    }
+    return true;
+}
+
+/**
+ * garch_fit(returns, model, horizon, demean, warm, filter)
+ *   returns: dates × series (T × N) float64, NaN = missing
+ * Returns a dict of per-series arrays (mu, omega, alpha, gamma, beta,
+ * log_likelihood, next_variance, iterations, status, inverse_hessian),
+ * `forecast` (N × horizon variances) and, with filter=True, `variance`:
+ * the T × N one-step-ahead conditional variances aligned with `returns`.
+ * Pass the dict back as `warm` for the next day's refit.
+ */
+PyObject* py_garch_fit(PyObject*, PyObject* args, PyObject* kwargs) {
+    static const char* kw[] = {"returns", "model", "horizon", "demean", "warm", "filter", nullptr};
+    PyObject* oR;
+    const char* model_name = "garch";
+    Py_ssize_t horizon = 1;
+    int demean = 1, filter = 0;
+    PyObject* oWarm = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|snpOp", const_cast<char**>(kw), &oR,
+                                     &model_name, &horizon, &demean, &oWarm, &filter))
+        return nullptr;
+    qf::GarchConfig cfg;
+    if (!parse_garch_model(model_name, cfg.model))
+        return nullptr;
+    cfg.demean = demean != 0;
+    if (horizon < 1) {
+        PyErr_SetString(PyExc_ValueError, "horizon must be at least 1");
+        return nullptr;
+    }
+
+    MatrixIn R;
+    if (!R.bind(oR, "returns"))
+        return nullptr;
+    const std::size_t T = R.rows(), N = R.cols();
+    const std::size_t H = static_cast<std::size_t>(horizon);
+
+    std::vector<qf::GarchFit> warm;
+    if (oWarm != Py_None && !parse_garch_warm(oWarm, N, warm))
+        return nullptr;
+
+    double *mu, *omega, *alpha, *gamma, *beta, *ll, *next, *fc, *hess, *var = nullptr;
+    std::uint32_t* iters;
+    std::uint8_t* status;
+    Ref dict(PyDict_New());
+    if (!dict)
+        return nullptr;
+    auto put = [&](const char* name, PyObject* arr) {
+        Ref r(arr);
+        return r && PyDict_SetItemString(dict.get(), name, r.get()) == 0;
+    };
+    auto vec = [&](double** p) { return new_array(N, "float64", reinterpret_cast<void**>(p)); };
+    if (!put("mu", vec(&mu)) || !put("omega", vec(&omega)) || !put("alpha", vec(&alpha)) ||
+        !put("gamma", vec(&gamma)) || !put("beta", vec(&beta)) ||
+        !put("log_likelihood", vec(&ll)) || !put("next_variance", vec(&next)) ||
+        !put("iterations", new_array(N, "uint32", reinterpret_cast<void**>(&iters))) ||
+        !put("status", new_array(N, "uint8", reinterpret_cast<void**>(&status))) ||
+        !put("inverse_hessian", new_matrix(N, 16, "float64", reinterpret_cast<void**>(&hess))) ||
+        !put("forecast", new_matrix(N, H, "float64", reinterpret_cast<void**>(&fc))))
+        return nullptr;
+    if (filter && !put("variance", new_matrix(T, N, "float64", reinterpret_cast<void**>(&var))))
+        return nullptr;
+
+    std::string error;
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        const std::vector<qf::GarchFit> fits =
+            warm.empty() ? qf::fit_garch(R.data(), T, N, N, cfg)
+                         : qf::fit_garch(R.data(), T, N, N, cfg, warm);
+        std::vector<qf::GarchParams> params(N);
+        for (std::size_t i = 0; i < N; ++i) {
+            const qf::GarchFit& f = fits[i];
+            params[i] = f.params;
+            mu[i] = f.params.mu;
+            omega[i] = f.params.omega;
+            alpha[i] = f.params.alpha;
+            gamma[i] = f.params.gamma;
+            beta[i] = f.params.beta;
+            ll[i] = f.log_likelihood;
+            next[i] = f.next_variance;
+            iters[i] = f.iterations;
+            status[i] = static_cast<std::uint8_t>(f.status);
+            std::memcpy(hess + 16 * i, f.inverse_hessian, 16 * sizeof(double));
+        }
+        qf::garch_forecast(cfg.model, fits.data(), N, H, fc);
+        if (var)
+            qf::garch_filter(cfg.model, params.data(), R.data(), T, N, N, var, N);
+    } catch (const std::exception& e) {
+        error = e.what();
+    }
+    Py_END_ALLOW_THREADS
+    if (!error.empty()) {
+        PyErr_SetString(PyExc_RuntimeError, error.c_str());
+        return nullptr;
+    }
+    return dict.release();
+}
+
+// =======================
+// Portfolio construction
+// =======================
+
+// A covariance given as an N × N matrix or as (exposures, factor_cov, specific).
+struct PortfolioCov {
+    bool factor = false;
+    qf::FactorCovariance model;
+    qf::PackedSymmetric dense;
+
+    std::size_t assets() const { return factor ? model.assets : dense.dim(); }
+};
+
+bool parse_portfolio_cov(PyObject* obj, PortfolioCov& out) {
+    if (PyTuple_Check(obj)) {
+        if (PyTuple_Size(obj) != 3) {
+            PyErr_SetString(PyExc_ValueError,
+                            "cov must be an N x N matrix or (exposures, factor_cov, specific)");
+            return false;
+        }
+        MatrixIn B, F;
+        ArrayIn<double> d;
+        if (!B.bind(PyTuple_GetItem(obj, 0), "exposures") ||
+            !F.bind(PyTuple_GetItem(obj, 1), "factor_cov") ||
+            !bind_double(d, PyTuple_GetItem(obj, 2), "specific"))
+            return false;
+        const std::size_t n = B.rows(), k = B.cols();
+        if (F.rows() != k || F.cols() != k || static_cast<std::size_t>(d.size()) != n) {
+            PyErr_SetString(PyExc_ValueError,
+                            "exposures (N x K), factor_cov (K x K) and specific (N) disagree");
+            return false;
+        }
+        out.factor = true;
+        out.model = qf::FactorCovariance(n, k);
+        std::memcpy(out.model.exposures.data(), B.data(), n * k * sizeof(double));
+        std::memcpy(out.model.factor_covariance.data(), F.data(), k * k * sizeof(double));
+        for (std::size_t i = 0; i < n; ++i)
+            out.model.specific_variance[i] = d[i];
+        return true;
+    }
+    MatrixIn C;
+    if (!C.bind(obj, "cov"))
+        return false;
+    if (C.rows() != C.cols()) {
+        PyErr_SetString(PyExc_ValueError, "cov must be square");
+        return false;
+    }
+    const std::size_t n = C.rows();
+    out.dense.resize(n);
+    for (std::size_t i = 0; i < n; ++i)
+        std::memcpy(out.dense.row(i), C.data() + i * n, (i + 1) * sizeof(double));
+    return true;
+}
+
+/**
+ * Optional per-asset input: None keeps the default, a scalar sets it, an
+ * array of length N is copied to `out`.
+ */
+bool parse_per_asset(PyObject* obj, const char* name, std::size_t n, double* scalar,
+                     std::vector<double>& out) {
+    if (obj == Py_None)
+        return true;
+    ArrayIn<double> a;
+    if (!bind_double(a, obj, name))
+        return false;
+    if (scalar && a.size() == 1 && n != 1) {
+        *scalar = a[0];
+        return true;
+    }
+    if (static_cast<std::size_t>(a.size()) != n) {
+        PyErr_Format(PyExc_ValueError, "%s has length %zd, expected %zu", name, a.size(), n);
+        return false;
+    }
+    out.resize(n);
+    for (std::size_t i = 0; i < n; ++i)
+        out[i] = a[i];
+    return true;
+}
+
+// Yesterday's result dict as a warm start: `weights`, plus `dual` and `rho` if present.
+bool parse_portfolio_warm(PyObject* warm, std::size_t n, qf::PortfolioResult& out) {
+    if (!PyDict_Check(warm)) {
+        PyErr_SetString(PyExc_TypeError, "warm must be the dict returned by the optimizer");
+        return false;
+    }
+    PyObject* w = PyDict_GetItemString(warm, "weights");
+    if (!w) {
+        PyErr_SetString(PyExc_KeyError, "warm is missing 'weights'");
+        return false;
+    }
+    if (!parse_per_asset(w, "warm['weights']", n, nullptr, out.weights))
+        return false;
+    // ADMM state is only there when mean_variance produced it; a
+    // risk_parity result carries weights alone.
+    PyObject* dual = PyDict_GetItemString(warm, "dual");
+    PyObject* rho = PyDict_GetItemString(warm, "rho");
+    if (!dual || !rho)
+        return true;
+    const Py_ssize_t len = PyObject_Length(dual);
+    const double r = len < 0 ? 0.0 : PyFloat_AsDouble(rho);
+    if (PyErr_Occurred())
+        return false;
+    if (len == 0 || r <= 0.0)
+        return true;
+    if (!parse_per_asset(dual, "warm['dual']", n, nullptr, out.dual))
+        return false;
+    out.rho = r;
+    return true;
+}
+
+// Result dict shared by mean_variance and risk_parity.
+PyObject* portfolio_dict(const qf::PortfolioResult& res) {
+    Ref dict(PyDict_New());
+    if (!dict)
+        return nullptr;
+    auto put = [&](const char* name, PyObject* value) {
+        Ref r(value);
+        return r && PyDict_SetItemString(dict.get(), name, r.get()) == 0;
+    };
+    auto vec = [](const std::vector<double>& v) {
+        double* p;
+        PyObject* arr = new_array(v.size(), "float64", reinterpret_cast<void**>(&p));
+        if (arr && !v.empty())
+            std::memcpy(p, v.data(), v.size() * sizeof(double));
+        return arr;
+    };
+    static const char* statuses[] = {"converged", "max_iterations", "infeasible"};
+    if (!res.dual.empty() &&
+        (!put("dual", vec(res.dual)) || !put("rho", PyFloat_FromDouble(res.rho))))
+        return nullptr;
+    if (!put("weights", vec(res.weights)) ||
+        !put("variance", PyFloat_FromDouble(res.variance)) ||
+        !put("expected_return", PyFloat_FromDouble(res.expected_return)) ||
+        !put("turnover", PyFloat_FromDouble(res.turnover)) ||
+        !put("iterations", PyLong_FromSize_t(res.iterations)) ||
+        !put("active_set_steps", PyLong_FromSize_t(res.active_set_steps)) ||
+        !put("status", PyUnicode_FromString(statuses[static_cast<int>(res.status)])))
+        return nullptr;
+    return dict.release();
+}
+
+/**
+ * mean_variance(cov, expected_returns, previous_weights, lower, upper,
+ *               turnover_cost, risk_aversion, budget, fully_invested, warm)
+ *   cov: N × N matrix or (exposures N × K, factor_cov K × K, specific N)
+ *   lower, upper, turnover_cost: scalars or length-N arrays
+ * Returns a dict with `weights`, `dual`, `rho`, `variance`,
+ * `expected_return`, `turnover`, `iterations`, `active_set_steps` and
+ * `status`. Pass it back as `warm` at the next rebalance. `dual` and `rho`
+ * are left out when no ADMM state was produced.
+ */
+PyObject* py_mean_variance(PyObject*, PyObject* args, PyObject* kwargs) {
+    static const char* kw[] = {"cov", "expected_returns", "previous_weights", "lower", "upper",
+                               "turnover_cost", "risk_aversion", "budget", "fully_invested",
+                               "warm", nullptr};
+    PyObject *oCov, *oAlpha = Py_None, *oPrev = Py_None, *oLo = Py_None, *oHi = Py_None,
+                    *oKappa = Py_None, *oWarm = Py_None;
+    qf::MeanVarianceConfig cfg;
+    int fully = 1;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|OOOOOddpO", const_cast<char**>(kw), &oCov,
+                                     &oAlpha, &oPrev, &oLo, &oHi, &oKappa, &cfg.risk_aversion,
+                                     &cfg.budget, &fully, &oWarm))
+        return nullptr;
+    cfg.fully_invested = fully != 0;
+
+    PortfolioCov cov;
+    if (!parse_portfolio_cov(oCov, cov))
+        return nullptr;
+    const std::size_t n = cov.assets();
+    qf::MeanVarianceProblem problem;
+    qf::PortfolioResult warm;
+    if (!parse_per_asset(oAlpha, "expected_returns", n, nullptr, problem.expected_returns) ||
+        !parse_per_asset(oPrev, "previous_weights", n, nullptr, problem.previous_weights) ||
+        !parse_per_asset(oLo, "lower", n, &cfg.lower, problem.lower) ||
+        !parse_per_asset(oHi, "upper", n, &cfg.upper, problem.upper) ||
+        !parse_per_asset(oKappa, "turnover_cost", n, &cfg.turnover_penalty,
+                         problem.turnover_cost) ||
+        (oWarm != Py_None && !parse_portfolio_warm(oWarm, n, warm)))
+        return nullptr;
+    const qf::PortfolioResult* start = oWarm != Py_None ? &warm : nullptr;
+
+    qf::PortfolioResult res;
+    std::string error;
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        res = cov.factor ? qf::optimize_mean_variance(cov.model, problem, cfg, start)
+                         : qf::optimize_mean_variance(cov.dense, problem, cfg, start);
+    } catch (const std::exception& e) {
+        error = e.what();
+    }
+    Py_END_ALLOW_THREADS
+    if (!error.empty()) {
+        PyErr_SetString(PyExc_RuntimeError, error.c_str());
+        return nullptr;
+    }
+    return portfolio_dict(res);
+}
+
+/**
+ * risk_parity(cov, budgets, warm): long-only weights summing to 1 whose
+ * risk contributions are proportional to `budgets` (equal when None).
+ * The result has no `dual` / `rho`; it can be passed back as `warm` to
+ * either optimizer.
+ */
+PyObject* py_risk_parity(PyObject*, PyObject* args, PyObject* kwargs) {
+    static const char* kw[] = {"cov", "budgets", "warm", nullptr};
+    PyObject *oCov, *oBudgets = Py_None, *oWarm = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|OO", const_cast<char**>(kw), &oCov,
+                                     &oBudgets, &oWarm))
+        return nullptr;
+    PortfolioCov cov;
+    if (!parse_portfolio_cov(oCov, cov))
+        return nullptr;
+    const std::size_t n = cov.assets();
+    std::vector<double> budgets;
+    qf::PortfolioResult warm;
+    if (!parse_per_asset(oBudgets, "budgets", n, nullptr, budgets) ||
+        (oWarm != Py_None && !parse_portfolio_warm(oWarm, n, warm)))
+        return nullptr;
+    const qf::PortfolioResult* start = oWarm != Py_None ? &warm : nullptr;
+
+    qf::PortfolioResult res;
+    std::string error;
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        res = cov.factor ? qf::risk_parity(cov.model, budgets, {}, start)
+                         : qf::risk_parity(cov.dense, budgets, {}, start);
+    } catch (const std::exception& e) {
+        error = e.what();
+    }
+    Py_END_ALLOW_THREADS
+    if (!error.empty()) {
+        PyErr_SetString(PyExc_RuntimeError, error.c_str());
+        return nullptr;
+    }
+    return portfolio_dict(res);
+}
+
+// =======================
+// Factor risk model
+// =======================
+
+/**
+ * factor_risk_model(returns, exposures, weights, snapshot, factor_lambda,
+ *                   specific_lambda)
+ *   returns: dates × assets (T × N) float64, NaN = missing
+ *   exposures: one N × K matrix, or a list of them selected per date by
+ *              `snapshot` (length T; defaults to date t → list[t] when the
+ *              list has T entries, else all 0)
+ *   weights: regression weights (N), None = equal
+ * Returns a dict with factor_returns (T × K), specific_returns (T × N),
+ * r_squared (T), factor_cov (K × K) and specific_var (N). The tuple
+ * (exposures, factor_cov, specific_var) is a `cov` for mean_variance.
+ * One-shot: the EWMA state is discarded; use the FactorRiskModel type to
+ * keep it across calls.
+ */
+PyObject* py_factor_risk_model(PyObject*, PyObject* args, PyObject* kwargs) {
+    static const char* kw[] = {"returns",  "exposures",     "weights", "snapshot",
+                               "factor_lambda", "specific_lambda", nullptr};
+    PyObject *oR, *oX, *oW = Py_None, *oSnap = Py_None;
+    qf::FactorRiskModelConfig cfg;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OO|OOdd", const_cast<char**>(kw), &oR, &oX,
+                                     &oW, &oSnap, &cfg.factor_lambda, &cfg.specific_lambda))
+        return nullptr;
+    MatrixIn R;
+    if (!R.bind(oR, "returns"))
+        return nullptr;
+    const std::size_t T = R.rows(), N = R.cols();
+
+    const bool many = PyList_Check(oX) || PyTuple_Check(oX);
+    const std::size_t S = many ? static_cast<std::size_t>(PySequence_Size(oX)) : 1;
+    if (S == 0) {
+        PyErr_SetString(PyExc_ValueError, "exposures is empty");
+        return nullptr;
+    }
+    std::vector<MatrixIn> X(S);
+    std::size_t K = 0;
+    for (std::size_t s = 0; s < S; ++s) {
+        PyObject* item = many ? PySequence_Fast_GET_ITEM(oX, static_cast<Py_ssize_t>(s)) : oX;
+        if (!X[s].bind(item, "exposures"))
+            return nullptr;
+        if (s == 0)
+            K = X[0].cols();
+        if (X[s].rows() != N || X[s].cols() != K) {
+            PyErr_Format(PyExc_ValueError, "exposures must be %zu x %zu matrices", N, K);
+            return nullptr;
+        }
+    }
+    std::vector<double> weights;
+    if (!parse_per_asset(oW, "weights", N, nullptr, weights))
+        return nullptr;
+    std::vector<std::size_t> snapshot(T, 0);
+    if (oSnap != Py_None) {
+        ArrayIn<std::int64_t> a;
+        if (!a.bind(oSnap, "snapshot", "int64"))
+            return nullptr;
+        if (static_cast<std::size_t>(a.size()) != T) {
+            PyErr_Format(PyExc_ValueError, "snapshot has length %zd, expected %zu", a.size(), T);
+            return nullptr;
+        }
+        for (std::size_t t = 0; t < T; ++t) {
+            if (a[t] < 0 || static_cast<std::size_t>(a[t]) >= S) {
+                PyErr_SetString(PyExc_ValueError, "snapshot index out of range");
+                return nullptr;
+            }
+            snapshot[t] = static_cast<std::size_t>(a[t]);
+        }
+    } else if (S == T) {
+        for (std::size_t t = 0; t < T; ++t)
+            snapshot[t] = t;
+    }
+
+    double *f, *e, *r2, *fc, *sv;
+    Ref dict(PyDict_New());
+    if (!dict)
+        return nullptr;
+    auto put = [&](const char* name, PyObject* arr) {
+        Ref r(arr);
+        return r && PyDict_SetItemString(dict.get(), name, r.get()) == 0;
+    };
+    if (!put("factor_returns", new_matrix(T, K, "float64", reinterpret_cast<void**>(&f))) ||
+        !put("specific_returns", new_matrix(T, N, "float64", reinterpret_cast<void**>(&e))) ||
+        !put("r_squared", new_array(T, "float64", reinterpret_cast<void**>(&r2))) ||
+        !put("factor_cov", new_matrix(K, K, "float64", reinterpret_cast<void**>(&fc))) ||
+        !put("specific_var", new_array(N, "float64", reinterpret_cast<void**>(&sv))))
+        return nullptr;
+
+    std::string error;
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        qf::FactorRiskModel model(N, K, cfg);
+        for (std::size_t s = 0; s < S; ++s)
+            model.add_exposures(X[s].data(), weights.empty() ? nullptr : weights.data());
+        model.update(R.data(), T, snapshot.data(), N, f, e, r2);
+        const std::vector<double> F = model.factor_covariance();
+        const std::vector<double> d = model.specific_variance();
+        std::copy(F.begin(), F.end(), fc);
+        std::copy(d.begin(), d.end(), sv);
+    } catch (const std::exception& ex) {
+        error = ex.what();
+    }
+    Py_END_ALLOW_THREADS
+    if (!error.empty()) {
+        PyErr_SetString(PyExc_RuntimeError, error.c_str());
+        return nullptr;
+    }
+    return dict.release();
+}
+
+/**
+ * risk_decomposition(cov, weights) with cov = (exposures, factor_cov,
+ * specific): dict with variance, factor_variance, specific_variance and
+ * the exposures, factor_contributions and asset_contributions arrays.
+ */
+PyObject* py_risk_decomposition(PyObject*, PyObject* args, PyObject* kwargs) {
+    static const char* kw[] = {"cov", "weights", nullptr};
+    PyObject *oCov, *oW;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OO", const_cast<char**>(kw), &oCov, &oW))
+        return nullptr;
+    PortfolioCov cov;
+    if (!parse_portfolio_cov(oCov, cov))
+        return nullptr;
+    if (!cov.factor) {
+        PyErr_SetString(PyExc_ValueError, "cov must be (exposures, factor_cov, specific)");
+        return nullptr;
+    }
+    std::vector<double> w;
+    if (!parse_per_asset(oW, "weights", cov.assets(), nullptr, w))
+        return nullptr;
+
+    qf::RiskDecomposition risk;
+    Py_BEGIN_ALLOW_THREADS
+    risk = qf::decompose_risk(cov.model, w.data());
+    Py_END_ALLOW_THREADS
+
+    Ref dict(PyDict_New());
+    if (!dict)
+        return nullptr;
+    auto put = [&](const char* name, PyObject* value) {
+        Ref r(value);
+        return r && PyDict_SetItemString(dict.get(), name, r.get()) == 0;
+    };
+    auto vec = [](const std::vector<double>& v) {
+        double* p;
+        PyObject* arr = new_array(v.size(), "float64", reinterpret_cast<void**>(&p));
+        if (arr && !v.empty())
+            std::memcpy(p, v.data(), v.size() * sizeof(double));
+        return arr;
+    };
+    if (!put("variance", PyFloat_FromDouble(risk.variance)) ||
+        !put("factor_variance", PyFloat_FromDouble(risk.factor_variance)) ||
+        !put("specific_variance", PyFloat_FromDouble(risk.specific_variance)) ||
+        !put("exposures", vec(risk.exposures)) ||
+        !put("factor_contributions", vec(risk.factor_contributions)) ||
+        !put("asset_contributions", vec(risk.asset_contributions)))
+        return nullptr;
+    return dict.release();
+}
+
+// =======================
+// OrderBook wrapper
+// =======================
+
+const Fields kTradeDtype = {{"command", "<u8"}, {"buy_id", "<u8"}, {"sell_id", "<u8"},
+                           {"price", "<f8"}, {"quantity", "<u8"}};
+const Fields kDepthDtype = {{"price", "<f8"}, {"quantity", "<u8"}, {"orders", "<u4"}};
+
+struct TradeRecord {
+    std::uint64_t command;  // index of the submitting command in the batch
+    std::uint64_t buy_id;
+    std::uint64_t sell_id;
+    double price;
+    std::uint64_t quantity;
+};
+static_assert(sizeof(TradeRecord) == 40, "TradeRecord must match kTradeDtype");
+
+struct PyOrderBook {
+    PyObject_HEAD
+    qf::OrderBook* book;
+    std::atomic<bool> busy;
+    static constexpr const char* kName = "OrderBook";
+};
+
+// The GIL is released while a batch runs, so guard against two Python
+// threads driving the same object at once. Readers take the guard too: a
+// best_bid() or depth() from another thread would otherwise walk the book
+// while submit() is changing it.
+template <typename Self>
+class BusyGuard {
+public:
+    explicit BusyGuard(Self* self) : self_(self) {
+        ok_ = !self_->busy.exchange(true);
+        if (!ok_)
+            PyErr_Format(PyExc_RuntimeError, "%s is in use by another thread", Self::kName);
+    }
+    ~BusyGuard() {
+        if (ok_)
+            self_->busy.store(false);
+    }
+    bool ok() const { return ok_; }
+
+private:
+    Self* self_;
+    bool ok_;
+};
+
+PyObject* book_new(PyTypeObject* type, PyObject*, PyObject*) {
+    auto* self = reinterpret_cast<PyOrderBook*>(type->tp_alloc(type, 0));
+    if (!self)
+        return nullptr;
+    self->book = new qf::OrderBook();
+    new (&self->busy) std::atomic<bool>(false);
+    return reinterpret_cast<PyObject*>(self);
+}
+
+void book_dealloc(PyObject* obj) {
+    auto* self = reinterpret_cast<PyOrderBook*>(obj);
+    delete self->book;
+    PyTypeObject* type = Py_TYPE(obj);
+    type->tp_free(obj);
+    Py_DECREF(type);
+}
+
+bool parse_side(long v, qf::Side& side) {
+    if (v == 0) { side = qf::Side::Buy; return true; }
+    if (v == 1) { side = qf::Side::Sell; return true; }
+    return false;
+}
+
+/**
+ * submit(kind, side, price, qty, order_id)
+ *   kind:     0 = add limit order, 1 = cancel (int array)
+ *   side:     0 = buy, 1 = sell (ignored for cancels)
+ *   price:    limit price (ignored for cancels)
+ *   qty:      quantity (ignored for cancels)
+ *   order_id: order to cancel (ignored for adds)
+ * Returns (ids, ok, trades): the ID assigned to each add (0 for cancels),
+ * the cancel results (True for adds) and all fills as a structured array
+ * whose `command` field indexes the submitting command.
+ */
+PyObject* book_submit(PyObject* obj, PyObject* args, PyObject* kwargs) {
+    auto* self = reinterpret_cast<PyOrderBook*>(obj);
+    static const char* kw[] = {"kind", "side", "price", "qty", "order_id", nullptr};
+    PyObject *oKind, *oSide, *oPrice, *oQty, *oId;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OOOOO", const_cast<char**>(kw), &oKind,
+                                     &oSide, &oPrice, &oQty, &oId))
+        return nullptr;
+
+    ArrayIn<std::int8_t> kind, side;
+    ArrayIn<double> price;
+    ArrayIn<std::uint64_t> qty, id;
+    if (!kind.bind(oKind, "kind", "int8") || !side.bind(oSide, "side", "int8") ||
+        !price.bind(oPrice, "price", "float64") || !qty.bind(oQty, "qty", "uint64") ||
+        !id.bind(oId, "order_id", "uint64"))
+        return nullptr;
+
+    Py_ssize_t len = kind.size();
+    for (Py_ssize_t s : {side.size(), price.size(), qty.size(), id.size()}) {
+        if (s != len && s != 1) {
+            PyErr_SetString(PyExc_ValueError, "submit: arrays must have equal length (or 1)");
+            return nullptr;
+        }
+    }
+    std::size_t n = static_cast<std::size_t>(len);
+    auto at = [](const auto& a, std::size_t i) { return a[a.size() == 1 ? 0 : i]; };
+
+    BusyGuard guard(self);
+    if (!guard.ok())
+        return nullptr;
+
+    std::uint64_t* ids;
+    Ref ids_arr(new_array(n, "uint64", reinterpret_cast<void**>(&ids)));
+    if (!ids_arr)
+        return nullptr;
+    bool* ok;
+    Ref ok_arr(new_array(n, "bool", reinterpret_cast<void**>(&ok)));
+    if (!ok_arr)
+        return nullptr;
+
+    std::vector<TradeRecord> records;
+    std::vector<qf::Trade> fills;
+    Py_ssize_t bad = -1;
+    Py_BEGIN_ALLOW_THREADS
+    for (std::size_t i = 0; i < n; ++i) {
+        if (at(kind, i) == 1) {
+            ids[i] = 0;
+            ok[i] = self->book->cancel_order(at(id, i));
+            continue;
+        }
+        qf::Side sd;
+        if (at(kind, i) != 0 || !parse_side(at(side, i), sd)) {
+            bad = static_cast<Py_ssize_t>(i);
+            break;
+        }
+        fills.clear();
+        ids[i] = self->book->add_limit_order(sd, at(price, i), at(qty, i), fills);
+        ok[i] = true;
+        for (const auto& t : fills)
+            records.push_back({i, t.buy_id, t.sell_id, t.price, t.quantity});
+    }
+    Py_END_ALLOW_THREADS
+    if (bad >= 0) {
+        PyErr_Format(PyExc_ValueError,
+                     "submit: command %zd has an invalid kind or side (commands before it "
+                     "were applied)", bad);
+        return nullptr;
+    }
+
+    void* tp;
+    Ref trades(new_structured(records.size(), kTradeDtype, &tp));
+    if (!trades)
+        return nullptr;
+    if (!records.empty())
+        std::memcpy(tp, records.data(), records.size() * sizeof(TradeRecord));
+
+    return PyTuple_Pack(3, ids_arr.get(), ok_arr.get(), trades.get());
+}
+
+PyObject* book_add_limit_order(PyObject* obj, PyObject* args) {
+    auto* self = reinterpret_cast<PyOrderBook*>(obj);
+    int side_v;
+    double price;
+    unsigned long long qty;
+    if (!PyArg_ParseTuple(args, "idK", &side_v, &price, &qty))
+        return nullptr;
+    qf::Side sd;
+    if (!parse_side(side_v, sd)) {
+        PyErr_SetString(PyExc_ValueError, "side must be 0 (buy) or 1 (sell)");
+        return nullptr;
+    }
+    BusyGuard guard(self);
+    if (!guard.ok())
+        return nullptr;
+    std::vector<qf::Trade> fills;
+    std::uint64_t id = self->book->add_limit_order(sd, price, qty, fills);
+
+    void* tp;
+    Ref trades(new_structured(fills.size(), kTradeDtype, &tp));
+    if (!trades)
+        return nullptr;
+    auto* rec = static_cast<TradeRecord*>(tp);
+    for (std::size_t i = 0; i < fills.size(); ++i)
+        rec[i] = {0, fills[i].buy_id, fills[i].sell_id, fills[i].price, fills[i].quantity};
+    return Py_BuildValue("(KO)", static_cast<unsigned long long>(id), trades.get());
+}
+
+PyObject* book_cancel_order(PyObject* obj, PyObject* args) {
+    auto* self = reinterpret_cast<PyOrderBook*>(obj);
+    unsigned long long id;
+    if (!PyArg_ParseTuple(args, "K", &id))
+        return nullptr;
+    BusyGuard guard(self);
+    if (!guard.ok())
+        return nullptr;
+    return PyBool_FromLong(self->book->cancel_order(id));
+}
+
+PyObject* optional_float(const std::optional<double>& v) {
+    if (!v)
+        Py_RETURN_NONE;
+    return PyFloat_FromDouble(*v);
+}
+
+PyObject* book_best_bid(PyObject* obj, PyObject*) {
+    auto* self = reinterpret_cast<PyOrderBook*>(obj);
+    BusyGuard guard(self);
+    if (!guard.ok())
+        return nullptr;
+    return optional_float(self->book->best_bid());
+}
+
+PyObject* book_best_ask(PyObject* obj, PyObject*) {
+    auto* self = reinterpret_cast<PyOrderBook*>(obj);
+    BusyGuard guard(self);
+    if (!guard.ok())
+        return nullptr;
+    return optional_float(self->book->best_ask());
+}
+
+PyObject* book_depth(PyObject* obj, PyObject* args) {
+    auto* self = reinterpret_cast<PyOrderBook*>(obj);
+    int side_v;
+    Py_ssize_t levels = 10;
+    if (!PyArg_ParseTuple(args, "i|n", &side_v, &levels))
+        return nullptr;
+    qf::Side sd;
+    if (!parse_side(side_v, sd) || levels < 0) {
+        PyErr_SetString(PyExc_ValueError, "depth(side, levels): side must be 0 or 1");
+        return nullptr;
+    }
+    std::vector<qf::DepthLevel> d;
+    {
+        BusyGuard guard(self);
+        if (!guard.ok())
+            return nullptr;
+        self->book->depth(sd, static_cast<std::size_t>(levels), d);
+    }
+
+    char* out;
+    Ref arr(new_structured(d.size(), kDepthDtype, reinterpret_cast<void**>(&out)));
+    if (!arr)
+        return nullptr;
+    for (std::size_t i = 0; i < d.size(); ++i) {
+        char* row = out + i * 20;  // packed: f8, u8, u4
+        std::memcpy(row, &d[i].price, 8);
+        std::memcpy(row + 8, &d[i].quantity, 8);
+        std::memcpy(row + 16, &d[i].orders, 4);
+    }
+    return arr.release();
+}
+
+PyObject* book_order_count(PyObject* obj, PyObject*) {
+    auto* self = reinterpret_cast<PyOrderBook*>(obj);
+    BusyGuard guard(self);
+    if (!guard.ok())
+        return nullptr;
+    return PyLong_FromSize_t(self->book->order_count());
+}
+
+PyMethodDef book_methods[] = {
+    {"submit", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)()>(book_submit)),
+     METH_VARARGS | METH_KEYWORDS,
+     "submit(kind, side, price, qty, order_id) -> (ids, ok, trades)"},
+    {"add_limit_order", book_add_limit_order, METH_VARARGS,
+     "add_limit_order(side, price, qty) -> (id, trades)"},
+    {"cancel_order", book_cancel_order, METH_VARARGS, "cancel_order(id) -> bool"},
+    {"best_bid", book_best_bid, METH_NOARGS, "best bid or None"},
+    {"best_ask", book_best_ask, METH_NOARGS, "best ask or None"},
+    {"depth", book_depth, METH_VARARGS, "depth(side, levels=10) -> structured array"},
+    {"order_count", book_order_count, METH_NOARGS, "number of resting orders"},
+    {nullptr, nullptr, 0, nullptr},
+};
+
+PyType_Slot book_slots[] = {
+    {Py_tp_new, reinterpret_cast<void*>(book_new)},
+    {Py_tp_dealloc, reinterpret_cast<void*>(book_dealloc)},
+    {Py_tp_methods, book_methods},
+    {Py_tp_doc, const_cast<char*>("Price-time priority limit order book (qf::OrderBook).")},
+    {0, nullptr},
+};
+
+PyType_Spec book_spec = {
+    "qf_native.OrderBook",
+    sizeof(PyOrderBook),
+    0,
+    Py_TPFLAGS_DEFAULT,
+    book_slots,
+};
+
+// =======================
+// FactorRiskModel
+// =======================
+
+/**
+ * Stateful counterpart of factor_risk_model(): the EWMA factor and
+ * specific risk persist between calls, so a backtest can feed one date at
+ * a time instead of re-running the whole history.
+ *
+ *   FactorRiskModel(assets, factors, factor_lambda=0.97, specific_lambda=0.97)
+ *   add_exposures(exposures, weights=None)   -> snapshot id
+ *   set_exposures(id, exposures, weights=None)
+ *   update(returns, snapshot=None)           -> dict of factor_returns,
+ *                                               specific_returns, r_squared
+ *   covariance(snapshot=None)                -> (exposures, factor_cov,
+ *                                                specific_var)
+ *
+ * `returns` is one date (N) or T × N; `snapshot` is one id for every date
+ * or one per date, the latest snapshot by default.
+ */
+struct PyRiskModel {
+    PyObject_HEAD
+    qf::FactorRiskModel* model;
+    std::atomic<bool> busy;
+    static constexpr const char* kName = "FactorRiskModel";
+};
+
+PyObject* risk_model_new(PyTypeObject* type, PyObject* args, PyObject* kwargs) {
+    static const char* kw[] = {"assets", "factors", "factor_lambda", "specific_lambda", nullptr};
+    Py_ssize_t n, k;
+    qf::FactorRiskModelConfig cfg;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "nn|dd", const_cast<char**>(kw), &n, &k,
+                                     &cfg.factor_lambda, &cfg.specific_lambda))
+        return nullptr;
+    if (n <= 0 || k <= 0) {
+        PyErr_SetString(PyExc_ValueError, "FactorRiskModel: assets and factors must be positive");
+        return nullptr;
+    }
+    auto* self = reinterpret_cast<PyRiskModel*>(type->tp_alloc(type, 0));
+    if (!self)
+        return nullptr;
+    new (&self->busy) std::atomic<bool>(false);
+    try {
+        self->model = new qf::FactorRiskModel(static_cast<std::size_t>(n),
+                                              static_cast<std::size_t>(k), cfg);
+    } catch (const std::exception& e) {
+        PyErr_SetString(PyExc_ValueError, e.what());
+        Py_DECREF(self);
+        return nullptr;
+    }
+    return reinterpret_cast<PyObject*>(self);
+}
+
+void risk_model_dealloc(PyObject* obj) {
+    auto* self = reinterpret_cast<PyRiskModel*>(obj);
+    delete self->model;
+    PyTypeObject* type = Py_TYPE(obj);
+    type->tp_free(obj);
+    Py_DECREF(type);
+}
+
+// N × K exposures and optional regression weights for `m`.
+bool bind_exposures(const qf::FactorRiskModel& m, PyObject* oX, PyObject* oW, MatrixIn& X,
+                    std::vector<double>& weights) {
+    if (!X.bind(oX, "exposures"))
+        return false;
+    if (X.rows() != m.assets() || X.cols() != m.factors()) {
+        PyErr_Format(PyExc_ValueError, "exposures must be a %zu x %zu matrix", m.assets(),
+                     m.factors());
+        return false;
+    }
+    return parse_per_asset(oW, "weights", m.assets(), nullptr, weights);
+}
+
+PyObject* risk_model_add_exposures(PyObject* obj, PyObject* args, PyObject* kwargs) {
+    auto* self = reinterpret_cast<PyRiskModel*>(obj);
+    static const char* kw[] = {"exposures", "weights", nullptr};
+    PyObject *oX, *oW = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|O", const_cast<char**>(kw), &oX, &oW))
+        return nullptr;
+    MatrixIn X;
+    std::vector<double> w;
+    if (!bind_exposures(*self->model, oX, oW, X, w))
+        return nullptr;
+    BusyGuard guard(self);
+    if (!guard.ok())
+        return nullptr;
+    std::size_t id = 0;
+    std::string error;
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        id = self->model->add_exposures(X.data(), w.empty() ? nullptr : w.data());
+    } catch (const std::exception& e) {
+        error = e.what();
+    }
+    Py_END_ALLOW_THREADS
+    if (!error.empty()) {
+        PyErr_SetString(PyExc_RuntimeError, error.c_str());
+        return nullptr;
+    }
+    return PyLong_FromSize_t(id);
+}
+
+PyObject* risk_model_set_exposures(PyObject* obj, PyObject* args, PyObject* kwargs) {
+    auto* self = reinterpret_cast<PyRiskModel*>(obj);
+    static const char* kw[] = {"id", "exposures", "weights", nullptr};
+    Py_ssize_t id;
+    PyObject *oX, *oW = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "nO|O", const_cast<char**>(kw), &id, &oX,
+                                     &oW))
+        return nullptr;
+    MatrixIn X;
+    std::vector<double> w;
+    if (!bind_exposures(*self->model, oX, oW, X, w))
+        return nullptr;
+    BusyGuard guard(self);
+    if (!guard.ok())
+        return nullptr;
+    if (id < 0 || static_cast<std::size_t>(id) >= self->model->snapshots()) {
+        PyErr_SetString(PyExc_ValueError, "set_exposures: unknown snapshot id");
+        return nullptr;
+    }
+    std::string error;
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        self->model->set_exposures(static_cast<std::size_t>(id), X.data(),
+                                   w.empty() ? nullptr : w.data());
+    } catch (const std::exception& e) {
+        error = e.what();
+    }
+    Py_END_ALLOW_THREADS
+    if (!error.empty()) {
+        PyErr_SetString(PyExc_RuntimeError, error.c_str());
+        return nullptr;
+    }
+    Py_RETURN_NONE;
+}
+
+PyObject* risk_model_update(PyObject* obj, PyObject* args, PyObject* kwargs) {
+    auto* self = reinterpret_cast<PyRiskModel*>(obj);
+    static const char* kw[] = {"returns", "snapshot", nullptr};
+    PyObject *oR, *oSnap = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|O", const_cast<char**>(kw), &oR, &oSnap))
+        return nullptr;
+    qf::FactorRiskModel& model = *self->model;
+    const std::size_t N = model.assets(), K = model.factors();
+    MatrixIn R;
+    if (!R.bind(oR, "returns"))
+        return nullptr;
+    std::size_t T;
+    if (R.cols() == N) {
+        T = R.rows();
+    } else if (R.rows() * R.cols() == N) {
+        T = 1;  // one date as a length-N vector
+    } else {
+        PyErr_Format(PyExc_ValueError, "returns must have %zu columns", N);
+        return nullptr;
+    }
+
+    BusyGuard guard(self);
+    if (!guard.ok())
+        return nullptr;
+    const std::size_t S = model.snapshots();
+    if (S == 0) {
+        PyErr_SetString(PyExc_ValueError, "update: call add_exposures first");
+        return nullptr;
+    }
+    std::vector<std::size_t> snapshot(T, S - 1);
+    if (oSnap != Py_None) {
+        ArrayIn<std::int64_t> a;
+        if (!a.bind(oSnap, "snapshot", "int64"))
+            return nullptr;
+        if (a.size() != 1 && static_cast<std::size_t>(a.size()) != T) {
+            PyErr_Format(PyExc_ValueError, "snapshot has length %zd, expected 1 or %zu", a.size(),
+                         T);
+            return nullptr;
+        }
+        for (std::size_t t = 0; t < T; ++t) {
+            const std::int64_t v = a[a.size() == 1 ? 0 : t];
+            if (v < 0 || static_cast<std::size_t>(v) >= S) {
+                PyErr_SetString(PyExc_ValueError, "snapshot index out of range");
+                return nullptr;
+            }
+            snapshot[t] = static_cast<std::size_t>(v);
+        }
+    }
+
+    double *f, *e, *r2;
+    Ref dict(PyDict_New());
+    if (!dict)
+        return nullptr;
+    auto put = [&](const char* name, PyObject* arr) {
+        Ref r(arr);
+        return r && PyDict_SetItemString(dict.get(), name, r.get()) == 0;
+    };
+    if (!put("factor_returns", new_matrix(T, K, "float64", reinterpret_cast<void**>(&f))) ||
+        !put("specific_returns", new_matrix(T, N, "float64", reinterpret_cast<void**>(&e))) ||
+        !put("r_squared", new_array(T, "float64", reinterpret_cast<void**>(&r2))))
+        return nullptr;
+
+    std::string error;
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        model.update(R.data(), T, snapshot.data(), N, f, e, r2);
+    } catch (const std::exception& ex) {
+        error = ex.what();
+    }
+    Py_END_ALLOW_THREADS
+    if (!error.empty()) {
+        PyErr_SetString(PyExc_RuntimeError, error.c_str());
+        return nullptr;
+    }
+    return dict.release();
+}
+
+PyObject* risk_model_covariance(PyObject* obj, PyObject* args, PyObject* kwargs) {
+    auto* self = reinterpret_cast<PyRiskModel*>(obj);
+    static const char* kw[] = {"snapshot", nullptr};
+    PyObject* oSnap = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|O", const_cast<char**>(kw), &oSnap))
+        return nullptr;
+    std::size_t id = std::numeric_limits<std::size_t>::max();
+    if (oSnap != Py_None) {
+        const Py_ssize_t v = PyNumber_AsSsize_t(oSnap, PyExc_OverflowError);
+        if (v == -1 && PyErr_Occurred())
+            return nullptr;
+        if (v < 0) {
+            PyErr_SetString(PyExc_ValueError, "snapshot index out of range");
+            return nullptr;
+        }
+        id = static_cast<std::size_t>(v);
+    }
+    BusyGuard guard(self);
+    if (!guard.ok())
+        return nullptr;
+    qf::FactorCovariance cov;
+    try {
+        cov = self->model->covariance(id);
+    } catch (const std::exception& e) {
+        PyErr_SetString(PyExc_ValueError, e.what());
+        return nullptr;
+    }
+
+    const std::size_t N = cov.assets, K = cov.factors;
+    double *x, *fc, *sv;
+    Ref ex(new_matrix(N, K, "float64", reinterpret_cast<void**>(&x)));
+    Ref fcov(new_matrix(K, K, "float64", reinterpret_cast<void**>(&fc)));
+    Ref spec(new_array(N, "float64", reinterpret_cast<void**>(&sv)));
+    if (!ex || !fcov || !spec)
+        return nullptr;
+    std::copy(cov.exposures.begin(), cov.exposures.end(), x);
+    std::copy(cov.factor_covariance.begin(), cov.factor_covariance.end(), fc);
+    std::copy(cov.specific_variance.begin(), cov.specific_variance.end(), sv);
+    return PyTuple_Pack(3, ex.get(), fcov.get(), spec.get());
+}
+
+PyObject* risk_model_observations(PyObject* obj, PyObject*) {
+    auto* self = reinterpret_cast<PyRiskModel*>(obj);
+    BusyGuard guard(self);
+    if (!guard.ok())
+        return nullptr;
+    return PyLong_FromSize_t(self->model->observations());
+}
+
+PyMethodDef risk_model_methods[] = {
+    {"add_exposures",
+     reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)()>(risk_model_add_exposures)),
+     METH_VARARGS | METH_KEYWORDS, "add_exposures(exposures, weights=None) -> snapshot id"},
+    {"set_exposures",
+     reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)()>(risk_model_set_exposures)),
+     METH_VARARGS | METH_KEYWORDS, "set_exposures(id, exposures, weights=None)"},
+    {"update", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)()>(risk_model_update)),
+     METH_VARARGS | METH_KEYWORDS,
+     "update(returns, snapshot=None) -> dict of factor_returns, specific_returns, r_squared"},
+    {"covariance",
+     reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)()>(risk_model_covariance)),
+     METH_VARARGS | METH_KEYWORDS,
+     "covariance(snapshot=None) -> (exposures, factor_cov, specific_var)"},
+    {"observations", risk_model_observations, METH_NOARGS, "dates absorbed so far"},
+    {nullptr, nullptr, 0, nullptr},
+};
+
+PyType_Slot risk_model_slots[] = {
+    {Py_tp_new, reinterpret_cast<void*>(risk_model_new)},
+    {Py_tp_dealloc, reinterpret_cast<void*>(risk_model_dealloc)},
+    {Py_tp_methods, risk_model_methods},
+    {Py_tp_doc, const_cast<char*>("Incremental factor risk model (qf::FactorRiskModel).")},
+    {0, nullptr},
+};
+
+PyType_Spec risk_model_spec = {
+    "qf_native.FactorRiskModel",
+    sizeof(PyRiskModel),
+    0,
+    Py_TPFLAGS_DEFAULT,
+    risk_model_slots,
+};
+
+// =======================
+// Module
+// =======================
+
+template <typename F>
+PyCFunction kw_fn(F f) {
+    return reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)()>(f));
+}
+
+PyMethodDef module_methods[] = {
+    {"bs_call", kw_fn(price_batch<qf::bs_call_batch>), METH_VARARGS | METH_KEYWORDS,
+     "bs_call(S, K, T, r, sigma) -> ndarray of call prices"},
+    {"bs_put", kw_fn(price_batch<qf::bs_put_batch>), METH_VARARGS | METH_KEYWORDS,
+     "bs_put(S, K, T, r, sigma) -> ndarray of put prices"},
+    {"greeks", kw_fn(py_greeks), METH_VARARGS | METH_KEYWORDS,
+     "greeks(S, K, T, r, sigma, kind='call') -> dict of delta/gamma/vega/theta/rho arrays"},
+    {"implied_vol", kw_fn(py_implied_vol), METH_VARARGS | METH_KEYWORDS,
+     "implied_vol(price, S, K, T, r, kind='call', tol=1e-6, max_iter=100) -> ndarray "
+     "(NaN where the solve does not converge)"},
+    {"detect_arbitrage", kw_fn(py_detect_arbitrage), METH_VARARGS | METH_KEYWORDS,
+     "detect_arbitrage(strike, maturity, implied_vol, bid, ask, spot, rate, option_type=None) -> "
+     "list of dicts; option_type is 'C'/'P' per quote (default: all calls)"},
+    {"garch_fit", kw_fn(py_garch_fit), METH_VARARGS | METH_KEYWORDS,
+     "garch_fit(returns, model='garch', horizon=1, demean=True, warm=None, filter=False) -> dict "
+     "of parameter, forecast and (with filter) conditional-variance arrays"},
+    {"mean_variance", kw_fn(py_mean_variance), METH_VARARGS | METH_KEYWORDS,
+     "mean_variance(cov, expected_returns=None, previous_weights=None, lower=0.0, upper=1.0, "
+     "turnover_cost=0.0, risk_aversion=1.0, budget=1.0, fully_invested=True, warm=None) -> dict "
+     "with weights; cov is N x N or (exposures, factor_cov, specific)"},
+    {"risk_parity", kw_fn(py_risk_parity), METH_VARARGS | METH_KEYWORDS,
+     "risk_parity(cov, budgets=None, warm=None) -> dict with weights"},
+    {"factor_risk_model", kw_fn(py_factor_risk_model), METH_VARARGS | METH_KEYWORDS,
+     "factor_risk_model(returns, exposures, weights=None, snapshot=None, factor_lambda=0.97, "
+     "specific_lambda=0.97) -> dict of factor/specific returns, factor_cov and specific_var"},
+    {"risk_decomposition", kw_fn(py_risk_decomposition), METH_VARARGS | METH_KEYWORDS,
+     "risk_decomposition(cov, weights) -> dict of factor/specific variance and contributions"},
+    {nullptr, nullptr, 0, nullptr},
+};
+
+PyModuleDef module_def = {
+    PyModuleDef_HEAD_INIT,
+    "qf_native",
+    "Batch NumPy bindings for the Quant Finance Toolkit C++ modules.",
+    -1,
+    module_methods,
+    nullptr, nullptr, nullptr, nullptr,
+};
+
+} // namespace
+
+PyMODINIT_FUNC PyInit_qf_native() {
+    Ref m(PyModule_Create(&module_def));
+    if (!m)
+        return nullptr;
+    const std::pair<PyType_Spec*, const char*> types[] = {
+        {&book_spec, "OrderBook"},
+        {&risk_model_spec, "FactorRiskModel"},
+    };
+    for (const auto& [spec, name] : types) {
+        PyObject* type = PyType_FromSpec(spec);
+        if (!type)
+            return nullptr;
+        if (PyModule_AddObject(m.get(), name, type) != 0) {
+            Py_DECREF(type);
+            return nullptr;
+        }
+    }
+    return m.release();
+}
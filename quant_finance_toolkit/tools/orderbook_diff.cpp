@@ -0,0 +1,444 @@
+/**
+ * @file orderbook_diff.cpp
+ * @author John Jacobson
+ * @brief Randomized differential test of optimized order books against qf::OrderBook.
+ *
+ * qf::OrderBook is the reference: any faster engine has to reproduce its
+ * output exactly. This tool generates seeded random command streams (passive
+ * adds, crossing orders, cancels and modifies of live, filled and unknown
+ * orders), feeds
+ * the same stream to the reference and a candidate, and after every command
+ * compares:
+ *
+ *   - the assigned order ID and the list of trades
+ *   - the result of each cancel and modify, and the trades a modify causes
+ *   - best bid / best ask and the top levels of depth on both sides
+ *   - the number of resting orders
+ *
+ * On the first mismatch the stream is cut at the failing step and shrunk
+ * with delta debugging (drop chunks while the mismatch persists, then
+ * simplify quantities), and the minimal repro is printed.
+ *
+ * Usage:
+ *   orderbook_diff [--seed S] [--runs N] [--steps N] [--depth LEVELS]
+ *                  [--engine NAME] [--self-test]
+ *
+ * Exit status: 0 when all runs agree, 1 on a mismatch, 2 on usage errors.
+ * --self-test runs against a deliberately broken engine and succeeds only
+ * if the harness catches and shrinks the bug.
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "fast_orderbook.h"
+#include "orderbook_simulator.h"
+
+namespace {
+
+using qf::DepthLevel;
+using qf::Side;
+using qf::Trade;
+
+// =======================
+// Command streams
+// =======================
+
+struct Command {
+    enum Kind { Add, Cancel, Modify } kind;
+    Side side;
+    double price;
+    std::uint64_t qty;
+    // Add: its tag (position among the adds when generated). Cancel and
+    // Modify: tag of the add to act on, or -1 for an ID that was never
+    // issued. Tags stay valid when the shrinker removes commands; a cancel
+    // whose add is gone becomes a cancel of an unknown ID.
+    std::int64_t tag;
+};
+
+/**
+ * Each run draws its own regime (price band width, cancel and crossing
+ * rates, quantity range) so that both deep books with long FIFOs and thin
+ * books that empty out often get exercised.
+ */
+std::vector<Command> generate(std::uint64_t seed, std::size_t steps) {
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> u(0.0, 1.0);
+
+    const int band = 1 + static_cast<int>(u(rng) * 40.0);   // ticks either side of mid
+    const double p_cancel = 0.05 + 0.4 * u(rng);
+    const double p_modify = 0.2 * u(rng);
+    const double p_cross = 0.02 + 0.3 * u(rng);
+    const std::uint64_t max_qty = 1 + static_cast<std::uint64_t>(u(rng) * 200.0);
+    const double tick = 0.01;
+
+    std::vector<Command> cmds;
+    cmds.reserve(steps);
+    std::vector<Command> adds_only;
+    adds_only.reserve(steps);
+    std::int64_t adds = 0;
+    int mid = 10000;  // in ticks; drifts so levels come and go
+
+    auto pick_tag = [&]() {
+        std::int64_t tag = -1;
+        if (adds > 0 && u(rng) > 0.02) {
+            // Bias towards recent adds, which are more likely to be live.
+            double r = u(rng);
+            std::int64_t back = static_cast<std::int64_t>(r * r * static_cast<double>(adds));
+            tag = adds - 1 - std::min(back, adds - 1);
+        }
+        return tag;
+    };
+
+    for (std::size_t i = 0; i < steps; ++i) {
+        double x = u(rng);
+        if (x < p_cancel) {
+            cmds.push_back({Command::Cancel, Side::Buy, 0.0, 0, pick_tag()});
+            continue;
+        }
+        if (x < p_cancel + p_modify) {
+            // Half keep the price, which exercises the in-place size cut.
+            std::int64_t tag = pick_tag();
+            Command m{Command::Modify, Side::Buy, 0.0, 0, tag};
+            if (tag >= 0) {
+                const Command& a = adds_only[static_cast<std::size_t>(tag)];
+                m.side = a.side;
+                m.price = a.price;
+                if (u(rng) < 0.5) {
+                    int ticks = static_cast<int>(std::lround(a.price / tick)) +
+                                static_cast<int>(u(rng) * (2 * band + 1)) - band;
+                    m.price = ticks * tick;
+                }
+            }
+            m.qty = (u(rng) < 0.02) ? 0 : 1 + static_cast<std::uint64_t>(u(rng) * max_qty);
+            cmds.push_back(m);
+            continue;
+        }
+
+        if (u(rng) < 0.01)
+            mid += (u(rng) < 0.5) ? -1 : 1;
+
+        Side side = (u(rng) < 0.5) ? Side::Buy : Side::Sell;
+        int offset = 1 + static_cast<int>(u(rng) * band);
+        if (u(rng) < p_cross)
+            offset = -static_cast<int>(u(rng) * (band + 1));  // at or through the far side
+        int ticks = (side == Side::Buy) ? mid - offset : mid + offset;
+        std::uint64_t qty = (u(rng) < 0.005) ? 0 : 1 + static_cast<std::uint64_t>(u(rng) * max_qty);
+
+        cmds.push_back({Command::Add, side, ticks * tick, qty, adds++});
+        adds_only.push_back(cmds.back());
+    }
+    return cmds;
+}
+
+std::string describe(const Command& c) {
+    std::ostringstream os;
+    if (c.kind == Command::Add) {
+        os << "add    " << (c.side == Side::Buy ? "buy " : "sell") << " " << c.price
+           << " x " << c.qty << "   (tag " << c.tag << ")";
+    } else if (c.kind == Command::Modify) {
+        os << "modify tag " << c.tag << " to " << c.price << " x " << c.qty;
+    } else {
+        os << "cancel tag " << c.tag;
+    }
+    return os.str();
+}
+
+// =======================
+// Differential replay
+// =======================
+
+struct Mismatch {
+    std::size_t step;
+    std::string what;
+};
+
+std::string fmt_opt(const std::optional<double>& v) {
+    return v ? std::to_string(*v) : std::string("none");
+}
+
+std::string fmt_trades(const std::vector<Trade>& t) {
+    std::ostringstream os;
+    os << "[";
+    for (std::size_t i = 0; i < t.size(); ++i)
+        os << (i ? ", " : "") << t[i].buy_id << "/" << t[i].sell_id << " " << t[i].price
+           << "x" << t[i].quantity;
+    os << "]";
+    return os.str();
+}
+
+std::string fmt_depth(const std::vector<DepthLevel>& d) {
+    std::ostringstream os;
+    os << "[";
+    for (std::size_t i = 0; i < d.size(); ++i)
+        os << (i ? ", " : "") << d[i].price << ":" << d[i].quantity << "/" << d[i].orders;
+    os << "]";
+    return os.str();
+}
+
+bool same_trades(const std::vector<Trade>& a, const std::vector<Trade>& b) {
+    if (a.size() != b.size())
+        return false;
+    for (std::size_t i = 0; i < a.size(); ++i)
+        if (a[i].buy_id != b[i].buy_id || a[i].sell_id != b[i].sell_id ||
+            a[i].price != b[i].price || a[i].quantity != b[i].quantity)
+            return false;
+    return true;
+}
+
+/**
+ * Replay `cmds` on a fresh reference book and a fresh `Candidate`, checking
+ * after every command. Returns the first mismatch, if any.
+ */
+template <typename Candidate>
+std::optional<Mismatch> run_diff(const std::vector<Command>& cmds, std::size_t depth_levels) {
+    qf::OrderBook ref;
+    Candidate cand;
+
+    std::vector<std::uint64_t> id_of_tag;
+    std::vector<Trade> tr_ref, tr_cand;
+    std::vector<DepthLevel> d_ref, d_cand;
+
+    for (std::size_t step = 0; step < cmds.size(); ++step) {
+        const Command& c = cmds[step];
+        auto fail = [&](const std::string& what) { return Mismatch{step, what}; };
+
+        if (c.kind == Command::Add) {
+            tr_ref.clear();
+            tr_cand.clear();
+            std::uint64_t a = ref.add_limit_order(c.side, c.price, c.qty, tr_ref);
+            std::uint64_t b = cand.add_limit_order(c.side, c.price, c.qty, tr_cand);
+            if (a != b)
+                return fail("order id " + std::to_string(a) + " vs " + std::to_string(b));
+            if (!same_trades(tr_ref, tr_cand))
+                return fail("trades " + fmt_trades(tr_ref) + " vs " + fmt_trades(tr_cand));
+            if (id_of_tag.size() <= static_cast<std::size_t>(c.tag))
+                id_of_tag.resize(static_cast<std::size_t>(c.tag) + 1, 0);
+            id_of_tag[static_cast<std::size_t>(c.tag)] = a;
+        } else {
+            // Tag -1, or an add the shrinker removed: an ID nobody issued.
+            std::uint64_t id = ~std::uint64_t{0};
+            if (c.tag >= 0 && static_cast<std::size_t>(c.tag) < id_of_tag.size() &&
+                id_of_tag[static_cast<std::size_t>(c.tag)] != 0)
+                id = id_of_tag[static_cast<std::size_t>(c.tag)];
+            const char* op = c.kind == Command::Modify ? "modify" : "cancel";
+            bool a, b;
+            if (c.kind == Command::Modify) {
+                tr_ref.clear();
+                tr_cand.clear();
+                a = ref.modify_order(id, c.price, c.qty, tr_ref);
+                b = cand.modify_order(id, c.price, c.qty, tr_cand);
+            } else {
+                a = ref.cancel_order(id);
+                b = cand.cancel_order(id);
+            }
+            if (a != b)
+                return fail(std::string(op) + " returned " + (a ? "true" : "false") + " vs " +
+                            (b ? "true" : "false"));
+            if (c.kind == Command::Modify && !same_trades(tr_ref, tr_cand))
+                return fail("trades " + fmt_trades(tr_ref) + " vs " + fmt_trades(tr_cand));
+        }
+
+        if (ref.best_bid() != cand.best_bid())
+            return fail("best bid " + fmt_opt(ref.best_bid()) + " vs " + fmt_opt(cand.best_bid()));
+        if (ref.best_ask() != cand.best_ask())
+            return fail("best ask " + fmt_opt(ref.best_ask()) + " vs " + fmt_opt(cand.best_ask()));
+        for (Side s : {Side::Buy, Side::Sell}) {
+            ref.depth(s, depth_levels, d_ref);
+            cand.depth(s, depth_levels, d_cand);
+            if (d_ref != d_cand)
+                return fail(std::string(s == Side::Buy ? "bid" : "ask") + " depth " +
+                            fmt_depth(d_ref) + " vs " + fmt_depth(d_cand));
+        }
+        if (ref.order_count() != cand.order_count())
+            return fail("resting orders " + std::to_string(ref.order_count()) + " vs " +
+                        std::to_string(cand.order_count()));
+    }
+    return std::nullopt;
+}
+
+// =======================
+// Shrinking
+// =======================
+
+using Oracle = std::function<std::optional<Mismatch>(const std::vector<Command>&)>;
+
+/**
+ * Delta debugging (ddmin): remove ever smaller chunks of the stream while
+ * it still fails, then try to simplify each remaining add's quantity.
+ */
+std::vector<Command> shrink(std::vector<Command> cmds, const Oracle& fails) {
+    if (auto m = fails(cmds))
+        cmds.resize(m->step + 1);
+
+    std::size_t n = 2;
+    while (cmds.size() >= 2) {
+        std::size_t chunk = (cmds.size() + n - 1) / n;
+        bool reduced = false;
+        for (std::size_t start = 0; start < cmds.size(); start += chunk) {
+            std::vector<Command> rest;
+            rest.reserve(cmds.size());
+            rest.insert(rest.end(), cmds.begin(), cmds.begin() + static_cast<std::ptrdiff_t>(start));
+            std::size_t stop = std::min(cmds.size(), start + chunk);
+            rest.insert(rest.end(), cmds.begin() + static_cast<std::ptrdiff_t>(stop), cmds.end());
+            if (auto m = fails(rest)) {
+                rest.resize(std::min(rest.size(), m->step + 1));
+                cmds = std::move(rest);
+                n = std::max<std::size_t>(n - 1, 2);
+                reduced = true;
+                break;
+            }
+        }
+        if (!reduced) {
+            if (n >= cmds.size())
+                break;
+            n = std::min(cmds.size(), n * 2);
+        }
+    }
+
+    for (auto& c : cmds) {
+        if (c.kind == Command::Cancel || c.qty <= 1)
+            continue;
+        std::uint64_t saved = c.qty;
+        c.qty = 1;
+        if (!fails(cmds))
+            c.qty = saved;
+    }
+    return cmds;
+}
+
+// =======================
+// Engines under test
+// =======================
+
+// Deliberately wrong engine for --self-test: quietly ignores cancels of even
+// order IDs while reporting success. The smallest repro is two adds and a
+// cancel.
+class BrokenCancelBook : public qf::FastOrderBook {
+public:
+    bool cancel_order(std::uint64_t id) {
+        if (id % 2 == 0 && id < next_order_id())
+            return true;
+        return qf::FastOrderBook::cancel_order(id);
+    }
+};
+
+struct Engine {
+    const char* name;
+    std::function<std::optional<Mismatch>(const std::vector<Command>&, std::size_t)> run;
+};
+
+std::vector<Engine> engines() {
+    return {
+        {"fast", [](const std::vector<Command>& c, std::size_t d) { return run_diff<qf::FastOrderBook>(c, d); }},
+        {"broken_cancel", [](const std::vector<Command>& c, std::size_t d) { return run_diff<BrokenCancelBook>(c, d); }},
+    };
+}
+
+void usage(const char* argv0) {
+    std::cerr
+        << "usage: " << argv0 << " [options]\n"
+        << "  --seed S        first seed (default 1); run r uses seed S + r\n"
+        << "  --runs N        number of independent streams (default 20)\n"
+        << "  --steps N       commands per stream (default 100000)\n"
+        << "  --depth LEVELS  depth levels compared per side (default 5)\n"
+        << "  --engine NAME   engine to test (default fast)\n"
+        << "  --self-test     check that a known-broken engine is caught\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::uint64_t seed = 1;
+    std::size_t runs = 20;
+    std::size_t steps = 100000;
+    std::size_t depth_levels = 5;
+    std::string engine_name = "fast";
+    bool self_test = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next = [&]() -> const char* {
+            if (i + 1 >= argc) {
+                std::cerr << "missing value for " << arg << "\n";
+                std::exit(2);
+            }
+            return argv[++i];
+        };
+
+        if (arg == "--seed") seed = std::strtoull(next(), nullptr, 10);
+        else if (arg == "--runs") runs = std::strtoull(next(), nullptr, 10);
+        else if (arg == "--steps") steps = std::strtoull(next(), nullptr, 10);
+        else if (arg == "--depth") depth_levels = std::strtoull(next(), nullptr, 10);
+        else if (arg == "--engine") engine_name = next();
+        else if (arg == "--self-test") self_test = true;
+        else if (arg == "--help" || arg == "-h") { usage(argv[0]); return 0; }
+        else {
+            std::cerr << "unknown option: " << arg << "\n";
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (self_test)
+        engine_name = "broken_cancel";
+
+    const Engine* engine = nullptr;
+    static const std::vector<Engine> all = engines();
+    for (const auto& e : all)
+        if (engine_name == e.name)
+            engine = &e;
+    if (!engine) {
+        std::cerr << "unknown engine: " << engine_name << "\n";
+        return 2;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::size_t total = 0;
+
+    for (std::size_t r = 0; r < runs; ++r) {
+        std::uint64_t s = seed + r;
+        auto cmds = generate(s, steps);
+        auto m = engine->run(cmds, depth_levels);
+        total += m ? m->step + 1 : cmds.size();
+        if (!m)
+            continue;
+
+        std::printf("MISMATCH engine=%s seed=%llu step=%zu: %s\n", engine->name,
+                    static_cast<unsigned long long>(s), m->step, m->what.c_str());
+
+        auto oracle = [&](const std::vector<Command>& c) { return engine->run(c, depth_levels); };
+        auto minimal = shrink(cmds, oracle);
+        auto mm = oracle(minimal);
+        std::printf("minimal repro (%zu commands):\n", minimal.size());
+        for (const auto& c : minimal)
+            std::printf("  %s\n", describe(c).c_str());
+        if (mm)
+            std::printf("  -> step %zu: %s\n", mm->step, mm->what.c_str());
+
+        if (self_test) {
+            bool ok = mm && minimal.size() <= 3;
+            std::printf("self-test %s\n", ok ? "passed" : "FAILED");
+            return ok ? 0 : 1;
+        }
+        return 1;
+    }
+
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (self_test) {
+        std::printf("self-test FAILED: broken engine was not caught\n");
+        return 1;
+    }
+    std::printf("engine=%s runs=%zu steps=%zu: no mismatches (%.1fM steps/min)\n", engine->name,
+                runs, total, secs > 0 ? 60.0 * static_cast<double>(total) / secs / 1e6 : 0.0);
+    return 0;
+}